@@ -6,6 +6,7 @@
 #define ZCASH_AMQP_AMQPABSTRACTNOTIFIER_H
 
 #include "amqpconfig.h"
+#include "notificationstream.h"
 
 class CBlockIndex;
 class AMQPAbstractNotifier;
@@ -34,6 +35,7 @@ public:
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyEvent(const CNotificationEventRef &event);
 
 protected:
     std::string type;
@@ -10,14 +10,17 @@
 #include "streams.h"
 #include "util.h"
 
+#include <boost/bind/bind.hpp>
+
+using namespace boost::placeholders;
+
 // AMQP 1.0 Support
 //
-// The boost::signals2 signals and slot system is thread safe, so CValidationInterface listeners
-// can be invoked from any thread.
+// CValidationInterface listeners can be invoked from any thread.
 //
-// Currently signals are fired from main.cpp so the callbacks should be invoked on the same thread.
-// It should be safe to share objects responsible for sending, as they should not be run concurrently
-// across different threads.
+// This interface is not synchronous, so its callbacks are invoked in order by the validation
+// queue thread. It should be safe to share objects responsible for sending, as they should not
+// be run concurrently across different threads.
 //
 // Developers should be mindful of where notifications are fired to avoid potential race conditions.
 // For example, different signals targeting the same address could be fired from different threads
@@ -49,6 +52,7 @@ AMQPNotificationInterface* AMQPNotificationInterface::CreateWithArguments(const
     factories["pubhashtx"] = AMQPAbstractNotifier::Create<AMQPPublishHashTransactionNotifier>;
     factories["pubrawblock"] = AMQPAbstractNotifier::Create<AMQPPublishRawBlockNotifier>;
     factories["pubrawtx"] = AMQPAbstractNotifier::Create<AMQPPublishRawTransactionNotifier>;
+    factories["pubevents"] = AMQPAbstractNotifier::Create<AMQPPublishEventNotifier>;
 
     for (std::map<std::string, AMQPNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i) {
         std::map<std::string, std::string>::const_iterator j = args.find("-amqp" + i->first);
@@ -95,6 +99,10 @@ bool AMQPNotificationInterface::Initialize()
         return false;
     }
 
+    if (pnotificationStream) {
+        pnotificationStream->EventPublished.connect(boost::bind(&AMQPNotificationInterface::NotifyEvent, this, _1));
+    }
+
     return true;
 }
 
@@ -103,6 +111,10 @@ void AMQPNotificationInterface::Shutdown()
 {
     LogPrint("amqp", "amqp: Shutdown notification interface\n");
 
+    if (pnotificationStream) {
+        pnotificationStream->EventPublished.disconnect(boost::bind(&AMQPNotificationInterface::NotifyEvent, this, _1));
+    }
+
     for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ++i) {
         AMQPAbstractNotifier *notifier = *i;
         notifier->Shutdown();
@@ -134,3 +146,15 @@ void AMQPNotificationInterface::SyncTransaction(const CTransaction &tx, const CB
         }
     }
 }
+
+// Called by the notification stream, in sequence order. A notifier failing to
+// send an event is kept, its subscribers see the gap in the sequence numbers.
+void AMQPNotificationInterface::NotifyEvent(const CNotificationEventRef &event)
+{
+    for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ++i) {
+        AMQPAbstractNotifier *notifier = *i;
+        if (!notifier->NotifyEvent(event)) {
+            LogPrint("amqp", "amqp: Notifier %s failed to send event %d\n", notifier->GetType(), event->nSequence);
+        }
+    }
+}
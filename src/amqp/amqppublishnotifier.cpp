@@ -128,6 +128,40 @@ bool AMQPAbstractPublishNotifier::SendMessage(const char *command, const void* d
     return true;
 }
 
+// Events carry the sequence number of the notification stream instead of the
+// one of this notifier, so that the subscribers can tell which events they missed.
+bool AMQPAbstractPublishNotifier::SendEvent(const CNotificationEventRef &event)
+{
+    try {
+        proton::binary content;
+        content.assign(event->payload.begin(), event->payload.end());
+
+        proton::message message(content);
+        message.subject(event->topic);
+        proton::message::property_map & props = message.properties();
+        props.put("x-opt-sequence-number", event->nSequence);
+        handler_->publish(message);
+
+    } catch (proton::error_condition &e) {
+        LogPrint("amqp", "amqp: error : %s\n", e.what());
+        return false;
+    }
+    catch (const std::runtime_error &e) {
+        LogPrint("amqp", "amqp: runtime error: %s\n", e.what());
+        return false;
+    }
+    catch (const std::exception &e) {
+        LogPrint("amqp", "amqp: exception: %s\n", e.what());
+        return false;
+    }
+    catch (...) {
+        LogPrint("amqp", "amqp: unknown error\n");
+        return false;
+    }
+
+    return true;
+}
+
 bool AMQPPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     uint256 hash = pindex->GetBlockHash();
@@ -175,3 +209,9 @@ bool AMQPPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool AMQPPublishEventNotifier::NotifyEvent(const CNotificationEventRef &event)
+{
+    LogPrint("amqp", "amqp: Publish event %s %d\n", event->topic, event->nSequence);
+    return SendEvent(event);
+}
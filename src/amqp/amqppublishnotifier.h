@@ -24,6 +24,7 @@ private:
 
 public:
     bool SendMessage(const char *command, const void* data, size_t size);
+    bool SendEvent(const CNotificationEventRef &event);
     bool Initialize();
     void Shutdown();
     void SpawnProtonContainer();
@@ -53,4 +54,10 @@ public:
     bool NotifyTransaction(const CTransaction &transaction);
 };
 
+class AMQPPublishEventNotifier : public AMQPAbstractPublishNotifier
+{
+public:
+    bool NotifyEvent(const CNotificationEventRef &event);
+};
+
 #endif // ZCASH_AMQP_AMQPPUBLISHNOTIFIER_H
@@ -0,0 +1,66 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockdownload.h"
+
+#include <algorithm>
+
+/** Weight of a new sample in the moving averages */
+static const double RATE_SAMPLE_WEIGHT = 0.25;
+/** How many times its usual delay a peer may take before its blocks are asked elsewhere */
+static const int OVERDUE_FACTOR = 4;
+
+CBlockDownloadRate::CBlockDownloadRate() :
+    dDelay(0), dServiceTime(0), nLastDelivery(0), nDelivered(0), nReassigned(0) {}
+
+void CBlockDownloadRate::AddSample(double nDelaySample, double nServiceSample)
+{
+    if (dServiceTime <= 0) {
+        dDelay = nDelaySample;
+        dServiceTime = nServiceSample;
+        return;
+    }
+    dDelay += RATE_SAMPLE_WEIGHT * (nDelaySample - dDelay);
+    dServiceTime += RATE_SAMPLE_WEIGHT * (nServiceSample - dServiceTime);
+}
+
+void CBlockDownloadRate::Delivered(int64_t nRequestTime, int64_t nNow)
+{
+    // With the request already pending at the previous delivery the peer was busy
+    // since then, otherwise it was idle until the request
+    int64_t nServiceStart = std::max(nRequestTime, nLastDelivery);
+    AddSample(std::max<int64_t>(nNow - nRequestTime, 1), std::max<int64_t>(nNow - nServiceStart, 1));
+    nLastDelivery = nNow;
+    nDelivered++;
+}
+
+void CBlockDownloadRate::Reassigned(int64_t nRequestTime, int64_t nNow)
+{
+    // The block is still missing, the peer is at least this slow
+    int64_t nLate = std::max<int64_t>(nNow - std::max(nRequestTime, nLastDelivery), 1);
+    AddSample(std::max<int64_t>(nNow - nRequestTime, 1), nLate);
+    nReassigned++;
+}
+
+int CBlockDownloadRate::GetWindow() const
+{
+    if (dServiceTime <= 0)
+        return DEFAULT_BLOCKS_IN_TRANSIT_PER_PEER;
+    double dWindow = BLOCK_DOWNLOAD_TARGET_TIME / dServiceTime;
+    return (int)std::max<double>(MIN_BLOCKS_IN_TRANSIT_PER_PEER, std::min<double>(MAX_BLOCKS_IN_TRANSIT_PER_PEER, dWindow));
+}
+
+bool CBlockDownloadRate::IsOverdue(int64_t nRequestTime, int64_t nNow) const
+{
+    // Either nothing arrived from the peer for a while, or it keeps sending other blocks but not this one
+    int64_t nIdle = nNow - std::max(nRequestTime, nLastDelivery);
+    int64_t nAge = nNow - nRequestTime;
+    return nIdle > std::max<double>(BLOCK_REASSIGN_MIN_DELAY, OVERDUE_FACTOR * dServiceTime) ||
+           nAge > std::max<double>(BLOCK_REASSIGN_MIN_DELAY, OVERDUE_FACTOR * dDelay);
+}
+
+bool CBlockDownloadRate::IsExpectedWithin(int64_t nDelay) const
+{
+    return nDelivered > 0 && dDelay < nDelay;
+}
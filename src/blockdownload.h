@@ -0,0 +1,63 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKDOWNLOAD_H
+#define BITCOIN_BLOCKDOWNLOAD_H
+
+#include <stdint.h>
+
+/** Number of blocks that can be in flight from a peer whose delivery rate is not measured yet. */
+static const int DEFAULT_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Bounds of the number of blocks in flight from a peer, once sized from its delivery rate. */
+static const int MIN_BLOCKS_IN_TRANSIT_PER_PEER = 2;
+static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 64;
+/** A peer is asked for as many blocks as it is expected to deliver in this time, in microseconds. */
+static const int64_t BLOCK_DOWNLOAD_TARGET_TIME = 2 * 1000000;
+/** A block is never asked to another peer before it has been pending this long, in microseconds. */
+static const int64_t BLOCK_REASSIGN_MIN_DELAY = 2 * 1000000;
+
+/**
+ * Block delivery rate of a peer, sizing how many blocks are requested from it.
+ *
+ * Each delivery updates moving averages of the delay between a request and
+ * its block, and of the service time: how long the peer takes for each block
+ * while it has requests pending. The peer is then kept busy with as many
+ * blocks as it delivers in BLOCK_DOWNLOAD_TARGET_TIME, so fast links get a
+ * deep queue while a slow peer only holds a few blocks, which faster peers
+ * take over once it is late with them.
+ */
+class CBlockDownloadRate
+{
+public:
+    CBlockDownloadRate();
+
+    //! A block requested at nRequestTime arrived at nNow, in microseconds
+    void Delivered(int64_t nRequestTime, int64_t nNow);
+    //! A block requested at nRequestTime was asked to another peer at nNow
+    void Reassigned(int64_t nRequestTime, int64_t nNow);
+
+    //! Number of blocks that may be in flight from the peer
+    int GetWindow() const;
+    //! Whether a block requested at nRequestTime is late enough to be asked to another peer
+    bool IsOverdue(int64_t nRequestTime, int64_t nNow) const;
+    //! Whether the peer is expected to deliver a block requested now within nDelay microseconds
+    bool IsExpectedWithin(int64_t nDelay) const;
+
+    //! Average delay and service time in microseconds, 0 until measured
+    int64_t GetDelay() const { return (int64_t)dDelay; }
+    int64_t GetServiceTime() const { return (int64_t)dServiceTime; }
+    uint64_t GetDelivered() const { return nDelivered; }
+    uint64_t GetReassigned() const { return nReassigned; }
+
+private:
+    double dDelay;
+    double dServiceTime;
+    int64_t nLastDelivery;
+    uint64_t nDelivered;
+    uint64_t nReassigned;
+
+    void AddSample(double nDelaySample, double nServiceSample);
+};
+
+#endif // BITCOIN_BLOCKDOWNLOAD_H
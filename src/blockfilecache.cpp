@@ -0,0 +1,238 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilecache.h"
+
+#include "chainparams.h"
+#include "crypto/common.h"
+#include "main.h"
+#include "protocol.h"
+#include "util.h"
+
+#include <string.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <univalue.h>
+
+CBlockFileCache blockFileCache;
+
+CMappedBlockFile::~CMappedBlockFile()
+{
+#ifndef WIN32
+    munmap(const_cast<char*>(pdata), nSize);
+#endif
+}
+
+std::shared_ptr<const CMappedBlockFile> CMappedBlockFile::Open(const CDiskBlockPos& pos, const char* prefix)
+{
+#ifndef WIN32
+    boost::filesystem::path path = GetBlockPosFilename(pos, prefix);
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return nullptr;
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping outlives the descriptor
+    close(fd);
+    if (p == MAP_FAILED)
+        return nullptr;
+    return std::shared_ptr<const CMappedBlockFile>(new CMappedBlockFile(static_cast<const char*>(p), st.st_size));
+#else
+    return nullptr;
+#endif
+}
+
+UniValue CBlockFileCacheStats::ToJSON() const
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("hits", nBlockHits);
+    obj.pushKV("misses", nBlockMisses);
+    obj.pushKV("blocks", (uint64_t)nCachedBlocks);
+    obj.pushKV("bytes", (uint64_t)nCachedBytes);
+    obj.pushKV("mappedreads", nMappedReads);
+    obj.pushKV("filereads", nFileReads);
+    obj.pushKV("bytesread", nBytesRead);
+    obj.pushKV("maps", nMaps);
+    obj.pushKV("mappedfiles", (uint64_t)nMappedFiles);
+    obj.pushKV("mappedbytes", (uint64_t)nMappedBytes);
+    return obj;
+}
+
+CBlockFileCache::CBlockFileCache() : nMaxBlockBytes(DEFAULT_BLOCK_READ_CACHE << 20) {}
+
+void CBlockFileCache::SetMaxBlockBytes(size_t nMaxBytes)
+{
+    LOCK(cs);
+    nMaxBlockBytes = nMaxBytes;
+    while (stats.nCachedBytes > nMaxBlockBytes) {
+        stats.nCachedBytes -= lruBlocks.back().second.nSize;
+        mapBlocks.erase(lruBlocks.back().first);
+        lruBlocks.pop_back();
+    }
+    stats.nCachedBlocks = lruBlocks.size();
+}
+
+std::shared_ptr<const CMappedBlockFile> CBlockFileCache::GetFile(const CDiskBlockPos& pos, const char* prefix, size_t nMinSize)
+{
+    AssertLockHeld(cs);
+    FileKey key(pos.nFile, prefix[0]);
+    for (auto it = lruFiles.begin(); it != lruFiles.end(); ++it) {
+        if (it->first != key)
+            continue;
+        if (it->second->size() >= nMinSize) {
+            lruFiles.splice(lruFiles.begin(), lruFiles, it);
+            return it->second;
+        }
+        // The file grew since it was mapped, readers still holding the old mapping keep it alive
+        stats.nMappedBytes -= it->second->size();
+        lruFiles.erase(it);
+        break;
+    }
+
+    std::shared_ptr<const CMappedBlockFile> file = CMappedBlockFile::Open(pos, prefix);
+    if (!file)
+        return nullptr;
+    stats.nMaps++;
+    stats.nMappedBytes += file->size();
+    lruFiles.push_front(std::make_pair(key, file));
+    while (lruFiles.size() > MAX_MAPPED_BLOCK_FILES) {
+        stats.nMappedBytes -= lruFiles.back().second->size();
+        lruFiles.pop_back();
+    }
+    stats.nMappedFiles = lruFiles.size();
+    return file->size() >= nMinSize ? file : nullptr;
+}
+
+bool CBlockFileCache::ReadBytes(const CDiskBlockPos& pos, const char* prefix, size_t nTrailer, CBlockFileBytes& bytes)
+{
+    // Records are preceded by the network magic and their size
+    static const size_t nHeaderSize = MESSAGE_START_SIZE + sizeof(uint32_t);
+    if (pos.IsNull() || pos.nPos < nHeaderSize)
+        return false;
+
+    LOCK(cs);
+    std::shared_ptr<const CMappedBlockFile> file = GetFile(pos, prefix, pos.nPos);
+    if (!file)
+        return false;
+    const char* pheader = file->data() + pos.nPos - nHeaderSize;
+    if (memcmp(pheader, Params().MessageStart(), MESSAGE_START_SIZE) != 0)
+        return false;
+    size_t nSize = ReadLE32(reinterpret_cast<const unsigned char*>(pheader + MESSAGE_START_SIZE)) + nTrailer;
+    if (file->size() - pos.nPos < nSize) {
+        file = GetFile(pos, prefix, pos.nPos + nSize);
+        if (!file)
+            return false;
+    }
+
+#ifndef WIN32
+    // Read ahead the whole record instead of faulting it in page by page
+    static const uintptr_t nPageMask = sysconf(_SC_PAGESIZE) - 1;
+    uintptr_t nStart = reinterpret_cast<uintptr_t>(file->data() + pos.nPos) & ~nPageMask;
+    posix_madvise(reinterpret_cast<void*>(nStart), reinterpret_cast<uintptr_t>(file->data() + pos.nPos + nSize) - nStart,
+                  POSIX_MADV_WILLNEED);
+#endif
+
+    bytes = CBlockFileBytes(file, file->data() + pos.nPos, nSize);
+    stats.nMappedReads++;
+    stats.nBytesRead += nSize;
+    return true;
+}
+
+bool CBlockFileCache::ReadBlockBytes(const CDiskBlockPos& pos, CBlockFileBytes& bytes)
+{
+    return ReadBytes(pos, "blk", 0, bytes);
+}
+
+bool CBlockFileCache::ReadUndoBytes(const CDiskBlockPos& pos, CBlockFileBytes& bytes)
+{
+    return ReadBytes(pos, "rev", sizeof(uint256), bytes);
+}
+
+void CBlockFileCache::AddFileRead(size_t nBytes)
+{
+    LOCK(cs);
+    stats.nFileReads++;
+    stats.nBytesRead += nBytes;
+}
+
+std::shared_ptr<const CBlock> CBlockFileCache::GetBlock(const CDiskBlockPos& pos)
+{
+    LOCK(cs);
+    if (nMaxBlockBytes == 0)
+        return nullptr;
+    auto it = mapBlocks.find(BlockKey(pos.nFile, pos.nPos));
+    if (it == mapBlocks.end()) {
+        stats.nBlockMisses++;
+        return nullptr;
+    }
+    stats.nBlockHits++;
+    lruBlocks.splice(lruBlocks.begin(), lruBlocks, it->second);
+    return it->second->second.pblock;
+}
+
+void CBlockFileCache::AddBlock(const CDiskBlockPos& pos, const std::shared_ptr<const CBlock>& pblock, size_t nSize)
+{
+    LOCK(cs);
+    BlockKey key(pos.nFile, pos.nPos);
+    if (nSize > nMaxBlockBytes || mapBlocks.count(key))
+        return;
+    CCachedBlock cached;
+    cached.pblock = pblock;
+    cached.nSize = nSize;
+    lruBlocks.push_front(std::make_pair(key, cached));
+    mapBlocks[key] = lruBlocks.begin();
+    stats.nCachedBytes += nSize;
+    while (stats.nCachedBytes > nMaxBlockBytes) {
+        stats.nCachedBytes -= lruBlocks.back().second.nSize;
+        mapBlocks.erase(lruBlocks.back().first);
+        lruBlocks.pop_back();
+    }
+    stats.nCachedBlocks = lruBlocks.size();
+}
+
+void CBlockFileCache::ForgetFile(int nFile)
+{
+    LOCK(cs);
+    for (auto it = lruFiles.begin(); it != lruFiles.end(); ) {
+        if (it->first.first == nFile) {
+            stats.nMappedBytes -= it->second->size();
+            it = lruFiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    stats.nMappedFiles = lruFiles.size();
+
+    auto it = mapBlocks.lower_bound(BlockKey(nFile, 0));
+    while (it != mapBlocks.end() && it->first.first == nFile) {
+        stats.nCachedBytes -= it->second->second.nSize;
+        lruBlocks.erase(it->second);
+        mapBlocks.erase(it++);
+    }
+    stats.nCachedBlocks = lruBlocks.size();
+}
+
+void CBlockFileCache::Clear()
+{
+    LOCK(cs);
+    lruFiles.clear();
+    lruBlocks.clear();
+    mapBlocks.clear();
+    stats.nMappedFiles = stats.nMappedBytes = 0;
+    stats.nCachedBlocks = stats.nCachedBytes = 0;
+}
+
+CBlockFileCacheStats CBlockFileCache::GetStats() const
+{
+    LOCK(cs);
+    return stats;
+}
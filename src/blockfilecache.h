@@ -0,0 +1,154 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILECACHE_H
+#define BITCOIN_BLOCKFILECACHE_H
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "sync.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <utility>
+
+class UniValue;
+
+/** Default for -blockreadcache, the size in MiB of the decoded blocks kept after being read from disk */
+static const int64_t DEFAULT_BLOCK_READ_CACHE = 32;
+/** Maximum number of blk/rev files kept mapped at the same time */
+static const size_t MAX_MAPPED_BLOCK_FILES = 16;
+
+/** Read-only mapping of a whole blk or rev file */
+class CMappedBlockFile
+{
+private:
+    const char* pdata;
+    size_t nSize;
+
+    CMappedBlockFile(const char* pdataIn, size_t nSizeIn) : pdata(pdataIn), nSize(nSizeIn) {}
+    CMappedBlockFile(const CMappedBlockFile&);
+    CMappedBlockFile& operator=(const CMappedBlockFile&);
+
+public:
+    ~CMappedBlockFile();
+
+    //! Map the file at the given position, NULL if it is empty or can't be mapped
+    static std::shared_ptr<const CMappedBlockFile> Open(const CDiskBlockPos& pos, const char* prefix);
+
+    const char* data() const { return pdata; }
+    size_t size() const { return nSize; }
+};
+
+/**
+ * Serialized bytes of a block or of an undo record. They point into the
+ * mapping of their file, or into a buffer when the file could not be mapped,
+ * and keep it alive: they stay valid after the file has been unmapped,
+ * pruned or truncated.
+ */
+class CBlockFileBytes
+{
+private:
+    std::shared_ptr<const void> owner;
+    const char* pbegin;
+    size_t nSize;
+
+public:
+    CBlockFileBytes() : pbegin(NULL), nSize(0) {}
+    CBlockFileBytes(const std::shared_ptr<const void>& ownerIn, const char* pbeginIn, size_t nSizeIn) :
+        owner(ownerIn), pbegin(pbeginIn), nSize(nSizeIn) {}
+
+    const char* begin() const { return pbegin; }
+    const char* end() const { return pbegin + nSize; }
+    size_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+};
+
+struct CBlockFileCacheStats
+{
+    //! Lookups of decoded blocks
+    uint64_t nBlockHits;
+    uint64_t nBlockMisses;
+    //! Reads of serialized blocks and undo records, from mappings or from file
+    uint64_t nMappedReads;
+    uint64_t nFileReads;
+    uint64_t nBytesRead;
+    //! Files mapped since startup and currently mapped
+    uint64_t nMaps;
+    size_t nMappedFiles;
+    size_t nMappedBytes;
+    //! Decoded blocks currently cached, and their serialized size
+    size_t nCachedBlocks;
+    size_t nCachedBytes;
+
+    CBlockFileCacheStats() : nBlockHits(0), nBlockMisses(0), nMappedReads(0), nFileReads(0), nBytesRead(0),
+                             nMaps(0), nMappedFiles(0), nMappedBytes(0), nCachedBlocks(0), nCachedBytes(0) {}
+
+    UniValue ToJSON() const;
+};
+
+/**
+ * Read side of the block storage.
+ *
+ * Recently read blk/rev files stay mapped, so a block or undo record is read
+ * without opening, seeking and buffering the file, and without copying at all
+ * when the caller only needs the serialized bytes. The most recently read
+ * blocks are also kept decoded, which saves both the deserialization and the
+ * header checks when explorers, rescans and websocket clients ask for the same
+ * recent blocks over and over.
+ *
+ * The cache is only a shortcut: a position it can't serve is read from file
+ * by the caller as before.
+ */
+class CBlockFileCache
+{
+private:
+    typedef std::pair<int, char> FileKey; // file number, 'b'lk or 'r'ev
+    typedef std::pair<int, unsigned int> BlockKey;
+    struct CCachedBlock
+    {
+        std::shared_ptr<const CBlock> pblock;
+        size_t nSize;
+    };
+
+    mutable CCriticalSection cs;
+    std::list<std::pair<FileKey, std::shared_ptr<const CMappedBlockFile> > > lruFiles;
+    std::list<std::pair<BlockKey, CCachedBlock> > lruBlocks;
+    std::map<BlockKey, std::list<std::pair<BlockKey, CCachedBlock> >::iterator> mapBlocks;
+    size_t nMaxBlockBytes;
+    CBlockFileCacheStats stats;
+
+    std::shared_ptr<const CMappedBlockFile> GetFile(const CDiskBlockPos& pos, const char* prefix, size_t nMinSize);
+    bool ReadBytes(const CDiskBlockPos& pos, const char* prefix, size_t nTrailer, CBlockFileBytes& bytes);
+
+public:
+    CBlockFileCache();
+
+    //! Bound the decoded blocks to nMaxBytes of serialized data, 0 to disable them
+    void SetMaxBlockBytes(size_t nMaxBytes);
+
+    //! Serialized block stored at pos
+    bool ReadBlockBytes(const CDiskBlockPos& pos, CBlockFileBytes& bytes);
+    //! Serialized undo record stored at pos, followed by its checksum
+    bool ReadUndoBytes(const CDiskBlockPos& pos, CBlockFileBytes& bytes);
+    //! Account for a read the caller had to do from file
+    void AddFileRead(size_t nBytes);
+
+    //! Decoded block stored at pos, NULL if not cached
+    std::shared_ptr<const CBlock> GetBlock(const CDiskBlockPos& pos);
+    void AddBlock(const CDiskBlockPos& pos, const std::shared_ptr<const CBlock>& pblock, size_t nSize);
+
+    //! Drop everything read from the blk/rev files numbered nFile, after they were truncated or removed
+    void ForgetFile(int nFile);
+    void Clear();
+
+    CBlockFileCacheStats GetStats() const;
+};
+
+extern CBlockFileCache blockFileCache;
+
+#endif // BITCOIN_BLOCKFILECACHE_H
@@ -0,0 +1,265 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockimport.h"
+
+#include "consensus/consensus.h"
+#include "consensus/validation.h"
+#include "crypto/common.h"
+#include "main.h"
+#include "streams.h"
+#include "tinyformat.h"
+#include "util.h"
+#include "utiltime.h"
+#include "version.h"
+#include "zcash/Proof.hpp"
+
+#include <string.h>
+
+#include <boost/bind/bind.hpp>
+
+namespace {
+
+//! Amount of data read from the file at a time
+const size_t READ_CHUNK_SIZE = 16 << 20;
+
+} // anon namespace
+
+void CBlockImportStage::Add(const CBlockImportStage& other)
+{
+    nBlocks += other.nBlocks;
+    nBytes += other.nBytes;
+    nTimeMicros += other.nTimeMicros;
+    nThreads = other.nThreads;
+}
+
+std::string CBlockImportStage::ToString() const
+{
+    // The threads of a stage work side by side
+    double dSeconds = nTimeMicros * 0.000001 / std::max(1, nThreads);
+    if (dSeconds <= 0)
+        return "idle";
+    return strprintf("%.1f blocks/s %.2f MB/s", nBlocks / dSeconds, nBytes / dSeconds / 1000000);
+}
+
+void CBlockImportStats::Add(const CBlockImportStats& other)
+{
+    read.Add(other.read);
+    parse.Add(other.parse);
+    accept.Add(other.accept);
+}
+
+std::string CBlockImportStats::ToString() const
+{
+    return strprintf("read %s, parse %s (%d threads), accept %s",
+                     read.ToString(), parse.ToString(), parse.nThreads, accept.ToString());
+}
+
+CBlockFileReader::CBlockFileReader(FILE* fileIn, const CMessageHeader::MessageStartChars& messageStartIn, int nThreadsIn, bool fHeadersOnlyIn) :
+    file(fileIn), fHeadersOnly(fHeadersOnlyIn), nParsing(0), nBufferedBytes(0), fEndOfFile(false), fStop(false)
+{
+    memcpy(messageStart, messageStartIn, MESSAGE_START_SIZE);
+    stats.parse.nThreads = std::max(1, nThreadsIn);
+
+    threads.create_thread(boost::bind(&CBlockFileReader::ThreadRead, this));
+    for (int i = 0; i < stats.parse.nThreads; i++)
+        threads.create_thread(boost::bind(&CBlockFileReader::ThreadParse, this));
+}
+
+CBlockFileReader::~CBlockFileReader()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStop = true;
+        condReader.notify_all();
+        condParser.notify_all();
+    }
+    threads.join_all();
+    if (file)
+        fclose(file);
+}
+
+bool CBlockFileReader::Next(Item& item)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (window.empty() || !window.front()->fDone) {
+        if (window.empty() && fEndOfFile)
+            return false;
+        condNext.wait(lock);
+    }
+
+    std::shared_ptr<Entry> entry = window.front();
+    window.pop_front();
+    nParsing--;
+    nBufferedBytes -= entry->item.nSize;
+    condReader.notify_one();
+
+    item = std::move(entry->item);
+    return true;
+}
+
+CBlockImportStats CBlockFileReader::GetStats() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return stats;
+}
+
+void CBlockFileReader::Push(const std::shared_ptr<Entry>& entry)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    // A block is let in when the buffer is empty, whatever its size
+    while (!fStop && nBufferedBytes > 0 && nBufferedBytes + entry->item.nSize > MAX_BLOCK_IMPORT_BUFFER)
+        condReader.wait(lock);
+
+    window.push_back(entry);
+    nBufferedBytes += entry->item.nSize;
+    stats.read.nBlocks++;
+    condParser.notify_one();
+}
+
+void CBlockFileReader::ThreadRead()
+{
+    RenameThread("horizen-blkread");
+
+    std::vector<char> buf;
+    // File position of buf[0]
+    uint64_t nBufPos = 0;
+    size_t nScan = 0;
+    bool fEof = false;
+
+    // Drop what is before buf[nKeep] and read more of the file,
+    // returns false when nothing more could be read
+    auto refill = [&](size_t nKeep) -> bool {
+        if (fEof)
+            return false;
+        buf.erase(buf.begin(), buf.begin() + nKeep);
+        nBufPos += nKeep;
+        nScan -= nKeep;
+
+        int64_t nStart = GetTimeMicros();
+        size_t nHave = buf.size();
+        buf.resize(nHave + READ_CHUNK_SIZE);
+        size_t nRead = fread(buf.data() + nHave, 1, READ_CHUNK_SIZE, file);
+        buf.resize(nHave + nRead);
+        fEof = (nRead < READ_CHUNK_SIZE);
+
+        boost::unique_lock<boost::mutex> lock(mutex);
+        stats.read.nBytes += nRead;
+        stats.read.nTimeMicros += GetTimeMicros() - nStart;
+        return nRead > 0;
+    };
+
+    while (true) {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fStop)
+                break;
+        }
+
+        // locate a header: magic number and size
+        if (nScan + 8 > buf.size()) {
+            if (!refill(nScan))
+                break;
+            continue;
+        }
+        const char* pMagic = (const char*)memchr(buf.data() + nScan, messageStart[0], buf.size() - nScan);
+        if (pMagic == NULL) {
+            nScan = buf.size();
+            continue;
+        }
+        const size_t nMagic = pMagic - buf.data();
+        if (nMagic + 8 > buf.size()) {
+            if (!refill(nMagic))
+                break;
+            continue;
+        }
+        nScan = nMagic + 1;
+        if (memcmp(pMagic, messageStart, MESSAGE_START_SIZE))
+            continue; // only first byte of magic number matches. Keep searching...
+        const unsigned int nSize = ReadLE32((const unsigned char*)pMagic + MESSAGE_START_SIZE);
+        if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
+            continue; // magic number matches but size can't be block one. Keep searching...
+
+        if (nMagic + 8 + nSize > buf.size() && !fEof) {
+            nScan = nMagic;
+            refill(nMagic);
+            continue;
+        }
+
+        // A block cut by the end of the file is handed out as well, for its
+        // deserialization to fail as when read from a stream.
+        std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+        entry->item.nMagicPos = nBufPos + nMagic;
+        entry->item.nPos = entry->item.nMagicPos + 8;
+        entry->item.nSize = nSize;
+        const size_t nEnd = std::min(buf.size(), nMagic + 8 + nSize);
+        entry->data.assign(buf.begin() + nMagic + 8, buf.begin() + nEnd);
+        Push(entry);
+    }
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    fEndOfFile = true;
+    condParser.notify_all();
+    condNext.notify_all();
+}
+
+void CBlockFileReader::ThreadParse()
+{
+    RenameThread("horizen-parsblk");
+
+    while (true) {
+        std::shared_ptr<Entry> entry;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!fStop && nParsing == window.size()) {
+                if (fEndOfFile)
+                    return;
+                condParser.wait(lock);
+            }
+            if (fStop)
+                return;
+            entry = window[nParsing++];
+        }
+
+        int64_t nStart = GetTimeMicros();
+        Parse(*entry);
+
+        boost::unique_lock<boost::mutex> lock(mutex);
+        entry->fDone = true;
+        stats.parse.nBlocks++;
+        stats.parse.nBytes += entry->item.nSize;
+        stats.parse.nTimeMicros += GetTimeMicros() - nStart;
+        if (entry == window.front())
+            condNext.notify_one();
+    }
+}
+
+void CBlockFileReader::Parse(Entry& entry) const
+{
+    Item& item = entry.item;
+    try {
+        // The whole block is read even for its header: a block that cannot
+        // be deserialized is not imported.
+        CDataStream ss(entry.data.begin(), entry.data.end(), SER_DISK, CLIENT_VERSION);
+        ss >> item.block;
+        item.nUsed = entry.data.size() - ss.size();
+        item.fDecoded = true;
+    } catch (const std::exception& e) {
+        item.strError = e.what();
+    }
+    std::vector<char>().swap(entry.data);
+
+    if (!item.fDecoded)
+        return;
+
+    // A failure is reported when the block is checked again by the import
+    CValidationState state;
+    if (fHeadersOnly) {
+        item.fHeaderChecked = CheckBlockHeader(item.block, state);
+    } else {
+        // The result is remembered by the block
+        auto verifier = libzcash::ProofVerifier::Disabled();
+        item.fHeaderChecked = CheckBlock(item.block, state, verifier);
+    }
+}
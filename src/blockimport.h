@@ -0,0 +1,137 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKIMPORT_H
+#define BITCOIN_BLOCKIMPORT_H
+
+#include "primitives/block.h"
+#include "protocol.h"
+
+#include <deque>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+/** Maximum amount of raw block data read ahead of the blocks being imported */
+static const size_t MAX_BLOCK_IMPORT_BUFFER = 128 << 20;
+
+/** Throughput of a stage of the block import */
+struct CBlockImportStage
+{
+    uint64_t nBlocks;
+    uint64_t nBytes;
+    //! Time spent by the stage, summed over its threads
+    int64_t nTimeMicros;
+    int nThreads;
+
+    CBlockImportStage() : nBlocks(0), nBytes(0), nTimeMicros(0), nThreads(1) {}
+
+    void Add(const CBlockImportStage& other);
+    std::string ToString() const;
+};
+
+struct CBlockImportStats
+{
+    CBlockImportStage read;
+    CBlockImportStage parse;
+    CBlockImportStage accept;
+
+    void Add(const CBlockImportStats& other);
+    std::string ToString() const;
+};
+
+/**
+ * Reads the blocks stored in a block file, or in a file with the same
+ * layout such as bootstrap.dat, ahead of their import.
+ *
+ * A reader thread scans the file for the network magic and hands out the
+ * raw blocks, which a pool of threads deserializes and submits to the
+ * context-free checks: CheckBlockHeader for a headers-only import, CheckBlock
+ * otherwise. Next() returns the blocks in file order.
+ *
+ * Every magic number followed by a plausible size is reported, even inside
+ * the data of the previous block: after a failed write the next block starts
+ * there, the importer skips them when the previous block is valid.
+ */
+class CBlockFileReader
+{
+public:
+    struct Item
+    {
+        //! Position of the magic number
+        uint64_t nMagicPos;
+        //! Position of the block data
+        uint64_t nPos;
+        //! Size recorded before the block
+        unsigned int nSize;
+        //! Bytes used by the block, set when it was deserialized
+        unsigned int nUsed;
+        bool fDecoded;
+        //! The header passed CheckBlockHeader, PoW included
+        bool fHeaderChecked;
+        std::string strError;
+        CBlock block;
+
+        Item() : nMagicPos(0), nPos(0), nSize(0), nUsed(0), fDecoded(false), fHeaderChecked(false) {}
+    };
+
+    /**
+     * Take over fileIn, which is closed by the destructor. With fHeadersOnly
+     * only the block headers are checked, otherwise the blocks go through
+     * CheckBlock.
+     */
+    CBlockFileReader(FILE* fileIn, const CMessageHeader::MessageStartChars& messageStartIn, int nThreadsIn, bool fHeadersOnlyIn);
+    ~CBlockFileReader();
+
+    CBlockFileReader(const CBlockFileReader&) = delete;
+    CBlockFileReader& operator=(const CBlockFileReader&) = delete;
+
+    /** Get the next block of the file, returns false at the end of it */
+    bool Next(Item& item);
+
+    /** Throughput of the read and parse stages so far */
+    CBlockImportStats GetStats() const;
+
+private:
+    struct Entry
+    {
+        Item item;
+        std::vector<char> data;
+        bool fDone;
+
+        Entry() : fDone(false) {}
+    };
+
+    FILE* file;
+    CMessageHeader::MessageStartChars messageStart;
+    const bool fHeadersOnly;
+
+    mutable boost::mutex mutex;
+    boost::condition_variable condReader;
+    boost::condition_variable condParser;
+    boost::condition_variable condNext;
+
+    //! The blocks read and not returned by Next() yet, in file order
+    std::deque<std::shared_ptr<Entry> > window;
+    //! Number of entries at the front of the window handed out to the parsers
+    size_t nParsing;
+    size_t nBufferedBytes;
+    bool fEndOfFile;
+    bool fStop;
+    CBlockImportStats stats;
+
+    boost::thread_group threads;
+
+    void ThreadRead();
+    void ThreadParse();
+    void Push(const std::shared_ptr<Entry>& entry);
+    void Parse(Entry& entry) const;
+};
+
+#endif // BITCOIN_BLOCKIMPORT_H
@@ -0,0 +1,124 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainsnapshot.h"
+
+#include "chain.h"
+#include "coins.h"
+#include "main.h"
+
+#include <algorithm>
+
+static std::shared_ptr<const CChainSnapshot> pchainSnapshot = std::make_shared<const CChainSnapshot>();
+
+CChainSnapshot::CChainSnapshot() : nHeight(-1), pSidechains(std::make_shared<const SidechainMap>()) {}
+
+void CChainSnapshot::CopyChain(const CChainSnapshot& prev, const CChain& chain, int nFrom)
+{
+    nHeight = chain.Height();
+    size_t nShared = std::min<size_t>(nFrom / CHUNK_SIZE, prev.vChunks.size());
+    vChunks.assign(prev.vChunks.begin(), prev.vChunks.begin() + nShared);
+
+    for (int nStart = nShared * CHUNK_SIZE; nStart <= nHeight; nStart += CHUNK_SIZE)
+    {
+        std::shared_ptr<Chunk> pchunk = std::make_shared<Chunk>();
+        int nEnd = std::min(nStart + CHUNK_SIZE - 1, nHeight);
+        pchunk->reserve(nEnd - nStart + 1);
+        for (int h = nStart; h <= nEnd; h++)
+            pchunk->push_back(chain[h]);
+        vChunks.push_back(pchunk);
+    }
+}
+
+std::shared_ptr<const CChainSnapshot> CChainSnapshot::Update(const CChainSnapshot& prev, const CChain& chain,
+                                                             const CCoinsViewCache* pview, const std::set<uint256>& scIdsChanged)
+{
+    // Most of the time the chain just grew by one block, reorgs are short
+    int nFork = std::min(prev.nHeight, chain.Height());
+    while (nFork >= 0 && prev[nFork] != chain[nFork])
+        nFork--;
+
+    std::shared_ptr<CChainSnapshot> psnapshot = std::make_shared<CChainSnapshot>();
+    psnapshot->CopyChain(prev, chain, nFork + 1);
+
+    if (scIdsChanged.empty() || pview == nullptr)
+    {
+        psnapshot->pSidechains = prev.pSidechains;
+        return psnapshot;
+    }
+
+    std::shared_ptr<SidechainMap> pSidechains = std::make_shared<SidechainMap>(*prev.pSidechains);
+    for (const uint256& scId : scIdsChanged)
+    {
+        CSidechain sidechain;
+        if (pview->GetSidechain(scId, sidechain))
+            (*pSidechains)[scId] = std::make_shared<const CSidechain>(sidechain);
+        else
+            pSidechains->erase(scId);
+    }
+    psnapshot->pSidechains = pSidechains;
+    return psnapshot;
+}
+
+std::shared_ptr<const CChainSnapshot> CChainSnapshot::Build(const CChain& chain, const CCoinsViewCache* pview)
+{
+    std::set<uint256> scIds;
+    if (pview != nullptr)
+        pview->GetScIds(scIds);
+    return Update(CChainSnapshot(), chain, pview, scIds);
+}
+
+CBlockIndex* CChainSnapshot::operator[](int nHeightIn) const
+{
+    if (nHeightIn < 0 || nHeightIn > nHeight)
+        return nullptr;
+    return (*vChunks[nHeightIn / CHUNK_SIZE])[nHeightIn % CHUNK_SIZE];
+}
+
+bool CChainSnapshot::Contains(const CBlockIndex* pindex) const
+{
+    return pindex != nullptr && (*this)[pindex->nHeight] == pindex;
+}
+
+CBlockIndex* CChainSnapshot::Next(const CBlockIndex* pindex) const
+{
+    return Contains(pindex) ? (*this)[pindex->nHeight + 1] : nullptr;
+}
+
+std::shared_ptr<const CSidechain> CChainSnapshot::GetSidechain(const uint256& scId) const
+{
+    SidechainMap::const_iterator it = pSidechains->find(scId);
+    return it == pSidechains->end() ? nullptr : it->second;
+}
+
+CSidechain::State CChainSnapshot::GetSidechainState(const uint256& scId) const
+{
+    std::shared_ptr<const CSidechain> psidechain = GetSidechain(scId);
+    if (!psidechain)
+        return CSidechain::State::NOT_APPLICABLE;
+    return psidechain->GetState(nHeight);
+}
+
+void CChainSnapshot::GetScIds(std::set<uint256>& scIds) const
+{
+    for (const auto& entry : *pSidechains)
+        scIds.insert(entry.first);
+}
+
+std::shared_ptr<const CChainSnapshot> GetChainSnapshot()
+{
+    return std::atomic_load(&pchainSnapshot);
+}
+
+void PublishChainSnapshot(const std::set<uint256>& scIdsChanged)
+{
+    AssertLockHeld(cs_main);
+    std::atomic_store(&pchainSnapshot, CChainSnapshot::Update(*GetChainSnapshot(), chainActive, pcoinsTip, scIdsChanged));
+}
+
+void ResetChainSnapshot()
+{
+    LOCK(cs_main);
+    std::atomic_store(&pchainSnapshot, CChainSnapshot::Build(chainActive, chainActive.Tip() ? pcoinsTip : nullptr));
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CHAINSNAPSHOT_H
+#define BITCOIN_CHAINSNAPSHOT_H
+
+#include "sc/sidechain.h"
+#include "uint256.h"
+
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+class CBlockIndex;
+class CChain;
+class CCoinsViewCache;
+
+/**
+ * Immutable view of the active chain, and of the sidechains at its tip.
+ *
+ * The validation code publishes a new snapshot each time the tip changes,
+ * and read-only RPCs answer from the latest one instead of taking cs_main,
+ * so API load does not hold up block validation. Consecutive snapshots
+ * share most of their data: the chain is stored in fixed-size chunks, and
+ * a new tip only copies the chunks from the fork point on; sidechain
+ * records are only read again for the sidechains the block changed.
+ */
+class CChainSnapshot
+{
+public:
+    CChainSnapshot();
+
+    //! Snapshot following prev, once the chain and the sidechains in scIdsChanged changed. Sidechains are read from pview, if any
+    static std::shared_ptr<const CChainSnapshot> Update(const CChainSnapshot& prev, const CChain& chain,
+                                                        const CCoinsViewCache* pview, const std::set<uint256>& scIdsChanged);
+    //! Snapshot built from scratch
+    static std::shared_ptr<const CChainSnapshot> Build(const CChain& chain, const CCoinsViewCache* pview);
+
+    CBlockIndex* Tip() const { return nHeight < 0 ? nullptr : (*this)[nHeight]; }
+    int Height() const { return nHeight; }
+    //! Block at nHeightIn on the chain, NULL if out of range
+    CBlockIndex* operator[](int nHeightIn) const;
+    bool Contains(const CBlockIndex* pindex) const;
+    CBlockIndex* Next(const CBlockIndex* pindex) const;
+
+    //! Sidechain record at the tip, NULL if the sidechain was not created
+    std::shared_ptr<const CSidechain> GetSidechain(const uint256& scId) const;
+    CSidechain::State GetSidechainState(const uint256& scId) const;
+    void GetScIds(std::set<uint256>& scIds) const;
+
+private:
+    typedef std::vector<CBlockIndex*> Chunk;
+    typedef std::map<uint256, std::shared_ptr<const CSidechain> > SidechainMap;
+    static const int CHUNK_SIZE = 4096;
+
+    std::vector<std::shared_ptr<const Chunk> > vChunks;
+    int nHeight;
+    std::shared_ptr<const SidechainMap> pSidechains;
+
+    //! Fill the chain from height nFrom on, keeping the chunks entirely below it
+    void CopyChain(const CChainSnapshot& prev, const CChain& chain, int nFrom);
+};
+
+/** Latest published snapshot, never NULL. Doesn't need cs_main */
+std::shared_ptr<const CChainSnapshot> GetChainSnapshot();
+/** Publish the snapshot of chainActive, after the block that changed the sidechains in scIdsChanged */
+void PublishChainSnapshot(const std::set<uint256>& scIdsChanged);
+/** Publish the snapshot of chainActive built from scratch, after loading or unloading the chain */
+void ResetChainSnapshot();
+
+#endif // BITCOIN_CHAINSNAPSHOT_H
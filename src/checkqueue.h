@@ -6,9 +6,12 @@
 #define BITCOIN_CHECKQUEUE_H
 
 #include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <vector>
 
-#include <boost/foreach.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
@@ -19,18 +22,37 @@ class CCheckQueueControl;
 /** 
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
-  * operator(), returning a bool.
+  * operator(), returning a bool, and a swap() method.
   *
   * One thread (the master) is assumed to push batches of verifications
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every worker owns a deque the master spreads the checks over. A worker
+  * takes its checks from the back of its own deque and, once it is empty,
+  * steals half of another worker's deque from the front, so no global lock
+  * is taken per batch. The first failing check aborts the round: the checks
+  * still queued are dropped without being run.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! The checks assigned to a worker
+    struct WorkerDeque
+    {
+        boost::mutex mutex;
+        std::deque<T> checks;
+    };
+
+    //! One deque per worker, the first one belongs to the master
+    std::vector<std::unique_ptr<WorkerDeque> > vDeques;
+
+    //! The number of worker threads (excluding the master) that joined the queue.
+    std::atomic<unsigned int> nWorkers;
+
+    //! Mutex used by the threads running out of work to go to sleep
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,25 +61,18 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
-
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
-
-    //! The total number of workers (including the master).
-    int nTotal;
-
-    //! The temporary evaluation result.
-    bool fAllOk;
+    //! The number of checks sitting in the deques.
+    std::atomic<unsigned int> nQueued;
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo;
+
+    //! The temporary evaluation result, cleared by the first failing check.
+    std::atomic<bool> fAllOk;
 
     //! Whether we're shutting down.
     bool fQuit;
@@ -65,106 +80,183 @@ private:
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
-    /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    //! The deque the next checks added go to (only used by the master)
+    unsigned int nNextDeque;
+
+    //! Account for nDone completed (or dropped) checks, waking up the master after the last one
+    void Done(unsigned int nDone)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
-        std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
-        do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
+        if (nTodo.fetch_sub(nDone) == nDone) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            condMaster.notify_one();
+        }
+    }
+
+    /**
+     * Move the next batch of checks for the worker owning deque nSlot into
+     * vChecks, stealing from the other deques when its own one is empty.
+     * Returns false when no check is left.
+     */
+    bool Take(unsigned int nSlot, std::vector<T>& vChecks)
+    {
+        const unsigned int nDeques = nWorkers + 1;
+        for (unsigned int i = 0; i < nDeques; i++) {
+            WorkerDeque& worker = *vDeques[(nSlot + i) % nDeques];
+            boost::unique_lock<boost::mutex> lock(worker.mutex);
+            const unsigned int nSize = worker.checks.size();
+            if (nSize == 0)
+                continue;
+
+            if (!fAllOk) {
+                // The result is already known, drop what is left
+                worker.checks.clear();
+                nQueued -= nSize;
+                lock.unlock();
+                Done(nSize);
+                continue;
+            }
+
+            // Decide how many work units to process now.
+            // * The owner takes small batches from the back of its deque, so
+            //   that what is left can still be shared when others run dry.
+            // * A thief takes half of the victim's deque from the front,
+            //   leaving the checks the owner is going to take next.
+            // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
+            const bool fOwn = (i == 0);
+            const unsigned int nNow = std::max(1U, std::min(nBatchSize, fOwn ? nSize / 4 : (nSize + 1) / 2));
+            vChecks.resize(nNow);
+            for (unsigned int j = 0; j < nNow; j++) {
+                // swap jobs to the local batch vector instead of copying.
+                if (fOwn) {
+                    vChecks[j].swap(worker.checks.back());
+                    worker.checks.pop_back();
                 } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if ((fMaster || fQuit) && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
+                    vChecks[j].swap(worker.checks.front());
+                    worker.checks.pop_front();
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
             }
-            // execute work
-            BOOST_FOREACH (T& check, vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
-        } while (true);
+            nQueued -= nNow;
+            return true;
+        }
+        return false;
+    }
+
+    //! Execute a batch, skipping the checks once one of them failed
+    void Run(std::vector<T>& vChecks)
+    {
+        const unsigned int nNow = vChecks.size();
+        for (T& check : vChecks) {
+            if (!fAllOk)
+                break;
+            if (!check())
+                fAllOk = false;
+        }
+        vChecks.clear();
+        Done(nNow);
     }
 
 public:
-    //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    //! Create a new check queue, which up to nMaxWorkers threads can serve
+    CCheckQueue(unsigned int nBatchSizeIn, unsigned int nMaxWorkers = 64) :
+        nWorkers(0), nQueued(0), nTodo(0), fAllOk(true), fQuit(false), nBatchSize(nBatchSizeIn), nNextDeque(0)
+    {
+        for (unsigned int i = 0; i <= nMaxWorkers; i++)
+            vDeques.emplace_back(new WorkerDeque());
+    }
 
     //! Worker thread
     void Thread()
     {
-        Loop();
+        const unsigned int nSlot = ++nWorkers;
+        assert(nSlot < vDeques.size());
+
+        std::vector<T> vChecks;
+        vChecks.reserve(nBatchSize);
+        do {
+            if (Take(nSlot, vChecks)) {
+                Run(vChecks);
+                continue;
+            }
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (nQueued == 0) {
+                if (fQuit)
+                    return;
+                condWorker.wait(lock); // wait
+            }
+        } while (true);
     }
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait()
     {
-        return Loop(true);
+        std::vector<T> vChecks;
+        vChecks.reserve(nBatchSize);
+        do {
+            if (Take(0, vChecks)) {
+                Run(vChecks);
+                continue;
+            }
+            boost::unique_lock<boost::mutex> lock(mutex);
+            // Only the master adds checks, nothing shows up while it waits
+            while (nTodo != 0 && nQueued == 0)
+                condMaster.wait(lock);
+            if (nTodo == 0)
+                break;
+        } while (true);
+
+        bool fRet = fAllOk;
+        // reset the status for new work later
+        fAllOk = true;
+        return fRet;
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        BOOST_FOREACH (T& check, vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty())
+            return;
+
+        // Spread the checks over the deques in contiguous chunks, one per
+        // worker, continuing from where the previous batch stopped so that
+        // batches of a single check are spread as well.
+        const unsigned int nDeques = nWorkers + 1;
+        const size_t nChunk = (vChecks.size() + nDeques - 1) / nDeques;
         nTodo += vChecks.size();
+        for (size_t nPos = 0; nPos < vChecks.size(); nPos += nChunk) {
+            const size_t nEnd = std::min(vChecks.size(), nPos + nChunk);
+            WorkerDeque& worker = *vDeques[nNextDeque % nDeques];
+            nNextDeque = (nNextDeque + 1) % nDeques;
+
+            boost::unique_lock<boost::mutex> lock(worker.mutex);
+            for (size_t i = nPos; i < nEnd; i++) {
+                worker.checks.push_back(T());
+                worker.checks.back().swap(vChecks[i]);
+            }
+            nQueued += nEnd - nPos;
+        }
+
+        boost::unique_lock<boost::mutex> lock(mutex);
         if (vChecks.size() == 1)
             condWorker.notify_one();
-        else if (vChecks.size() > 1)
+        else
             condWorker.notify_all();
     }
 
+    //! Make the worker threads return once they are out of work
+    void Quit()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fQuit = true;
+        condWorker.notify_all();
+    }
+
     ~CCheckQueue()
     {
     }
 
     bool IsIdle()
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        return (nTotal == nIdle && nTodo == 0 && fAllOk == true);
+        return (nTodo == 0 && fAllOk == true);
     }
 
 };
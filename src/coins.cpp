@@ -17,6 +17,7 @@
 #include <consensus/validation.h>
 
 #include <sc/proofverifier.h>
+#include <sc/cswnullifiers.h>
 
 #include "txdb.h"
 #include "maturityheightindex.h"
@@ -247,17 +248,14 @@ bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock,
 bool CCoinsViewBacked::GetStats(CCoinsStats &stats)                                  const { return base->GetStats(stats); }
 
 CCoinsKeyHasher::CCoinsKeyHasher() : salt(GetRandHash()) {}
-CCswNullifiersKeyHasher::CCswNullifiersKeyHasher() : salt() {GetRandBytes(reinterpret_cast<unsigned char*>(salt), BUF_LEN);}
+CCswNullifiersKeyHasher::CCswNullifiersKeyHasher() : salt() {GetRandBytes(reinterpret_cast<unsigned char*>(salt), sizeof(salt));}
 
-size_t CCswNullifiersKeyHasher::operator()(const std::pair<uint256, CFieldElement>& key) const {
+size_t CCswNullifiersKeyHasher::operator()(const std::pair<uint256, uint256>& key) const {
     uint32_t buf[BUF_LEN];
 
-    // nullifiers are already checked by the caller, but let's assert it too
-    assert(!key.second.IsNull());
-
     // note: we may consider buf as a raw data, so bytes size of buf is (BUF_LEN * 4)
     memcpy(buf, key.first.begin(), sizeof(uint256));
-    memcpy((buf + sizeof(uint256)/sizeof(uint32_t)), &(key.second.GetByteArray()[0]), CFieldElement::ByteSize());
+    memcpy((buf + sizeof(uint256)/sizeof(uint32_t)), key.second.begin(), sizeof(uint256));
     return CalculateHash(buf, BUF_LEN, salt);
 }
 
@@ -377,7 +375,7 @@ bool CCoinsViewCache::GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tr
     CAnchorsMap::const_iterator it = cacheAnchors.find(rt);
     if (it != cacheAnchors.end()) {
         if (it->second.entered) {
-            tree = it->second.tree;
+            tree = *it->second.tree;
             return true;
         } else {
             return false;
@@ -390,8 +388,8 @@ bool CCoinsViewCache::GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tr
 
     CAnchorsMap::iterator ret = cacheAnchors.insert(std::make_pair(rt, CAnchorsCacheEntry())).first;
     ret->second.entered = true;
-    ret->second.tree = tree;
-    cachedCoinsUsage += ret->second.tree.DynamicMemoryUsage();
+    ret->second.tree = std::make_shared<const ZCIncrementalMerkleTree>(tree);
+    cachedCoinsUsage += ret->second.tree->DynamicMemoryUsage();
 
     return true;
 }
@@ -425,12 +423,12 @@ void CCoinsViewCache::PushAnchor(const ZCIncrementalMerkleTree &tree) {
         CAnchorsMap::iterator ret = insertRet.first;
 
         ret->second.entered = true;
-        ret->second.tree = tree;
+        ret->second.tree = std::make_shared<const ZCIncrementalMerkleTree>(tree);
         ret->second.flags = CAnchorsCacheEntry::DIRTY;
 
         if (insertRet.second) {
             // An insert took place
-            cachedCoinsUsage += ret->second.tree.DynamicMemoryUsage();
+            cachedCoinsUsage += ret->second.tree->DynamicMemoryUsage();
         }
 
         hashAnchor = newrt;
@@ -534,7 +532,7 @@ void CCoinsViewCache::SetBestBlock(const uint256 &hashBlockIn) {
 }
 
 bool CCoinsViewCache::HaveCswNullifier(const uint256& scId, const CFieldElement &nullifier) const {
-    std::pair<uint256, CFieldElement> key = std::make_pair(scId, nullifier);
+    std::pair<uint256, uint256> key = std::make_pair(scId, CswNullifierKey(nullifier));
 
     CCswNullifiersMap::iterator it = cacheCswNullifiers.find(key);
     if (it != cacheCswNullifiers.end())
@@ -551,7 +549,7 @@ bool CCoinsViewCache::AddCswNullifier(const uint256& scId, const CFieldElement &
     if (HaveCswNullifier(scId, nullifier))
         return false;
 
-    std::pair<uint256, CFieldElement> key = std::make_pair(scId, nullifier);
+    std::pair<uint256, uint256> key = std::make_pair(scId, CswNullifierKey(nullifier));
     cacheCswNullifiers.insert(std::make_pair(key, CCswNullifiersCacheEntry{CCswNullifiersCacheEntry::Flags::FRESH}));
     return true;
 }
@@ -560,7 +558,7 @@ bool CCoinsViewCache::RemoveCswNullifier(const uint256& scId, const CFieldElemen
     if (!HaveCswNullifier(scId, nullifier))
         return false;
 
-    cacheCswNullifiers.at(std::make_pair(scId, nullifier)).flag = CCswNullifiersCacheEntry::Flags::ERASED;
+    cacheCswNullifiers.at(std::make_pair(scId, CswNullifierKey(nullifier))).flag = CCswNullifiersCacheEntry::Flags::ERASED;
     return true;
 }
 
@@ -631,7 +629,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins,
                 entry.tree = child_it->second.tree;
                 entry.flags = CAnchorsCacheEntry::DIRTY;
 
-                cachedCoinsUsage += entry.tree.DynamicMemoryUsage();
+                cachedCoinsUsage += entry.tree->DynamicMemoryUsage();
             } else {
                 if (parent_it->second.entered != child_it->second.entered) {
                     // The parent may have removed the entry.
@@ -2266,13 +2264,7 @@ CSidechain::State CCoinsViewCache::GetSidechainState(const uint256& scId) const
     if (!GetSidechain(scId, sidechain))
         return CSidechain::State::NOT_APPLICABLE;
 
-    if (!sidechain.isCreationConfirmed())
-        return CSidechain::State::UNCONFIRMED;
-
-    if (this->GetHeight() >= sidechain.GetScheduledCeasingHeight())
-        return CSidechain::State::CEASED;
-    else
-        return CSidechain::State::ALIVE;
+    return sidechain.GetState(this->GetHeight());
 }
 
 
@@ -2287,23 +2279,7 @@ const CScCertificateView& CCoinsViewCache::GetActiveCertView(const uint256& scId
         return nullView;
     }
 
-    if (this->GetSidechainState(scId) == CSidechain::State::CEASED)
-        return pSidechain->pastEpochTopQualityCertView;
-
-    if (this->GetSidechainState(scId) == CSidechain::State::UNCONFIRMED)
-        return pSidechain->lastTopQualityCertView;
-
-    int certReferencedEpoch = pSidechain->EpochFor(this->GetHeight() + 1 - pSidechain->GetCertSubmissionWindowLength()) - 1;
-
-    if (pSidechain->lastTopQualityCertReferencedEpoch == certReferencedEpoch)
-        return pSidechain->lastTopQualityCertView;
-    else if (pSidechain->lastTopQualityCertReferencedEpoch - 1 == certReferencedEpoch)
-        return pSidechain->pastEpochTopQualityCertView;
-    else
-        assert(false);
-
-    // just for compiler warning, should never reach this line
-    return nullView;
+    return pSidechain->GetActiveCertView(this->GetHeight());
 }
 
 CFieldElement CCoinsViewCache::GetCeasingCumTreeHash(const uint256& scId) const
@@ -299,7 +299,7 @@ public:
 class CCswNullifiersKeyHasher
 {
 private:
-    static const size_t BUF_LEN = (sizeof(uint256) + CFieldElement::ByteSize())/sizeof(uint32_t);
+    static const size_t BUF_LEN = (sizeof(uint256) + sizeof(uint256))/sizeof(uint32_t);
     uint32_t salt[BUF_LEN];
 public:
     CCswNullifiersKeyHasher();
@@ -309,7 +309,7 @@ public:
      * unordered_map will behave unpredictably if the custom hasher returns a
      * uint64_t, resulting in failures when syncing the chain (#4634).
      */
-    size_t operator()(const std::pair<uint256, CFieldElement>& key) const;
+    size_t operator()(const std::pair<uint256, uint256>& key) const;
 };
 
 struct CCoinsCacheEntry
@@ -328,14 +328,16 @@ struct CCoinsCacheEntry
 struct CAnchorsCacheEntry
 {
     bool entered; // This will be false if the anchor is removed from the cache
-    ZCIncrementalMerkleTree tree; // The tree itself
+    // The tree itself. It never changes once pushed, so the cache layers
+    // holding the same anchor share it instead of copying it.
+    std::shared_ptr<const ZCIncrementalMerkleTree> tree;
     unsigned char flags;
 
     enum Flags {
         DIRTY = (1 << 0), // This cache entry is potentially different from the version in the parent view.
     };
 
-    CAnchorsCacheEntry() : entered(false), flags(0) {}
+    CAnchorsCacheEntry() : entered(false), tree(std::make_shared<const ZCIncrementalMerkleTree>()), flags(0) {}
 };
 
 struct CNullifiersCacheEntry
@@ -464,7 +466,8 @@ typedef boost::unordered_map<uint256, CNullifiersCacheEntry, CCoinsKeyHasher> CN
 
 typedef boost::unordered_map<uint256, CSidechainsCacheEntry, CCoinsKeyHasher> CSidechainsMap;
 typedef boost::unordered_map<int, CSidechainEventsCacheEntry> CSidechainEventsMap;
-typedef boost::unordered_map<std::pair<uint256, CFieldElement>, CCswNullifiersCacheEntry, CCswNullifiersKeyHasher> CCswNullifiersMap;
+// Keyed by sidechain id and raw nullifier encoding, see CswNullifierKey
+typedef boost::unordered_map<std::pair<uint256, uint256>, CCswNullifiersCacheEntry, CCswNullifiersKeyHasher> CCswNullifiersMap;
 
 struct CCoinsStats
 {
@@ -42,14 +42,14 @@ void makeSerializedTxObj(Stream& is, int objVer, std::unique_ptr<CTransactionBas
     {
         CTransaction tx(objVer);
         tx.SerializationOpInternal(is, CSerActionUnserialize(), nType, nVersion);
-        pTxBase.reset(new CTransaction(tx));
+        pTxBase.reset(new CTransaction(std::move(tx)));
     }
     else
     if (CTransactionBase::IsCertificate(objVer) )
     {
         CScCertificate cert(objVer);
         cert.SerializationOpInternal(is, CSerActionUnserialize(), nType, nVersion);
-        pTxBase.reset(new CScCertificate(cert));
+        pTxBase.reset(new CScCertificate(std::move(cert)));
     }
     else
     {
@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <math.h>
 #include <stdexcept>
 
 #include <boost/thread.hpp>
@@ -723,6 +724,250 @@ invalidsolution:
 
     return false;
 }
+
+// Big-endian value of a collision chunk
+static inline uint64_t ReadChunk(const unsigned char* p, size_t len)
+{
+    uint64_t v = 0;
+    for (size_t i = 0; i < len; i++)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+template<unsigned int N, unsigned int K>
+EquihashArena<N,K>::EquihashArena() : nDropped(0)
+{
+    // Room for the average bucket plus a margin of several standard deviations
+    const size_t nAverage = InitSize / NumBuckets;
+    nBucketSize = nAverage + 8 * (size_t)sqrt((double)nAverage) + 16;
+    nSlots = NumBuckets * nBucketSize;
+    assert(nBucketSize < (1 << 16));
+
+    for (int i = 0; i < 2; i++) {
+        hashes[i].resize(nSlots * Eh::HashLength);
+        counts[i].resize(NumBuckets);
+    }
+    refs[0].resize(nSlots);
+    for (int r = 1; r < K; r++)
+        refs[r].resize(2 * nSlots);
+    sorted.reserve(nBucketSize);
+}
+
+template<unsigned int N, unsigned int K>
+size_t EquihashArena<N,K>::DynamicMemoryUsage() const
+{
+    size_t nUsage = sorted.capacity() * sizeof(uint64_t);
+    for (int i = 0; i < 2; i++)
+        nUsage += hashes[i].capacity() + counts[i].capacity() * sizeof(uint32_t);
+    for (int r = 0; r < K; r++)
+        nUsage += refs[r].capacity() * sizeof(uint32_t);
+    return nUsage;
+}
+
+template<unsigned int N, unsigned int K>
+void EquihashArena<N,K>::GenerateRows(const eh_HashState& base_state, const std::function<bool(EhSolverCancelCheck)>& cancelled)
+{
+    std::fill(counts[0].begin(), counts[0].end(), 0);
+    unsigned char tmpHash[Eh::HashOutput];
+    unsigned char row[Eh::HashLength];
+
+    // Each hash output provides several rows, which go straight to their bucket
+    for (eh_index g = 0; g * Eh::IndicesPerHashOutput < InitSize; g++) {
+        GenerateHash(base_state, g, tmpHash, Eh::HashOutput);
+        for (eh_index i = 0; i < Eh::IndicesPerHashOutput; i++) {
+            const eh_index index = g * Eh::IndicesPerHashOutput + i;
+            if (index >= InitSize)
+                break;
+            ExpandArray(tmpHash + (i * N/8), N/8, row, Eh::HashLength, Eh::CollisionBitLength);
+            const size_t bucket = ReadChunk(row, Eh::CollisionByteLength) >> (Eh::CollisionBitLength - BucketBits);
+            if (counts[0][bucket] == nBucketSize) {
+                nDropped++;
+                continue;
+            }
+            const size_t slot = bucket * nBucketSize + counts[0][bucket]++;
+            memcpy(&hashes[0][slot * Eh::HashLength], row, Eh::HashLength);
+            refs[0][slot] = index;
+        }
+        if ((g & 0xfff) == 0 && cancelled(ListGeneration)) throw solver_cancelled;
+    }
+}
+
+template<unsigned int N, unsigned int K>
+void EquihashArena<N,K>::CollideRows(int r, const std::function<bool(EhSolverCancelCheck)>& cancelled)
+{
+    const std::vector<unsigned char>& src = hashes[(r - 1) & 1];
+    const std::vector<uint32_t>& srcCounts = counts[(r - 1) & 1];
+    std::vector<unsigned char>& dst = hashes[r & 1];
+    std::vector<uint32_t>& dstCounts = counts[r & 1];
+    const size_t CollisionByteLength = Eh::CollisionByteLength;
+    const size_t width = Eh::HashLength - r * CollisionByteLength;
+
+    std::fill(dstCounts.begin(), dstCounts.end(), 0);
+    for (size_t bucket = 0; bucket < NumBuckets; bucket++) {
+        const size_t n = srcCounts[bucket];
+        const size_t first = bucket * nBucketSize;
+
+        // Rows colliding on the whole chunk are adjacent once sorted
+        sorted.clear();
+        for (size_t p = 0; p < n; p++)
+            sorted.push_back((ReadChunk(&src[(first + p) * Eh::HashLength], CollisionByteLength) << 16) | p);
+        std::sort(sorted.begin(), sorted.end());
+
+        size_t i = 0;
+        while (i + 1 < n) {
+            size_t j = i + 1;
+            while (j < n && (sorted[j] >> 16) == (sorted[i] >> 16))
+                j++;
+
+            for (size_t l = i; l < j - 1; l++) {
+                for (size_t m = l + 1; m < j; m++) {
+                    const uint32_t xs = first + (sorted[l] & 0xffff);
+                    const uint32_t ys = first + (sorted[m] & 0xffff);
+                    if (r > 1 && (refs[r-1][2*xs] == refs[r-1][2*ys] || refs[r-1][2*xs] == refs[r-1][2*ys+1] ||
+                                  refs[r-1][2*xs+1] == refs[r-1][2*ys] || refs[r-1][2*xs+1] == refs[r-1][2*ys+1]))
+                        continue;
+
+                    const unsigned char* a = &src[xs * Eh::HashLength + CollisionByteLength];
+                    const unsigned char* b = &src[ys * Eh::HashLength + CollisionByteLength];
+                    uint64_t next = 0;
+                    for (size_t t = 0; t < CollisionByteLength; t++)
+                        next = (next << 8) | (a[t] ^ b[t]);
+                    const size_t dstBucket = next >> (Eh::CollisionBitLength - BucketBits);
+                    if (dstCounts[dstBucket] == nBucketSize) {
+                        nDropped++;
+                        continue;
+                    }
+
+                    const size_t slot = dstBucket * nBucketSize + dstCounts[dstBucket];
+                    unsigned char* row = &dst[slot * Eh::HashLength];
+                    unsigned char any = 0;
+                    for (size_t t = 0; t < width; t++) {
+                        row[t] = a[t] ^ b[t];
+                        any |= row[t];
+                    }
+                    // A row cancelling out entirely almost always has duplicate indices
+                    if (any == 0)
+                        continue;
+
+                    dstCounts[dstBucket]++;
+                    refs[r][2*slot] = xs;
+                    refs[r][2*slot+1] = ys;
+                }
+            }
+            i = j;
+        }
+        if ((bucket & 0x3f) == 0x3f && cancelled(ListColliding)) throw solver_cancelled;
+    }
+}
+
+template<unsigned int N, unsigned int K>
+void EquihashArena<N,K>::GetIndices(int r, uint32_t slot, eh_index* indices) const
+{
+    if (r == 0) {
+        indices[0] = refs[0][slot];
+        return;
+    }
+
+    // The subtree with the lowest first index goes on the left
+    const size_t half = (size_t)1 << (r - 1);
+    GetIndices(r - 1, refs[r][2*slot], indices);
+    GetIndices(r - 1, refs[r][2*slot+1], indices + half);
+    if (indices[half] < indices[0])
+        std::swap_ranges(indices, indices + half, indices + half);
+}
+
+template<unsigned int N, unsigned int K>
+bool EquihashArena<N,K>::Solve(const eh_HashState& base_state,
+                               const std::function<bool(std::vector<unsigned char>)> validBlock,
+                               const std::function<bool(EhSolverCancelCheck)> cancelled)
+{
+    nDropped = 0;
+
+    LogPrint("pow", "Generating first list\n");
+    GenerateRows(base_state, cancelled);
+
+    for (int r = 1; r < K; r++) {
+        LogPrint("pow", "Round %d:\n", r);
+        CollideRows(r, cancelled);
+        boost::this_thread::interruption_point();
+        if (cancelled(RoundEnd)) throw solver_cancelled;
+    }
+
+    // k+1) Find a collision on the last 2n/(k+1) bits
+    LogPrint("pow", "Final round:\n");
+    const std::vector<unsigned char>& src = hashes[(K - 1) & 1];
+    const std::vector<uint32_t>& srcCounts = counts[(K - 1) & 1];
+    const size_t hashLen = 2 * Eh::CollisionByteLength;
+    const size_t half = (size_t)1 << (K - 1);
+    std::vector<eh_index> indices(2 * half);
+    std::vector<eh_index> check(2 * half);
+    for (size_t bucket = 0; bucket < NumBuckets; bucket++) {
+        const size_t n = srcCounts[bucket];
+        const size_t first = bucket * nBucketSize;
+
+        sorted.clear();
+        for (size_t p = 0; p < n; p++)
+            sorted.push_back((ReadChunk(&src[(first + p) * Eh::HashLength], hashLen) << 16) | p);
+        std::sort(sorted.begin(), sorted.end());
+
+        size_t i = 0;
+        while (i + 1 < n) {
+            size_t j = i + 1;
+            while (j < n && (sorted[j] >> 16) == (sorted[i] >> 16))
+                j++;
+
+            for (size_t l = i; l < j - 1; l++) {
+                for (size_t m = l + 1; m < j; m++) {
+                    const uint32_t xs = first + (sorted[l] & 0xffff);
+                    const uint32_t ys = first + (sorted[m] & 0xffff);
+                    GetIndices(K - 1, xs, &indices[0]);
+                    GetIndices(K - 1, ys, &indices[half]);
+                    if (indices[half] < indices[0])
+                        std::swap_ranges(indices.begin(), indices.begin() + half, indices.begin() + half);
+
+                    check = indices;
+                    std::sort(check.begin(), check.end());
+                    if (std::adjacent_find(check.begin(), check.end()) != check.end())
+                        continue;
+
+                    auto soln = GetMinimalFromIndices(indices, Eh::CollisionBitLength);
+                    assert(soln.size() == equihash_solution_size(N, K));
+                    if (validBlock(soln))
+                        return true;
+                }
+            }
+            i = j;
+        }
+        if ((bucket & 0x3f) == 0x3f && cancelled(FinalColliding)) throw solver_cancelled;
+    }
+    LogPrint("pow", "- Number of rows dropped: %d\n", nDropped);
+
+    return false;
+}
+
+EhArenaSolver::EhArenaSolver() {}
+EhArenaSolver::~EhArenaSolver() {}
+
+bool EhArenaSolver::Solve(unsigned int n, unsigned int k, const eh_HashState& base_state,
+                          const std::function<bool(std::vector<unsigned char>)> validBlock,
+                          const std::function<bool(EhSolverCancelCheck)> cancelled)
+{
+    if (n == 96 && k == 3) {
+        if (!eh96_3) eh96_3.reset(new EquihashArena<96,3>());
+        return eh96_3->Solve(base_state, validBlock, cancelled);
+    } else if (n == 200 && k == 9) {
+        if (!eh200_9) eh200_9.reset(new EquihashArena<200,9>());
+        return eh200_9->Solve(base_state, validBlock, cancelled);
+    } else if (n == 96 && k == 5) {
+        if (!eh96_5) eh96_5.reset(new EquihashArena<96,5>());
+        return eh96_5->Solve(base_state, validBlock, cancelled);
+    } else if (n == 48 && k == 5) {
+        if (!eh48_5) eh48_5.reset(new EquihashArena<48,5>());
+        return eh48_5->Solve(base_state, validBlock, cancelled);
+    } else {
+        throw std::invalid_argument("Unsupported Equihash parameters");
+    }
+}
 #endif // ENABLE_MINING
 
 template<unsigned int N, unsigned int K>
@@ -782,6 +1027,7 @@ template bool Equihash<96,3>::BasicSolve(const eh_HashState& base_state,
 template bool Equihash<96,3>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(std::vector<unsigned char>)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
+template class EquihashArena<96,3>;
 #endif
 template bool Equihash<96,3>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
 
@@ -794,6 +1040,7 @@ template bool Equihash<200,9>::BasicSolve(const eh_HashState& base_state,
 template bool Equihash<200,9>::OptimisedSolve(const eh_HashState& base_state,
                                               const std::function<bool(std::vector<unsigned char>)> validBlock,
                                               const std::function<bool(EhSolverCancelCheck)> cancelled);
+template class EquihashArena<200,9>;
 #endif
 template bool Equihash<200,9>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
 
@@ -806,6 +1053,7 @@ template bool Equihash<96,5>::BasicSolve(const eh_HashState& base_state,
 template bool Equihash<96,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(std::vector<unsigned char>)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
+template class EquihashArena<96,5>;
 #endif
 template bool Equihash<96,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
 
@@ -818,5 +1066,6 @@ template bool Equihash<48,5>::BasicSolve(const eh_HashState& base_state,
 template bool Equihash<48,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(std::vector<unsigned char>)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
+template class EquihashArena<48,5>;
 #endif
 template bool Equihash<48,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
@@ -261,6 +261,77 @@ inline bool EhOptimisedSolveUncancellable(unsigned int n, unsigned int k, const
     return EhOptimisedSolve(n, k, base_state, validBlock,
                             [](EhSolverCancelCheck pos) { return false; });
 }
+
+/**
+ * Equihash solver working in bucketed slot arenas, allocated once and reused
+ * for every following nonce.
+ *
+ * Each round appends its rows to the bucket of the bits they collide on next,
+ * so that collisions are searched within small buckets instead of sorting the
+ * whole list. A row only keeps its remaining hash bytes and the slots of the
+ * two rows it comes from, the indices are recovered from these references for
+ * the candidate solutions only. Rows overflowing a bucket are dropped, which
+ * loses a negligible fraction of the solutions.
+ *
+ * An instance is not thread safe, each mining thread owns one.
+ */
+template<unsigned int N, unsigned int K>
+class EquihashArena
+{
+private:
+    typedef Equihash<N,K> Eh;
+
+    enum : size_t { BucketBits=Eh::CollisionBitLength < 12 ? Eh::CollisionBitLength : 12 };
+    enum : size_t { NumBuckets=(size_t)1 << BucketBits };
+    enum : size_t { InitSize=(size_t)1 << (Eh::CollisionBitLength + 1) };
+
+    size_t nBucketSize;
+    size_t nSlots;
+    size_t nDropped;
+    std::vector<unsigned char> hashes[2]; //! rows of the previous and current round, HashLength bytes per slot
+    std::vector<uint32_t> counts[2];      //! rows per bucket
+    std::vector<uint32_t> refs[K];        //! per round: index (round 0) or the two parent slots of each slot
+    std::vector<uint64_t> sorted;         //! scratch space to sort a bucket
+
+    void GenerateRows(const eh_HashState& base_state, const std::function<bool(EhSolverCancelCheck)>& cancelled);
+    void CollideRows(int r, const std::function<bool(EhSolverCancelCheck)>& cancelled);
+    void GetIndices(int r, uint32_t slot, eh_index* indices) const;
+
+public:
+    EquihashArena();
+
+    bool Solve(const eh_HashState& base_state,
+               const std::function<bool(std::vector<unsigned char>)> validBlock,
+               const std::function<bool(EhSolverCancelCheck)> cancelled);
+
+    /** Rows dropped because their bucket was full, during the last run */
+    size_t GetDroppedRows() const { return nDropped; }
+    size_t DynamicMemoryUsage() const;
+};
+
+/** Keeps an arena solver per parameter set, created on first use */
+class EhArenaSolver
+{
+private:
+    std::unique_ptr<EquihashArena<96,3>> eh96_3;
+    std::unique_ptr<EquihashArena<200,9>> eh200_9;
+    std::unique_ptr<EquihashArena<96,5>> eh96_5;
+    std::unique_ptr<EquihashArena<48,5>> eh48_5;
+
+public:
+    EhArenaSolver();
+    ~EhArenaSolver();
+
+    bool Solve(unsigned int n, unsigned int k, const eh_HashState& base_state,
+               const std::function<bool(std::vector<unsigned char>)> validBlock,
+               const std::function<bool(EhSolverCancelCheck)> cancelled);
+    bool SolveUncancellable(unsigned int n, unsigned int k, const eh_HashState& base_state,
+                            const std::function<bool(std::vector<unsigned char>)> validBlock)
+    {
+        return Solve(n, k, base_state, validBlock,
+                     [](EhSolverCancelCheck pos) { return false; });
+    }
+};
 #endif // ENABLE_MINING
 
 #define EhIsValidSolution(n, k, base_state, soln, ret)   \
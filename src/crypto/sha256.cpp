@@ -9,6 +9,10 @@
 #include <string.h>
 #include <stdexcept>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // Internal implementation code.
 namespace
 {
@@ -128,6 +132,121 @@ void Transform(uint32_t* s, const unsigned char* chunk)
     s[7] += h;
 }
 
+
+/** Number of inputs compressed together by TransformLanes. */
+static const size_t LANES = 4;
+
+#if defined(__SSE2__)
+/** One 32-bit word of each of the LANES inputs, held in a single SSE2 register. */
+struct Lanes
+{
+    __m128i v;
+    Lanes(__m128i x) : v(x) {}
+    explicit Lanes(uint32_t x) : v(_mm_set1_epi32(x)) {}
+    Lanes(uint32_t l0, uint32_t l1, uint32_t l2, uint32_t l3) : v(_mm_set_epi32(l3, l2, l1, l0)) {}
+    void Store(uint32_t out[LANES]) const { _mm_storeu_si128((__m128i*)out, v); }
+};
+Lanes inline operator+(Lanes x, Lanes y) { return _mm_add_epi32(x.v, y.v); }
+Lanes inline operator^(Lanes x, Lanes y) { return _mm_xor_si128(x.v, y.v); }
+Lanes inline operator&(Lanes x, Lanes y) { return _mm_and_si128(x.v, y.v); }
+Lanes inline operator|(Lanes x, Lanes y) { return _mm_or_si128(x.v, y.v); }
+template <int n> Lanes inline Shr(Lanes x) { return _mm_srli_epi32(x.v, n); }
+template <int n> Lanes inline Shl(Lanes x) { return _mm_slli_epi32(x.v, n); }
+#else
+/** One 32-bit word of each of the LANES inputs. */
+struct Lanes
+{
+    uint32_t v[LANES];
+    explicit Lanes(uint32_t x) { v[0] = v[1] = v[2] = v[3] = x; }
+    Lanes(uint32_t l0, uint32_t l1, uint32_t l2, uint32_t l3) { v[0] = l0; v[1] = l1; v[2] = l2; v[3] = l3; }
+    void Store(uint32_t out[LANES]) const { memcpy(out, v, sizeof(v)); }
+};
+#define SHA256_LANES_OP(op)                                               \
+    Lanes inline operator op(Lanes x, Lanes y)                            \
+    {                                                                     \
+        return Lanes(x.v[0] op y.v[0], x.v[1] op y.v[1], x.v[2] op y.v[2], x.v[3] op y.v[3]); \
+    }
+SHA256_LANES_OP(+)
+SHA256_LANES_OP(^)
+SHA256_LANES_OP(&)
+SHA256_LANES_OP(|)
+#undef SHA256_LANES_OP
+template <int n> Lanes inline Shr(Lanes x) { return Lanes(x.v[0] >> n, x.v[1] >> n, x.v[2] >> n, x.v[3] >> n); }
+template <int n> Lanes inline Shl(Lanes x) { return Lanes(x.v[0] << n, x.v[1] << n, x.v[2] << n, x.v[3] << n); }
+#endif
+
+template <int n> Lanes inline Rotr(Lanes x) { return Shr<n>(x) | Shl<32 - n>(x); }
+
+Lanes inline Ch(Lanes x, Lanes y, Lanes z) { return z ^ (x & (y ^ z)); }
+Lanes inline Maj(Lanes x, Lanes y, Lanes z) { return (x & y) | (z & (x | y)); }
+Lanes inline Sigma0(Lanes x) { return Rotr<2>(x) ^ Rotr<13>(x) ^ Rotr<22>(x); }
+Lanes inline Sigma1(Lanes x) { return Rotr<6>(x) ^ Rotr<11>(x) ^ Rotr<25>(x); }
+Lanes inline sigma0(Lanes x) { return Rotr<7>(x) ^ Rotr<18>(x) ^ Shr<3>(x); }
+Lanes inline sigma1(Lanes x) { return Rotr<17>(x) ^ Rotr<19>(x) ^ Shr<10>(x); }
+
+/** One round of SHA-256 on every lane. */
+void inline Round(Lanes a, Lanes b, Lanes c, Lanes& d, Lanes e, Lanes f, Lanes g, Lanes& h, uint32_t k, Lanes w)
+{
+    Lanes t1 = h + Sigma1(e) + Ch(e, f, g) + Lanes(k) + w;
+    Lanes t2 = Sigma0(a) + Maj(a, b, c);
+    d = d + t1;
+    h = t1 + t2;
+}
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+/**
+ * Compress LANES independent 64-byte chunks from the initial state into
+ * LANES consecutive 32-byte outputs, running the rounds of all of them at
+ * once.
+ */
+void TransformLanes(unsigned char* out, const unsigned char* in)
+{
+    uint32_t init[8];
+    Initialize(init);
+
+    Lanes a(init[0]), b(init[1]), c(init[2]), d(init[3]), e(init[4]), f(init[5]), g(init[6]), h(init[7]);
+
+    Lanes w[16] = {
+        Lanes(0), Lanes(0), Lanes(0), Lanes(0), Lanes(0), Lanes(0), Lanes(0), Lanes(0),
+        Lanes(0), Lanes(0), Lanes(0), Lanes(0), Lanes(0), Lanes(0), Lanes(0), Lanes(0)};
+    for (size_t t = 0; t < 16; t++)
+        w[t] = Lanes(ReadBE32(in + 4 * t), ReadBE32(in + 64 + 4 * t), ReadBE32(in + 128 + 4 * t), ReadBE32(in + 192 + 4 * t));
+
+    for (size_t t = 0; t < 64; t += 8) {
+        if (t >= 16) {
+            // Extend the message schedule in place, 8 words at a time
+            for (size_t i = t & 15; i < (t & 15) + 8; i++)
+                w[i] = w[i] + sigma1(w[(i + 14) & 15]) + w[(i + 9) & 15] + sigma0(w[(i + 1) & 15]);
+        }
+        const Lanes* wt = w + (t & 15);
+        Round(a, b, c, d, e, f, g, h, K[t + 0], wt[0]);
+        Round(h, a, b, c, d, e, f, g, K[t + 1], wt[1]);
+        Round(g, h, a, b, c, d, e, f, K[t + 2], wt[2]);
+        Round(f, g, h, a, b, c, d, e, K[t + 3], wt[3]);
+        Round(e, f, g, h, a, b, c, d, K[t + 4], wt[4]);
+        Round(d, e, f, g, h, a, b, c, K[t + 5], wt[5]);
+        Round(c, d, e, f, g, h, a, b, K[t + 6], wt[6]);
+        Round(b, c, d, e, f, g, h, a, K[t + 7], wt[7]);
+    }
+
+    const Lanes* state[8] = {&a, &b, &c, &d, &e, &f, &g, &h};
+    for (size_t i = 0; i < 8; i++) {
+        uint32_t words[LANES];
+        (*state[i] + Lanes(init[i])).Store(words);
+        for (size_t l = 0; l < LANES; l++)
+            WriteBE32(out + 32 * l + 4 * i, words[l]);
+    }
+}
+
 } // namespace sha256
 } // namespace
 
@@ -197,3 +316,23 @@ CSHA256& CSHA256::Reset()
     sha256::Initialize(s);
     return *this;
 }
+
+void SHA256Compress64(unsigned char* output, const unsigned char* input, size_t blocks)
+{
+    while (blocks >= sha256::LANES) {
+        sha256::TransformLanes(output, input);
+        output += 32 * sha256::LANES;
+        input += 64 * sha256::LANES;
+        blocks -= sha256::LANES;
+    }
+    while (blocks) {
+        uint32_t s[8];
+        sha256::Initialize(s);
+        sha256::Transform(s, input);
+        for (size_t i = 0; i < 8; i++)
+            WriteBE32(output + 4 * i, s[i]);
+        output += 32;
+        input += 64;
+        blocks--;
+    }
+}
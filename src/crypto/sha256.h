@@ -29,4 +29,13 @@ private:
     void FinalizeNoPadding(unsigned char hash[OUTPUT_SIZE], bool enforce_compression);
 };
 
+/**
+ * Apply the SHA-256 compression function, without padding, to `blocks`
+ * independent 64-byte inputs laid out one after the other, writing the
+ * 32-byte results one after the other. Equivalent to running CSHA256 with
+ * FinalizeNoPadding over each input, but several inputs are compressed at
+ * once.
+ */
+void SHA256Compress64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include "blockdownload.h"
 #include "main.h"
 
 using namespace zen;
@@ -107,3 +108,45 @@ TEST(initialblockdwnld, checkIBDState) {
     // Restore active chain tip
     chainActive.SetTip(originalTip);
 }
+
+// The number of blocks in flight follows the rate at which the peer delivers them
+TEST(blockdownloadrate, windowFollowsDeliveryRate) {
+    CBlockDownloadRate fast, slow;
+    EXPECT_EQ(DEFAULT_BLOCKS_IN_TRANSIT_PER_PEER, fast.GetWindow());
+    EXPECT_FALSE(fast.IsExpectedWithin(BLOCK_REASSIGN_MIN_DELAY * 10));
+
+    // All requested at once, then one block every 10ms from the fast peer and every second from the slow one
+    int64_t nRequestTime = 1000000;
+    for (int i = 1; i <= 50; i++) {
+        fast.Delivered(nRequestTime, nRequestTime + i * 10000);
+        slow.Delivered(nRequestTime, nRequestTime + i * 1000000);
+    }
+    EXPECT_EQ(MAX_BLOCKS_IN_TRANSIT_PER_PEER, fast.GetWindow());
+    EXPECT_EQ(MIN_BLOCKS_IN_TRANSIT_PER_PEER, slow.GetWindow());
+    EXPECT_EQ(50u, fast.GetDelivered());
+    EXPECT_TRUE(fast.IsExpectedWithin(slow.GetDelay()));
+    EXPECT_FALSE(slow.IsExpectedWithin(fast.GetDelay()));
+}
+
+// A block is handed to another peer only once its peer is late with it, and that peer's window shrinks
+TEST(blockdownloadrate, overdueBlocksAreReassigned) {
+    CBlockDownloadRate rate;
+    int64_t nNow = 1000000;
+    for (int i = 0; i < 20; i++) {
+        rate.Delivered(nNow - 100000, nNow);
+        nNow += 100000;
+    }
+    int nWindow = rate.GetWindow();
+
+    int64_t nRequestTime = nNow;
+    EXPECT_FALSE(rate.IsOverdue(nRequestTime, nRequestTime + BLOCK_REASSIGN_MIN_DELAY / 2));
+    EXPECT_TRUE(rate.IsOverdue(nRequestTime, nRequestTime + BLOCK_REASSIGN_MIN_DELAY + 1));
+
+    // Still delivering other blocks, but not this one
+    rate.Delivered(nRequestTime, nRequestTime + BLOCK_REASSIGN_MIN_DELAY);
+    EXPECT_TRUE(rate.IsOverdue(nRequestTime - BLOCK_REASSIGN_MIN_DELAY, nRequestTime + BLOCK_REASSIGN_MIN_DELAY + 1));
+
+    rate.Reassigned(nRequestTime, nRequestTime + 10 * BLOCK_REASSIGN_MIN_DELAY);
+    EXPECT_EQ(1u, rate.GetReassigned());
+    EXPECT_LT(rate.GetWindow(), nWindow);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include "blockfilecache.h"
+#include "chainparams.h"
+#include "main.h"
+#include "script/script.h"
+#include "streams.h"
+#include "util.h"
+#include "version.h"
+
+class BlockFileCacheTestSuite: public ::testing::Test {
+public:
+    BlockFileCacheTestSuite():
+        dataDirLocation(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path())
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        boost::filesystem::create_directories(dataDirLocation);
+        mapArgs["-datadir"] = dataDirLocation.string();
+        ClearDatadirCache();
+    }
+
+    ~BlockFileCacheTestSuite()
+    {
+        ClearDatadirCache();
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(dataDirLocation.string(), ec);
+    }
+
+protected:
+    CBlock createBlock(uint32_t nTime)
+    {
+        CBlock block;
+        block.nTime = nTime;
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.addOut(CTxOut(1, CScript() << OP_TRUE));
+        block.vtx.push_back(mtx);
+        return block;
+    }
+
+    std::string serialize(const CBlock& block)
+    {
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << block;
+        return ss.str();
+    }
+
+    boost::filesystem::path dataDirLocation;
+};
+
+TEST_F(BlockFileCacheTestSuite, BlockBytesAreReadFromMappedFile)
+{
+    CBlockFileCache cache;
+    CBlock block = createBlock(1);
+    CDiskBlockPos pos(0, 0);
+    ASSERT_TRUE(WriteBlockToDisk(block, pos, Params().MessageStart()));
+
+    CBlockFileBytes bytes;
+    ASSERT_TRUE(cache.ReadBlockBytes(pos, bytes));
+    EXPECT_EQ(serialize(block), std::string(bytes.begin(), bytes.end()));
+
+    CBlock readBlock;
+    CSpanReader reader(bytes.begin(), bytes.end(), SER_DISK, CLIENT_VERSION);
+    reader >> readBlock;
+    EXPECT_TRUE(reader.empty());
+    EXPECT_EQ(block.GetHash(), readBlock.GetHash());
+
+    CBlockFileCacheStats stats = cache.GetStats();
+    EXPECT_EQ(1u, stats.nMappedReads);
+    EXPECT_EQ(bytes.size(), stats.nBytesRead);
+    EXPECT_EQ(1u, stats.nMaps);
+}
+
+TEST_F(BlockFileCacheTestSuite, FileIsMappedAgainOnceGrown)
+{
+    CBlockFileCache cache;
+    CBlock first = createBlock(1);
+    CDiskBlockPos firstPos(0, 0);
+    ASSERT_TRUE(WriteBlockToDisk(first, firstPos, Params().MessageStart()));
+
+    CBlockFileBytes firstBytes;
+    ASSERT_TRUE(cache.ReadBlockBytes(firstPos, firstBytes));
+
+    // Appended after the first one, as FindBlockPos would place it
+    CBlock second = createBlock(2);
+    CDiskBlockPos secondPos(0, firstPos.nPos + firstBytes.size());
+    ASSERT_TRUE(WriteBlockToDisk(second, secondPos, Params().MessageStart()));
+    EXPECT_GT(secondPos.nPos, firstPos.nPos);
+
+    CBlockFileBytes secondBytes;
+    ASSERT_TRUE(cache.ReadBlockBytes(secondPos, secondBytes));
+    EXPECT_EQ(serialize(second), std::string(secondBytes.begin(), secondBytes.end()));
+    EXPECT_EQ(2u, cache.GetStats().nMaps);
+    EXPECT_EQ(1u, cache.GetStats().nMappedFiles);
+
+    // The bytes read before stay valid even though their mapping was replaced
+    EXPECT_EQ(serialize(first), std::string(firstBytes.begin(), firstBytes.end()));
+}
+
+TEST_F(BlockFileCacheTestSuite, MissingOrCorruptedRecordIsNotRead)
+{
+    CBlockFileCache cache;
+    CBlockFileBytes bytes;
+    EXPECT_FALSE(cache.ReadBlockBytes(CDiskBlockPos(3, 8), bytes));
+
+    CBlock block = createBlock(1);
+    CDiskBlockPos pos(0, 0);
+    ASSERT_TRUE(WriteBlockToDisk(block, pos, Params().MessageStart()));
+    EXPECT_FALSE(cache.ReadBlockBytes(CDiskBlockPos(0, pos.nPos + 1), bytes));
+    EXPECT_EQ(0u, cache.GetStats().nMappedReads);
+}
+
+TEST_F(BlockFileCacheTestSuite, DecodedBlocksAreBoundedBySize)
+{
+    CBlockFileCache cache;
+    cache.SetMaxBlockBytes(250);
+    std::shared_ptr<const CBlock> pblock = std::make_shared<const CBlock>(createBlock(1));
+
+    cache.AddBlock(CDiskBlockPos(0, 8), pblock, 100);
+    cache.AddBlock(CDiskBlockPos(0, 200), pblock, 100);
+    EXPECT_TRUE(cache.GetBlock(CDiskBlockPos(0, 8)) != nullptr);
+
+    // The least recently used block makes room for the new one
+    cache.AddBlock(CDiskBlockPos(1, 8), pblock, 100);
+    EXPECT_TRUE(cache.GetBlock(CDiskBlockPos(0, 200)) == nullptr);
+    EXPECT_TRUE(cache.GetBlock(CDiskBlockPos(0, 8)) != nullptr);
+    EXPECT_TRUE(cache.GetBlock(CDiskBlockPos(1, 8)) != nullptr);
+
+    // Too large to be cached at all
+    cache.AddBlock(CDiskBlockPos(1, 300), pblock, 300);
+    EXPECT_TRUE(cache.GetBlock(CDiskBlockPos(1, 300)) == nullptr);
+
+    CBlockFileCacheStats stats = cache.GetStats();
+    EXPECT_EQ(3u, stats.nBlockHits);
+    EXPECT_EQ(2u, stats.nBlockMisses);
+    EXPECT_EQ(2u, stats.nCachedBlocks);
+    EXPECT_EQ(200u, stats.nCachedBytes);
+
+    cache.ForgetFile(0);
+    EXPECT_TRUE(cache.GetBlock(CDiskBlockPos(0, 8)) == nullptr);
+    EXPECT_TRUE(cache.GetBlock(CDiskBlockPos(1, 8)) != nullptr);
+    EXPECT_EQ(100u, cache.GetStats().nCachedBytes);
+
+    cache.SetMaxBlockBytes(0);
+    EXPECT_TRUE(cache.GetBlock(CDiskBlockPos(1, 8)) == nullptr);
+    EXPECT_EQ(0u, cache.GetStats().nCachedBlocks);
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include "chain.h"
+#include "chainparams.h"
+#include "chainsnapshot.h"
+#include "coins.h"
+#include "random.h"
+#include "tx_creation_utils.h"
+#include "undo.h"
+
+#include <deque>
+
+class ChainSnapshotTestSuite: public ::testing::Test {
+protected:
+    // deque, so that the entries already linked keep their address
+    std::deque<CBlockIndex> blocks;
+    std::deque<uint256> hashes;
+
+    CBlockIndex* extend(CBlockIndex* pprev, int nBlocks)
+    {
+        for (int i = 0; i < nBlocks; i++) {
+            blocks.emplace_back();
+            hashes.push_back(GetRandHash());
+            CBlockIndex* pindex = &blocks.back();
+            pindex->pprev = pprev;
+            pindex->nHeight = pprev ? pprev->nHeight + 1 : 0;
+            pindex->phashBlock = &hashes.back();
+            pprev = pindex;
+        }
+        return pprev;
+    }
+
+    void checkMatches(const CChainSnapshot& snapshot, const CChain& chain)
+    {
+        ASSERT_EQ(chain.Height(), snapshot.Height());
+        EXPECT_EQ(chain.Tip(), snapshot.Tip());
+        for (int h = 0; h <= chain.Height(); h++)
+            ASSERT_EQ(chain[h], snapshot[h]);
+        EXPECT_EQ(nullptr, snapshot[chain.Height() + 1]);
+        EXPECT_EQ(nullptr, snapshot[-1]);
+    }
+};
+
+TEST_F(ChainSnapshotTestSuite, EmptyChain)
+{
+    CChain chain;
+    std::shared_ptr<const CChainSnapshot> snapshot = CChainSnapshot::Build(chain, nullptr);
+    EXPECT_EQ(-1, snapshot->Height());
+    EXPECT_EQ(nullptr, snapshot->Tip());
+
+    std::set<uint256> scIds;
+    snapshot->GetScIds(scIds);
+    EXPECT_TRUE(scIds.empty());
+    EXPECT_EQ(CSidechain::State::NOT_APPLICABLE, snapshot->GetSidechainState(GetRandHash()));
+}
+
+TEST_F(ChainSnapshotTestSuite, FollowsTheChainAcrossChunks)
+{
+    CChain chain;
+    CBlockIndex* pindex = extend(nullptr, 1);
+    chain.SetTip(pindex);
+    std::shared_ptr<const CChainSnapshot> snapshot = CChainSnapshot::Build(chain, nullptr);
+    checkMatches(*snapshot, chain);
+
+    // Block by block, across a chunk boundary
+    for (int i = 0; i < 5000; i++) {
+        pindex = extend(pindex, 1);
+        chain.SetTip(pindex);
+        std::shared_ptr<const CChainSnapshot> next = CChainSnapshot::Update(*snapshot, chain, nullptr, std::set<uint256>());
+        // The previous snapshot is left untouched
+        ASSERT_EQ(chain.Height() - 1, snapshot->Height());
+        ASSERT_EQ(pindex->pprev, snapshot->Tip());
+        snapshot = next;
+    }
+    checkMatches(*snapshot, chain);
+    EXPECT_TRUE(snapshot->Contains(chain[4095]));
+    EXPECT_EQ(chain[4096], snapshot->Next(chain[4095]));
+    EXPECT_EQ(nullptr, snapshot->Next(chain.Tip()));
+}
+
+TEST_F(ChainSnapshotTestSuite, ReorgAcrossChunkBoundary)
+{
+    CChain chain;
+    CBlockIndex* pfork = extend(nullptr, 4090);
+    CBlockIndex* pold = extend(pfork, 20);
+    chain.SetTip(pold);
+    std::shared_ptr<const CChainSnapshot> oldSnapshot = CChainSnapshot::Build(chain, nullptr);
+
+    // A longer branch forking below the boundary replaces the old one
+    CBlockIndex* pnew = extend(pfork, 30);
+    chain.SetTip(pnew);
+    std::shared_ptr<const CChainSnapshot> newSnapshot = CChainSnapshot::Update(*oldSnapshot, chain, nullptr, std::set<uint256>());
+    checkMatches(*newSnapshot, chain);
+
+    EXPECT_FALSE(newSnapshot->Contains(pold));
+    EXPECT_TRUE(newSnapshot->Contains(pfork));
+    EXPECT_EQ(nullptr, newSnapshot->Next(pold->pprev));
+    EXPECT_TRUE(oldSnapshot->Contains(pold));
+    EXPECT_EQ(pold, oldSnapshot->Tip());
+
+    // Back to a shorter chain, as after disconnecting blocks
+    chain.SetTip(pfork);
+    std::shared_ptr<const CChainSnapshot> shortSnapshot = CChainSnapshot::Update(*newSnapshot, chain, nullptr, std::set<uint256>());
+    checkMatches(*shortSnapshot, chain);
+    EXPECT_FALSE(shortSnapshot->Contains(pnew));
+}
+
+TEST_F(ChainSnapshotTestSuite, DisconnectRollsBackMaturedBalance)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    CCoinsView dummyBackingView;
+    CCoinsViewCache view(&dummyBackingView);
+
+    CTransaction scCreationTx = txCreationUtils::createNewSidechainTxWith(CAmount(10));
+    const uint256& scId = scCreationTx.GetScIdFromScCcOut(0);
+    int scCreationHeight = 5;
+    int maturityHeight = scCreationHeight + Params().ScCoinsMaturity();
+    ASSERT_TRUE(view.UpdateSidechain(scCreationTx, CBlock(), scCreationHeight));
+
+    CChain chain;
+    CBlockIndex* pindex = extend(nullptr, maturityHeight);
+    chain.SetTip(pindex);
+    std::shared_ptr<const CChainSnapshot> snapshot = CChainSnapshot::Build(chain, &view);
+    ASSERT_TRUE(snapshot->GetSidechain(scId) != nullptr);
+    EXPECT_EQ(CAmount(0), snapshot->GetSidechain(scId)->balance);
+
+    // Connect the block where the creation amount matures, the events being read before they are consumed
+    CSidechainEvents scEvents;
+    ASSERT_TRUE(view.GetSidechainEvents(maturityHeight, scEvents));
+    CBlockUndo blockUndo(IncludeScAttributes::ON);
+    std::vector<CScCertificateStatusUpdateInfo> certsStateInfo;
+    ASSERT_TRUE(view.HandleSidechainEvents(maturityHeight, blockUndo, &certsStateInfo));
+    chain.SetTip(extend(pindex, 1));
+    snapshot = CChainSnapshot::Update(*snapshot, chain, &view, scEvents.maturingScs);
+    EXPECT_EQ(CAmount(10), snapshot->GetSidechain(scId)->balance);
+
+    // Disconnect it: the revert restores the events of its height, so they are read after it
+    ASSERT_TRUE(view.RevertSidechainEvents(blockUndo, maturityHeight, &certsStateInfo));
+    scEvents = CSidechainEvents();
+    ASSERT_TRUE(view.GetSidechainEvents(maturityHeight, scEvents));
+    EXPECT_TRUE(scEvents.maturingScs.count(scId));
+    chain.SetTip(pindex);
+    snapshot = CChainSnapshot::Update(*snapshot, chain, &view, scEvents.maturingScs);
+
+    checkMatches(*snapshot, chain);
+    EXPECT_EQ(CAmount(0), snapshot->GetSidechain(scId)->balance);
+}
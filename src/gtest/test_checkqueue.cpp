@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include "checkqueue.h"
+
+#include <atomic>
+
+#include <boost/bind/bind.hpp>
+#include <boost/thread.hpp>
+
+namespace {
+
+std::atomic<unsigned int> nChecksRun(0);
+
+struct CountingCheck
+{
+    bool fOk;
+
+    CountingCheck(bool fOkIn = true) : fOk(fOkIn) {}
+
+    bool operator()()
+    {
+        nChecksRun++;
+        return fOk;
+    }
+
+    void swap(CountingCheck& check) { std::swap(fOk, check.fOk); }
+};
+
+class CheckQueueTest : public ::testing::Test
+{
+protected:
+    CCheckQueue<CountingCheck> queue;
+    boost::thread_group threads;
+
+    CheckQueueTest() : queue(16) {}
+
+    void SetUp()
+    {
+        nChecksRun = 0;
+        for (int i = 0; i < 4; i++)
+            threads.create_thread(boost::bind(&CCheckQueue<CountingCheck>::Thread, &queue));
+    }
+
+    void TearDown()
+    {
+        queue.Quit();
+        threads.join_all();
+    }
+};
+
+} // anon namespace
+
+TEST_F(CheckQueueTest, RunsEveryCheck) {
+    for (unsigned int nRound = 1; nRound < 200; nRound += 17) {
+        nChecksRun = 0;
+        {
+            CCheckQueueControl<CountingCheck> control(&queue);
+            for (unsigned int i = 0; i < nRound; i++) {
+                std::vector<CountingCheck> vChecks(i % 5 + 1);
+                control.Add(vChecks);
+            }
+            EXPECT_TRUE(control.Wait());
+        }
+        unsigned int nExpected = 0;
+        for (unsigned int i = 0; i < nRound; i++)
+            nExpected += i % 5 + 1;
+        EXPECT_EQ(nChecksRun, nExpected);
+        EXPECT_TRUE(queue.IsIdle());
+    }
+}
+
+TEST_F(CheckQueueTest, AbortsOnFailure) {
+    {
+        CCheckQueueControl<CountingCheck> control(&queue);
+        std::vector<CountingCheck> vChecks(100000, CountingCheck(false));
+        control.Add(vChecks);
+        EXPECT_FALSE(control.Wait());
+    }
+    // each thread stops at its first failure, the checks left are dropped
+    EXPECT_GE(nChecksRun, 1);
+    EXPECT_LE(nChecksRun, 5);
+    EXPECT_TRUE(queue.IsIdle());
+
+    // the queue is ready for the next round
+    nChecksRun = 0;
+    CCheckQueueControl<CountingCheck> control(&queue);
+    std::vector<CountingCheck> vChecks(1000);
+    control.Add(vChecks);
+    EXPECT_TRUE(control.Wait());
+    EXPECT_EQ(nChecksRun, 1000);
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include "chainparams.h"
+#include "random.h"
+#include "sc/cswnullifiers.h"
+#include "txdb.h"
+
+#include <map>
+
+class CswNullifiersTestSuite: public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+    };
+
+protected:
+    uint256 nullifierKey(unsigned char b0, unsigned char b1)
+    {
+        uint256 key;
+        key.begin()[0] = b0;
+        key.begin()[1] = b1;
+        return key;
+    }
+
+    void writeNullifier(CCoinsViewDB& db, const uint256& scId, const uint256& nullifier, CCswNullifiersCacheEntry::Flags flag)
+    {
+        CCoinsMap mapCoins;
+        CAnchorsMap mapAnchors;
+        CNullifiersMap mapNullifiers;
+        CSidechainsMap mapSidechains;
+        CSidechainEventsMap mapSidechainEvents;
+        CCswNullifiersMap cswNullifiers;
+        cswNullifiers[std::make_pair(scId, nullifier)] = CCswNullifiersCacheEntry(flag);
+        ASSERT_TRUE(db.BatchWrite(mapCoins, uint256(), uint256(), mapAnchors, mapNullifiers,
+                                  mapSidechains, mapSidechainEvents, cswNullifiers));
+    }
+};
+
+TEST_F(CswNullifiersTestSuite, TxMapBehavesAsAnOrderedMap)
+{
+    // Few distinct keys make slots collide, wrap around and get emptied often
+    for (int round = 0; round < 50; round++) {
+        CCswNullifierTxMap nullifiers;
+        std::map<uint256, uint256> expected;
+        int nKeys = 1 + insecure_rand() % 200;
+
+        for (int op = 0; op < 2000; op++) {
+            uint256 nullifier = nullifierKey(insecure_rand() % nKeys, insecure_rand() % 2);
+            switch (insecure_rand() % 3) {
+                case 0: {
+                    uint256 txHash = GetRandHash();
+                    nullifiers.set(nullifier, txHash);
+                    expected[nullifier] = txHash;
+                    break;
+                }
+                case 1:
+                    ASSERT_EQ(expected.erase(nullifier) != 0, nullifiers.erase(nullifier));
+                    break;
+                default: {
+                    const uint256* txHash = nullifiers.find(nullifier);
+                    ASSERT_EQ(expected.count(nullifier) != 0, txHash != nullptr);
+                    if (txHash)
+                        ASSERT_EQ(expected[nullifier], *txHash);
+                }
+            }
+            ASSERT_EQ(expected.size(), nullifiers.size());
+        }
+
+        size_t nVisited = 0;
+        for (const auto& entry : nullifiers) {
+            ASSERT_EQ(expected.at(entry.nullifier), entry.txHash);
+            nVisited++;
+        }
+        ASSERT_EQ(expected.size(), nVisited);
+    }
+}
+
+TEST_F(CswNullifiersTestSuite, FilterIsRebuiltOnceFull)
+{
+    CCswNullifierFilter filter;
+    EXPECT_FALSE(filter.IsUsable());
+
+    filter.Reset(0);
+    EXPECT_TRUE(filter.IsUsable());
+    uint256 scId = GetRandHash();
+    EXPECT_FALSE(filter.MayContain(scId, nullifierKey(1, 0)));
+
+    std::vector<uint256> inserted;
+    while (filter.IsUsable()) {
+        inserted.push_back(GetRandHash());
+        filter.Insert(scId, inserted.back());
+    }
+    EXPECT_GT(inserted.size(), 1000u);
+
+    // Not usable anymore, but still without false negatives
+    for (const uint256& nullifier : inserted)
+        EXPECT_TRUE(filter.MayContain(scId, nullifier));
+}
+
+TEST_F(CswNullifiersTestSuite, DbLookupsGoThroughTheFilter)
+{
+    CCoinsViewDB chainStateDb(2 * 1024 * 1024, /*fMemory*/true, /*fWipe*/true);
+    uint256 scId = GetRandHash();
+    uint256 otherScId = GetRandHash();
+
+    // Written before the first lookup, found by the scan loading the filter
+    writeNullifier(chainStateDb, scId, nullifierKey(1, 1), CCswNullifiersCacheEntry::Flags::FRESH);
+    EXPECT_TRUE(chainStateDb.HaveCswNullifier(scId, CFieldElement(nullifierKey(1, 1))));
+    EXPECT_FALSE(chainStateDb.HaveCswNullifier(otherScId, CFieldElement(nullifierKey(1, 1))));
+    EXPECT_FALSE(chainStateDb.HaveCswNullifier(scId, CFieldElement(nullifierKey(2, 2))));
+
+    // Written once the filter is loaded
+    writeNullifier(chainStateDb, scId, nullifierKey(2, 2), CCswNullifiersCacheEntry::Flags::FRESH);
+    EXPECT_TRUE(chainStateDb.HaveCswNullifier(scId, CFieldElement(nullifierKey(2, 2))));
+
+    writeNullifier(chainStateDb, scId, nullifierKey(1, 1), CCswNullifiersCacheEntry::Flags::ERASED);
+    EXPECT_FALSE(chainStateDb.HaveCswNullifier(scId, CFieldElement(nullifierKey(1, 1))));
+    EXPECT_TRUE(chainStateDb.HaveCswNullifier(scId, CFieldElement(nullifierKey(2, 2))));
+}
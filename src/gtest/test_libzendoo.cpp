@@ -627,6 +627,39 @@ TEST(SidechainsField, NakedZendooFeatures_EmptyTreeCommitmentCalculation)
     EXPECT_TRUE(scTxCommitmentHash == emptySha) <<scTxCommitmentHash.ToString() << "\n" << emptySha.ToString();
 }
 
+TEST(SidechainsField, CachedCommitmentCalculation)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    const BlockchainTestManager& testManager = BlockchainTestManager::GetInstance();
+
+    std::vector<CTransaction> vtx;
+    std::vector<CScCertificate> vcert;
+    vtx.push_back(CTransaction());
+    EXPECT_TRUE(SidechainTxsCommitmentBuilder::getCommitment(vtx, vcert, testManager.CoinsViewCache().get()) ==
+                SidechainTxsCommitmentBuilder::getEmptyCommitment());
+
+    vtx.push_back(CreateDefaultTx(0));
+    vcert.push_back(CreateDefaultCert());
+
+    SidechainTxsCommitmentBuilder builder;
+    ASSERT_TRUE(builder.add(vtx[1]));
+    ASSERT_TRUE(builder.add(vcert[0], testManager.CoinsViewCache().get()));
+    const uint256 expected = builder.getCommitment();
+
+    // The second call finds the commitment in the cache
+    EXPECT_TRUE(SidechainTxsCommitmentBuilder::getCommitment(vtx, vcert, testManager.CoinsViewCache().get()) == expected);
+    EXPECT_TRUE(SidechainTxsCommitmentBuilder::getCommitment(vtx, vcert, testManager.CoinsViewCache().get()) == expected);
+
+    // Txs and certs are committed in order
+    vtx.push_back(CreateDefaultTx(1));
+    std::swap(vtx[1], vtx[2]);
+    SidechainTxsCommitmentBuilder reorderedBuilder;
+    for (const CTransaction& tx : vtx)
+        ASSERT_TRUE(reorderedBuilder.add(tx));
+    ASSERT_TRUE(reorderedBuilder.add(vcert[0], testManager.CoinsViewCache().get()));
+    EXPECT_TRUE(SidechainTxsCommitmentBuilder::getCommitment(vtx, vcert, testManager.CoinsViewCache().get()) == reorderedBuilder.getCommitment());
+}
+
 /**
  * @brief This test checks the computation of the commitment tree of a known block.
  * The block is read from a raw byte string stored in a file.
@@ -468,3 +468,245 @@ TEST(ProcessMempoolMsgTest, TxesInMempoolAreRelayed)
     EXPECT_TRUE(theNode.pushedInvList.count(CInv{MSG_TX, scTx.GetHash()}));
     EXPECT_TRUE(theNode.pushedInvList.count(CInv{MSG_TX, cert.GetHash()}));
 }
+
+#ifdef ENABLE_ADDRESS_INDEXING
+TEST(Mempool, AddressIndexKeepsKeyOrderAcrossRemovals)
+{
+    CMempoolAddressIndex index;
+    uint160 address = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+
+    std::vector<uint256> txHashes;
+    for (int i = 0; i < 10; i++) {
+        uint256 txHash = GetRandHash();
+        CMempoolAddressIndex::DeltaList deltas;
+        deltas.push_back(std::make_pair(CMempoolAddressDeltaKey(1, address, txHash, 1, 0), CMempoolAddressDelta(i, 10)));
+        deltas.push_back(std::make_pair(CMempoolAddressDeltaKey(1, address, txHash, 0, 1), CMempoolAddressDelta(i, -20, uint256(), 0)));
+        index.add(txHash, deltas);
+        txHashes.push_back(txHash);
+    }
+    EXPECT_EQ(index.size(), 20);
+
+    index.remove(txHashes[3]);
+    index.remove(txHashes[7]);
+    EXPECT_EQ(index.size(), 16);
+
+    CMempoolAddressDeltaKey key(1, address, txHashes[5], 1, 0);
+    EXPECT_TRUE(index.setOutputStatus(key, CMempoolAddressDelta::LOW_QUALITY_CERT_BACKWARD_TRANSFER));
+    EXPECT_FALSE(index.setOutputStatus(CMempoolAddressDeltaKey(1, address, txHashes[3], 1, 0),
+                                       CMempoolAddressDelta::LOW_QUALITY_CERT_BACKWARD_TRANSFER));
+
+    CMempoolAddressIndex::DeltaList results;
+    index.get(1, address, results);
+    ASSERT_EQ(results.size(), 16);
+    for (size_t i = 1; i < results.size(); i++) {
+        EXPECT_TRUE(CMempoolAddressDeltaKeyCompare()(results[i-1].first, results[i].first));
+    }
+    for (const auto& item : results) {
+        EXPECT_NE(item.first.txhash, txHashes[3]);
+        EXPECT_NE(item.first.txhash, txHashes[7]);
+        if (item.first.txhash == txHashes[5] && item.first.index == 1)
+            EXPECT_EQ(item.second.outStatus, CMempoolAddressDelta::LOW_QUALITY_CERT_BACKWARD_TRANSFER);
+    }
+
+    results.clear();
+    index.get(2, address, results);
+    EXPECT_TRUE(results.empty());
+
+    for (const uint256& txHash : txHashes)
+        index.remove(txHash);
+    EXPECT_EQ(index.size(), 0);
+}
+#endif // ENABLE_ADDRESS_INDEXING
+
+static CTransaction CreateSpendingTx(const COutPoint& prevout)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = prevout;
+    mtx.addOut(CTxOut(1000, CScript() << OP_TRUE));
+    return CTransaction(mtx);
+}
+
+TEST(Mempool, TrimToSizeEvictsLowestFeeRatePackages)
+{
+    CTxMemPool pool(CFeeRate(1000));
+    int64_t nNow = GetTime();
+    SetMockTime(nNow);
+
+    // A cheap parent whose child pays a lot is evicted with it
+    CTransaction parent = CreateSpendingTx(COutPoint(GetRandHash(), 0));
+    CTransaction child = CreateSpendingTx(COutPoint(parent.GetHash(), 0));
+    CTransaction other = CreateSpendingTx(COutPoint(GetRandHash(), 0));
+    pool.addUnchecked(parent.GetHash(), CTxMemPoolEntry(parent, 1000, nNow, 0, 1));
+    pool.addUnchecked(child.GetHash(), CTxMemPoolEntry(child, 100000, nNow, 0, 1));
+    pool.addUnchecked(other.GetHash(), CTxMemPoolEntry(other, 10000, nNow, 0, 1));
+    EXPECT_EQ(CFeeRate(0), pool.GetMinFee(1));
+
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1, removedTxs, removedCerts);
+    EXPECT_EQ(2, removedTxs.size());
+    EXPECT_FALSE(pool.existsTx(parent.GetHash()));
+    EXPECT_FALSE(pool.existsTx(child.GetHash()));
+    EXPECT_TRUE(pool.existsTx(other.GetHash()));
+
+    // The pool now asks for more than the package paid
+    CFeeRate packageRate(101000, parent.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION) +
+                                 child.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION));
+    CFeeRate minFee(packageRate.GetFeePerK() + 1000);
+    EXPECT_EQ(minFee, pool.GetMinFee(1));
+
+    // Prioritising an entry moves it in the eviction order
+    pool.PrioritiseTransaction(other.GetHash(), other.GetHash().ToString(), 0, 1000000);
+    CTransaction cheap = CreateSpendingTx(COutPoint(GetRandHash(), 0));
+    pool.addUnchecked(cheap.GetHash(), CTxMemPoolEntry(cheap, 20000, nNow, 0, 1));
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1, removedTxs, removedCerts);
+    EXPECT_TRUE(pool.existsTx(other.GetHash()));
+    EXPECT_FALSE(pool.existsTx(cheap.GetHash()));
+
+    // It only starts decaying once a block is found
+    CFeeRate bumpedFee = pool.GetMinFee(1);
+    SetMockTime(nNow + CTxMemPool::ROLLING_FEE_HALFLIFE);
+    EXPECT_EQ(bumpedFee, pool.GetMinFee(1));
+    std::vector<CTransaction> vtx;
+    pool.removeForBlock(vtx, 1, removedTxs, removedCerts);
+    SetMockTime(nNow + 2 * CTxMemPool::ROLLING_FEE_HALFLIFE);
+    EXPECT_EQ(bumpedFee.GetFeePerK() / 2, pool.GetMinFee(1).GetFeePerK());
+
+    SetMockTime(0);
+}
+
+TEST(Mempool, ExpireRemovesOldEntriesWithDependencies)
+{
+    CTxMemPool pool(CFeeRate(1000));
+
+    CTransaction parent = CreateSpendingTx(COutPoint(GetRandHash(), 0));
+    CTransaction child = CreateSpendingTx(COutPoint(parent.GetHash(), 0));
+    CTransaction recent = CreateSpendingTx(COutPoint(GetRandHash(), 0));
+    pool.addUnchecked(parent.GetHash(), CTxMemPoolEntry(parent, 1000, 100, 0, 1));
+    pool.addUnchecked(child.GetHash(), CTxMemPoolEntry(child, 1000, 300, 0, 1));
+    pool.addUnchecked(recent.GetHash(), CTxMemPoolEntry(recent, 1000, 300, 0, 1));
+
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    EXPECT_EQ(0, pool.Expire(100, removedTxs, removedCerts));
+    EXPECT_EQ(2, pool.Expire(200, removedTxs, removedCerts));
+    EXPECT_FALSE(pool.existsTx(parent.GetHash()));
+    EXPECT_FALSE(pool.existsTx(child.GetHash()));
+    EXPECT_TRUE(pool.existsTx(recent.GetHash()));
+    EXPECT_EQ(1, pool.sizeTx());
+}
+
+TEST(Mempool, HashesByDependenciesListParentsFirst)
+{
+    CTxMemPool pool(CFeeRate(1000));
+
+    CTransaction parent = CreateSpendingTx(COutPoint(GetRandHash(), 0));
+    CTransaction child = CreateSpendingTx(COutPoint(parent.GetHash(), 0));
+    CTransaction grandChild = CreateSpendingTx(COutPoint(child.GetHash(), 0));
+    // Added in reverse order, the pool doesn't check the inputs
+    pool.addUnchecked(grandChild.GetHash(), CTxMemPoolEntry(grandChild, 1000, 100, 0, 1));
+    pool.addUnchecked(child.GetHash(), CTxMemPoolEntry(child, 1000, 100, 0, 1));
+    pool.addUnchecked(parent.GetHash(), CTxMemPoolEntry(parent, 1000, 100, 0, 1));
+
+    std::vector<uint256> vHashes;
+    pool.queryHashesByDependencies(vHashes);
+    ASSERT_EQ(3u, vHashes.size());
+    EXPECT_EQ(parent.GetHash(), vHashes[0]);
+    EXPECT_EQ(child.GetHash(), vHashes[1]);
+    EXPECT_EQ(grandChild.GetHash(), vHashes[2]);
+}
+
+TEST(Mempool, DumpBeyondCompactSizeLimitReadsBack)
+{
+    CTxMemPool pool(CFeeRate(1000));
+
+    // More than a single serialized vector may hold
+    size_t nDumpSize = 0;
+    int64_t nTime = 100;
+    CTransaction last;
+    while (nDumpSize <= MAX_SERIALIZED_COMPACT_SIZE) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(100000, 1);
+        mtx.addOut(CTxOut(1000, CScript() << OP_TRUE));
+        last = CTransaction(mtx);
+        pool.addUnchecked(last.GetHash(), CTxMemPoolEntry(last, 1000, nTime++, 0, 1));
+        nDumpSize += last.GetSerializeSize(SER_DISK, CLIENT_VERSION);
+    }
+    pool.PrioritiseTransaction(last.GetHash(), last.GetHash().ToString(), 0, 5000);
+    uint256 hashBestBlock = GetRandHash();
+
+    boost::filesystem::path path = GetTempPath() / boost::filesystem::unique_path();
+    {
+        CAutoFile file(fopen(path.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+        ASSERT_FALSE(file.IsNull());
+        LOCK(pool.cs);
+        WriteMempoolDump(file, pool, hashBestBlock);
+    }
+
+    uint256 hashBestBlockRead;
+    std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+    std::vector<CMempoolDumpEntry> vEntries;
+    {
+        CAutoFile file(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+        ASSERT_TRUE(ReadMempoolDump(file, hashBestBlockRead, mapDeltas, vEntries));
+    }
+    EXPECT_EQ(hashBestBlock, hashBestBlockRead);
+    ASSERT_EQ(pool.sizeTx(), vEntries.size());
+    for (const CMempoolDumpEntry& entry : vEntries) {
+        EXPECT_FALSE(entry.fCertificate);
+        ASSERT_TRUE(pool.existsTx(entry.tx.GetHash()));
+        EXPECT_EQ(pool.mapTx.at(entry.tx.GetHash()).GetTime(), entry.nTime);
+    }
+    ASSERT_EQ(1u, mapDeltas.size());
+    EXPECT_EQ(5000, mapDeltas[last.GetHash()].second);
+
+    // A corrupted byte is caught by the checksum
+    {
+        FILE* pfile = fopen(path.string().c_str(), "r+b");
+        ASSERT_NE(nullptr, pfile);
+        fseek(pfile, nDumpSize / 2, SEEK_SET);
+        int c = fgetc(pfile);
+        fseek(pfile, nDumpSize / 2, SEEK_SET);
+        fputc(c ^ 0xff, pfile);
+        fclose(pfile);
+    }
+    {
+        CAutoFile file(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+        EXPECT_FALSE(ReadMempoolDump(file, hashBestBlockRead, mapDeltas, vEntries));
+    }
+    boost::filesystem::remove(path);
+}
+
+TEST(Mempool, SampledCheckSweepsThePoolAcrossCalls)
+{
+    CTxMemPool pool(CFeeRate(1000));
+    CCoinsView coinsDummy;
+    CCoinsViewCache view(&coinsDummy);
+
+    // Spending coins the view doesn't have
+    for (int i = 0; i < 3; i++) {
+        CTransaction tx = CreateSpendingTx(COutPoint(GetRandHash(), 0));
+        pool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, 1000, 100, 0, 1));
+    }
+
+    // Sampling is off by default
+    pool.check(&view);
+    EXPECT_EQ(0u, pool.GetCheckStats().nRuns);
+
+    pool.setSampledCheck(2, 1000000);
+    pool.check(&view);
+    CMempoolCheckStats stats = pool.GetCheckStats();
+    EXPECT_EQ(1u, stats.nRuns);
+    EXPECT_EQ(2u, stats.nEntriesChecked);
+    EXPECT_EQ(0u, stats.nSweeps);
+    EXPECT_EQ(2u, stats.nInconsistencies);
+
+    pool.check(&view);
+    stats = pool.GetCheckStats();
+    EXPECT_EQ(3u, stats.nEntriesChecked);
+    EXPECT_EQ(1u, stats.nSweeps);
+    EXPECT_EQ(3u, stats.nInconsistencies);
+}
@@ -11,6 +11,7 @@
 
 #include <stdexcept>
 
+#include "arith_uint256.h"
 #include "utilstrencodings.h"
 #include "version.h"
 #include "serialize.h"
@@ -299,3 +300,93 @@ TEST(merkletree, testZeroElements) {
         ASSERT_TRUE(newTree.root() == oldroot);
     }
 }
+
+TEST(merkletree, subtreeCacheAppend) {
+    // Appending a run of commitments through a shared subtree cache must
+    // give the same witnesses as appending them one at a time, both for
+    // witnesses older than the run and for those created inside it.
+    for (size_t before = 0; before < 12; before++) {
+        for (size_t count = 0; before + count <= 16; count++) {
+            ZCTestingIncrementalMerkleTree tree;
+            std::vector<ZCTestingIncrementalWitness> witnesses;
+
+            for (size_t i = 0; i < before; i++) {
+                uint256 cm = ArithToUint256(arith_uint256(i + 1));
+                tree.append(cm);
+                for (auto& w : witnesses) {
+                    w.append(cm);
+                }
+                witnesses.push_back(tree.witness());
+            }
+
+            std::vector<libzcash::SHA256Compress> commitments;
+            for (size_t i = before; i < before + count; i++) {
+                commitments.push_back(ArithToUint256(arith_uint256(i + 1)));
+            }
+            ZCTestingMerkleSubtreeCache subtrees(tree.size(), commitments);
+
+            std::vector<ZCTestingIncrementalWitness> cached = witnesses;
+            for (auto& w : cached) {
+                w.append(subtrees);
+            }
+
+            std::vector<ZCTestingIncrementalWitness> newWitnesses;
+            for (size_t i = 0; i < commitments.size(); i++) {
+                tree.append(commitments[i]);
+                for (auto& w : witnesses) {
+                    w.append(commitments[i]);
+                }
+                for (auto& w : newWitnesses) {
+                    w.append(commitments[i]);
+                }
+
+                ZCTestingIncrementalWitness w = tree.witness();
+                w.append(subtrees, i + 1);
+                cached.push_back(w);
+                newWitnesses.push_back(tree.witness());
+            }
+            witnesses.insert(witnesses.end(), newWitnesses.begin(), newWitnesses.end());
+
+            ASSERT_EQ(witnesses.size(), cached.size());
+            for (size_t i = 0; i < witnesses.size(); i++) {
+                ASSERT_TRUE(witnesses[i] == cached[i]);
+                ASSERT_TRUE(cached[i].root() == tree.root());
+            }
+        }
+    }
+}
+
+TEST(merkletree, batchAppend) {
+    // Appending a run of commitments at once must leave the tree exactly
+    // as appending them one at a time, whatever the tree held before.
+    for (size_t before = 0; before <= 16; before++) {
+        for (size_t count = 0; before + count <= 16; count++) {
+            ZCTestingIncrementalMerkleTree tree;
+            ZCTestingIncrementalMerkleTree batchTree;
+            std::vector<libzcash::SHA256Compress> commitments;
+
+            for (size_t i = 0; i < before + count; i++) {
+                uint256 cm = ArithToUint256(arith_uint256(i + 1));
+                tree.append(cm);
+                if (i < before) {
+                    batchTree.append(cm);
+                } else {
+                    commitments.push_back(cm);
+                }
+            }
+            batchTree.append(commitments);
+
+            ASSERT_TRUE(tree == batchTree);
+            ASSERT_TRUE(tree.root() == batchTree.root());
+            ASSERT_EQ(tree.size(), batchTree.size());
+        }
+    }
+
+    ZCTestingIncrementalMerkleTree fullTree;
+    fullTree.append(std::vector<libzcash::SHA256Compress>(16));
+    ASSERT_THROW(fullTree.append(std::vector<libzcash::SHA256Compress>(1)), std::runtime_error);
+
+    ZCTestingIncrementalMerkleTree almostFullTree;
+    almostFullTree.append(uint256());
+    ASSERT_THROW(almostFullTree.append(std::vector<libzcash::SHA256Compress>(16)), std::runtime_error);
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include "main.h"
+#include "notificationstream.h"
+#include "random.h"
+#include "streams.h"
+#include "txmempool.h"
+#include "version.h"
+
+TEST(NotificationStream, SequenceAndReplay) {
+    CTxMemPool pool(::minRelayTxFee);
+    // room for a few events only
+    CNotificationStream stream(pool, 1024);
+
+    std::vector<uint64_t> received;
+    stream.EventPublished.connect([&received](const CNotificationEventRef& event) {
+        received.push_back(event->nSequence);
+    });
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << GetRandHash();
+    for (uint64_t i = 0; i < 100; i++)
+        EXPECT_EQ(stream.Publish("test", ss), i);
+
+    ASSERT_EQ(received.size(), 100);
+    for (uint64_t i = 0; i < received.size(); i++)
+        EXPECT_EQ(received[i], i);
+    EXPECT_EQ(stream.GetNextSequence(), 100);
+
+    size_t nKept = stream.GetReplayBufferSize();
+    EXPECT_GT(nKept, 0);
+    EXPECT_LT(nKept, 100);
+
+    // the evicted events are reported through the oldest available one
+    std::vector<CNotificationEventRef> events;
+    uint64_t nFirst = stream.GetEventsSince(0, MAX_NOTIFICATION_REPLAY_EVENTS, events);
+    EXPECT_EQ(nFirst, 100 - nKept);
+    ASSERT_EQ(events.size(), nKept);
+    for (size_t i = 0; i < events.size(); i++) {
+        EXPECT_EQ(events[i]->nSequence, nFirst + i);
+        EXPECT_EQ(events[i]->topic, "test");
+        EXPECT_TRUE(std::equal(ss.begin(), ss.end(), events[i]->payload.begin()));
+    }
+
+    events.clear();
+    EXPECT_EQ(stream.GetEventsSince(98, 1, events), nFirst);
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0]->nSequence, 98);
+
+    events.clear();
+    stream.GetEventsSince(100, MAX_NOTIFICATION_REPLAY_EVENTS, events);
+    EXPECT_TRUE(events.empty());
+}
+
+TEST(NotificationStream, MempoolRemoval) {
+    CTxMemPool pool(::minRelayTxFee);
+    CNotificationStream stream(pool, DEFAULT_NOTIFICATION_REPLAY_BUFFER << 20);
+
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    mtx.addOut(CTxOut(1, CScript()));
+    CTransaction tx(mtx);
+
+    pool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, 0, 0, 0.0, 1));
+    EXPECT_EQ(stream.GetNextSequence(), 0);
+
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    pool.remove(tx, removedTxs, removedCerts);
+
+    std::vector<CNotificationEventRef> events;
+    stream.GetEventsSince(0, MAX_NOTIFICATION_REPLAY_EVENTS, events);
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0]->topic, NOTIFY_MEMPOOL_REMOVED);
+
+    CDataStream ss(events[0]->payload, SER_NETWORK, PROTOCOL_VERSION);
+    uint256 hash;
+    unsigned char fCertificate;
+    ss >> hash >> fCertificate;
+    EXPECT_EQ(hash, tx.GetHash());
+    EXPECT_EQ(fCertificate, 0);
+}
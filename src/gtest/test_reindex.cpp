@@ -14,7 +14,7 @@
 //includes for sut
 #include <main.h>
 
-//NOTES: LoadBlocksFromExternalFile invoke fclose on file via CBufferedFile dtor
+//NOTES: LoadBlocksFromExternalFile invoke fclose on file via CBlockFileReader dtor
 
 class CFakeCoinDB : public CCoinsViewDB
 {
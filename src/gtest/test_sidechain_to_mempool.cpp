@@ -805,6 +805,112 @@ TEST_F(SidechainsInMempoolTestSuite, UnconfirmedFwtTxToCeasedSidechainsAreRemove
     EXPECT_TRUE(removedCerts.size() == 0);
 }
 
+TEST_F(SidechainsInMempoolTestSuite, UnconfirmedFwtTxToCeasedSidechainsAreRemovedOnlyWhenTheSidechainIsChecked) {
+    CNakedCCoinsViewCache sidechainsView(pcoinsTip);
+
+    CSidechain initialScState;
+    uint256 scId = uint256S("aaaa");
+    initialScState.creationBlockHeight = 1492;
+    initialScState.fixedParams.withdrawalEpochLength = 14;
+    initialScState.balance = CAmount{1000};
+    initialScState.InitScFees();
+    int heightWhereAlive = initialScState.GetScheduledCeasingHeight() -1;
+
+    storeSidechainWithCurrentHeight(sidechainsView, scId, initialScState, heightWhereAlive);
+
+    CTransaction fwtTx = GenerateFwdTransferTx(scId, CAmount(10));
+    CTxMemPoolEntry fwtEntry(fwtTx, /*fee*/CAmount(5), /*time*/ 1000, /*priority*/1.0, /*height*/1987);
+    EXPECT_TRUE(mempool.addUnchecked(fwtTx.GetHash(), fwtEntry));
+
+    chainSettingUtils::ExtendChainActiveToHeight(initialScState.GetScheduledCeasingHeight());
+    sidechainsView.SetBestBlock(chainActive.Tip()->GetBlockHash());
+    ASSERT_TRUE(sidechainsView.GetSidechainState(scId) == CSidechain::State::CEASED);
+
+    // The block did not touch the sidechain: the FT is not checked
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    mempool.removeStaleTransactions(&sidechainsView, std::set<uint256>{uint256S("bbbb")}, removedTxs, removedCerts);
+    EXPECT_TRUE(removedTxs.size() == 0);
+    EXPECT_TRUE(mempool.exists(fwtTx.GetHash()));
+
+    // The sidechain ceased at the block height
+    CSidechainEvents scEvents;
+    scEvents.ceasingScs.insert(scId);
+    mempool.removeStaleTransactions(&sidechainsView, GetSidechainsTouchedByBlock(CBlock(), scEvents), removedTxs, removedCerts);
+    EXPECT_TRUE(removedTxs.size() == 1);
+    EXPECT_TRUE(std::find(removedTxs.begin(), removedTxs.end(), fwtTx) != removedTxs.end());
+    EXPECT_TRUE(removedCerts.size() == 0);
+}
+
+TEST_F(SidechainsInMempoolTestSuite, UnconfirmedBwtSpenderIsRemovedWhenTheSidechainCeases) {
+    uint256 scId = createAndStoreSidechain(/*ftScFee*/CAmount(0), /*mbtrScFee*/CAmount(0), /*mbtrScDataLength*/0, /*epochLength*/10);
+
+    CSidechain sidechain;
+    ASSERT_TRUE(pcoinsTip->GetSidechain(scId, sidechain));
+    int certHeight = sidechain.GetCertSubmissionWindowStart(/*certEpoch*/0);
+    chainSettingUtils::ExtendChainActiveToHeight(certHeight);
+
+    // Confirm the top quality cert of epoch 0, with a change output and a bwt
+    CScCertificate cert = GenerateCertificate(scId, /*epochNum*/0, CFieldElement{SAMPLE_FIELD}, /*inputAmount*/CAmount(20),
+        /*changeTotalAmount*/CAmount(10), /*numChangeOut*/1, /*bwtTotalAmount*/CAmount(0), /*numBwt*/1,
+        /*ftScFee*/CAmount(0), /*mbtrScFee*/CAmount(0), /*quality*/1);
+    {
+        CCoinsViewCache sidechainsView(pcoinsTip);
+        CBlockUndo certBlockUndo(IncludeScAttributes::ON);
+        ASSERT_TRUE(sidechainsView.UpdateSidechain(cert, certBlockUndo));
+        CTxUndo certUndo;
+        UpdateCoins(cert, sidechainsView, certUndo, certHeight, /*isBlockTopQualityCert*/true);
+        sidechainsView.SetBestBlock(chainActive.Tip()->GetBlockHash());
+        sidechainsView.Flush();
+    }
+
+    // No cert for epoch 1 comes: at ceasing-1 the bwt is spendable by the next block, the ceasing one
+    ASSERT_TRUE(pcoinsTip->GetSidechain(scId, sidechain));
+    int ceasingHeight = sidechain.GetScheduledCeasingHeight();
+    chainSettingUtils::ExtendChainActiveToHeight(ceasingHeight - 1);
+    pcoinsTip->SetBestBlock(chainActive.Tip()->GetBlockHash());
+    ASSERT_TRUE(pcoinsTip->AccessCoins(cert.GetHash())->isOutputMature(cert.nFirstBwtPos, ceasingHeight));
+
+    CMutableTransaction mutTx;
+    mutTx.vin.push_back(CTxIn(COutPoint(cert.GetHash(), cert.nFirstBwtPos), CScript(), -1));
+    CTransaction bwtSpender(mutTx);
+    CTxMemPoolEntry bwtSpenderEntry(bwtSpender, /*fee*/CAmount(1), /*time*/ 1000, /*priority*/1.0, /*height*/ceasingHeight - 1);
+    ASSERT_TRUE(mempool.addUnchecked(bwtSpender.GetHash(), bwtSpenderEntry));
+
+    mutTx.vin.clear();
+    mutTx.vin.push_back(CTxIn(COutPoint(cert.GetHash(), 0), CScript(), -1));
+    CTransaction changeSpender(mutTx);
+    CTxMemPoolEntry changeSpenderEntry(changeSpender, /*fee*/CAmount(1), /*time*/ 1000, /*priority*/1.0, /*height*/ceasingHeight - 1);
+    ASSERT_TRUE(mempool.addUnchecked(changeSpender.GetHash(), changeSpenderEntry));
+
+    // The ceasing block voids the bwts of the top quality cert
+    std::vector<CScCertificateStatusUpdateInfo> certsStateInfo;
+    {
+        CCoinsViewCache sidechainsView(pcoinsTip);
+        CBlockUndo ceasingBlockUndo(IncludeScAttributes::ON);
+        ASSERT_TRUE(sidechainsView.HandleSidechainEvents(ceasingHeight, ceasingBlockUndo, &certsStateInfo));
+        chainSettingUtils::ExtendChainActiveToHeight(ceasingHeight);
+        sidechainsView.SetBestBlock(chainActive.Tip()->GetBlockHash());
+        sidechainsView.Flush();
+    }
+
+    std::set<uint256> voidedCerts;
+    for(const CScCertificateStatusUpdateInfo& certInfo: certsStateInfo)
+        if (certInfo.bwtState == CScCertificateStatusUpdateInfo::BwtState::BWT_OFF)
+            voidedCerts.insert(certInfo.certHash);
+    ASSERT_TRUE(voidedCerts.count(cert.GetHash()));
+
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    mempool.removeSpendersOfVoidedCerts(pcoinsTip, voidedCerts, removedTxs, removedCerts);
+
+    EXPECT_FALSE(mempool.exists(bwtSpender.GetHash()));
+    EXPECT_TRUE(std::find(removedTxs.begin(), removedTxs.end(), bwtSpender) != removedTxs.end());
+    EXPECT_TRUE(mempool.exists(changeSpender.GetHash()));
+    EXPECT_TRUE(removedTxs.size() == 1);
+    EXPECT_TRUE(removedCerts.size() == 0);
+}
+
 TEST_F(SidechainsInMempoolTestSuite, UnconfirmedCsw_LargerThanSidechainBalanceAreRemovedFromMempool) {
     // This can happen upon faulty/malicious circuits
 
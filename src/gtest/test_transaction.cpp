@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 
+#include "clientversion.h"
+#include "primitives/block.h"
 #include "primitives/transaction.h"
+#include "random.h"
+#include "streams.h"
 #include "zcash/Note.hpp"
 #include "zcash/Address.hpp"
 
@@ -118,3 +122,50 @@ TEST(Transaction, JSDescriptionRandomizedGroth) {
     do_test(true);
 }
 
+
+TEST(Transaction, MovedTransactionKeepsHashAndContents) {
+    CMutableTransaction mtx;
+    mtx.vin.resize(2);
+    mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 1);
+    mtx.vin[1].prevout = COutPoint(GetRandHash(), 1);
+    mtx.addOut(CTxOut(600, CScript() << OP_TRUE));
+    mtx.nLockTime = 42;
+    const CTransaction expected(mtx);
+
+    // From a temporary mutable transaction
+    CMutableTransaction mtxToMove(mtx);
+    CTransaction fromMutable(std::move(mtxToMove));
+    EXPECT_EQ(expected.GetHash(), fromMutable.GetHash());
+    EXPECT_EQ(mtx.GetHash(), fromMutable.GetHash());
+    EXPECT_EQ(expected.GetVin(), fromMutable.GetVin());
+    EXPECT_EQ(expected.GetVout(), fromMutable.GetVout());
+    EXPECT_EQ(expected.GetLockTime(), fromMutable.GetLockTime());
+
+    // From another transaction, by construction and by assignment
+    CTransaction moved(std::move(fromMutable));
+    EXPECT_EQ(expected.GetHash(), moved.GetHash());
+    EXPECT_EQ(expected.GetVin(), moved.GetVin());
+    EXPECT_EQ(expected.GetVout(), moved.GetVout());
+
+    CTransaction assigned;
+    assigned = std::move(moved);
+    EXPECT_EQ(expected.GetHash(), assigned.GetHash());
+    EXPECT_EQ(expected.GetVin(), assigned.GetVin());
+    EXPECT_EQ(expected.GetVout(), assigned.GetVout());
+    EXPECT_EQ(expected.GetLockTime(), assigned.GetLockTime());
+
+    // Read back within a block, which builds each tx from the stream and moves it in
+    CBlock block;
+    block.vtx.push_back(expected);
+    block.vtx.push_back(CTransaction());
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    CBlock blockRead;
+    ss >> blockRead;
+    ASSERT_EQ(2u, blockRead.vtx.size());
+    EXPECT_EQ(expected.GetHash(), blockRead.vtx[0].GetHash());
+    EXPECT_EQ(expected.GetVin(), blockRead.vtx[0].GetVin());
+    EXPECT_EQ(expected.GetVout(), blockRead.vtx[0].GetVout());
+    EXPECT_EQ(block.vtx[1].GetHash(), blockRead.vtx[1].GetHash());
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include "chain.h"
+#include "utiltime.h"
+#include "validationinterface.h"
+
+#include <boost/thread.hpp>
+
+class RecordingListener : public CValidationInterface
+{
+public:
+    bool fSynchronous;
+    std::vector<const CBlockIndex*> tips;
+    std::vector<boost::thread::id> threads;
+
+    //! lock taken for every event, as a queued listener may need cs_main
+    boost::mutex* pgate;
+    int nSleepMillis;
+
+    RecordingListener(bool fSynchronousIn) : fSynchronous(fSynchronousIn), pgate(NULL), nSleepMillis(0) {}
+
+    bool IsSynchronous() const override { return fSynchronous; }
+    std::string ValidationInterfaceName() const override { return fSynchronous ? "sync" : "queued"; }
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindex) override {
+        if (pgate)
+            boost::lock_guard<boost::mutex> lock(*pgate);
+        if (nSleepMillis)
+            MilliSleep(nSleepMillis);
+        tips.push_back(pindex);
+        threads.push_back(boost::this_thread::get_id());
+    }
+};
+
+TEST(ValidationInterface, QueuedListenersGetEventsInOrder) {
+    CMainSignals signals;
+    RecordingListener syncListener(true);
+    RecordingListener queuedListener(false);
+    signals.Register(&syncListener);
+    signals.Register(&queuedListener);
+
+    std::vector<CBlockIndex> blocks(100);
+    signals.StartQueue(blocks.size());
+    for (const CBlockIndex& block : blocks)
+        signals.UpdatedBlockTip(&block);
+    signals.FlushQueue();
+
+    ASSERT_EQ(syncListener.tips.size(), blocks.size());
+    ASSERT_EQ(queuedListener.tips.size(), blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++) {
+        EXPECT_EQ(syncListener.tips[i], &blocks[i]);
+        EXPECT_EQ(queuedListener.tips[i], &blocks[i]);
+        EXPECT_EQ(syncListener.threads[i], boost::this_thread::get_id());
+        EXPECT_NE(queuedListener.threads[i], boost::this_thread::get_id());
+    }
+
+    CValidationQueueStats stats = signals.GetQueueStats();
+    EXPECT_TRUE(stats.fRunning);
+    EXPECT_EQ(stats.nDepth, 0);
+    EXPECT_EQ(stats.nQueued, blocks.size());
+    EXPECT_EQ(stats.nOverflowed, 0);
+    ASSERT_EQ(stats.listeners.size(), 2);
+    EXPECT_EQ(stats.listeners[0].name, "sync");
+    EXPECT_EQ(stats.listeners[0].nEvents, blocks.size());
+    EXPECT_EQ(stats.listeners[1].name, "queued");
+    EXPECT_EQ(stats.listeners[1].nEvents, blocks.size());
+
+    // once stopped, every listener is called synchronously
+    signals.StopQueue();
+    signals.UpdatedBlockTip(&blocks[0]);
+    EXPECT_EQ(queuedListener.tips.size(), blocks.size() + 1);
+    EXPECT_EQ(queuedListener.threads.back(), boost::this_thread::get_id());
+
+    signals.Unregister(&queuedListener);
+    signals.UpdatedBlockTip(&blocks[0]);
+    EXPECT_EQ(queuedListener.tips.size(), blocks.size() + 1);
+    EXPECT_EQ(syncListener.tips.size(), blocks.size() + 2);
+    signals.UnregisterAll();
+}
+
+TEST(ValidationInterface, FullQueueHoldsBackTheFiringThread) {
+    CMainSignals signals;
+    RecordingListener slowListener(false);
+    slowListener.nSleepMillis = 1;
+    signals.Register(&slowListener);
+
+    std::vector<CBlockIndex> blocks(50);
+    signals.StartQueue(2);
+    for (const CBlockIndex& block : blocks)
+        signals.UpdatedBlockTip(&block);
+    signals.FlushQueue();
+
+    // Nothing is lost, the firing thread waited for room instead
+    ASSERT_EQ(slowListener.tips.size(), blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++)
+        EXPECT_EQ(slowListener.tips[i], &blocks[i]);
+
+    CValidationQueueStats stats = signals.GetQueueStats();
+    EXPECT_EQ(stats.nQueued, blocks.size());
+    EXPECT_GT(stats.nBlocked, 0);
+    EXPECT_LE(stats.nPeakDepth, 2);
+    EXPECT_EQ(stats.nOverflowed, 0);
+    signals.UnregisterAll();
+}
+
+TEST(ValidationInterface, FullQueueWaitingForTheFiringThreadOverflows) {
+    CMainSignals signals;
+    boost::mutex gate;
+    RecordingListener gatedListener(false);
+    gatedListener.pgate = &gate;
+    signals.Register(&gatedListener);
+
+    std::vector<CBlockIndex> blocks(10);
+    signals.StartQueue(2);
+    {
+        // The listener waits for a lock held by the firing thread, as it would for cs_main
+        boost::lock_guard<boost::mutex> lock(gate);
+        for (const CBlockIndex& block : blocks)
+            signals.UpdatedBlockTip(&block);
+    }
+    signals.FlushQueue();
+
+    ASSERT_EQ(gatedListener.tips.size(), blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++)
+        EXPECT_EQ(gatedListener.tips[i], &blocks[i]);
+
+    CValidationQueueStats stats = signals.GetQueueStats();
+    EXPECT_GT(stats.nOverflowed, 0);
+    // Only waited until the queue thread was seen stalled, not once per event
+    EXPECT_GT(stats.nBlocked, 0);
+    EXPECT_LT(stats.nBlocked, stats.nOverflowed);
+    EXPECT_LT(stats.nTotalBlockedMicros, 1000000);
+    signals.UnregisterAll();
+}
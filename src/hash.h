@@ -153,6 +153,53 @@ public:
     }
 };
 
+/** Writes data to an underlying stream, while hashing the written data. */
+template<typename Sink>
+class CHashingWriter : public CHashWriter
+{
+private:
+    Sink* sink;
+
+public:
+    explicit CHashingWriter(Sink* sinkIn) : CHashWriter(sinkIn->GetType(), sinkIn->GetVersion()), sink(sinkIn) {}
+
+    CHashingWriter<Sink>& write(const char *pch, size_t size) {
+        sink->write(pch, size);
+        CHashWriter::write(pch, size);
+        return (*this);
+    }
+
+    template<typename T>
+    CHashingWriter<Sink>& operator<<(const T& obj) {
+        // Serialize to this stream
+        ::Serialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
+/** Reads data from an underlying stream, while hashing the read data. */
+template<typename Source>
+class CHashVerifier : public CHashWriter
+{
+private:
+    Source* source;
+
+public:
+    explicit CHashVerifier(Source* sourceIn) : CHashWriter(sourceIn->GetType(), sourceIn->GetVersion()), source(sourceIn) {}
+
+    void read(char *pch, size_t size) {
+        source->read(pch, size);
+        CHashWriter::write(pch, size);
+    }
+
+    template<typename T>
+    CHashVerifier<Source>& operator>>(T& obj) {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
 /** Compute the 256-bit hash of an object's serialization. */
 template<typename T>
 uint256 SerializeHash(const T& obj, int nType=SER_GETHASH, int nVersion=PROTOCOL_VERSION)
@@ -118,25 +118,22 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
     JSONRequest jreq;
     try {
         // Parse request
-        UniValue valRequest;
-        if (!valRequest.read(req->ReadBody()))
+        UniValue valBatch;
+        if (!jreq.read(req->ReadBody(), valBatch))
             throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
 
         std::string strReply;
-        // singleton request
-        if (valRequest.isObject()) {
-            jreq.parse(valRequest);
+        // array of requests
+        if (valBatch.isArray())
+            strReply = JSONRPCExecBatch(valBatch.get_array());
 
+        // singleton request
+        else {
             UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
 
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
-
-        // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
-        else
-            throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
+        }
 
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strReply);
@@ -178,6 +175,7 @@ bool StartHTTPRPC()
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
     RPCRegisterTimerInterface(httpRPCTimerInterface);
+    RPCSetBatchQueue(EnqueueHTTPWork);
     return true;
 }
 
@@ -190,6 +188,7 @@ void StopHTTPRPC()
 {
     LogPrint("rpc", "Stopping HTTP RPC server\n");
     UnregisterHTTPHandler("/", true);
+    RPCSetBatchQueue(RPCTaskQueue());
     if (httpRPCTimerInterface) {
         RPCUnregisterTimerInterface(httpRPCTimerInterface);
         delete httpRPCTimerInterface;
@@ -58,6 +58,22 @@ private:
     HTTPRequestHandler func;
 };
 
+/** Work item running a function on behalf of a handler */
+class HTTPFunctionWorkItem : public HTTPClosure
+{
+public:
+    HTTPFunctionWorkItem(const boost::function<void(void)>& func): func(func)
+    {
+    }
+    void operator()()
+    {
+        func();
+    }
+
+private:
+    boost::function<void(void)> func;
+};
+
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
  */
@@ -108,11 +124,11 @@ public:
             queue.pop_front();
         }
     }
-    /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    /** Enqueue a work item, unless the queue holds nLimit items (default: its depth) */
+    bool Enqueue(WorkItem* item, size_t nLimit = 0)
     {
         boost::unique_lock<boost::mutex> lock(cs);
-        if (queue.size() >= maxDepth) {
+        if (queue.size() >= (nLimit ? std::min(nLimit, maxDepth) : maxDepth)) {
             return false;
         }
         queue.push_back(item);
@@ -153,6 +169,12 @@ public:
             cond.wait(lock);
     }
 
+    /** Return maximum depth of queue */
+    size_t MaxDepth()
+    {
+        return maxDepth;
+    }
+
     /** Return current depth of queue */
     size_t Depth()
     {
@@ -667,3 +689,15 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
     }
 }
 
+bool EnqueueHTTPWork(const boost::function<void(void)>& func)
+{
+    if (!workQueue)
+        return false;
+    // Keep half of the queue for incoming requests
+    std::unique_ptr<HTTPFunctionWorkItem> item(new HTTPFunctionWorkItem(func));
+    if (!workQueue->Enqueue(item.get(), std::max(workQueue->MaxDepth() / 2, (size_t)1)))
+        return false;
+    item.release(); /* queue took ownership */
+    return true;
+}
+
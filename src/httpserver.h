@@ -44,6 +44,11 @@ void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPR
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Run func on a worker thread. Returns false if the work queue is
+ * more than half full, so that it keeps room for incoming requests.
+ */
+bool EnqueueHTTPWork(const boost::function<void(void)>& func);
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -14,6 +14,8 @@
 #ifdef ENABLE_MINING
 #include "base58.h"
 #endif
+#include "blockfilecache.h"
+#include "blockimport.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
@@ -24,6 +26,8 @@
 #include "metrics.h"
 #include "miner.h"
 #include "net.h"
+#include "notificationstream.h"
+#include "orphanpool.h"
 #include "rpc/server.h"
 #include "script/standard.h"
 #include "scheduler.h"
@@ -80,6 +84,7 @@ ZCJoinSplit* pzcashParams = NULL;
 CWallet* pwalletMain = NULL;
 #endif
 bool fFeeEstimatesInitialized = false;
+static bool fDumpMempoolLater = false;
 
 #if ENABLE_ZMQ
 static CZMQNotificationInterface* pzmqNotificationInterface = NULL;
@@ -195,6 +200,10 @@ void Shutdown()
     RenameThread("horizen-shutoff");
     mempool.AddTransactionsUpdated(1);
 
+    // Deliver the pending events while the listeners are still up, the
+    // later ones are dispatched synchronously
+    GetMainSignals().StopQueue();
+
     StopWsServer();
     StopHTTPRPC();
     StopREST();
@@ -215,6 +224,9 @@ void Shutdown()
     StopTorControl();
     UnregisterNodeSignals(GetNodeSignals());
 
+    if (fDumpMempoolLater && GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+        DumpMempool();
+
     if (fFeeEstimatesInitialized)
     {
         boost::filesystem::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
@@ -261,6 +273,12 @@ void Shutdown()
     }
 #endif
 
+    if (pnotificationStream) {
+        UnregisterValidationInterface(pnotificationStream);
+        delete pnotificationStream;
+        pnotificationStream = NULL;
+    }
+
 #ifndef WIN32
     try {
         boost::filesystem::remove(GetPidFile());
@@ -321,6 +339,7 @@ bool static Bind(const CService &addr, unsigned int flags) {
 void OnRPCStopped()
 {
     cvBlockChange.notify_all();
+    NotifyBlockTemplateEvent();
     LogPrint("rpc", "RPC stopped.\n");
 }
 
@@ -354,6 +373,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-daemon", _("Run in the background as a daemon and accept commands"));
 #endif
     }
+    strUsage += HelpMessageOpt("-blockreadcache=<n>", strprintf(_("Keep up to <n> megabytes of the blocks most recently read from disk decoded in memory (0 to disable, default: %u)"), DEFAULT_BLOCK_READ_CACHE));
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-disabledeprecation=<version>", strprintf(_("Disable block-height node deprecation and automatic shutdown (example: -disabledeprecation=%s)"),
         FormatVersion(CLIENT_VERSION)));
@@ -361,9 +381,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+    strUsage += HelpMessageOpt("-maxorphanpeersize=<n>", strprintf(_("Keep at most <n> kilobytes of unconnectable transactions received from each peer (default: %u)"), DEFAULT_MAX_ORPHAN_PEER_SIZE));
+    strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
+    strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(_("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY));
     strUsage += HelpMessageOpt("-mempooltxinputlimit=<n>", _("Set the maximum number of transparent inputs in a transaction that the mempool will accept (default: 0 = no limit applied)"));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), "zend.pid"));
 #endif
@@ -372,9 +396,12 @@ std::string HelpMessage(HelpMessageMode mode)
             "(default: 0 = disable pruning blocks, >%u = target size in MiB to use for block files)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild block chain index from current blk000??.dat files on startup"));
     strUsage += HelpMessageOpt("-reindexfast", _("Rebuild block chain index from current blk000??.dat files on startup, skipping expensive checks for blocks below checkpoints. It is incompatible with reindex"));
+    strUsage += HelpMessageOpt("-reindexthreads=<n>", strprintf(_("Set the number of threads parsing and checking block files during a reindex or an import (1 to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        MAX_BLOCK_IMPORT_THREADS, DEFAULT_BLOCK_IMPORT_THREADS));
     #if !defined(WIN32)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
+    strUsage += HelpMessageOpt("-validationqueuedepth=<n>", strprintf(_("Queue up to <n> validation events for the notification listeners that are not synchronous, 0 = call them synchronously (default: %u)"), DEFAULT_VALIDATION_QUEUE_DEPTH));
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), 0));
     strUsage += HelpMessageOpt("-maturityheightindex", strprintf(_("Maintain a maturity height index that stores for every height the cerficates that became mature, used by the getblockexpanded rpc call. It requires -txindex (default: %u)"), 0));
 
@@ -451,6 +478,10 @@ std::string HelpMessage(HelpMessageMode mode)
         CURRENCY_UNIT, FormatMoney(maxTxFee)));
     strUsage += HelpMessageOpt("-upgradewallet", _("Upgrade wallet to latest format") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-wallet=<file>", _("Specify wallet file (within data directory)") + " " + strprintf(_("(default: %s)"), "wallet.dat"));
+    strUsage += HelpMessageOpt("-witnessupdatethreads=<n>", strprintf(_("Set the number of threads updating note witnesses on block connection (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        1, MAX_WITNESS_UPDATE_THREADS, DEFAULT_WITNESS_UPDATE_THREADS));
+    strUsage += HelpMessageOpt("-walletloadthreads=<n>", strprintf(_("Set the number of threads decoding the wallet transactions on startup (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        1, MAX_WALLET_LOAD_THREADS, DEFAULT_WALLET_LOAD_THREADS));
     strUsage += HelpMessageOpt("-walletbroadcast", _("Make the wallet broadcast transactions") + " " + strprintf(_("(default: %u)"), true));
     strUsage += HelpMessageOpt("-walletnotify=<cmd>", _("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)"));
     strUsage += HelpMessageOpt("-zapwallettxes=<mode>", _("Delete all wallet transactions and only recover those parts of the blockchain through -rescan on startup") +
@@ -463,6 +494,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubevents=<address>", _("Enable publish sequence numbered transaction, certificate, block and mempool removal events in <address>"));
+    strUsage += HelpMessageOpt("-zmqreplayevents=<address>", _("Enable replay of the recent events to the subscribers that missed them in <address>"));
 #endif
 
 #if ENABLE_PROTON
@@ -471,11 +504,18 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-amqppubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-amqppubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-amqppubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-amqppubevents=<address>", _("Enable publish sequence numbered transaction, certificate, block and mempool removal events in <address>"));
+#endif
+
+#if ENABLE_ZMQ || ENABLE_PROTON
+    strUsage += HelpMessageOpt("-notificationreplaybuffer=<n>", strprintf(_("Keep up to <n> megabytes of recent events for replay (default: %u)"), DEFAULT_NOTIFICATION_REPLAY_BUFFER));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
     if (showDebug)
     {
+        strUsage += HelpMessageOpt("-checkmempoolsample=<n>", strprintf("Unless -checkmempool is set, check the consistency of the next <n> mempool entries each time the mempool changes, sweeping the whole pool over time (default: %u)", 0));
+        strUsage += HelpMessageOpt("-checkmempoolbudget=<n>", strprintf("Spend at most <n> milliseconds in each sampled mempool check (default: %u)", DEFAULT_CHECKMEMPOOL_BUDGET));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", 1));
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf("Flush database activity from memory pool to disk log every <n> megabytes (default: %u)", 100));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", 0));
@@ -573,7 +613,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup(_("Mining options:"));
     strUsage += HelpMessageOpt("-gen", strprintf(_("Generate coins (default: %u)"), 0));
     strUsage += HelpMessageOpt("-genproclimit=<n>", strprintf(_("Set the number of threads for coin generation if enabled (-1 = all cores, default: %d)"), 1));
-    strUsage += HelpMessageOpt("-equihashsolver=<name>", _("Specify the Equihash solver to be used if enabled (default: \"default\")"));
+    strUsage += HelpMessageOpt("-equihashsolver=<name>", _("Specify the Equihash solver to be used if enabled: \"default\", \"arena\" or \"tromp\" (default: \"default\")"));
     strUsage += HelpMessageOpt("-mineraddress=<addr>", _("Send mined coins to a specific single address"));
     strUsage += HelpMessageOpt("-minetolocalwallet", strprintf(
             _("Require that mined blocks use a coinbase address in the local wallet (default: %u)"),
@@ -593,6 +633,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcpassword=<pw>", _("Password for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 8231, 18231));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
+    strUsage += HelpMessageOpt("-rpcbatchmaxsize=<n>", strprintf(_("Reject JSON-RPC batches of more than <n> requests, 0 = unlimited (default: %u)"), DEFAULT_RPC_BATCH_MAX_SIZE));
+    strUsage += HelpMessageOpt("-rpcbatchmethodbudget=<n>", strprintf(_("Fail the remaining calls of a method in a JSON-RPC batch once they took <n> seconds, 0 = unlimited (default: %d)"), DEFAULT_RPC_BATCH_METHOD_BUDGET));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
@@ -685,6 +727,7 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
     {
         CImportingNow imp;
         int nFile = 0;
+        CBlockImportStats stats;
         if (fReindexFast) uiInterface.InitMessage(_("Reindexing block headers from files..."));
         while (fReindexFast)
         {
@@ -694,11 +737,13 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
             FILE *file = OpenBlockFile(pos, true);
             if (!file) break; // This error is logged in OpenBlockFile
             LogPrintf("Reindexing block file blk%05u.dat, headers-only...\n", (unsigned int)nFile);
-            LoadBlocksFromExternalFile(file, &pos, /*loadHeadersOnly*/true);
+            LoadBlocksFromExternalFile(file, &pos, /*loadHeadersOnly*/true, &stats);
             nFile++;
         }
-        if (fReindexFast)
-            LogPrintf("Headers-only reindexing finished. Going on with blocks\n");
+        if (fReindexFast) {
+            LogPrintf("Headers-only reindexing finished: %s. Going on with blocks\n", stats.ToString());
+            stats = CBlockImportStats();
+        }
 
         nFile = 0;
         uiInterface.InitMessage(_("Reindexing block from files..."));
@@ -710,7 +755,8 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
             FILE *file = OpenBlockFile(pos, true);
             if (!file) break; // This error is logged in OpenBlockFile
             LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-            LoadBlocksFromExternalFile(file, &pos, /*loadHeadersOnly*/false);
+            LoadBlocksFromExternalFile(file, &pos, /*loadHeadersOnly*/false, &stats);
+            LogPrintf("Reindexing throughput: %s\n", stats.ToString());
             nFile++;
         }
 
@@ -756,6 +802,12 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
         LogPrintf("Stopping after block import\n");
         StartShutdown();
     }
+
+    // Entries are accepted one by one under cs_main, the node keeps serving meanwhile
+    if (GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
+        LoadMempool();
+        fDumpMempoolLater = !ShutdownRequested();
+    }
 }
 
 void ThreadNotifyRecentlyAdded()
@@ -1093,6 +1145,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // Checkmempool and checkblockindex default to true in regtest mode
     mempool.setSanityCheck(GetBoolArg("-checkmempool", chainparams.DefaultConsistencyChecks()));
+    int64_t nCheckSample = GetArg("-checkmempoolsample", 0);
+    int64_t nCheckBudget = GetArg("-checkmempoolbudget", DEFAULT_CHECKMEMPOOL_BUDGET);
+    if (nCheckSample < 0 || nCheckBudget <= 0)
+        return InitError(_("-checkmempoolsample and -checkmempoolbudget must not be negative, and the budget must be positive"));
+    mempool.setSampledCheck(nCheckSample, nCheckBudget * 1000);
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", true);
 
@@ -1105,6 +1162,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // -reindexthreads=0 means autodetect, like -par
+    nBlockImportThreads = GetArg("-reindexthreads", DEFAULT_BLOCK_IMPORT_THREADS);
+    if (nBlockImportThreads <= 0)
+        nBlockImportThreads += GetNumCores();
+    nBlockImportThreads = std::max(1, std::min(nBlockImportThreads, MAX_BLOCK_IMPORT_THREADS));
+
     fServer = GetBoolArg("-server", false);
 
     // block pruning; get the amount of disk space (in MB) to allot for block & undo files
@@ -1185,6 +1248,15 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     nTxConfirmTarget = GetArg("-txconfirmtarget", DEFAULT_TX_CONFIRM_TARGET);
     bSpendZeroConfChange = GetBoolArg("-spendzeroconfchange", true);
     fSendFreeTransactions = GetBoolArg("-sendfreetransactions", false);
+    // -witnessupdatethreads=0 means autodetect, like -par
+    int nWitnessThreads = GetArg("-witnessupdatethreads", DEFAULT_WITNESS_UPDATE_THREADS);
+    if (nWitnessThreads <= 0)
+        nWitnessThreads += GetNumCores();
+    nWitnessUpdateThreads = std::max(1, std::min(nWitnessThreads, MAX_WITNESS_UPDATE_THREADS));
+    int nLoadThreads = GetArg("-walletloadthreads", DEFAULT_WALLET_LOAD_THREADS);
+    if (nLoadThreads <= 0)
+        nLoadThreads += GetNumCores();
+    nWalletLoadThreads = std::max(1, std::min(nLoadThreads, MAX_WALLET_LOAD_THREADS));
 
     std::string strWalletFile = GetArg("-wallet", "wallet.dat");
 #endif // ENABLE_WALLET
@@ -1208,6 +1280,13 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
 #endif
 
+    // The pool must at least hold a few full blocks worth of transactions
+    int64_t nMempoolSizeMax = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
+    if (nMempoolSizeMax < 0 || nMempoolSizeMax < 4 * (int64_t)MAX_BLOCK_SIZE)
+        return InitError(strprintf(_("-maxmempool must be at least %d MB"), (4 * MAX_BLOCK_SIZE + 999999) / 1000000));
+    if (GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) <= 0)
+        return InitError(_("-mempoolexpiry must be a positive number of hours"));
+
     // Default value of 0 for mempooltxinputlimit means no limit is applied
     if (mapArgs.count("-mempooltxinputlimit")) {
         int64_t limit = GetArg("-mempooltxinputlimit", 0);
@@ -1289,8 +1368,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i=0; i<nScriptCheckThreads-1; i++)
+        for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadScProofCheck);
+        }
     }
 
     // Start the lightweight task scheduler thread
@@ -1476,6 +1557,13 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             return InitError(strprintf(_("Cannot find trusted certificates directory: '%s'"), pathTLSTrustredDir.string()));
     }
 
+    // The event stream is shared by the transports, create it before them
+    if (mapArgs.count("-zmqpubevents") || mapArgs.count("-zmqreplayevents") || mapArgs.count("-amqppubevents")) {
+        size_t nReplayBuffer = std::max<int64_t>(GetArg("-notificationreplaybuffer", DEFAULT_NOTIFICATION_REPLAY_BUFFER), 0);
+        pnotificationStream = new CNotificationStream(mempool, nReplayBuffer << 20);
+        RegisterValidationInterface(pnotificationStream);
+    }
+
 #if ENABLE_ZMQ
     pzmqNotificationInterface = CZMQNotificationInterface::CreateWithArguments(mapArgs);
 
@@ -1499,6 +1587,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
 #endif
 
+    int nValidationQueueDepth = GetArg("-validationqueuedepth", DEFAULT_VALIDATION_QUEUE_DEPTH);
+    if (nValidationQueueDepth > 0)
+        GetMainSignals().StartQueue(nValidationQueueDepth);
+
     // ********************************************************* Step 7: load block chain
 
     fReindex = GetBoolArg("-reindex", false);
@@ -1574,6 +1666,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
 
+    int64_t nBlockReadCache = std::max(GetArg("-blockreadcache", DEFAULT_BLOCK_READ_CACHE), (int64_t)0) << 20;
+    blockFileCache.SetMaxBlockBytes(nBlockReadCache);
+    LogPrintf("* Using %.1fMiB for blocks read from disk\n", nBlockReadCache * (1.0 / 1024 / 1024));
+
+    orphanPool.SetMaxPeerBytes(std::max(GetArg("-maxorphanpeersize", DEFAULT_MAX_ORPHAN_PEER_SIZE), (int64_t)0) * 1000);
+
     bool fLoaded = false;
     while (!fLoaded) {
         bool fReset = fReindex || fReindexFast;
@@ -1972,6 +2070,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // recently added to the mempool.
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "txnotify", &ThreadNotifyRecentlyAdded));
 
+    // Keep the getblocktemplate template up to date as the tip and the mempool change
+    mempool.NotifyTransactionsUpdated.connect(&NotifyBlockTemplateEvent);
+    uiInterface.NotifyBlockTip.connect(boost::bind(&NotifyBlockTemplateEvent));
+    if (fServer)
+        threadGroup.create_thread(&ThreadUpdateBlockTemplate);
+
     if (GetBoolArg("-listenonion", DEFAULT_LISTEN_ONION))
         StartTorControl(threadGroup, scheduler);
 
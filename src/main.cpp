@@ -10,6 +10,10 @@
 #include "addrman.h"
 #include "alert.h"
 #include "arith_uint256.h"
+#include "blockdownload.h"
+#include "blockfilecache.h"
+#include "blockimport.h"
+#include "chainsnapshot.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
 #include "consensus/validation.h"
@@ -17,6 +21,7 @@
 #include "init.h"
 #include "merkleblock.h"
 #include "metrics.h"
+#include "orphanpool.h"
 #include "pow.h"
 #include "txdb.h"
 #include "ui_interface.h"
@@ -66,12 +71,15 @@ BlockSet sGlobalForkTips;
 BlockTimeMap mGlobalForkTips;
 
 BlockMap mapBlockIndex;
+/** Taken exclusively, besides cs_main, to modify mapBlockIndex, and shared to look it up without cs_main */
+static boost::shared_mutex csBlockIndexMap;
 CChain chainActive;
 CBlockIndex *pindexBestHeader = NULL;
 int64_t nTimeBestReceived = 0;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
+int nBlockImportThreads = 1;
 bool fExperimentalMode = false;
 bool fImporting = false;
 bool fReindex = false;
@@ -103,11 +111,6 @@ CFeeRate minRelayTxFee = CFeeRate(DEFAULT_MIN_RELAY_TX_FEE);
 
 CTxMemPool mempool(::minRelayTxFee);
 
-map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(cs_main);;
-map<uint256, set<uint256> > mapOrphanTransactionsByPrev GUARDED_BY(cs_main);;
-
-void EraseOrphansFor(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
-
 static void CheckBlockIndex();
 
 /** Constant stuff for coinbase transactions we create: */
@@ -295,6 +298,8 @@ struct CNodeState {
     list<QueuedBlock> vBlocksInFlight;
     int nBlocksInFlight;
     int nBlocksInFlightValidHeaders;
+    //! How fast the peer delivers the blocks we request, sizing how many we keep in flight from it.
+    CBlockDownloadRate downloadRate;
     //! Whether we consider this a preferred download peer.
     bool fPreferredDownload;
 
@@ -366,18 +371,21 @@ void FinalizeNode(NodeId nodeid) {
 
     BOOST_FOREACH(const QueuedBlock& entry, state->vBlocksInFlight)
         mapBlocksInFlight.erase(entry.hash);
-    EraseOrphansFor(nodeid);
+    orphanPool.EraseForPeer(nodeid);
     nPreferredDownload -= state->fPreferredDownload;
 
     mapNodeState.erase(nodeid);
 }
 
 // Requires cs_main.
-// Returns a bool indicating whether we requested this block.
-bool MarkBlockAsReceived(const uint256& hash) {
+// Returns a bool indicating whether we requested this block. When nodeFrom is the peer
+// we requested it from, the delivery is accounted to its download rate.
+bool MarkBlockAsReceived(const uint256& hash, NodeId nodeFrom = -1) {
     map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
     if (itInFlight != mapBlocksInFlight.end()) {
         CNodeState *state = State(itInFlight->second.first);
+        if (itInFlight->second.first == nodeFrom)
+            state->downloadRate.Delivered(itInFlight->second.second->nTime, GetTimeMicros());
         nQueuedValidatedHeaders -= itInFlight->second.second->fValidatedHeaders;
         state->nBlocksInFlightValidHeaders -= itInFlight->second.second->fValidatedHeaders;
         state->vBlocksInFlight.erase(itInFlight->second.second);
@@ -393,11 +401,18 @@ bool MarkBlockAsReceived(const uint256& hash) {
 void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const Consensus::Params& consensusParams, CBlockIndex *pindex = NULL) {
     CNodeState *state = State(nodeid);
     assert(state != NULL);
+    int64_t nNow = GetTimeMicros();
+
+    // Taken over from a peer late with it
+    map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
+    if (itInFlight != mapBlocksInFlight.end() && itInFlight->second.first != nodeid) {
+        State(itInFlight->second.first)->downloadRate.Reassigned(itInFlight->second.second->nTime, nNow);
+        LogPrint("net", "Reassigning block %s from peer=%d to peer=%d\n", hash.ToString(), itInFlight->second.first, nodeid);
+    }
 
     // Make sure it's not listed somewhere already.
     MarkBlockAsReceived(hash);
 
-    int64_t nNow = GetTimeMicros();
     QueuedBlock newentry = {hash, pindex, nNow, pindex != NULL, GetBlockTimeout(nNow, nQueuedValidatedHeaders, consensusParams)};
     nQueuedValidatedHeaders += newentry.fValidatedHeaders;
     list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(), newentry);
@@ -497,8 +512,16 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
     // linked block we have in common with this peer. The +1 is so we can detect stalling, namely if we would be able to
     // download that next block if the window were 1 larger.
     int nWindowEnd = state->pindexLastCommonBlock->nHeight + BLOCK_DOWNLOAD_WINDOW;
+    // Blocks stored ahead of validation are bounded as well. The bound is only reached when validation, not any
+    // peer, is what lags behind, so no peer is blamed for stalling then.
+    bool fValidationBound = false;
+    if (chainActive.Height() + (int)MAX_BLOCKS_AHEAD_OF_VALIDATION < nWindowEnd) {
+        nWindowEnd = chainActive.Height() + MAX_BLOCKS_AHEAD_OF_VALIDATION;
+        fValidationBound = true;
+    }
     int nMaxHeight = std::min<int>(state->pindexBestKnownBlock->nHeight, nWindowEnd + 1);
     NodeId waitingfor = -1;
+    int64_t nNow = GetTimeMicros();
     while (pindexWalk->nHeight < nMaxHeight) {
         // Read up to 128 (or more, if more blocks than that are needed) successors of pindexWalk (towards
         // pindexBestKnownBlock) into vToFetch. We fetch 128, because CBlockIndex::GetAncestor may be as expensive
@@ -527,7 +550,7 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
                 // The block is not already downloaded, and not yet in flight.
                 if (pindex->nHeight > nWindowEnd) {
                     // We reached the end of the window.
-                    if (vBlocks.size() == 0 && waitingfor != nodeid) {
+                    if (vBlocks.size() == 0 && waitingfor != nodeid && !fValidationBound) {
                         // We aren't able to fetch anything, but we would be if the download window was one larger.
                         nodeStaller = waitingfor;
                     }
@@ -538,9 +561,21 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
                 if (vBlocks.size() == count) {
                     return;
                 }
-            } else if (waitingfor == -1) {
-                // This is the first already-in-flight block.
-                waitingfor = mapBlocksInFlight[pindex->GetBlockHash()].first;
+            } else {
+                const pair<NodeId, list<QueuedBlock>::iterator>& inFlight = mapBlocksInFlight[pindex->GetBlockHash()];
+                if (inFlight.first != nodeid && pindex->nHeight <= nWindowEnd &&
+                    State(inFlight.first)->downloadRate.IsOverdue(inFlight.second->nTime, nNow) &&
+                    state->downloadRate.IsExpectedWithin(nNow - inFlight.second->nTime)) {
+                    // Its peer is late with it and this one should deliver it sooner: ask it here instead,
+                    // rather than letting the block hold up the window until the peer is disconnected.
+                    vBlocks.push_back(pindex);
+                    if (vBlocks.size() == count) {
+                        return;
+                    }
+                } else if (waitingfor == -1) {
+                    // This is the first already-in-flight block.
+                    waitingfor = inFlight.first;
+                }
             }
         }
     }
@@ -556,6 +591,9 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
     stats.nMisbehavior = state->nMisbehavior;
     stats.nSyncHeight = state->pindexBestKnownBlock ? state->pindexBestKnownBlock->nHeight : -1;
     stats.nCommonHeight = state->pindexLastCommonBlock ? state->pindexLastCommonBlock->nHeight : -1;
+    stats.nBlocksInFlightWindow = state->downloadRate.GetWindow();
+    stats.nBlockDelay = state->downloadRate.GetDelay();
+    stats.nBlocksReassigned = state->downloadRate.GetReassigned();
     BOOST_FOREACH(const QueuedBlock& queue, state->vBlocksInFlight) {
         if (queue.pindex)
             stats.vHeightInFlight.push_back(queue.pindex->nHeight);
@@ -581,6 +619,13 @@ void UnregisterNodeSignals(CNodeSignals& nodeSignals)
     nodeSignals.FinalizeNode.disconnect(&FinalizeNode);
 }
 
+CBlockIndex* LookupBlockIndex(const uint256& hash)
+{
+    boost::shared_lock<boost::shared_mutex> lock(csBlockIndexMap);
+    BlockMap::const_iterator it = mapBlockIndex.find(hash);
+    return it == mapBlockIndex.end() ? NULL : it->second;
+}
+
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator)
 {
     // Find the first block the caller has in the main chain
@@ -599,92 +644,6 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 CCoinsViewCache *pcoinsTip = NULL;
 CBlockTreeDB *pblocktree = NULL;
 
-//////////////////////////////////////////////////////////////////////////////
-//
-// mapOrphanTransactions
-//
-
-bool AddOrphanTx(const CTransactionBase& txObj, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
-{
-    uint256 hash = txObj.GetHash();
-    if (mapOrphanTransactions.count(hash))
-        return false;
-
-    // Ignore big transactions, to avoid a
-    // send-big-orphans memory exhaustion attack. If a peer has a legitimate
-    // large transaction with a missing parent then we assume
-    // it will rebroadcast it later, after the parent transaction(s)
-    // have been mined or received.
-    // 10,000 orphans, each of which is at most 5,000 bytes big is
-    // at most 500 megabytes of orphans:
-    unsigned int sz = txObj.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
-    if (sz > 5000)
-    {
-        LogPrint("mempool", "ignoring large orphan tx (size: %u, hash: %s)\n", sz, hash.ToString());
-        return false;
-    }
-
-    mapOrphanTransactions[hash].tx = txObj.MakeShared();
-    mapOrphanTransactions[hash].fromPeer = peer;
-    BOOST_FOREACH(const CTxIn& txin, txObj.GetVin())
-        mapOrphanTransactionsByPrev[txin.prevout.hash].insert(hash);
-
-    LogPrint("mempool", "stored orphan tx %s (mapsz %u prevsz %u)\n", hash.ToString(),
-             mapOrphanTransactions.size(), mapOrphanTransactionsByPrev.size());
-    return true;
-}
-
-void static EraseOrphanTx(uint256 hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
-{
-    map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.find(hash);
-    if (it == mapOrphanTransactions.end())
-        return;
-    BOOST_FOREACH(const CTxIn& txin, it->second.tx->GetVin())
-    {
-        map<uint256, set<uint256> >::iterator itPrev = mapOrphanTransactionsByPrev.find(txin.prevout.hash);
-        if (itPrev == mapOrphanTransactionsByPrev.end())
-            continue;
-        itPrev->second.erase(hash);
-        if (itPrev->second.empty())
-            mapOrphanTransactionsByPrev.erase(itPrev);
-    }
-    mapOrphanTransactions.erase(it);
-}
-
-void EraseOrphansFor(NodeId peer)
-{
-    int nErased = 0;
-    map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
-    while (iter != mapOrphanTransactions.end())
-    {
-        map<uint256, COrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
-        if (maybeErase->second.fromPeer == peer)
-        {
-            EraseOrphanTx(maybeErase->second.tx->GetHash());
-            ++nErased;
-        }
-    }
-    if (nErased > 0) LogPrint("mempool", "Erased %d orphan tx from peer %d\n", nErased, peer);
-}
-
-
-unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
-{
-    unsigned int nEvicted = 0;
-    while (mapOrphanTransactions.size() > nMaxOrphans)
-    {
-        // Evict a random orphan:
-        uint256 randomhash = GetRandHash();
-        map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.lower_bound(randomhash);
-        if (it == mapOrphanTransactions.end())
-            it = mapOrphanTransactions.begin();
-        EraseOrphanTx(it->first);
-        ++nEvicted;
-    }
-    return nEvicted;
-}
-
-
 bool IsStandardTx(const CTransactionBase& txBase, string& reason, const int nHeight)
 {
     if (!txBase.IsVersionStandard(nHeight))
@@ -1158,6 +1117,50 @@ CAmount GetMinRelayFee(const CTransactionBase& tx, unsigned int nBytes, bool fAl
     return nMinFee;
 }
 
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128, MAX_SCRIPTCHECK_THREADS);
+
+/**
+ * Run the script checks of a transaction or certificate entering the mempool
+ * on the script check threads. cs_main makes this thread the only master of
+ * the queue.
+ */
+static bool RunMempoolScriptChecks(std::vector<CScriptCheck>& vChecks)
+{
+    AssertLockHeld(cs_main);
+    if (vChecks.empty())
+        return true;
+
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
+/**
+ * Expire the entries which stayed in the pool too long and evict the cheapest ones while the pool
+ * exceeds its memory limit. The wallets learn about the ones they lost, as about conflicted ones.
+ */
+static void LimitMempoolSize(CTxMemPool& pool, size_t limit, int64_t age)
+{
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    int expired = pool.Expire(GetTime() - age, removedTxs, removedCerts);
+    if (expired != 0)
+        LogPrint("mempool", "Expired %i transactions from the memory pool\n", expired);
+
+    pool.TrimToSize(limit, removedTxs, removedCerts);
+
+    for(const CTransaction& tx: removedTxs)
+        SyncWithWallets(tx, nullptr);
+    for(const CScCertificate& cert: removedCerts)
+        SyncWithWallets(cert, nullptr);
+}
+
+static void LimitMempoolSize(CTxMemPool& pool)
+{
+    LimitMempoolSize(pool, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000,
+                     GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+}
+
 void RejectMemoryPoolTxBase(const CValidationState& state, const CTransactionBase& txBase, CNode* pfrom)
 {
     LogPrint("mempool", "%s from peer=%d %s was not accepted into the memory pool: %s\n", txBase.GetHash().ToString(),
@@ -1171,7 +1174,8 @@ void RejectMemoryPoolTxBase(const CValidationState& state, const CTransactionBas
 }
 
 MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationState &state, const CScCertificate &cert,
-    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom)
+    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom,
+    int64_t nAcceptTime)
 {
     AssertLockHeld(cs_main);
 
@@ -1312,7 +1316,7 @@ MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationSt
         double dPriority = view.GetPriority(cert, chainActive.Height());
         LogPrint("mempool", "%s():%d - Computed fee=%lld, prio[%22.8f]\n", __func__, __LINE__, nFees, dPriority);
 
-        CCertificateMemPoolEntry entry(cert, nFees, GetTime(), dPriority, chainActive.Height());
+        CCertificateMemPoolEntry entry(cert, nFees, nAcceptTime ? nAcceptTime : GetTime(), dPriority, chainActive.Height());
         unsigned int nSize = entry.GetCertificateSize();
 
         // Don't accept it if it can't get into a block
@@ -1372,7 +1376,12 @@ MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationSt
 
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        if (!ContextualCheckCertInputs(cert, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus()))
+        // The signatures are checked in parallel first. On a failure the
+        // checks are run again serially to fill the validation state.
+        std::vector<CScriptCheck> vChecks;
+        if (!ContextualCheckCertInputs(cert, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus(), nScriptCheckThreads ? &vChecks : NULL) ||
+            (!RunMempoolScriptChecks(vChecks) &&
+             !ContextualCheckCertInputs(cert, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus())))
         {
             LogPrintf("%s():%d - ERROR: ConnectInputs failed, cert[%s]\n", __func__, __LINE__, certHash.ToString());
             return MempoolReturnValue::INVALID;
@@ -1425,6 +1434,15 @@ MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationSt
         // Store transaction in memory
         pool.addUnchecked(certHash, entry, !IsInitialBlockDownload());
 
+        // A superseded certificate may be the first to go to make room for itself
+        LimitMempoolSize(pool);
+        if (!pool.existsCert(certHash))
+        {
+            state.DoS(0, error("%s():%d - mempool full, cert %s evicted", __func__, __LINE__, certHash.ToString()),
+                      CValidationState::Code::INSUFFICIENT_FEE, "mempool full");
+            return MempoolReturnValue::INVALID;
+        }
+
 #ifdef ENABLE_ADDRESS_INDEXING
         // Add memory address index
         if (fAddressIndex) {
@@ -1441,7 +1459,8 @@ MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationSt
 }
 
 MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, LimitFreeFlag fLimitFree,
-                        RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom)
+                        RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom,
+                        int64_t nAcceptTime)
 {
     AssertLockHeld(cs_main);
 
@@ -1620,7 +1639,7 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
         double dPriority = view.GetPriority(tx, chainActive.Height());
         LogPrint("mempool", "%s():%d - tx[%s], Computed fee=%lld, prio[%22.8f]\n", __func__, __LINE__, hash.ToString(), nFees, dPriority);
 
-        CTxMemPoolEntry entry(tx, nFees, GetTime(), dPriority, chainActive.Height(), mempool.HasNoInputsOf(tx));
+        CTxMemPoolEntry entry(tx, nFees, nAcceptTime ? nAcceptTime : GetTime(), dPriority, chainActive.Height(), mempool.HasNoInputsOf(tx));
         unsigned int nSize = entry.GetTxSize();
 
         // Accept a tx if it contains joinsplits and has at least the default fee specified by z_sendmany.
@@ -1644,6 +1663,16 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
             }
         }
 
+        // Once the pool has been full, it only takes what pays more than the entries it evicted
+        CAmount mempoolRejectFee = pool.GetMinFee(GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000).GetFee(nSize);
+        if (fLimitFree == LimitFreeFlag::ON && mempoolRejectFee > 0 && nFees < mempoolRejectFee)
+        {
+            state.DoS(0, error("%s():%d - mempool min fee not met %s, %d < %d",
+                      __func__, __LINE__, hash.ToString(), nFees, mempoolRejectFee),
+                      CValidationState::Code::INSUFFICIENT_FEE, "mempool min fee not met");
+            return MempoolReturnValue::INVALID;
+        }
+
         // Require that free transactions have sufficient priority to be mined in the next block.
         if (GetBoolArg("-relaypriority", false) &&
             nFees < ::minRelayTxFee.GetFee(nSize) &&
@@ -1689,7 +1718,12 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
 
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        if (!ContextualCheckTxInputs(tx, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus()))
+        // The signatures are checked in parallel first. On a failure the
+        // checks are run again serially to fill the validation state.
+        std::vector<CScriptCheck> vChecks;
+        if (!ContextualCheckTxInputs(tx, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus(), nScriptCheckThreads ? &vChecks : NULL) ||
+            (!RunMempoolScriptChecks(vChecks) &&
+             !ContextualCheckTxInputs(tx, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus())))
         {
             error("%s(): ConnectInputs failed %s", __func__, hash.ToString());
             return MempoolReturnValue::INVALID;
@@ -1737,6 +1771,15 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
 
         pool.addUnchecked(hash, entry, !IsInitialBlockDownload());
 
+        // The cheapest entries, which may be this one, make room for it
+        LimitMempoolSize(pool);
+        if (!pool.existsTx(hash))
+        {
+            state.DoS(0, error("%s():%d - mempool full, tx %s evicted", __func__, __LINE__, hash.ToString()),
+                      CValidationState::Code::INSUFFICIENT_FEE, "mempool full");
+            return MempoolReturnValue::INVALID;
+        }
+
 #ifdef ENABLE_ADDRESS_INDEXING
         // Add memory address index
         if (fAddressIndex) {
@@ -1777,6 +1820,158 @@ MempoolReturnValue AcceptTxBaseToMemoryPool(CTxMemPool& pool, CValidationState &
     return MempoolReturnValue::INVALID;
 }
 
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+
+void WriteMempoolDump(CAutoFile& file, const CTxMemPool& pool, const uint256& hashBestBlock)
+{
+    AssertLockHeld(pool.cs);
+    std::vector<uint256> vHashes;
+    pool.queryHashesByDependencies(vHashes);
+
+    file << MEMPOOL_DUMP_VERSION;
+
+    // Entries go straight to the file, whatever the size of the pool, and
+    // the checksum following them covers everything but the version
+    CHashingWriter<CAutoFile> writer(&file);
+    writer << hashBestBlock;
+    writer << pool.mapDeltas;
+    writer << (uint64_t)vHashes.size();
+    for (const uint256& hash : vHashes) {
+        if (pool.mapTx.count(hash)) {
+            const CTxMemPoolEntry& entry = pool.mapTx.at(hash);
+            writer << false;
+            writer << entry.GetTx();
+            writer << entry.GetTime();
+        } else {
+            const CCertificateMemPoolEntry& entry = pool.mapCertificate.at(hash);
+            writer << true;
+            writer << entry.GetCertificate();
+            writer << entry.GetTime();
+        }
+    }
+    file << writer.GetHash();
+}
+
+bool ReadMempoolDump(CAutoFile& file, uint256& hashBestBlock, std::map<uint256, std::pair<double, CAmount> >& mapDeltas,
+                     std::vector<CMempoolDumpEntry>& vEntries)
+{
+    uint64_t version;
+    file >> version;
+    if (version != MEMPOOL_DUMP_VERSION)
+        return false;
+
+    CHashVerifier<CAutoFile> verifier(&file);
+    uint64_t nEntries;
+    verifier >> hashBestBlock;
+    verifier >> mapDeltas;
+    verifier >> nEntries;
+    vEntries.clear();
+    while (nEntries--) {
+        vEntries.emplace_back();
+        verifier >> vEntries.back();
+    }
+
+    uint256 hashChecksum;
+    file >> hashChecksum;
+    return verifier.GetHash() == hashChecksum;
+}
+
+bool LoadMempool()
+{
+    int64_t nExpiryTimeout = GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
+    boost::filesystem::path path = GetDataDir() / "mempool.dat";
+    CAutoFile file(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open mempool file from disk. Continuing anyway.\n");
+        return false;
+    }
+
+    int64_t nStart = GetTimeMillis();
+    int64_t nNow = GetTime();
+    int nLoaded = 0, nFailed = 0, nExpired = 0, nProofsSkipped = 0;
+    try {
+        // The proofs of the entries are only trusted along with the rest of the dump,
+        // so the whole of it is read and checked before any entry is accepted
+        uint256 hashBestBlock;
+        std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+        std::vector<CMempoolDumpEntry> vEntries;
+        if (!ReadMempoolDump(file, hashBestBlock, mapDeltas, vEntries))
+            return error("%s: mempool file %s is corrupted or of another version", __func__, path.string());
+        file.fclose();
+
+        for (const auto& delta : mapDeltas)
+            mempool.PrioritiseTransaction(delta.first, delta.first.ToString(), delta.second.first, delta.second.second);
+
+        for (const CMempoolDumpEntry& entry : vEntries) {
+            if (entry.nTime + nExpiryTimeout <= nNow) {
+                ++nExpired;
+                continue;
+            }
+
+            CValidationState state;
+            MempoolReturnValue res;
+            {
+                LOCK(cs_main);
+                // This node verified the proofs of the entries against the chain state they were dumped at.
+                // As long as the tip didn't move, they would verify again, otherwise they are checked now.
+                MempoolProofVerificationFlag fProofVerification = MempoolProofVerificationFlag::SYNC;
+                if (chainActive.Tip() != nullptr && chainActive.Tip()->GetBlockHash() == hashBestBlock) {
+                    fProofVerification = MempoolProofVerificationFlag::DISABLED;
+                    if (entry.fCertificate || !entry.tx.GetVcswCcIn().empty())
+                        ++nProofsSkipped;
+                }
+                if (entry.fCertificate)
+                    res = AcceptCertificateToMemoryPool(mempool, state, entry.cert, LimitFreeFlag::OFF, RejectAbsurdFeeFlag::OFF,
+                                                        fProofVerification, nullptr, entry.nTime);
+                else
+                    res = AcceptTxToMemoryPool(mempool, state, entry.tx, LimitFreeFlag::OFF, RejectAbsurdFeeFlag::OFF,
+                                               fProofVerification, nullptr, entry.nTime);
+            }
+            if (res == MempoolReturnValue::VALID)
+                ++nLoaded;
+            else
+                ++nFailed;
+
+            if (ShutdownRequested())
+                return false;
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+
+    LogPrintf("Imported mempool transactions from disk: %i successes, %i failed, %i expired, %i without proof verification, %dms\n",
+              nLoaded, nFailed, nExpired, nProofsSkipped, GetTimeMillis() - nStart);
+    return true;
+}
+
+bool DumpMempool()
+{
+    int64_t nStart = GetTimeMicros();
+
+    try {
+        boost::filesystem::path path = GetDataDir() / "mempool.dat";
+        boost::filesystem::path pathNew = GetDataDir() / "mempool.dat.new";
+        CAutoFile file(fopen(pathNew.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+        if (file.IsNull())
+            return false;
+
+        {
+            // Only called at shutdown, once the node stopped, so the locks are held while writing
+            LOCK2(cs_main, mempool.cs);
+            WriteMempoolDump(file, mempool, chainActive.Tip() != nullptr ? chainActive.Tip()->GetBlockHash() : uint256());
+        }
+        FileCommit(file.Get());
+        file.fclose();
+        RenameOver(pathNew, path);
+        LogPrintf("Dumped mempool: %gs to dump\n", (GetTimeMicros() - nStart) * 0.000001);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump mempool: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
 #ifdef ENABLE_ADDRESS_INDEXING
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes)
 {
@@ -1831,8 +2026,7 @@ bool GetAddressUnspent(uint160 addressHash, int type,
 /** Return transaction in tx, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock, bool fAllowSlow)
 {
-    LOCK(cs_main);
-
+    // The mempool and the tx index have their own locking, only the coins lookup needs cs_main
     if (mempool.lookup(hash, txOut))
         return true;
 
@@ -1863,6 +2057,7 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
 
     if (fAllowSlow) // use coin database to locate block that contains transaction, and scan it
     {
+        LOCK(cs_main);
         CBlockIndex *pindexSlow = nullptr;
         int nHeight = -1;
         {
@@ -1898,8 +2093,6 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
 /** Return certificate in certOut, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetCertificate(const uint256 &hash, CScCertificate &certOut, uint256 &hashBlock, bool fAllowSlow)
 {
-    LOCK(cs_main);
-
     if (mempool.lookup(hash, certOut))
         return true;
 
@@ -1930,6 +2123,7 @@ bool GetCertificate(const uint256 &hash, CScCertificate &certOut, uint256 &hashB
 
     if (fAllowSlow) // use coin database to locate block that contains cert, and scan it
     {
+        LOCK(cs_main);
         int nHeight = -1;
         CBlockIndex *pindexSlow = nullptr;
         {
@@ -2011,17 +2205,40 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
-
-    // Read block
-    try {
-        filein >> block;
+    // Recently read blocks have been checked already
+    std::shared_ptr<const CBlock> pcached = blockFileCache.GetBlock(pos);
+    if (pcached) {
+        block = *pcached;
+        return true;
     }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+
+    size_t nSize;
+    CBlockFileBytes bytes;
+    if (blockFileCache.ReadBlockBytes(pos, bytes)) {
+        // Read block straight from the mapped file
+        try {
+            CSpanReader reader(bytes.begin(), bytes.end(), SER_DISK, CLIENT_VERSION);
+            reader >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+        nSize = bytes.size();
+    } else {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+
+        // Read block
+        try {
+            filein >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+        nSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+        blockFileCache.AddFileRead(nSize);
     }
 
     // Check the header
@@ -2029,6 +2246,7 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
           CheckProofOfWork(block.GetHash(), block.nBits, Params().GetConsensus())))
         return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
 
+    blockFileCache.AddBlock(pos, std::make_shared<const CBlock>(block), nSize);
     return true;
 }
 
@@ -2042,6 +2260,35 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
     return true;
 }
 
+bool ReadRawBlockFromDisk(CBlockFileBytes& bytes, const CBlockIndex* pindex)
+{
+    if (!blockFileCache.ReadBlockBytes(pindex->GetBlockPos(), bytes)) {
+        // The file can't be mapped, serialize the block read from it
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex))
+            return false;
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << block;
+        std::shared_ptr<std::vector<char> > pbuffer = std::make_shared<std::vector<char> >(ss.begin(), ss.end());
+        bytes = CBlockFileBytes(pbuffer, pbuffer->data(), pbuffer->size());
+        return true;
+    }
+
+    // The header hash matching the index is enough to trust bytes of a block accepted before
+    CBlockHeader header;
+    try {
+        CSpanReader reader(bytes.begin(), bytes.end(), SER_DISK, CLIENT_VERSION);
+        reader >> header;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize error - %s at %s", __func__, e.what(), pindex->GetBlockPos().ToString());
+    }
+    if (header.GetHash() != pindex->GetBlockHash())
+        return error("ReadRawBlockFromDisk(CBlockFileBytes&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
+                pindex->ToString(), pindex->GetBlockPos().ToString());
+    return true;
+}
+
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
 {
     CAmount nSubsidy = 12.5 * COIN;
@@ -2652,19 +2899,33 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("%s: OpenBlockFile failed", __func__);
-
-    // Read block
     uint256 hashChecksum;
-    try {
-        filein >> blockundo;
-        filein >> hashChecksum;
-    }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    CBlockFileBytes bytes;
+    if (blockFileCache.ReadUndoBytes(pos, bytes)) {
+        // Read undo data straight from the mapped file
+        try {
+            CSpanReader reader(bytes.begin(), bytes.end(), SER_DISK, CLIENT_VERSION);
+            reader >> blockundo;
+            reader >> hashChecksum;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s", __func__, e.what());
+        }
+    } else {
+        // Open history file to read
+        CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("%s: OpenBlockFile failed", __func__);
+
+        // Read block
+        try {
+            filein >> blockundo;
+            filein >> hashChecksum;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+        blockFileCache.AddFileRead(::GetSerializeSize(blockundo, SER_DISK, CLIENT_VERSION) + sizeof(hashChecksum));
     }
 
     // Verify checksum
@@ -3122,6 +3383,10 @@ void static FlushBlockFile(bool fFinalize = false)
 
     CDiskBlockPos posOld(nLastBlockFile, 0);
 
+    // Mappings of the files cover their preallocated size
+    if (fFinalize)
+        blockFileCache.ForgetFile(nLastBlockFile);
+
     FILE *fileOld = OpenBlockFile(posOld);
     if (fileOld) {
         if (fFinalize)
@@ -3141,8 +3406,6 @@ void static FlushBlockFile(bool fFinalize = false)
 
 bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
-
 void ThreadScriptCheck() {
     RenameThread("horizen-scriptch");
     scriptcheckqueue.Thread();
@@ -3359,12 +3622,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         // match what we asked for.
         assert(tree.root() == old_tree_root);
     }
+    // Note commitments of the block, appended to the tree all at once
+    std::vector<libzcash::SHA256Compress> vNoteCommitments;
 
     const auto scVerifierMode = fExpensiveChecks ?
                 CScProofVerifier::Verification::Strict : CScProofVerifier::Verification::Loose;
     // Set high priority to verify the proofs as soon as possible (pausing mempool verification operations if any.)
     CScProofVerifier scVerifier{scVerifierMode, CScProofVerifier::Priority::High};
-    SidechainTxsCommitmentBuilder scCommitmentBuilder;
      
     for (unsigned int txIdx = 0; txIdx < block.vtx.size(); ++txIdx) // Processing transactions loop
     {
@@ -3505,19 +3769,16 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
 
         BOOST_FOREACH(const JSDescription &joinsplit, tx.GetVjoinsplit()) {
-            BOOST_FOREACH(const uint256 &note_commitment, joinsplit.commitments) {
-                // Insert the note commitments into our temporary tree.
-                tree.append(note_commitment);
-            }
+            vNoteCommitments.insert(vNoteCommitments.end(), joinsplit.commitments.begin(), joinsplit.commitments.end());
         }
 
         vTxIndexValues.push_back(std::make_pair(tx.GetHash(), CTxIndexValue(pos, txIdx, 0)));
         pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
-
-        if (fScRelatedChecks == flagScRelatedChecks::ON)
-            scCommitmentBuilder.add(tx);
     }  //end of Processing transactions loop
 
+    // Insert the note commitments into our temporary tree.
+    tree.append(vNoteCommitments);
+
 
     std::map<uint256, uint256> highQualityCertData = HighQualityCertData(block, view);
     // key: current block top quality cert for given sc --> value: prev block superseeded cert hash (possibly null)
@@ -3714,11 +3975,6 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         vTxIndexValues.push_back(std::make_pair(cert.GetHash(), CTxIndexValue(pos, certIdx, certMaturityHeight)));
         pos.nTxOffset += cert.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
 
-        if (fScRelatedChecks == flagScRelatedChecks::ON)
-        {
-            scCommitmentBuilder.add(cert, view);
-        }
-
 #ifdef ENABLE_ADDRESS_INDEXING
         // Update the explorer indexes according to the Backward Transfer outputs
         if (fAddressIndex && explorerIndexesWrite == flagLevelDBIndexesWrite::ON)
@@ -3811,7 +4067,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     if (fScRelatedChecks == flagScRelatedChecks::ON)
     {
         int64_t nCommTreeStartTime = GetTimeMicros();
-        const uint256& scTxsCommitment = scCommitmentBuilder.getCommitment();
+        // Blocks mined from a template of this node find its commitment in the cache
+        const uint256 scTxsCommitment = SidechainTxsCommitmentBuilder::getCommitment(block.vtx, block.vcert, view);
         int64_t deltaCommTreeTime = GetTimeMicros() - nCommTreeStartTime;
         LogPrint("bench", "    - txsCommTree: %.2fms\n", deltaCommTreeTime * 0.001);
 
@@ -4066,10 +4323,19 @@ void PruneAndFlush() {
     FlushStateToDisk(state, FLUSH_STATE_NONE);
 }
 
+/** Sidechains whose record changes when block is connected, or disconnected */
+static std::set<uint256> GetSidechainsChangedByBlock(const CBlock& block, const CSidechainEvents& scEvents)
+{
+    std::set<uint256> scIds = GetSidechainsTouchedByBlock(block, scEvents);
+    scIds.insert(scEvents.maturingScs.begin(), scEvents.maturingScs.end());
+    return scIds;
+}
+
 /** Update chainActive and related internal data structures. */
-void static UpdateTip(CBlockIndex *pindexNew) {
+void static UpdateTip(CBlockIndex *pindexNew, const std::set<uint256>& scIdsChanged) {
     const CChainParams& chainParams = Params();
     chainActive.SetTip(pindexNew);
+    PublishChainSnapshot(scIdsChanged);
 
     // New best block
     nTimeBestReceived = GetTime();
@@ -4161,7 +4427,11 @@ bool static DisconnectTip(CValidationState &state) {
 
     mempool.check(pcoinsTip);
     // Update chainActive and related variables.
-    UpdateTip(pindexDelete->pprev);
+    // DisconnectBlock reverted the sidechain events, so the ones of this height are back in pcoinsTip:
+    // the snapshot reads again the sidechains whose amounts had matured here
+    CSidechainEvents scEvents;
+    pcoinsTip->GetSidechainEvents(pindexDelete->nHeight, scEvents);
+    UpdateTip(pindexDelete->pprev, GetSidechainsChangedByBlock(block, scEvents));
     // Get the current commitment tree
     ZCIncrementalMerkleTree newTree;
     assert(pcoinsTip->GetAnchorAt(pcoinsTip->GetBestAnchor(), newTree));
@@ -4191,8 +4461,28 @@ static int64_t nTimeReadFromDisk = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
+static int64_t nTimeMempoolCleanup = 0;
 static int64_t nTimePostConnect = 0;
 
+std::set<uint256> GetSidechainsTouchedByBlock(const CBlock& block, const CSidechainEvents& scEvents)
+{
+    std::set<uint256> scIds(scEvents.ceasingScs.begin(), scEvents.ceasingScs.end());
+    for(const CTransaction& tx: block.vtx)
+    {
+        for(const CTxScCreationOut& sc: tx.GetVscCcOut())
+            scIds.insert(sc.GetScId());
+        for(const CTxForwardTransferOut& ft: tx.GetVftCcOut())
+            scIds.insert(ft.scId);
+        for(const CBwtRequestOut& mbtr: tx.GetVBwtRequestOut())
+            scIds.insert(mbtr.scId);
+        for(const CTxCeasedSidechainWithdrawalInput& csw: tx.GetVcswCcIn())
+            scIds.insert(csw.scId);
+    }
+    for(const CScCertificate& cert: block.vcert)
+        scIds.insert(cert.GetScId());
+    return scIds;
+}
+
 /**
  * Connect a new block to chainActive. pblock is either NULL or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
@@ -4216,6 +4506,9 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
     int64_t nTime3;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
     std::vector<CScCertificateStatusUpdateInfo> certsStateInfo;
+    // The events are consumed by ConnectBlock, the mempool cleanup needs them afterwards
+    CSidechainEvents scEvents;
+    pcoinsTip->GetSidechainEvents(pindexNew->nHeight, scEvents);
     {
         CCoinsViewCache view(pcoinsTip);
         bool rv = ConnectBlock(*pblock, state, pindexNew, view, chainActive, flagBlockProcessingType::COMPLETE,
@@ -4243,14 +4536,23 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
     std::list<CTransaction> removedTxs;
     std::list<CScCertificate> removedCerts;
     mempool.removeForBlock(pblock->vtx, pindexNew->nHeight, removedTxs,  removedCerts, !IsInitialBlockDownload());
-    mempool.removeForBlock(pblock->vcert, pindexNew->nHeight, removedTxs, removedCerts);
-
-    mempool.removeStaleTransactions(pcoinsTip, removedTxs, removedCerts);
+    mempool.removeForBlock(pblock->vcert, pindexNew->nHeight, removedTxs, removedCerts, !IsInitialBlockDownload());
+
+    mempool.removeStaleTransactions(pcoinsTip, GetSidechainsTouchedByBlock(*pblock, scEvents), removedTxs, removedCerts);
+    // bwts of superseded certs and of the top cert of a ceasing sidechain are voided by the block,
+    // so their spenders accepted in mempool before it are no longer valid
+    std::set<uint256> voidedCerts;
+    for(const CScCertificateStatusUpdateInfo& certInfo: certsStateInfo)
+        if (certInfo.bwtState == CScCertificateStatusUpdateInfo::BwtState::BWT_OFF)
+            voidedCerts.insert(certInfo.certHash);
+    mempool.removeSpendersOfVoidedCerts(pcoinsTip, voidedCerts, removedTxs, removedCerts);
     mempool.removeStaleCertificates(pcoinsTip, removedCerts);
+    int64_t nTimeCleanup = GetTimeMicros() - nTime5; nTimeMempoolCleanup += nTimeCleanup;
+    LogPrint("bench", "  - Mempool cleanup: %.2fms [%.2fs]\n", nTimeCleanup * 0.001, nTimeMempoolCleanup * 0.000001);
 
     mempool.check(pcoinsTip);
 
-    UpdateTip(pindexNew); // Update chainActive & related variables.
+    UpdateTip(pindexNew, GetSidechainsChangedByBlock(*pblock, scEvents)); // Update chainActive & related variables.
 
     // Tell wallet about transactions and certificates that went from mempool to conflicted:
     for(const CTransaction &tx: removedTxs) {
@@ -4724,34 +5026,38 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
     pindexNew->nSequenceId = 0;
-    BlockMap::iterator mi = mapBlockIndex.insert(make_pair(hash, pindexNew)).first;
-    pindexNew->phashBlock = &((*mi).first);
-    BlockMap::iterator miPrev = mapBlockIndex.find(block.hashPrevBlock);
-    if (miPrev != mapBlockIndex.end())
-    {
-        pindexNew->pprev = (*miPrev).second;
-        pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
-        pindexNew->BuildSkip();
-    }
-    pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
-    if (pindexNew->pprev){
-        pindexNew->nChainDelay = pindexNew->pprev->nChainDelay + GetBlockDelay(*pindexNew,*(pindexNew->pprev), chainActive.Height(), fIsStartupSyncing);
-    } else {
-        pindexNew->nChainDelay = 0 ;
+    {
+        // LookupBlockIndex doesn't take cs_main: the entry is completed before readers can see it
+        boost::unique_lock<boost::shared_mutex> lock(csBlockIndexMap);
+        BlockMap::iterator mi = mapBlockIndex.insert(make_pair(hash, pindexNew)).first;
+        pindexNew->phashBlock = &((*mi).first);
+        BlockMap::iterator miPrev = mapBlockIndex.find(block.hashPrevBlock);
+        if (miPrev != mapBlockIndex.end())
+        {
+            pindexNew->pprev = (*miPrev).second;
+            pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
+            pindexNew->BuildSkip();
+        }
+        pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
+        if (pindexNew->pprev){
+            pindexNew->nChainDelay = pindexNew->pprev->nChainDelay + GetBlockDelay(*pindexNew,*(pindexNew->pprev), chainActive.Height(), fIsStartupSyncing);
+        } else {
+            pindexNew->nChainDelay = 0 ;
+        }
+
+        if (pindexNew->pprev && pindexNew->nVersion == BLOCK_VERSION_SC_SUPPORT )
+        {
+            const CFieldElement& prevScCumTreeHash =
+                    (pindexNew->pprev->nVersion == BLOCK_VERSION_SC_SUPPORT) ?
+                            pindexNew->pprev->scCumTreeHash : CBlockIndex::defaultScCumTreeHash;
+            pindexNew->scCumTreeHash = CFieldElement::ComputeHash(prevScCumTreeHash, CFieldElement{block.hashScTxsCommitment});
+        }
+
+        pindexNew->RaiseValidity(BLOCK_VALID_TREE);
     }
     if(pindexNew->nChainDelay != 0) {
         LogPrintf("%s: Block belong to a chain under punishment Delay VAL: %i BLOCKHEIGHT: %d\n",__func__, pindexNew->nChainDelay, pindexNew->nHeight);
     }
-
-    if (pindexNew->pprev && pindexNew->nVersion == BLOCK_VERSION_SC_SUPPORT )
-    {
-        const CFieldElement& prevScCumTreeHash =
-                (pindexNew->pprev->nVersion == BLOCK_VERSION_SC_SUPPORT) ?
-                        pindexNew->pprev->scCumTreeHash : CBlockIndex::defaultScCumTreeHash;
-        pindexNew->scCumTreeHash = CFieldElement::ComputeHash(prevScCumTreeHash, CFieldElement{block.hashScTxsCommitment});
-    }
-
-    pindexNew->RaiseValidity(BLOCK_VALID_TREE);
     if (pindexBestHeader == NULL || (pindexBestHeader->nChainWork < pindexNew->nChainWork && pindexNew->nChainDelay==0))
         pindexBestHeader = pindexNew;
 
@@ -4954,6 +5260,13 @@ bool CheckBlock(const CBlock& block, CValidationState& state,
 {
     // These are checks that are independent of context.
 
+    // A block already checked is not checked again, unless the proofs are
+    // to be verified this time.
+    const bool fCacheable = fCheckPOW == flagCheckPow::ON && fCheckMerkleRoot == flagCheckMerkleRoot::ON &&
+                            !verifier.isVerificationEnabled();
+    if (fCacheable && block.fChecked)
+        return true;
+
     // Check that the header is valid (particularly PoW).  This is mostly
     // redundant with the call in AcceptBlockHeader.
     if (!CheckBlockHeader(block, state, fCheckPOW))
@@ -5041,6 +5354,9 @@ bool CheckBlock(const CBlock& block, CValidationState& state,
         return state.DoS(100, error("CheckBlock(): out-of-bounds SigOpCount"),
                          CValidationState::Code::INVALID, "bad-blk-sigops", true);
 
+    if (fCacheable)
+        block.fChecked = true;
+
     return true;
 }
 
@@ -5190,7 +5506,8 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
     return true;
 }
 
-bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex** ppindex, bool lookForwardTips)
+bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex** ppindex, bool lookForwardTips,
+                       flagCheckPow fCheckPOW)
 {
     dump_global_tips(10);
 
@@ -5214,7 +5531,7 @@ bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBloc
         return true;
     }
 
-    if (!CheckBlockHeader(block, state))
+    if (!CheckBlockHeader(block, state, fCheckPOW))
         return false;
 
     // Get prev block index
@@ -5251,7 +5568,9 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
 
     CBlockIndex *&pindex = *ppindex;
 
-    if (!AcceptBlockHeader(block, state, &pindex))
+    // The PoW of a block that passed CheckBlock is not verified again
+    if (!AcceptBlockHeader(block, state, &pindex, /*lookForwardTips*/false,
+                           block.fChecked ? flagCheckPow::OFF : flagCheckPow::ON))
         return false;
 
     // Try to process all requested blocks that we don't have, but only
@@ -5321,7 +5640,7 @@ bool ProcessNewBlock(CValidationState &state, CNode* pfrom, CBlock* pblock, bool
     {
         LOCK(cs_main);
 
-        bool fRequested = MarkBlockAsReceived(pblock->GetHash());
+        bool fRequested = MarkBlockAsReceived(pblock->GetHash(), pfrom ? pfrom->GetId() : -1);
         fRequested |= fForceProcessing;
 
         if (!checked)
@@ -5451,6 +5770,7 @@ void UnlinkPrunedFiles(std::set<int>& setFilesToPrune)
         CDiskBlockPos pos(*it, 0);
         boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
+        blockFileCache.ForgetFile(*it);
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
     }
 }
@@ -5564,8 +5884,11 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
     CBlockIndex* pindexNew = new CBlockIndex();
     if (!pindexNew)
         throw runtime_error("LoadBlockIndex(): new CBlockIndex failed");
-    mi = mapBlockIndex.insert(make_pair(hash, pindexNew)).first;
-    pindexNew->phashBlock = &((*mi).first);
+    {
+        boost::unique_lock<boost::shared_mutex> lock(csBlockIndexMap);
+        mi = mapBlockIndex.insert(make_pair(hash, pindexNew)).first;
+        pindexNew->phashBlock = &((*mi).first);
+    }
 
     return pindexNew;
 }
@@ -5717,6 +6040,7 @@ bool static LoadBlockIndexDB()
     chainActive.SetTip(it->second);
     // Set hashAnchorEnd for the end of best chain
     it->second->hashAnchorEnd = pcoinsTip->GetBestAnchor();
+    ResetChainSnapshot();
 
     PruneBlockIndexCandidates();
 
@@ -5841,11 +6165,11 @@ void UnloadBlockIndex()
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    ResetChainSnapshot();
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
     mempool.clear();
-    mapOrphanTransactions.clear();
-    mapOrphanTransactionsByPrev.clear();
+    orphanPool.Clear();
     nSyncStarted = 0;
     mapBlocksUnlinked.clear();
     vinfoBlockFile.clear();
@@ -5860,6 +6184,7 @@ void UnloadBlockIndex()
     mapNodeState.clear();
     recentRejects.reset(NULL);
 
+    boost::unique_lock<boost::shared_mutex> lock(csBlockIndexMap);
     BOOST_FOREACH(BlockMap::value_type& entry, mapBlockIndex) {
         delete entry.second;
     }
@@ -5999,7 +6324,7 @@ CBlock LoadBlockFrom(CBufferedFile& blkdat, CDiskBlockPos* pLastLoadedBlkPos)
     return res;
 }
 
-bool LoadBlocksFromExternalFile(FILE* fileIn, CDiskBlockPos *dbp, bool loadHeadersOnly)
+bool LoadBlocksFromExternalFile(FILE* fileIn, CDiskBlockPos *dbp, bool loadHeadersOnly, CBlockImportStats* pstats)
 {
     const CChainParams& chainparams = Params();
     // Map of disk positions for blocks with unknown parent (only used for reindex)
@@ -6009,46 +6334,35 @@ bool LoadBlocksFromExternalFile(FILE* fileIn, CDiskBlockPos *dbp, bool loadHeade
     int nLoadedHeaders = 0;
     int nLoadedBlocks = 0;
 
+    // The blocks are read, deserialized and checked ahead by the reader threads,
+    // only their acceptance is sequential.
+    CBlockImportStage accept;
+    std::unique_ptr<CBlockFileReader> reader;
     try
     {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof())
+        // This takes over fileIn and calls fclose() on it in the CBlockFileReader destructor
+        reader.reset(new CBlockFileReader(fileIn, chainparams.MessageStart(), nBlockImportThreads, loadHeadersOnly));
+        // Position from which the next block is looked for, past the last block deserialized
+        uint64_t nRewind = 0;
+        CBlockFileReader::Item item;
+        while (reader->Next(item))
         {
             boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(Params().MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
-                    continue; //only first byte of magic number matches. Keep searching...
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
-                    continue; //magic number matches but size can't be block one. Keep searching...
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
+            if (item.nMagicPos < nRewind)
+                continue; // inside the previous block
+            if (!item.fDecoded) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, item.strError);
+                continue;
             }
+            nRewind = item.nPos + item.nUsed;
+            if (dbp)
+                dbp->nPos = item.nPos;
+
+            int64_t nAcceptStart = GetTimeMicros();
             try
             {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock loadedBlk;
-                blkdat >> loadedBlk;
-                nRewind = blkdat.GetPos();
+                CBlock& loadedBlk = item.block;
                 // detect out of order blocks, and store them for later
                 uint256 hash = loadedBlk.GetHash();
                 if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(loadedBlk.hashPrevBlock) == mapBlockIndex.end()) {
@@ -6065,7 +6379,8 @@ bool LoadBlocksFromExternalFile(FILE* fileIn, CDiskBlockPos *dbp, bool loadHeade
                     CValidationState state;
                     if (loadHeadersOnly)
                     {
-                        if (AcceptBlockHeader(loadedBlk, state, /*ppindex*/nullptr, /*lookForwardTips*/false)) //Todo: verify lookForwardTips
+                        if (AcceptBlockHeader(loadedBlk, state, /*ppindex*/nullptr, /*lookForwardTips*/false, //Todo: verify lookForwardTips
+                                              item.fHeaderChecked ? flagCheckPow::OFF : flagCheckPow::ON))
                             ++nLoadedHeaders;
 
                         if (state.IsError())
@@ -6123,11 +6438,22 @@ bool LoadBlocksFromExternalFile(FILE* fileIn, CDiskBlockPos *dbp, bool loadHeade
             } catch (const std::exception& e) {
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
+            accept.nBlocks++;
+            accept.nBytes += item.nSize;
+            accept.nTimeMicros += GetTimeMicros() - nAcceptStart;
         }
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
 
+    if (reader) {
+        CBlockImportStats stats = reader->GetStats();
+        stats.accept = accept;
+        LogPrint("reindex", "%s: %s\n", __func__, stats.ToString());
+        if (pstats)
+            pstats->Add(stats);
+    }
+
     if (nLoadedBlocks > 0)
         LogPrintf("Loaded %i blocks from external file in %dms\n", nLoadedBlocks, GetTimeMillis() - nStart);
     return (loadHeadersOnly && (nLoadedHeaders > 0)) || (!loadHeadersOnly && (nLoadedBlocks > 0));
@@ -6416,7 +6742,7 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 
             return recentRejects->contains(inv.hash) ||
                    mempool.exists(inv.hash) ||
-                   mapOrphanTransactions.count(inv.hash) ||
+                   orphanPool.Exists(inv.hash) ||
                    pcoinsTip->HaveCoins(inv.hash);
         }
         case MSG_BLOCK:
@@ -6568,39 +6894,40 @@ void static ProcessGetData(CNode* pfrom)
             }
             else if (inv.IsKnownType())
             {
-                // Send stream from relay memory
-                bool pushed = false;
+                // Send stream from relay memory, or else from the mempool entry
+                CRelayPayloadRef payload;
                 {
                     LOCK(cs_mapRelay);
-                    map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
-                    if (mi != mapRelay.end()) {
-                        pfrom->PushMessage(inv.GetCommand(), (*mi).second);
-                        pushed = true;
-                    }
+                    map<CInv, CRelayPayloadRef>::iterator mi = mapRelay.find(inv);
+                    if (mi != mapRelay.end())
+                        payload = mi->second;
                 }
-                if (!pushed && inv.type == MSG_TX) {
-                    CTransaction tx;
-                    if (mempool.lookup(inv.hash, tx)) {
+                if (!payload && inv.type == MSG_TX) {
+                    payload = mempool.GetRelayPayload(inv.hash);
+                    if (!payload) {
+                        CTransaction tx;
+                        CScCertificate cert;
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
-                        ss << tx;
-                        LogPrint("cert", "%s():%d - pushing tx\n", __func__, __LINE__);
-                        pfrom->PushMessage("tx", ss);
-                        pushed = true;
-                    }
-                    else
-                    {
-                        CScCertificate cert;
-                        if (mempool.lookup(inv.hash, cert)) {
-                            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                            ss.reserve(1000);
+                        if (mempool.lookup(inv.hash, tx)) {
+                            ss << tx;
+                            LogPrint("cert", "%s():%d - pushing tx\n", __func__, __LINE__);
+                        } else if (mempool.lookup(inv.hash, cert)) {
                             ss << cert;
                             LogPrint("cert", "%s():%d - pushing certificate\n", __func__, __LINE__);
-                            pfrom->PushMessage("tx", ss);
-                            pushed = true;
+                        }
+                        if (!ss.empty()) {
+                            payload = std::make_shared<const CRelayPayload>(ss);
+                            mempool.SetRelayPayload(inv.hash, payload);
                         }
                     }
                 }
+                bool pushed = false;
+                if (payload) {
+                    pfrom->PushRelayPayload(inv.GetCommand(), *payload);
+                    RecordRelayServed(*payload);
+                    pushed = true;
+                }
                 if (!pushed) {
                     vNotFound.push_back(inv);
                 }
@@ -6673,6 +7000,17 @@ void ProcessMempoolMsg(const CTxMemPool& pool, CNode* pfrom)
     return;
 }
 
+/** Whether some of the outputs txBase spends are neither in the mempool nor in the utxo set */
+static bool HasUnavailableInputs(const CTransactionBase& txBase) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    for (const CTxIn& txin : txBase.GetVin())
+    {
+        if (!mempool.exists(txin.prevout.hash) && !pcoinsTip->HaveCoins(txin.prevout.hash))
+            return true;
+    }
+    return false;
+}
+
 void ProcessTxBaseAcceptToMemoryPool(const CTransactionBase& txBase, CNode* pfrom, BatchVerificationStateFlag proofVerificationState, CValidationState& state)
 {
     if (proofVerificationState == BatchVerificationStateFlag::FAILED)
@@ -6700,32 +7038,34 @@ void ProcessTxBaseAcceptToMemoryPool(const CTransactionBase& txBase, CNode* pfro
     {
         mempool.check(pcoinsTip);
         txBase.Relay();
-        std::vector<uint256> vWorkQueue{txBase.GetHash()};
-        std::vector<uint256> vEraseQueue;
+        std::vector<uint256> vAccepted{txBase.GetHash()};
 
         LogPrint("mempool", "%s(): peer=%d %s: accepted %s (poolsz %u)\n", __func__,
             pfrom->id, pfrom->cleanSubVer,
             txBase.GetHash().ToString(),
             mempool.size());
 
-        // Recursively process any orphan transactions that depended on this one
+        // Process the orphans unblocked by this one, then the ones unblocked by those, and so on.
+        // Each pass tries all the orphans spending what the previous pass accepted, once each.
         set<NodeId> setMisbehaving;
-        for (unsigned int i = 0; i < vWorkQueue.size(); i++)
+        while (!vAccepted.empty())
         {
-            map<uint256, set<uint256> >::iterator itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue[i]);
-            if (itByPrev == mapOrphanTransactionsByPrev.end())
-                continue;
-            for (const uint256& orphanHash: itByPrev->second)
+            std::vector<COrphanTx> vUnblocked = orphanPool.GetSpendersOf(vAccepted);
+            vAccepted.clear();
+            for (const COrphanTx& orphan : vUnblocked)
             {
-                const CTransactionBase& orphanTx = *mapOrphanTransactions[orphanHash].tx;
-                NodeId fromPeer = mapOrphanTransactions[orphanHash].fromPeer;
-                bool fMissingInputs2 = false;
+                const CTransactionBase& orphanTx = *orphan.tx;
+                const uint256& orphanHash = orphanTx.GetHash();
                 // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
                 // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
                 // anyone relaying LegitTxX banned)
                 CValidationState stateDummy;
 
-                if (setMisbehaving.count(fromPeer))
+                if (setMisbehaving.count(orphan.fromPeer))
+                    continue;
+
+                // Still waiting for another parent, possibly a later orphan of this same pass
+                if (HasUnavailableInputs(orphanTx))
                     continue;
 
                 MempoolReturnValue resOrphan = AcceptTxBaseToMemoryPool(mempool, stateDummy, orphanTx,
@@ -6734,46 +7074,44 @@ void ProcessTxBaseAcceptToMemoryPool(const CTransactionBase& txBase, CNode* pfro
                 {
                     LogPrint("mempool", "   accepted orphan tx %s\n", orphanHash.ToString());
                     orphanTx.Relay();
-                    vWorkQueue.push_back(orphanHash);
-                    vEraseQueue.push_back(orphanHash);
+                    vAccepted.push_back(orphanHash);
+                    orphanPool.EraseResolved(orphanHash);
                 }
                 else if (resOrphan == MempoolReturnValue::INVALID)
                 {
                     if (stateDummy.IsInvalid() && stateDummy.GetDoS() > 0)
                     {
                         // Punish peer that gave us an invalid orphan tx
-                        Misbehaving(fromPeer, stateDummy.GetDoS());
-                        setMisbehaving.insert(fromPeer);
+                        Misbehaving(orphan.fromPeer, stateDummy.GetDoS());
+                        setMisbehaving.insert(orphan.fromPeer);
                         LogPrint("mempool", "   invalid orphan tx %s\n", orphanHash.ToString());
                     }
                     // Has inputs but not accepted to mempool
                     // Probably non-standard or insufficient fee/priority
                     LogPrint("mempool", "   removed orphan tx %s\n", orphanHash.ToString());
-                    vEraseQueue.push_back(orphanHash);
+                    orphanPool.EraseInvalid(orphanHash);
                     assert(recentRejects);
                     recentRejects->insert(orphanHash);
                 }
                 else if (resOrphan == MempoolReturnValue::PARTIALLY_VALIDATED)
                 {
-                    vEraseQueue.push_back(orphanHash);
+                    // Its proof is verified asynchronously, then it goes through here as any other tx
+                    orphanPool.EraseResolved(orphanHash);
                 }
                 mempool.check(pcoinsTip);
             }
         }
-
-            for(const uint256& hash: vEraseQueue)
-            EraseOrphanTx(hash);
     }
-    // TODO: currently, prohibit joinsplits from entering mapOrphans
+    // TODO: currently, prohibit joinsplits from entering the orphan pool
     else if (res == MempoolReturnValue::MISSING_INPUT && txBase.GetVjoinsplit().size() == 0)
     {
-        AddOrphanTx(txBase, pfrom->GetId());
+        orphanPool.Add(txBase, pfrom->GetId());
 
-        // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
+        // DoS prevention: do not allow the orphan pool to grow unbounded
         unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
-        unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
+        unsigned int nEvicted = orphanPool.LimitSize(nMaxOrphanTx);
         if (nEvicted > 0)
-            LogPrint("mempool", "mapOrphan overflow, removed %u tx\n", nEvicted);
+            LogPrint("mempool", "orphan pool overflow, removed %u tx\n", nEvicted);
     }
 }
 
@@ -7113,7 +7451,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     pfrom->PushMessage("getheaders", bl, inv.hash);
                     CNodeState *nodestate = State(pfrom->GetId());
                     if (chainActive.Tip()->GetBlockTime() > GetTime() - chainparams.GetConsensus().nPowTargetSpacing * 20 &&
-                        nodestate->nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+                        nodestate->nBlocksInFlight < nodestate->downloadRate.GetWindow()) {
                         vToFetch.push_back(inv);
                         // Mark block as in flight already, even though the actual "getdata" message only goes out
                         // later (within the same cs_main lock, though).
@@ -8036,34 +8374,20 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         // Message: inventory
         //
         vector<CInv> vInv;
-        vector<CInv> vInvWait;
         {
             LOCK(pto->cs_inventory);
-            vInv.reserve(pto->vInventoryToSend.size());
-            vInvWait.reserve(pto->vInventoryToSend.size());
-            BOOST_FOREACH(const CInv& inv, pto->vInventoryToSend)
+            // Transaction inventory held back to protect privacy is sent in
+            // one batch at the trickle
+            if (fSendTrickle && !pto->vInventoryToTrickle.empty())
             {
-                if (pto->setInventoryKnown.count(inv))
-                    continue;
-
-                // trickle out tx inv to protect privacy
-                if (inv.type == MSG_TX && !fSendTrickle)
-                {
-                    // 1/4 of tx invs blast to all immediately
-                    static uint256 hashSalt;
-                    if (hashSalt.IsNull())
-                        hashSalt = GetRandHash();
-                    uint256 hashRand = ArithToUint256(UintToArith256(inv.hash) ^ UintToArith256(hashSalt));
-                    hashRand = Hash(BEGIN(hashRand), END(hashRand));
-                    bool fTrickleWait = ((UintToArith256(hashRand) & 3) != 0);
-
-                    if (fTrickleWait)
-                    {
-                        vInvWait.push_back(inv);
-                        continue;
-                    }
-                }
+                pto->vInventoryToSend.insert(pto->vInventoryToSend.end(),
+                    pto->vInventoryToTrickle.begin(), pto->vInventoryToTrickle.end());
+                pto->vInventoryToTrickle.clear();
+            }
 
+            vInv.reserve(std::min<size_t>(pto->vInventoryToSend.size(), 1000));
+            BOOST_FOREACH(const CInv& inv, pto->vInventoryToSend)
+            {
                 // returns true if wasn't already contained in the set
                 if (pto->setInventoryKnown.insert(inv).second)
                 {
@@ -8076,7 +8400,7 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
                     }
                 }
             }
-            pto->vInventoryToSend = vInvWait;
+            pto->vInventoryToSend.clear();
         }
         if (!vInv.empty())
         {
@@ -8120,10 +8444,11 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         // Message: getdata (blocks)
         //
         vector<CInv> vGetData;
-        if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload()) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        int nDownloadWindow = state.downloadRate.GetWindow();
+        if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload()) && state.nBlocksInFlight < nDownloadWindow) {
             vector<CBlockIndex*> vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
+            FindNextBlocksToDownload(pto->GetId(), nDownloadWindow - state.nBlocksInFlight, vToDownload, staller);
             BOOST_FOREACH(CBlockIndex *pindex, vToDownload) {
                 vGetData.push_back(CInv(MSG_BLOCK, pindex->GetBlockHash()));
                 MarkBlockAsInFlight(pto->GetId(), pindex->GetBlockHash(), consensusParams, pindex);
@@ -8185,8 +8510,7 @@ public:
         mapBlockIndex.clear();
 
         // orphan transactions
-        mapOrphanTransactions.clear();
-        mapOrphanTransactionsByPrev.clear();
+        orphanPool.Clear();
     }
 } instance_of_cmaincleanup;
 
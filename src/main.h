@@ -41,12 +41,14 @@ class CCoins;
 class CCoinsViewCache;
 class CCoinsView;
 class CBlock;
+class CBlockFileBytes;
 class CBlockLocator;
 class CBlockTreeDB;
 class CScriptCheck;
 class CValidationState;
 class CTxUndo;
 struct CNodeStateStats;
+struct CBlockImportStats;
 class CTxInUndo;
 
 /** Default for -blockmaxsize and -blockminsize, which control the range of sizes the mining code will create **/
@@ -75,6 +77,14 @@ static const unsigned int MAX_STANDARD_TX_SIGOPS = MAX_BLOCK_SIGOPS/5;
 static const unsigned int DEFAULT_MIN_RELAY_TX_FEE = 100;
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
+/** Default for -maxmempool, maximum megabytes of mempool memory usage */
+static const unsigned int DEFAULT_MAX_MEMPOOL_SIZE = 300;
+/** Default for -mempoolexpiry, expiration time for mempool transactions in hours */
+static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 72;
+/** Default for -persistmempool, whether the mempool is saved on shutdown and loaded on restart */
+static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Default for -checkmempoolbudget, the milliseconds a sampled mempool check may take */
+static const int64_t DEFAULT_CHECKMEMPOOL_BUDGET = 5;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
@@ -85,8 +95,10 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
-/** Number of blocks that can be requested at any given time from a single peer. */
-static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Maximum number of threads parsing block files during an import */
+static const int MAX_BLOCK_IMPORT_THREADS = 16;
+/** -reindexthreads default (number of block file parsing threads, 0 = auto) */
+static const int DEFAULT_BLOCK_IMPORT_THREADS = 0;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
 static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
@@ -95,8 +107,10 @@ static const unsigned int MAX_HEADERS_RESULTS = 160;
 /** Size of the "block download window": how far ahead of our current height do we fetch?
  *  Larger windows tolerate larger download speed differences between peer, but increase the potential
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
- *  harder). We'll probably want to make this a per-peer adaptive value at some point. */
+ *  harder). How many blocks of the window each peer has in flight adapts to its delivery rate. */
 static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
+/** Maximum number of blocks downloaded ahead of the active chain tip, waiting to be validated. */
+static const unsigned int MAX_BLOCKS_AHEAD_OF_VALIDATION = 2 * BLOCK_DOWNLOAD_WINDOW;
 /** Time to wait (in seconds) between writing blocks/block index to disk. */
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
@@ -146,6 +160,7 @@ extern bool fImporting;
 extern bool fReindex;
 extern bool fReindexFast;
 extern int nScriptCheckThreads;
+extern int nBlockImportThreads;
 
 #ifdef ENABLE_ADDRESS_INDEXING
 extern bool fAddressIndex;
@@ -239,8 +254,8 @@ FILE* OpenBlockFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 /** Translation to a filesystem path */
 boost::filesystem::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix);
-/** Import blocks from an external file, possibly headers only */
-bool LoadBlocksFromExternalFile(FILE* fileIn, CDiskBlockPos *dbp, bool loadHeadersOnly);
+/** Import blocks from an external file, possibly headers only, adding the throughput of the import to pstats */
+bool LoadBlocksFromExternalFile(FILE* fileIn, CDiskBlockPos *dbp, bool loadHeadersOnly, CBlockImportStats* pstats = nullptr);
 /** Initialize a new block tree database + block data on disk */
 bool InitBlockIndex();
 /** Load the block tree and coins database from disk */
@@ -381,22 +396,62 @@ void RejectMemoryPoolTxBase(const CValidationState& state, const CTransactionBas
 MempoolReturnValue AcceptTxBaseToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransactionBase &txBase,
     LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom = nullptr);
 
+/** nAcceptTime, when not 0, is the time the transaction first entered the memory pool, before a restart */
 MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx,
-    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom = nullptr);
+    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom = nullptr,
+    int64_t nAcceptTime = 0);
 
 MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationState &state, const CScCertificate &cert,
-    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom = nullptr);
+    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom = nullptr,
+    int64_t nAcceptTime = 0);
+
+/** A mempool entry as written by DumpMempool, with the time it was accepted */
+struct CMempoolDumpEntry
+{
+    bool fCertificate;
+    CTransaction tx;
+    CScCertificate cert;
+    int64_t nTime;
+
+    CMempoolDumpEntry() : fCertificate(false), nTime(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(fCertificate);
+        if (fCertificate)
+            READWRITE(cert);
+        else
+            READWRITE(tx);
+        READWRITE(nTime);
+    }
+};
+
+/** Write the entries of pool, in dependency order, and its prioritisation deltas to file. Requires pool.cs */
+void WriteMempoolDump(CAutoFile& file, const CTxMemPool& pool, const uint256& hashBestBlock);
+
+/** Read what WriteMempoolDump wrote, returning false if the version or the checksum don't match */
+bool ReadMempoolDump(CAutoFile& file, uint256& hashBestBlock, std::map<uint256, std::pair<double, CAmount> >& mapDeltas,
+                     std::vector<CMempoolDumpEntry>& vEntries);
+
+/** Dump the memory pool to disk, in dependency order, with the prioritisation deltas */
+bool DumpMempool();
+
+/** Load the memory pool dumped by DumpMempool */
+bool LoadMempool();
+
+/** Sidechains the mempool entries are checked against after connecting block, whose ceasing events are scEvents */
+std::set<uint256> GetSidechainsTouchedByBlock(const CBlock& block, const CSidechainEvents& scEvents);
 
 struct CNodeStateStats {
     int nMisbehavior;
     int nSyncHeight;
     int nCommonHeight;
     std::vector<int> vHeightInFlight;
-};
-
-struct COrphanTx {
-    std::shared_ptr<const CTransactionBase> tx;
-    NodeId fromPeer;
+    int nBlocksInFlightWindow;
+    int64_t nBlockDelay;
+    uint64_t nBlocksReassigned;
 };
 
 CAmount GetMinRelayFee(const CTransactionBase& tx, unsigned int nBytes, bool fAllowFree, unsigned int block_priority_size);
@@ -533,6 +588,8 @@ bool GetAddressUnspent(uint160 addressHash, int type,
 bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
+/** Serialized block of pindex, without decoding it when its file can be mapped */
+bool ReadRawBlockFromDisk(CBlockFileBytes& bytes, const CBlockIndex* pindex);
 CBlock LoadBlockFrom(CBufferedFile& blkdat, CDiskBlockPos* pLastLoadedBlkPos);
 
 /** Functions for validating blocks and updating the block tree */
@@ -601,7 +658,9 @@ bool TestBlockValidity(CValidationState &state, const CBlock& block, CBlockIndex
  * If dbp is non-NULL, the file is known to already reside on disk
  */
 bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex **pindex, bool fRequested, CDiskBlockPos* dbp, BlockSet* sForkTips = NULL);
-bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex **ppindex= NULL, bool lookForwardTips = false);
+/** Store a block header in the block index, fCheckPOW OFF if its PoW was already verified */
+bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex **ppindex= NULL, bool lookForwardTips = false,
+                       flagCheckPow fCheckPOW = flagCheckPow::ON);
 
 
 class CBlockFileInfo
@@ -666,6 +725,15 @@ public:
     bool VerifyDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth);
 };
 
+/**
+ * Block index entry of hash, NULL if unknown. Doesn't need cs_main: entries are published fully built.
+ * Without cs_main only the fields fixed when the entry is added can be read: the header, phashBlock, pprev,
+ * pskip, nHeight, nChainWork, nChainDelay and scCumTreeHash. nStatus, nTx, nChainTx, the disk positions and
+ * the value pools change as the block is received, connected or pruned, so they need cs_main unless pruning is
+ * off and the entry is in a chain snapshot, whose blocks were connected before it was taken.
+ */
+CBlockIndex* LookupBlockIndex(const uint256& hash);
+
 /** Find the last common block between the parameter chain and a locator. */
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator);
 
@@ -0,0 +1,205 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/bitcoin-config.h"
+#endif
+
+#ifdef ENABLE_ADDRESS_INDEXING
+
+#include "mempoolindex.h"
+
+#include "memusage.h"
+#include "random.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace {
+
+struct DeltaOrder
+{
+    bool operator()(const std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>& a,
+                    const std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>& b) const {
+        if (a.first.txhash != b.first.txhash)
+            return a.first.txhash < b.first.txhash;
+        if (a.first.index != b.first.index)
+            return a.first.index < b.first.index;
+        return a.first.spending < b.first.spending;
+    }
+};
+
+} // anon namespace
+
+CMempoolAddressKeyHasher::CMempoolAddressKeyHasher() : salt(GetRandHash()) {}
+
+size_t CMempoolAddressKeyHasher::operator()(const CMempoolAddressKey& key) const
+{
+    uint256 buf;
+    memcpy(buf.begin(), key.addressBytes.begin(), key.addressBytes.size());
+    memcpy(buf.begin() + key.addressBytes.size(), &key.type, sizeof(key.type));
+    return buf.GetHash(salt);
+}
+
+CSpentIndexKeyHasher::CSpentIndexKeyHasher() : salt(GetRandHash()) {}
+
+CMempoolAddressIndex::Delta* CMempoolAddressIndex::find(const CMempoolAddressDeltaKey& key)
+{
+    auto txIt = mapTxDeltas.find(key.txhash);
+    if (txIt == mapTxDeltas.end())
+        return nullptr;
+
+    CMempoolAddressKey address(key.type, key.addressBytes);
+    for (const DeltaRef& ref : txIt->second) {
+        if (!(ref.address == address))
+            continue;
+        Delta& entry = mapDeltas.at(address)[ref.pos];
+        if (entry.index == key.index && entry.spending == key.spending)
+            return &entry;
+    }
+    return nullptr;
+}
+
+void CMempoolAddressIndex::add(const uint256& txhash, const DeltaList& deltas)
+{
+    for (const auto& item : deltas) {
+        const CMempoolAddressDeltaKey& key = item.first;
+        assert(key.txhash == txhash);
+
+        if (find(key) != nullptr)
+            continue;
+
+        CMempoolAddressKey address(key.type, key.addressBytes);
+        DeltaVector& vec = mapDeltas[address];
+        mapTxDeltas[txhash].push_back(DeltaRef(address, vec.size()));
+        vec.push_back(Delta(key, item.second));
+        nDeltas++;
+    }
+}
+
+void CMempoolAddressIndex::remove(const uint256& txhash)
+{
+    auto txIt = mapTxDeltas.find(txhash);
+    if (txIt == mapTxDeltas.end())
+        return;
+
+    // Deltas are removed by moving the last delta of the address into their
+    // slot. Going through them from the highest position down guarantees the
+    // moved delta never belongs to this transaction.
+    std::vector<DeltaRef> refs = txIt->second;
+    mapTxDeltas.erase(txIt);
+    std::sort(refs.begin(), refs.end(),
+              [](const DeltaRef& a, const DeltaRef& b) { return a.pos > b.pos; });
+
+    for (const DeltaRef& ref : refs) {
+        auto it = mapDeltas.find(ref.address);
+        assert(it != mapDeltas.end());
+
+        DeltaVector& vec = it->second;
+        const uint32_t last = vec.size() - 1;
+        if (ref.pos != last) {
+            vec[ref.pos] = vec[last];
+            for (DeltaRef& moved : mapTxDeltas.at(vec[ref.pos].txhash)) {
+                if (moved.pos == last && moved.address == ref.address) {
+                    moved.pos = ref.pos;
+                    break;
+                }
+            }
+        }
+        vec.pop_back();
+        nDeltas--;
+
+        if (vec.empty())
+            mapDeltas.erase(it);
+    }
+}
+
+bool CMempoolAddressIndex::setOutputStatus(const CMempoolAddressDeltaKey& key, CMempoolAddressDelta::OutputStatus status)
+{
+    Delta* entry = find(key);
+    if (entry == nullptr)
+        return false;
+
+    entry->delta.outStatus = status;
+    return true;
+}
+
+void CMempoolAddressIndex::get(int type, const uint160& addressHash, DeltaList& results) const
+{
+    auto it = mapDeltas.find(CMempoolAddressKey(type, addressHash));
+    if (it == mapDeltas.end())
+        return;
+
+    size_t first = results.size();
+    results.reserve(first + it->second.size());
+    for (const Delta& entry : it->second) {
+        results.push_back(std::make_pair(
+            CMempoolAddressDeltaKey(type, addressHash, entry.txhash, entry.index, entry.spending),
+            entry.delta));
+    }
+    std::sort(results.begin() + first, results.end(), DeltaOrder());
+}
+
+void CMempoolAddressIndex::clear()
+{
+    mapDeltas.clear();
+    mapTxDeltas.clear();
+    nDeltas = 0;
+}
+
+size_t CMempoolAddressIndex::DynamicMemoryUsage() const
+{
+    // Vectors are not walked here, their content is estimated from the
+    // number of deltas so that this stays O(1).
+    return memusage::DynamicUsage(mapDeltas) +
+           memusage::DynamicUsage(mapTxDeltas) +
+           (sizeof(Delta) + sizeof(DeltaRef)) * nDeltas;
+}
+
+void CMempoolSpentIndex::add(const uint256& txhash, const SpentList& spent)
+{
+    std::vector<CSpentIndexKey>& txKeys = mapTxSpent[txhash];
+
+    for (const auto& item : spent) {
+        if (mapSpent.insert(item).second)
+            txKeys.push_back(item.first);
+    }
+}
+
+void CMempoolSpentIndex::remove(const uint256& txhash)
+{
+    auto txIt = mapTxSpent.find(txhash);
+    if (txIt == mapTxSpent.end())
+        return;
+
+    for (const CSpentIndexKey& key : txIt->second)
+        mapSpent.erase(key);
+
+    mapTxSpent.erase(txIt);
+}
+
+bool CMempoolSpentIndex::get(const CSpentIndexKey& key, CSpentIndexValue& value) const
+{
+    auto it = mapSpent.find(key);
+    if (it == mapSpent.end())
+        return false;
+
+    value = it->second;
+    return true;
+}
+
+void CMempoolSpentIndex::clear()
+{
+    mapSpent.clear();
+    mapTxSpent.clear();
+}
+
+size_t CMempoolSpentIndex::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(mapSpent) +
+           memusage::DynamicUsage(mapTxSpent) +
+           memusage::MallocUsage(sizeof(CSpentIndexKey)) * mapSpent.size();
+}
+
+#endif // ENABLE_ADDRESS_INDEXING
@@ -0,0 +1,132 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_MEMPOOLINDEX_H
+#define BITCOIN_MEMPOOLINDEX_H
+
+#include "addressindex.h"
+#include "spentindex.h"
+#include "coins.h"
+#include "uint256.h"
+
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+/** Address an address index delta refers to: address type and address hash */
+struct CMempoolAddressKey
+{
+    int type;
+    uint160 addressBytes;
+
+    CMempoolAddressKey(int addressType, const uint160& addressHash) :
+        type(addressType), addressBytes(addressHash) {}
+
+    friend bool operator==(const CMempoolAddressKey& a, const CMempoolAddressKey& b) {
+        return a.type == b.type && a.addressBytes == b.addressBytes;
+    }
+};
+
+class CMempoolAddressKeyHasher
+{
+private:
+    uint256 salt;
+
+public:
+    CMempoolAddressKeyHasher();
+
+    size_t operator()(const CMempoolAddressKey& key) const;
+};
+
+class CSpentIndexKeyHasher
+{
+private:
+    uint256 salt;
+
+public:
+    CSpentIndexKeyHasher();
+
+    size_t operator()(const CSpentIndexKey& key) const {
+        return key.txid.GetHash(salt) ^ key.outputIndex;
+    }
+};
+
+/**
+ * Address index of the mempool entries.
+ *
+ * Deltas are kept in one contiguous vector per address, found through a hash
+ * map keyed by the address. Vectors are unordered so that adding and
+ * removing a transaction is O(1) per delta even for addresses with many
+ * pending entries; each transaction remembers where its deltas are, and
+ * lookups sort the deltas of the requested address in key order.
+ */
+class CMempoolAddressIndex
+{
+public:
+    struct Delta
+    {
+        uint256 txhash;
+        unsigned int index;
+        int spending;
+        CMempoolAddressDelta delta;
+
+        Delta(const CMempoolAddressDeltaKey& key, const CMempoolAddressDelta& d) :
+            txhash(key.txhash), index(key.index), spending(key.spending), delta(d) {}
+    };
+
+    typedef std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > DeltaList;
+
+    /** Add all the deltas of a transaction; existing deltas for the same key are kept */
+    void add(const uint256& txhash, const DeltaList& deltas);
+    /** Remove every delta added for txhash */
+    void remove(const uint256& txhash);
+    /** Change the status of an existing output delta. Returns false if there is no such delta */
+    bool setOutputStatus(const CMempoolAddressDeltaKey& key, CMempoolAddressDelta::OutputStatus status);
+    /** Append the deltas of an address to results, in key order */
+    void get(int type, const uint160& addressHash, DeltaList& results) const;
+    void clear();
+
+    size_t size() const { return nDeltas; }
+    size_t DynamicMemoryUsage() const;
+
+private:
+    /** Position of one delta of a transaction */
+    struct DeltaRef
+    {
+        CMempoolAddressKey address;
+        uint32_t pos;
+
+        DeltaRef(const CMempoolAddressKey& a, uint32_t p) : address(a), pos(p) {}
+    };
+
+    typedef std::vector<Delta> DeltaVector;
+    boost::unordered_map<CMempoolAddressKey, DeltaVector, CMempoolAddressKeyHasher> mapDeltas;
+    boost::unordered_map<uint256, std::vector<DeltaRef>, CCoinsKeyHasher> mapTxDeltas;
+    size_t nDeltas = 0;
+
+    Delta* find(const CMempoolAddressDeltaKey& key);
+};
+
+/**
+ * Spent index of the mempool entries: which mempool transaction spends a
+ * given outpoint, hash-indexed by the outpoint.
+ */
+class CMempoolSpentIndex
+{
+public:
+    typedef std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > SpentList;
+
+    void add(const uint256& txhash, const SpentList& spent);
+    void remove(const uint256& txhash);
+    bool get(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+    void clear();
+
+    size_t size() const { return mapSpent.size(); }
+    size_t DynamicMemoryUsage() const;
+
+private:
+    boost::unordered_map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyHasher> mapSpent;
+    boost::unordered_map<uint256, std::vector<CSpentIndexKey>, CCoinsKeyHasher> mapTxSpent;
+};
+
+#endif // BITCOIN_MEMPOOLINDEX_H
@@ -38,6 +38,7 @@
 #ifdef ENABLE_MINING
 #include <functional>
 #endif
+#include <atomic>
 #include <mutex>
 #include <init.h>
 #include <undo.h>
@@ -865,6 +866,108 @@ CBlockTemplate* CreateNewBlockWithKey()
     return CreateNewBlock(*scriptPubKey);
 }
 
+//////////////////////////////////////////////////////////////////////////////
+//
+// Shared block template
+//
+
+static CSharedBlockTemplate sharedBlockTemplate; // guarded by cs_main
+static std::atomic<int64_t> nLastBlockTemplateRequest(0);
+
+static CWaitableCriticalSection csBlockTemplateEvent;
+static CConditionVariable cvBlockTemplateEvent;
+static uint64_t nBlockTemplateEvents = 0; // guarded by csBlockTemplateEvent
+
+static bool IsBlockTemplateStale()
+{
+    AssertLockHeld(cs_main);
+    const CSharedBlockTemplate& shared = sharedBlockTemplate;
+    return !shared.pblocktemplate || shared.pindexPrev != chainActive.Tip() ||
+        (mempool.GetTransactionsUpdated() != shared.nTransactionsUpdated &&
+         GetTime() - shared.nTime > BLOCK_TEMPLATE_REFRESH_INTERVAL);
+}
+
+static void UpdateSharedBlockTemplate()
+{
+    AssertLockHeld(cs_main);
+
+    // Clear the template so future calls make a new block, despite any failures from here on
+    sharedBlockTemplate = CSharedBlockTemplate();
+
+    // Store the counter and tip used before CreateNewBlockWithKey, to avoid races
+    CSharedBlockTemplate shared;
+    shared.nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    shared.pindexPrev = chainActive.Tip();
+    shared.nTime = GetTime();
+#ifdef ENABLE_WALLET
+    CReserveKey reservekey(pwalletMain);
+    shared.pblocktemplate.reset(CreateNewBlockWithKey(reservekey));
+#else
+    shared.pblocktemplate.reset(CreateNewBlockWithKey());
+#endif
+    if (shared.pblocktemplate)
+        sharedBlockTemplate = shared;
+}
+
+CSharedBlockTemplate GetSharedBlockTemplate()
+{
+    AssertLockHeld(cs_main);
+    nLastBlockTemplateRequest = GetTime();
+    if (IsBlockTemplateStale())
+        UpdateSharedBlockTemplate();
+    return sharedBlockTemplate;
+}
+
+void NotifyBlockTemplateEvent()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(csBlockTemplateEvent);
+        nBlockTemplateEvents++;
+    }
+    cvBlockTemplateEvent.notify_all();
+}
+
+uint64_t GetBlockTemplateEvents()
+{
+    boost::lock_guard<boost::mutex> lock(csBlockTemplateEvent);
+    return nBlockTemplateEvents;
+}
+
+bool WaitBlockTemplateEvent(uint64_t nEvents, const boost::system_time& deadline)
+{
+    boost::unique_lock<boost::mutex> lock(csBlockTemplateEvent);
+    while (nBlockTemplateEvents == nEvents)
+        if (!cvBlockTemplateEvent.timed_wait(lock, deadline))
+            return false;
+    return true;
+}
+
+void ThreadUpdateBlockTemplate()
+{
+    RenameThread("zen-blocktmpl");
+    uint64_t nEvents = GetBlockTemplateEvents();
+    while (true)
+    {
+        // A mempool change may only make the template stale once it ages, so wake up periodically as well
+        WaitBlockTemplateEvent(nEvents, boost::get_system_time() + boost::posix_time::seconds(BLOCK_TEMPLATE_REFRESH_INTERVAL));
+        boost::this_thread::interruption_point();
+        nEvents = GetBlockTemplateEvents();
+
+        if (GetTime() - nLastBlockTemplateRequest > BLOCK_TEMPLATE_IDLE_TIMEOUT)
+            continue;
+
+        LOCK(cs_main);
+        if (IsInitialBlockDownload() || !IsBlockTemplateStale())
+            continue;
+        try {
+            UpdateSharedBlockTemplate();
+        } catch (const std::exception& e) {
+            // The next getblocktemplate call reports it
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // Internal miner
@@ -959,9 +1062,12 @@ void static BitcoinMiner()
     unsigned int k = chainparams.EquihashK();
 
     std::string solver = GetArg("-equihashsolver", "default");
-    assert(solver == "tromp" || solver == "default");
+    assert(solver == "tromp" || solver == "arena" || solver == "default");
     LogPrint("pow", "Using Equihash solver \"%s\" with n = %u, k = %u\n", solver, n, k);
 
+    // Arenas are allocated by the first solve and reused for every nonce
+    EhArenaSolver arenaSolver;
+
     std::mutex m_cs;
     bool cancelSolver = false;
     boost::signals2::connection c = uiInterface.NotifyBlockTip.connect(
@@ -1128,7 +1234,9 @@ void static BitcoinMiner()
                 } else {
                     try {
                         // If we find a valid block, we rebuild
-                        bool found = EhOptimisedSolve(n, k, curr_state, validBlock, cancelled);
+                        bool found = (solver == "arena") ?
+                                arenaSolver.Solve(n, k, curr_state, validBlock, cancelled) :
+                                EhOptimisedSolve(n, k, curr_state, validBlock, cancelled);
                         ehSolverRuns.increment();
                         if (found) {
                             break;
@@ -9,7 +9,9 @@
 #include "primitives/block.h"
 
 #include <boost/optional.hpp>
+#include <boost/thread/thread_time.hpp>
 #include <boost/tuple/tuple.hpp>
+#include <memory>
 #include <stdint.h>
 
 class CBlockIndex;
@@ -82,6 +84,43 @@ CBlockTemplate* CreateNewBlockWithKey();
 
 CMutableTransaction createCoinbase(const CScript &scriptPubKeyIn, CAmount fees, const int nHeight);
 
+/** Age (in seconds) after which a template is rebuilt if the mempool changed */
+static const int64_t BLOCK_TEMPLATE_REFRESH_INTERVAL = 5;
+/** Time (in seconds) the template is kept up to date after the last request */
+static const int64_t BLOCK_TEMPLATE_IDLE_TIMEOUT = 60;
+
+/**
+ * Block template shared by the getblocktemplate callers, with the tip it
+ * builds on and the mempool update counter it reflects.
+ */
+struct CSharedBlockTemplate
+{
+    std::shared_ptr<CBlockTemplate> pblocktemplate;
+    CBlockIndex* pindexPrev;
+    unsigned int nTransactionsUpdated;
+    int64_t nTime;
+
+    CSharedBlockTemplate(): pindexPrev(NULL), nTransactionsUpdated(0), nTime(0) {}
+};
+
+/**
+ * Return the current block template, rebuilding it if the tip changed, or if
+ * the mempool changed and it is older than BLOCK_TEMPLATE_REFRESH_INTERVAL.
+ * The returned pblocktemplate is null if the template could not be built.
+ * Requires cs_main, which also guards the returned template.
+ */
+CSharedBlockTemplate GetSharedBlockTemplate();
+
+/** Signal a change of the tip or of the mempool to the template updater and long-poll waiters */
+void NotifyBlockTemplateEvent();
+/** Return the number of template events so far */
+uint64_t GetBlockTemplateEvents();
+/** Wait until deadline for an event after the first nEvents, returns false on timeout */
+bool WaitBlockTemplateEvent(uint64_t nEvents, const boost::system_time& deadline);
+
+/** Rebuild the shared template in the background as events make it stale, while it is being requested */
+void ThreadUpdateBlockTemplate();
+
 #ifdef ENABLE_MINING
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
@@ -10,12 +10,14 @@
 #include "net.h"
 
 #include "addrman.h"
+#include "arith_uint256.h"
 #include "chainparams.h"
 #include "clientversion.h"
 #include "primitives/transaction.h"
 #include "scheduler.h"
 #include "ui_interface.h"
 #include "crypto/common.h"
+#include "memusage.h"
 #include "zen/utiltls.h"
 
 
@@ -28,6 +30,10 @@
 #include <fcntl.h>
 #endif
 
+#include <atomic>
+#include <mutex>
+#include <math.h>
+
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 
@@ -95,9 +101,12 @@ bool fAddressesInitialized = false;
 TLSManager tlsmanager = TLSManager();
 vector<CNode*> vNodes;
 CCriticalSection cs_vNodes;
-map<CInv, CDataStream> mapRelay;
+map<CInv, CRelayPayloadRef> mapRelay;
 deque<pair<int64_t, CInv> > vRelayExpiration;
 CCriticalSection cs_mapRelay;
+static CRelayStats relayStats = {}; // guarded by cs_mapRelay
+static int64_t nLastRelayTime = 0;
+static std::atomic<uint64_t> nRelaySerialized(0);
 limitedmap<CInv, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
 
 static deque<string> vOneShots;
@@ -2116,7 +2125,88 @@ void CNode::NetCleanup()
 #endif
 }
 
-void Relay(const CTransactionBase& tx, const CDataStream& ss)
+static unsigned int MessageChecksum(const CDataStream& ss)
+{
+    uint256 hash = Hash(ss.begin(), ss.end());
+    unsigned int nChecksum = 0;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    return nChecksum;
+}
+
+CRelayPayload::CRelayPayload(const CDataStream& ss) :
+    data(ss.begin(), ss.end()), nChecksum(MessageChecksum(ss))
+{
+    ++nRelaySerialized;
+}
+
+size_t CRelayPayload::DynamicMemoryUsage() const
+{
+    return memusage::MallocUsage(sizeof(CRelayPayload)) + memusage::MallocUsage(data.capacity());
+}
+
+// Window of the relay rate average, in seconds
+static const double RELAY_RATE_WINDOW = 60.0;
+
+static double DecayedRelayRate(int64_t nNow)
+{
+    return relayStats.dRelayRate * exp(-(nNow - nLastRelayTime) / (RELAY_RATE_WINDOW * 1000000));
+}
+
+CRelayStats GetRelayStats()
+{
+    LOCK(cs_mapRelay);
+    CRelayStats stats = relayStats;
+    stats.nSerialized = nRelaySerialized;
+    stats.dRelayRate = DecayedRelayRate(GetTimeMicros());
+    return stats;
+}
+
+void RecordRelayServed(const CRelayPayload& payload)
+{
+    LOCK(cs_mapRelay);
+    relayStats.nServed++;
+    relayStats.nServedBytes += payload.data.size();
+}
+
+/**
+ * 3/4 of the transaction inventory waits for the next trickle to protect
+ * privacy, the rest is announced immediately. The choice only depends on the
+ * hash, so it is made once for all the peers.
+ */
+static bool IsTrickledInventory(const CInv& inv)
+{
+    if (inv.type != MSG_TX)
+        return false;
+
+    // Relay runs on the RPC and the net threads alike
+    static uint256 hashSalt;
+    static std::once_flag initSaltOnce;
+    std::call_once(initSaltOnce, []() { hashSalt = GetRandHash(); });
+    uint256 hashRand = ArithToUint256(UintToArith256(inv.hash) ^ UintToArith256(hashSalt));
+    hashRand = Hash(BEGIN(hashRand), END(hashRand));
+    return (UintToArith256(hashRand) & 3) != 0;
+}
+
+uint64_t AnnounceTransaction(const CTransactionBase& tx, const std::vector<CNode*>& vPeers)
+{
+    CInv inv(MSG_TX, tx.GetHash());
+    const bool fTrickle = IsTrickledInventory(inv);
+
+    uint64_t nAnnounced = 0;
+    BOOST_FOREACH(CNode* pnode, vPeers)
+    {
+        if(!pnode->fRelayTxes || pnode->fDisconnect)
+            continue;
+        LOCK(pnode->cs_filter);
+        if (pnode->pfilter && !pnode->pfilter->IsRelevantAndUpdate(tx))
+            continue;
+        pnode->PushInventory(inv, fTrickle);
+        nAnnounced++;
+    }
+    return nAnnounced;
+}
+
+void Relay(const CTransactionBase& tx, const CRelayPayloadRef& payload)
 {
     CInv inv(MSG_TX, tx.GetHash());
     {
@@ -2129,22 +2219,35 @@ void Relay(const CTransactionBase& tx, const CDataStream& ss)
         }
 
         // Save original serialized message so newer versions are preserved
-        mapRelay.insert(std::make_pair(inv, ss));
+        mapRelay.insert(std::make_pair(inv, payload));
         vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
+
+        int64_t nNow = GetTimeMicros();
+        relayStats.dRelayRate = DecayedRelayRate(nNow) + 1.0 / RELAY_RATE_WINDOW;
+        nLastRelayTime = nNow;
+        relayStats.nRelayed++;
     }
-    LOCK(cs_vNodes);
-    BOOST_FOREACH(CNode* pnode, vNodes)
+
+    // Peers are referenced so that cs_vNodes is not held while their filters
+    // are matched against the transaction
+    vector<CNode*> vNodesCopy;
     {
-        if(!pnode->fRelayTxes)
-            continue;
-        LOCK(pnode->cs_filter);
-        if (pnode->pfilter)
-        {
-            if (pnode->pfilter->IsRelevantAndUpdate(tx))
-                pnode->PushInventory(inv);
-        } else
-            pnode->PushInventory(inv);
+        LOCK(cs_vNodes);
+        vNodesCopy = vNodes;
+        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+            pnode->AddRef();
+    }
+
+    uint64_t nAnnounced = AnnounceTransaction(tx, vNodesCopy);
+
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+            pnode->Release();
     }
+
+    LOCK(cs_mapRelay);
+    relayStats.nAnnounced += nAnnounced;
 }
 
 #if 0
@@ -2496,7 +2599,7 @@ void CNode::AbortMessage() UNLOCK_FUNCTION(cs_vSend)
     LogPrint("net", "(aborted)\n");
 }
 
-void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
+void CNode::EndMessage(const unsigned int* pnChecksum) UNLOCK_FUNCTION(cs_vSend)
 {
     // The -*messagestest options are intentionally not documented in the help message,
     // since they are only used during development to debug the networking code and are
@@ -2508,7 +2611,10 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
         return;
     }
     if (mapArgs.count("-fuzzmessagestest"))
+    {
         Fuzz(GetArg("-fuzzmessagestest", 10));
+        pnChecksum = NULL;
+    }
 
     if (ssSend.size() == 0)
     {
@@ -2519,10 +2625,15 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
     unsigned int nSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
     WriteLE32((uint8_t*)&ssSend[CMessageHeader::MESSAGE_SIZE_OFFSET], nSize);
 
-    // Set the checksum
-    uint256 hash = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
+    // Set the checksum, unless the payload comes with it
     unsigned int nChecksum = 0;
-    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    if (pnChecksum)
+        nChecksum = *pnChecksum;
+    else
+    {
+        uint256 hash = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
+        memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    }
     assert(ssSend.size () >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
     memcpy((char*)&ssSend[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
 
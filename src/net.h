@@ -20,6 +20,7 @@
 #include "utilstrencodings.h"
 
 #include <deque>
+#include <memory>
 #include <stdint.h>
 
 #ifndef WIN32
@@ -165,7 +166,41 @@ extern int nMaxConnections;
 
 extern std::vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
-extern std::map<CInv, CDataStream> mapRelay;
+
+/**
+ * A transaction or certificate serialized once for all the peers it is sent
+ * to, along with the checksum of the message carrying it. The same payload is
+ * kept by the relay memory and by the mempool entry.
+ */
+class CRelayPayload
+{
+public:
+    const CSerializeData data;
+    const unsigned int nChecksum;
+
+    explicit CRelayPayload(const CDataStream& ss);
+
+    size_t DynamicMemoryUsage() const;
+};
+
+typedef std::shared_ptr<const CRelayPayload> CRelayPayloadRef;
+
+/** Transaction relay counters, see getnettotals */
+struct CRelayStats
+{
+    uint64_t nRelayed;       //! transactions and certificates handed to the peers
+    uint64_t nAnnounced;     //! inventory entries queued for the peers
+    uint64_t nServed;        //! payloads sent in reply to getdata
+    uint64_t nServedBytes;
+    uint64_t nSerialized;    //! payloads serialized, the others were shared
+    double dRelayRate;       //! relayed per second, averaged over the last minute
+};
+
+CRelayStats GetRelayStats();
+/** Account for a relay payload sent in reply to getdata */
+void RecordRelayServed(const CRelayPayload& payload);
+
+extern std::map<CInv, CRelayPayloadRef> mapRelay;
 extern std::deque<std::pair<int64_t, CInv> > vRelayExpiration;
 extern CCriticalSection cs_mapRelay;
 extern limitedmap<CInv, int64_t> mapAlreadyAskedFor;
@@ -349,6 +384,7 @@ public:
     // inventory based relay
     mruset<CInv> setInventoryKnown;
     std::vector<CInv> vInventoryToSend;
+    std::vector<CInv> vInventoryToTrickle; //! held back until the next trickle
     CCriticalSection cs_inventory;
     std::set<uint256> setAskFor;
     std::multimap<int64_t, CInv> mapAskFor;
@@ -451,12 +487,12 @@ public:
         }
     }
 
-    void PushInventory(const CInv& inv)
+    void PushInventory(const CInv& inv, bool fTrickle = false)
     {
         {
             LOCK(cs_inventory);
             if (!setInventoryKnown.count(inv))
-                vInventoryToSend.push_back(inv);
+                (fTrickle ? vInventoryToTrickle : vInventoryToSend).push_back(inv);
         }
     }
 
@@ -469,7 +505,23 @@ public:
     void AbortMessage() UNLOCK_FUNCTION(cs_vSend);
 
     // TODO: Document the precondition of this function.  Is cs_vSend locked?
-    void EndMessage() UNLOCK_FUNCTION(cs_vSend);
+    void EndMessage(const unsigned int* pnChecksum = NULL) UNLOCK_FUNCTION(cs_vSend);
+
+    /** Send a payload serialized once for all the peers, without hashing it again */
+    void PushRelayPayload(const char* pszCommand, const CRelayPayload& payload)
+    {
+        try
+        {
+            BeginMessage(pszCommand);
+            ssSend.write(&payload.data[0], payload.data.size());
+            EndMessage(&payload.nChecksum);
+        }
+        catch (...)
+        {
+            AbortMessage();
+            throw;
+        }
+    }
 
     void PushVersion();
 
@@ -689,7 +741,9 @@ class CTransaction;
 class CScCertificate;
 void Relay(const CTransaction& tx);
 void Relay(const CScCertificate& cert);
-void Relay(const CTransactionBase& tx, const CDataStream& ss);
+void Relay(const CTransactionBase& tx, const CRelayPayloadRef& payload);
+/** Queue the inventory of tx to the peers in vPeers, kept referenced by the caller. Returns how many got it */
+uint64_t AnnounceTransaction(const CTransactionBase& tx, const std::vector<CNode*>& vPeers);
 
 /** Access to the (IP) address database (peers.dat) */
 class CAddrDB
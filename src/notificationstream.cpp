@@ -0,0 +1,140 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "notificationstream.h"
+
+#include "chain.h"
+#include "crypto/common.h"
+#include "memusage.h"
+#include "primitives/block.h"
+#include "primitives/certificate.h"
+#include "streams.h"
+#include "txmempool.h"
+#include "util.h"
+#include "version.h"
+
+#include <boost/bind/bind.hpp>
+
+using namespace boost::placeholders;
+
+const char *NOTIFY_TX_ADDED           = "txadded";
+const char *NOTIFY_CERT_ADDED         = "certadded";
+const char *NOTIFY_CERT_STATUS        = "certstatus";
+const char *NOTIFY_MEMPOOL_REMOVED    = "mempoolremoved";
+const char *NOTIFY_BLOCK_CONNECTED    = "blockconnected";
+const char *NOTIFY_BLOCK_DISCONNECTED = "blockdisconnected";
+
+CNotificationStream* pnotificationStream = NULL;
+
+CNotificationEvent::CNotificationEvent(uint64_t nSequenceIn, const std::string& topicIn, const CDataStream& ss) :
+    nSequence(nSequenceIn), topic(topicIn), payload(ss.begin(), ss.end())
+{
+}
+
+size_t CNotificationEvent::DynamicMemoryUsage() const
+{
+    return memusage::MallocUsage(sizeof(CNotificationEvent)) + memusage::DynamicUsage(payload);
+}
+
+CNotificationStream::CNotificationStream(CTxMemPool& poolIn, size_t nMaxReplayBytesIn) :
+    pool(poolIn), nMaxReplayBytes(nMaxReplayBytesIn), nNextSequence(0), nReplayBytes(0)
+{
+    pool.NotifyEntryRemoved.connect(boost::bind(&CNotificationStream::EntryRemoved, this, _1, _2));
+}
+
+CNotificationStream::~CNotificationStream()
+{
+    pool.NotifyEntryRemoved.disconnect(boost::bind(&CNotificationStream::EntryRemoved, this, _1, _2));
+}
+
+uint64_t CNotificationStream::Publish(const std::string& topic, const CDataStream& ss)
+{
+    // Publishing under cs keeps the subscribers receiving the events in
+    // sequence order when they are produced by different threads.
+    LOCK(cs);
+    CNotificationEventRef event = std::make_shared<const CNotificationEvent>(nNextSequence++, topic, ss);
+
+    replayBuffer.push_back(event);
+    nReplayBytes += event->DynamicMemoryUsage();
+    while (nReplayBytes > nMaxReplayBytes && replayBuffer.size() > 1) {
+        nReplayBytes -= replayBuffer.front()->DynamicMemoryUsage();
+        replayBuffer.pop_front();
+    }
+
+    EventPublished(event);
+    return event->nSequence;
+}
+
+uint64_t CNotificationStream::GetEventsSince(uint64_t nSequence, size_t nMaxEvents, std::vector<CNotificationEventRef>& events) const
+{
+    LOCK(cs);
+    if (replayBuffer.empty())
+        return nNextSequence;
+
+    // Sequence numbers in the buffer are consecutive
+    const uint64_t nFirst = replayBuffer.front()->nSequence;
+    for (uint64_t n = std::max(nSequence, nFirst); n < nNextSequence && events.size() < nMaxEvents; ++n)
+        events.push_back(replayBuffer[n - nFirst]);
+
+    return nFirst;
+}
+
+uint64_t CNotificationStream::GetNextSequence() const
+{
+    LOCK(cs);
+    return nNextSequence;
+}
+
+size_t CNotificationStream::GetReplayBufferSize() const
+{
+    LOCK(cs);
+    return replayBuffer.size();
+}
+
+void CNotificationStream::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+{
+    // Confirmed transactions are published with their block, and a
+    // transaction removed from the mempool is synced too: only report the
+    // ones actually entering it.
+    if (pblock != NULL || !pool.existsTx(tx.GetHash()))
+        return;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << tx;
+    Publish(NOTIFY_TX_ADDED, ss);
+}
+
+void CNotificationStream::SyncCertificate(const CScCertificate &cert, const CBlock *pblock, int bwtMaturityDepth)
+{
+    if (pblock != NULL || !pool.existsCert(cert.GetHash()))
+        return;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << cert;
+    Publish(NOTIFY_CERT_ADDED, ss);
+}
+
+void CNotificationStream::SyncCertStatusInfo(const CScCertificateStatusUpdateInfo& certStatusInfo)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << certStatusInfo.scId << certStatusInfo;
+    Publish(NOTIFY_CERT_STATUS, ss);
+}
+
+void CNotificationStream::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    unsigned char height[sizeof(uint32_t)];
+    WriteLE32(&height[0], pindex->nHeight);
+    ss.write((const char*)height, sizeof(height));
+    ss << *pblock;
+    Publish(added ? NOTIFY_BLOCK_CONNECTED : NOTIFY_BLOCK_DISCONNECTED, ss);
+}
+
+void CNotificationStream::EntryRemoved(const uint256& hash, bool fCertificate)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << hash << (unsigned char)(fCertificate ? 1 : 0);
+    Publish(NOTIFY_MEMPOOL_REMOVED, ss);
+}
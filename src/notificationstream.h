@@ -0,0 +1,111 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NOTIFICATIONSTREAM_H
+#define BITCOIN_NOTIFICATIONSTREAM_H
+
+#include "sync.h"
+#include "validationinterface.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/signals2/signal.hpp>
+
+class CDataStream;
+class CTxMemPool;
+
+/** Default for -notificationreplaybuffer, in megabytes */
+static const unsigned int DEFAULT_NOTIFICATION_REPLAY_BUFFER = 64;
+/** Maximum number of events returned by a single replay request */
+static const unsigned int MAX_NOTIFICATION_REPLAY_EVENTS = 1000;
+
+/** Event topics, used as message subject by the transports */
+extern const char *NOTIFY_TX_ADDED;           //! payload: raw transaction
+extern const char *NOTIFY_CERT_ADDED;         //! payload: raw certificate
+extern const char *NOTIFY_CERT_STATUS;        //! payload: scId, certHash, epoch, quality, bwt state
+extern const char *NOTIFY_MEMPOOL_REMOVED;    //! payload: hash, 1 byte (0 = transaction, 1 = certificate),
+                                              //! also sent for the entries confirmed by a block, before its blockconnected
+extern const char *NOTIFY_BLOCK_CONNECTED;    //! payload: LE 4 byte height, raw block
+extern const char *NOTIFY_BLOCK_DISCONNECTED; //! payload: LE 4 byte height, raw block
+
+/**
+ * A notification, serialized once and shared by every transport publishing
+ * it and by the replay buffer.
+ */
+struct CNotificationEvent
+{
+    uint64_t nSequence;
+    std::string topic;
+    std::vector<unsigned char> payload;
+
+    CNotificationEvent(uint64_t nSequenceIn, const std::string& topicIn, const CDataStream& ss);
+
+    size_t DynamicMemoryUsage() const;
+};
+
+typedef std::shared_ptr<const CNotificationEvent> CNotificationEventRef;
+
+/**
+ * Numbers the validation and mempool events consecutively and publishes them
+ * to the ZMQ and AMQP event notifiers.
+ *
+ * Every event gets the next sequence number of a single stream, whatever its
+ * topic, so a subscriber detects a lost message from a gap in the sequence.
+ * The most recent events are kept in a replay buffer bounded in bytes, from
+ * which a subscriber can fetch what it missed.
+ */
+class CNotificationStream : public CValidationInterface
+{
+public:
+    CNotificationStream(CTxMemPool& poolIn, size_t nMaxReplayBytesIn);
+    ~CNotificationStream();
+
+    // Mempool removals are published by the thread removing the entries,
+    // the validation events must be published in the same order
+    bool IsSynchronous() const override { return true; }
+    std::string ValidationInterfaceName() const override { return "notificationstream"; }
+
+    /** Fired for every event, in sequence order */
+    boost::signals2::signal<void (const CNotificationEventRef&)> EventPublished;
+
+    /** Assign the next sequence number to an event and publish it */
+    uint64_t Publish(const std::string& topic, const CDataStream& ss);
+
+    /**
+     * Get up to nMaxEvents events starting at nSequence. Returns the sequence
+     * number of the oldest event still in the replay buffer, which is greater
+     * than nSequence when the events in between have been evicted.
+     */
+    uint64_t GetEventsSince(uint64_t nSequence, size_t nMaxEvents, std::vector<CNotificationEventRef>& events) const;
+
+    /** Sequence number the next event will get */
+    uint64_t GetNextSequence() const;
+    size_t GetReplayBufferSize() const;
+
+protected:
+    // CValidationInterface
+    void SyncTransaction(const CTransaction &tx, const CBlock *pblock) override;
+    void SyncCertificate(const CScCertificate &cert, const CBlock *pblock, int bwtMaturityDepth) override;
+    void SyncCertStatusInfo(const CScCertificateStatusUpdateInfo& certStatusInfo) override;
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added) override;
+
+private:
+    CTxMemPool& pool;
+    const size_t nMaxReplayBytes;
+
+    mutable CCriticalSection cs;
+    uint64_t nNextSequence;
+    std::deque<CNotificationEventRef> replayBuffer;
+    size_t nReplayBytes;
+
+    void EntryRemoved(const uint256& hash, bool fCertificate);
+};
+
+/** Set at startup when an event notifier is configured */
+extern CNotificationStream* pnotificationStream;
+
+#endif // BITCOIN_NOTIFICATIONSTREAM_H
@@ -0,0 +1,231 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "orphanpool.h"
+
+#include "util.h"
+#include "version.h"
+
+#include <algorithm>
+
+#include <univalue.h>
+
+COrphanPool orphanPool;
+
+UniValue COrphanPoolStats::ToJSON() const
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("size", (uint64_t)nOrphans);
+    obj.pushKV("bytes", (uint64_t)nBytes);
+    obj.pushKV("peers", (uint64_t)nPeers);
+    obj.pushKV("added", nAdded);
+    obj.pushKV("resolved", nResolved);
+    obj.pushKV("hitrate", nAdded > 0 ? (double)nResolved / nAdded : 0.0);
+    obj.pushKV("invalid", nInvalid);
+    obj.pushKV("evictedpeersize", nEvictedPeerSize);
+    obj.pushKV("evictedcount", nEvictedCount);
+    obj.pushKV("erasedforpeer", nErasedForPeer);
+    obj.pushKV("ignoredlarge", nIgnoredLarge);
+    return obj;
+}
+
+COrphanPool::COrphanPool() : nMaxPeerBytes(DEFAULT_MAX_ORPHAN_PEER_SIZE * 1000), nNextSequence(0) {}
+
+void COrphanPool::SetMaxPeerBytes(size_t nMaxBytes)
+{
+    LOCK(cs);
+    nMaxPeerBytes = nMaxBytes;
+    std::vector<NodeId> vPeers;
+    for (const auto& peer : mapPeers)
+        vPeers.push_back(peer.first);
+    for (NodeId peer : vPeers)
+        LimitPeer(peer);
+}
+
+bool COrphanPool::Add(const CTransactionBase& tx, NodeId peer)
+{
+    uint256 hash = tx.GetHash();
+    LOCK(cs);
+    if (mapOrphans.count(hash))
+        return false;
+
+    // Ignore big transactions, to avoid a send-big-orphans memory exhaustion
+    // attack. If a peer has a legitimate large transaction with a missing
+    // parent then we assume it will rebroadcast it later, after the parent
+    // transaction(s) have been mined or received.
+    unsigned int nSize = tx.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+    if (nSize > MAX_ORPHAN_TX_SIZE)
+    {
+        LogPrint("mempool", "ignoring large orphan tx (size: %u, hash: %s)\n", nSize, hash.ToString());
+        stats.nIgnoredLarge++;
+        return false;
+    }
+
+    COrphanTx& orphan = mapOrphans[hash];
+    orphan.tx = tx.MakeShared();
+    orphan.fromPeer = peer;
+    orphan.nSize = nSize;
+    orphan.nSequence = nNextSequence++;
+    for (const CTxIn& txin : tx.GetVin())
+        setSpentOutpoints.insert(std::make_pair(txin.prevout, hash));
+
+    CPeerOrphans& peerOrphans = mapPeers[peer];
+    peerOrphans.nBytes += nSize;
+    peerOrphans.byArrival[orphan.nSequence] = hash;
+    stats.nAdded++;
+    stats.nBytes += nSize;
+    stats.nOrphans = mapOrphans.size();
+    stats.nPeers = mapPeers.size();
+
+    unsigned int nEvicted = LimitPeer(peer);
+    if (nEvicted > 0)
+        LogPrint("mempool", "peer=%d over its orphan size limit, removed %u tx\n", peer, nEvicted);
+    if (!mapOrphans.count(hash))
+        return false;
+
+    LogPrint("mempool", "stored orphan tx %s (mapsz %u outpointsz %u)\n", hash.ToString(),
+             mapOrphans.size(), setSpentOutpoints.size());
+    return true;
+}
+
+bool COrphanPool::Exists(const uint256& hash) const
+{
+    LOCK(cs);
+    return mapOrphans.count(hash) != 0;
+}
+
+std::vector<COrphanTx> COrphanPool::GetSpendersOf(const std::vector<uint256>& vParents) const
+{
+    LOCK(cs);
+    std::set<uint256> setSpenders;
+    std::vector<COrphanTx> vSpenders;
+    for (const uint256& parent : vParents)
+    {
+        // Outpoints of the same parent are adjacent, starting from its output 0
+        auto it = setSpentOutpoints.lower_bound(std::make_pair(COutPoint(parent, 0), uint256()));
+        for (; it != setSpentOutpoints.end() && it->first.hash == parent; ++it)
+        {
+            if (setSpenders.insert(it->second).second)
+                vSpenders.push_back(mapOrphans.at(it->second));
+        }
+    }
+
+    std::sort(vSpenders.begin(), vSpenders.end(), [](const COrphanTx& a, const COrphanTx& b) {
+        return a.nSequence < b.nSequence;
+    });
+    return vSpenders;
+}
+
+void COrphanPool::Erase(const uint256& hash)
+{
+    AssertLockHeld(cs);
+    auto it = mapOrphans.find(hash);
+    if (it == mapOrphans.end())
+        return;
+    const COrphanTx& orphan = it->second;
+    for (const CTxIn& txin : orphan.tx->GetVin())
+        setSpentOutpoints.erase(std::make_pair(txin.prevout, hash));
+
+    auto itPeer = mapPeers.find(orphan.fromPeer);
+    itPeer->second.nBytes -= orphan.nSize;
+    itPeer->second.byArrival.erase(orphan.nSequence);
+    if (itPeer->second.byArrival.empty())
+        mapPeers.erase(itPeer);
+
+    stats.nBytes -= orphan.nSize;
+    mapOrphans.erase(it);
+    stats.nOrphans = mapOrphans.size();
+    stats.nPeers = mapPeers.size();
+}
+
+void COrphanPool::EraseResolved(const uint256& hash)
+{
+    LOCK(cs);
+    if (mapOrphans.count(hash))
+        stats.nResolved++;
+    Erase(hash);
+}
+
+void COrphanPool::EraseInvalid(const uint256& hash)
+{
+    LOCK(cs);
+    if (mapOrphans.count(hash))
+        stats.nInvalid++;
+    Erase(hash);
+}
+
+unsigned int COrphanPool::EraseForPeer(NodeId peer)
+{
+    LOCK(cs);
+    auto itPeer = mapPeers.find(peer);
+    if (itPeer == mapPeers.end())
+        return 0;
+
+    std::vector<uint256> vErase;
+    for (const auto& entry : itPeer->second.byArrival)
+        vErase.push_back(entry.second);
+    for (const uint256& hash : vErase)
+        Erase(hash);
+    stats.nErasedForPeer += vErase.size();
+    LogPrint("mempool", "Erased %u orphan tx from peer %d\n", vErase.size(), peer);
+    return vErase.size();
+}
+
+unsigned int COrphanPool::LimitPeer(NodeId peer)
+{
+    AssertLockHeld(cs);
+    unsigned int nEvicted = 0;
+    auto itPeer = mapPeers.find(peer);
+    while (itPeer != mapPeers.end() && itPeer->second.nBytes > nMaxPeerBytes)
+    {
+        uint256 oldest = itPeer->second.byArrival.begin()->second;
+        Erase(oldest);
+        ++nEvicted;
+        itPeer = mapPeers.find(peer);
+    }
+    stats.nEvictedPeerSize += nEvicted;
+    return nEvicted;
+}
+
+unsigned int COrphanPool::LimitSize(unsigned int nMaxOrphans)
+{
+    LOCK(cs);
+    unsigned int nEvicted = 0;
+    while (mapOrphans.size() > nMaxOrphans)
+    {
+        // The oldest orphan of the peer holding most of the pool
+        auto itLargest = mapPeers.begin();
+        for (auto it = mapPeers.begin(); it != mapPeers.end(); ++it)
+        {
+            if (it->second.nBytes > itLargest->second.nBytes)
+                itLargest = it;
+        }
+        uint256 oldest = itLargest->second.byArrival.begin()->second;
+        Erase(oldest);
+        ++nEvicted;
+    }
+    stats.nEvictedCount += nEvicted;
+    return nEvicted;
+}
+
+void COrphanPool::Clear()
+{
+    LOCK(cs);
+    mapOrphans.clear();
+    setSpentOutpoints.clear();
+    mapPeers.clear();
+    stats.nOrphans = stats.nBytes = stats.nPeers = 0;
+}
+
+size_t COrphanPool::size() const
+{
+    LOCK(cs);
+    return mapOrphans.size();
+}
+
+COrphanPoolStats COrphanPool::GetStats() const
+{
+    LOCK(cs);
+    return stats;
+}
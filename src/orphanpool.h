@@ -0,0 +1,117 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ORPHANPOOL_H
+#define BITCOIN_ORPHANPOOL_H
+
+#include "net.h"
+#include "primitives/transaction.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <map>
+#include <memory>
+#include <set>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+class UniValue;
+
+/** Default for -maxorphanpeersize, maximum kilobytes of orphan transactions kept for each peer */
+static const unsigned int DEFAULT_MAX_ORPHAN_PEER_SIZE = 100;
+/** Orphans larger than this are not kept, their sender is expected to relay them again later */
+static const unsigned int MAX_ORPHAN_TX_SIZE = 5000;
+
+struct COrphanTx {
+    std::shared_ptr<const CTransactionBase> tx;
+    NodeId fromPeer;
+    unsigned int nSize;
+    //! Arrival order, the oldest orphans are evicted first
+    uint64_t nSequence;
+};
+
+struct COrphanPoolStats
+{
+    //! Orphans stored, and how they left the pool since startup
+    uint64_t nAdded;
+    uint64_t nResolved;
+    uint64_t nInvalid;
+    uint64_t nEvictedPeerSize;
+    uint64_t nEvictedCount;
+    uint64_t nErasedForPeer;
+    //! Orphans not stored because too large
+    uint64_t nIgnoredLarge;
+    //! Orphans currently stored, their serialized size and the peers they came from
+    size_t nOrphans;
+    size_t nBytes;
+    size_t nPeers;
+
+    COrphanPoolStats() : nAdded(0), nResolved(0), nInvalid(0), nEvictedPeerSize(0), nEvictedCount(0),
+                         nErasedForPeer(0), nIgnoredLarge(0), nOrphans(0), nBytes(0), nPeers(0) {}
+
+    UniValue ToJSON() const;
+};
+
+/**
+ * Transactions and certificates received before the outputs they spend.
+ *
+ * Orphans are indexed by the outpoints they spend, so that all the orphans
+ * unblocked by a parent are found with a range lookup on the parent hash.
+ * Each peer may only keep a bounded amount of bytes in the pool, and when the
+ * pool holds too many orphans the oldest ones of the peer using most of it
+ * make room: a peer flooding orphans only evicts its own.
+ */
+class COrphanPool
+{
+public:
+    COrphanPool();
+
+    //! Bound the orphans kept for each peer to nMaxBytes of serialized data
+    void SetMaxPeerBytes(size_t nMaxBytes);
+
+    //! Store tx, received from peer. False if it was already stored, too large or evicted right away
+    bool Add(const CTransactionBase& tx, NodeId peer);
+    bool Exists(const uint256& hash) const;
+
+    //! Orphans spending outputs of any of the parents, each once and in arrival order
+    std::vector<COrphanTx> GetSpendersOf(const std::vector<uint256>& vParents) const;
+
+    //! The orphan entered the mempool, or was found invalid
+    void EraseResolved(const uint256& hash);
+    void EraseInvalid(const uint256& hash);
+    //! The peer disconnected
+    unsigned int EraseForPeer(NodeId peer);
+    //! Evict orphans until at most nMaxOrphans are left
+    unsigned int LimitSize(unsigned int nMaxOrphans);
+    void Clear();
+
+    size_t size() const;
+    COrphanPoolStats GetStats() const;
+
+private:
+    struct CPeerOrphans
+    {
+        size_t nBytes;
+        std::map<uint64_t, uint256> byArrival;
+
+        CPeerOrphans() : nBytes(0) {}
+    };
+
+    mutable CCriticalSection cs;
+    std::map<uint256, COrphanTx> mapOrphans;
+    std::set<std::pair<COutPoint, uint256> > setSpentOutpoints;
+    std::map<NodeId, CPeerOrphans> mapPeers;
+    size_t nMaxPeerBytes;
+    uint64_t nNextSequence;
+    COrphanPoolStats stats;
+
+    void Erase(const uint256& hash);
+    //! Evict the oldest orphans of peer while it uses more than nMaxPeerBytes
+    unsigned int LimitPeer(NodeId peer);
+};
+
+extern COrphanPool orphanPool;
+
+#endif // BITCOIN_ORPHANPOOL_H
@@ -11,6 +11,32 @@
 #include "txmempool.h"
 #include "util.h"
 
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+//! Once the stored moving averages grow past this, they are brought back to scale 1
+const double MAX_SCALE = 1e100;
+
+std::vector<float> ToFloats(const std::vector<double>& v, double factor)
+{
+    std::vector<float> result(v.size());
+    for (unsigned int i = 0; i < v.size(); i++)
+        result[i] = v[i] * factor;
+    return result;
+}
+
+std::vector<double> ToDoubles(const std::vector<float>& v)
+{
+    return std::vector<double>(v.begin(), v.end());
+}
+
+} // anon namespace
+
+TxConfirmStats::TxConfirmStats()
+    : fRegularBuckets(false), logFirstBucket(0), invLogSpacing(0), scale(1), nUpdates(0) {}
+
 void TxConfirmStats::Initialize(std::vector<double>& defaultBuckets,
                                 unsigned int maxConfirms, double _decay, std::string _dataTypeString)
 {
@@ -19,45 +45,82 @@ void TxConfirmStats::Initialize(std::vector<double>& defaultBuckets,
 
     buckets.insert(buckets.end(), defaultBuckets.begin(), defaultBuckets.end());
     buckets.push_back(std::numeric_limits<double>::infinity());
-
-    for (unsigned int i = 0; i < buckets.size(); i++) {
-        bucketMap[buckets[i]] = i;
-    }
+    SetupBuckets();
 
     confAvg.resize(maxConfirms);
-    curBlockConf.resize(maxConfirms);
     unconfTxs.resize(maxConfirms);
     for (unsigned int i = 0; i < maxConfirms; i++) {
         confAvg[i].resize(buckets.size());
-        curBlockConf[i].resize(buckets.size());
         unconfTxs[i].resize(buckets.size());
     }
 
     oldUnconfTxs.resize(buckets.size());
-    curBlockTxCt.resize(buckets.size());
     txCtAvg.resize(buckets.size());
-    curBlockVal.resize(buckets.size());
     avg.resize(buckets.size());
+    estimateCache.assign(maxConfirms, std::make_pair(0, 0.0));
+    nUpdates++;
+}
+
+void TxConfirmStats::SetupBuckets()
+{
+    // The finite buckets must share the same ratio, as built by CBlockPolicyEstimator
+    fRegularBuckets = buckets.size() > 2 && buckets[0] > 0;
+    double spacing = fRegularBuckets ? buckets[1] / buckets[0] : 0;
+    for (unsigned int i = 1; fRegularBuckets && i + 1 < buckets.size(); i++) {
+        if (std::abs(buckets[i] / buckets[i - 1] - spacing) > 1e-6 * spacing)
+            fRegularBuckets = false;
+    }
+    fRegularBuckets = fRegularBuckets && spacing > 1;
+    if (fRegularBuckets) {
+        logFirstBucket = log(buckets[0]);
+        invLogSpacing = 1 / log(spacing);
+    }
 }
 
-// Zero out the data for the current block
+void TxConfirmStats::Rescale()
+{
+    double invScale = 1 / scale;
+    for (unsigned int j = 0; j < buckets.size(); j++) {
+        for (unsigned int i = 0; i < confAvg.size(); i++)
+            confAvg[i][j] *= invScale;
+        avg[j] *= invScale;
+        txCtAvg[j] *= invScale;
+    }
+    scale = 1;
+}
+
+// Decay the moving averages, which the data of the new block are added to
 void TxConfirmStats::ClearCurrent(unsigned int nBlockHeight)
 {
     for (unsigned int j = 0; j < buckets.size(); j++) {
         oldUnconfTxs[j] += unconfTxs[nBlockHeight%unconfTxs.size()][j];
         unconfTxs[nBlockHeight%unconfTxs.size()][j] = 0;
-        for (unsigned int i = 0; i < curBlockConf.size(); i++)
-            curBlockConf[i][j] = 0;
-        curBlockTxCt[j] = 0;
-        curBlockVal[j] = 0;
     }
+    scale /= decay;
+    if (scale > MAX_SCALE)
+        Rescale();
+    nUpdates++;
 }
 
 unsigned int TxConfirmStats::FindBucketIndex(double val)
 {
-    auto it = bucketMap.lower_bound(val);
-    assert(it != bucketMap.end());
-    return it->second;
+    unsigned int bucketindex;
+    if (fRegularBuckets) {
+        // Also true for NaN
+        if (!(val > buckets[0]))
+            return 0;
+        // Jump next to the bucket, then correct the rounding errors
+        double guess = (log(val) - logFirstBucket) * invLogSpacing;
+        bucketindex = guess < buckets.size() - 1 ? (unsigned int)guess : buckets.size() - 1;
+        while (bucketindex > 0 && buckets[bucketindex - 1] >= val)
+            bucketindex--;
+        while (buckets[bucketindex] < val)
+            bucketindex++;
+    } else {
+        bucketindex = std::lower_bound(buckets.begin(), buckets.end(), val) - buckets.begin();
+    }
+    assert(bucketindex < buckets.size());
+    return bucketindex;
 }
 
 void TxConfirmStats::Record(int blocksToConfirm, double val)
@@ -66,21 +129,11 @@ void TxConfirmStats::Record(int blocksToConfirm, double val)
     if (blocksToConfirm < 1)
         return;
     unsigned int bucketindex = FindBucketIndex(val);
-    for (size_t i = blocksToConfirm; i <= curBlockConf.size(); i++) {
-        curBlockConf[i - 1][bucketindex]++;
-    }
-    curBlockTxCt[bucketindex]++;
-    curBlockVal[bucketindex] += val;
-}
-
-void TxConfirmStats::UpdateMovingAverages()
-{
-    for (unsigned int j = 0; j < buckets.size(); j++) {
-        for (unsigned int i = 0; i < confAvg.size(); i++)
-            confAvg[i][j] = confAvg[i][j] * decay + curBlockConf[i][j];
-        avg[j] = avg[j] * decay + curBlockVal[j];
-        txCtAvg[j] = txCtAvg[j] * decay + curBlockTxCt[j];
-    }
+    if ((unsigned int)blocksToConfirm <= confAvg.size())
+        confAvg[blocksToConfirm - 1][bucketindex] += scale;
+    txCtAvg[bucketindex] += scale;
+    avg[bucketindex] += val * scale;
+    nUpdates++;
 }
 
 // returns -1 on error conditions
@@ -115,11 +168,14 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     bool foundAnswer = false;
     unsigned int bins = unconfTxs.size();
 
+    double invScale = 1 / scale;
+
     // Start counting from highest(default) or lowest fee/pri transactions
     for (int bucket = startbucket; bucket >= 0 && bucket <= maxbucketindex; bucket += step) {
         curFarBucket = bucket;
-        nConf += confAvg[confTarget - 1][bucket];
-        totalNum += txCtAvg[bucket];
+        for (int confct = 0; confct < confTarget; confct++)
+            nConf += confAvg[confct][bucket] * invScale;
+        totalNum += txCtAvg[bucket] * invScale;
         for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
             extraNum += unconfTxs[(nBlockHeight - confct)%bins][bucket];
         extraNum += oldUnconfTxs[bucket];
@@ -160,13 +216,13 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     unsigned int minBucket = bestNearBucket < bestFarBucket ? bestNearBucket : bestFarBucket;
     unsigned int maxBucket = bestNearBucket > bestFarBucket ? bestNearBucket : bestFarBucket;
     for (unsigned int j = minBucket; j <= maxBucket; j++) {
-        txSum += txCtAvg[j];
+        txSum += txCtAvg[j] * invScale;
     }
     if (foundAnswer && txSum != 0) {
         txSum = txSum / 2;
         for (unsigned int j = minBucket; j <= maxBucket; j++) {
-            if (txCtAvg[j] < txSum)
-                txSum -= txCtAvg[j];
+            if (txCtAvg[j] * invScale < txSum)
+                txSum -= txCtAvg[j] * invScale;
             else { // we're in the right bucket
                 median = avg[j] / txCtAvg[j];
                 break;
@@ -182,16 +238,30 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     return median;
 }
 
+double TxConfirmStats::EstimateCachedMedianVal(int confTarget, double sufficientTxVal, unsigned int nBlockHeight)
+{
+    std::pair<uint64_t, double>& cached = estimateCache[confTarget - 1];
+    if (cached.first != nUpdates) {
+        cached.second = EstimateMedianVal(confTarget, sufficientTxVal, MIN_SUCCESS_PCT, true, nBlockHeight);
+        cached.first = nUpdates;
+    }
+    return cached.second;
+}
+
 void TxConfirmStats::Write(CAutoFile& fileout)
 {
+    // The moving averages as of the last block, floats are precise enough for them
+    double invScale = 1 / scale;
     fileout << decay;
     fileout << buckets;
-    fileout << avg;
-    fileout << txCtAvg;
-    fileout << confAvg;
+    fileout << ToFloats(avg, invScale);
+    fileout << ToFloats(txCtAvg, invScale);
+    WriteCompactSize(fileout, confAvg.size());
+    for (unsigned int i = 0; i < confAvg.size(); i++)
+        fileout << ToFloats(confAvg[i], invScale);
 }
 
-void TxConfirmStats::Read(CAutoFile& filein)
+void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion)
 {
     // Read data file into temporary variables and do some very basic sanity checking
     std::vector<double> fileBuckets;
@@ -201,6 +271,7 @@ void TxConfirmStats::Read(CAutoFile& filein)
     double fileDecay;
     size_t maxConfirms;
     size_t numBuckets;
+    bool fCompact = nFileVersion >= FEE_ESTIMATES_COMPACT_VERSION;
 
     filein >> fileDecay;
     if (fileDecay <= 0 || fileDecay >= 1)
@@ -209,20 +280,47 @@ void TxConfirmStats::Read(CAutoFile& filein)
     numBuckets = fileBuckets.size();
     if (numBuckets <= 1 || numBuckets > 1000)
         throw std::runtime_error("Corrupt estimates file. Must have between 2 and 1000 fee/pri buckets");
-    filein >> fileAvg;
+    if (fCompact) {
+        std::vector<float> fileFloats;
+        filein >> fileFloats;
+        fileAvg = ToDoubles(fileFloats);
+        filein >> fileFloats;
+        fileTxCtAvg = ToDoubles(fileFloats);
+    } else {
+        filein >> fileAvg;
+        filein >> fileTxCtAvg;
+    }
     if (fileAvg.size() != numBuckets)
         throw std::runtime_error("Corrupt estimates file. Mismatch in fee/pri average bucket count");
-    filein >> fileTxCtAvg;
     if (fileTxCtAvg.size() != numBuckets)
         throw std::runtime_error("Corrupt estimates file. Mismatch in tx count bucket count");
-    filein >> fileConfAvg;
-    maxConfirms = fileConfAvg.size();
-    if (maxConfirms <= 0 || maxConfirms > 6 * 24 * 7) // one week
-        throw std::runtime_error("Corrupt estimates file.  Must maintain estimates for between 1 and 1008 (one week) confirms");
+    if (fCompact) {
+        maxConfirms = ReadCompactSize(filein);
+        if (maxConfirms <= 0 || maxConfirms > 6 * 24 * 7) // one week
+            throw std::runtime_error("Corrupt estimates file.  Must maintain estimates for between 1 and 1008 (one week) confirms");
+        fileConfAvg.resize(maxConfirms);
+        for (unsigned int i = 0; i < maxConfirms; i++) {
+            std::vector<float> fileFloats;
+            filein >> fileFloats;
+            fileConfAvg[i] = ToDoubles(fileFloats);
+        }
+    } else {
+        filein >> fileConfAvg;
+        maxConfirms = fileConfAvg.size();
+        if (maxConfirms <= 0 || maxConfirms > 6 * 24 * 7) // one week
+            throw std::runtime_error("Corrupt estimates file.  Must maintain estimates for between 1 and 1008 (one week) confirms");
+    }
     for (unsigned int i = 0; i < maxConfirms; i++) {
         if (fileConfAvg[i].size() != numBuckets)
             throw std::runtime_error("Corrupt estimates file. Mismatch in fee/pri conf average bucket count");
     }
+    if (!fCompact) {
+        // Older files count the txs confirmed within Y blocks, we count those confirmed in exactly Y
+        for (unsigned int i = maxConfirms - 1; i > 0; i--) {
+            for (unsigned int j = 0; j < numBuckets; j++)
+                fileConfAvg[i][j] = std::max(0.0, fileConfAvg[i][j] - fileConfAvg[i - 1][j]);
+        }
+    }
     // Now that we've processed the entire fee estimate data file and not
     // thrown any errors, we can copy it to our data structures
     decay = fileDecay;
@@ -230,25 +328,18 @@ void TxConfirmStats::Read(CAutoFile& filein)
     avg = fileAvg;
     confAvg = fileConfAvg;
     txCtAvg = fileTxCtAvg;
-    bucketMap.clear();
+    scale = 1;
+    SetupBuckets();
 
-    // Resize the current block variables which aren't stored in the data file
+    // Resize the mempool tracking which isn't stored in the data file
     // to match the number of confirms and buckets
-    curBlockConf.resize(maxConfirms);
-    for (unsigned int i = 0; i < maxConfirms; i++) {
-        curBlockConf[i].resize(buckets.size());
-    }
-    curBlockTxCt.resize(buckets.size());
-    curBlockVal.resize(buckets.size());
-
     unconfTxs.resize(maxConfirms);
     for (unsigned int i = 0; i < maxConfirms; i++) {
         unconfTxs[i].resize(buckets.size());
     }
     oldUnconfTxs.resize(buckets.size());
-
-    for (unsigned int i = 0; i < buckets.size(); i++)
-        bucketMap[buckets[i]] = i;
+    estimateCache.assign(maxConfirms, std::make_pair(0, 0.0));
+    nUpdates++;
 
     LogPrint("estimatefee", "Reading estimates: %u %s buckets counting confirms up to %u blocks\n",
              numBuckets, dataTypeString, maxConfirms);
@@ -259,6 +350,7 @@ unsigned int TxConfirmStats::NewTx(unsigned int nBlockHeight, double val)
     unsigned int bucketindex = FindBucketIndex(val);
     unsigned int blockIndex = nBlockHeight % unconfTxs.size();
     unconfTxs[blockIndex][bucketindex]++;
+    nUpdates++;
     LogPrint("estimatefee", "adding to %s\n", dataTypeString);
     return bucketindex;
 }
@@ -273,6 +365,7 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         LogPrint("estimatefee", "Blockpolicy error, blocks ago is negative for mempool tx\n");
         return;  //This can't happen because we call this with our best seen height, no entries can have higher
     }
+    nUpdates++;
 
     if (blocksAgo >= (int)unconfTxs.size()) {
         if (oldUnconfTxs[bucketindex] > 0)
@@ -325,12 +418,20 @@ CBlockPolicyEstimator::CBlockPolicyEstimator(const CFeeRate& _minRelayFee)
     }
     priStats.Initialize(vprilist, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY, "Priority");
 
+    scFeeStats.Initialize(vfeelist, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY, "ScTxFeeRate");
+    certFeeStats.Initialize(vfeelist, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY, "CertFeeRate");
+
     feeUnlikely = CFeeRate(0);
     feeLikely = CFeeRate(INF_FEERATE);
     priUnlikely = 0;
     priLikely = INF_PRIORITY;
 }
 
+TxConfirmStats& CBlockPolicyEstimator::feeStatsFor(const CTransaction& tx)
+{
+    return tx.ccOutIsNull() ? feeStats : scFeeStats;
+}
+
 bool CBlockPolicyEstimator::isFeeDataPoint(const CFeeRate &fee, double pri)
 {
     if ((pri < minTrackedPriority && fee >= minTrackedFee) ||
@@ -394,8 +495,9 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     }
     // Record this as a fee estimate
     else if (isFeeDataPoint(feeRate, curPri)) {
-        mapMemPoolTxs[hash].stats = &feeStats;
-        mapMemPoolTxs[hash].bucketIndex = feeStats.NewTx(txHeight, (double)feeRate.GetFeePerK());
+        TxConfirmStats& stats = feeStatsFor(entry.GetTx());
+        mapMemPoolTxs[hash].stats = &stats;
+        mapMemPoolTxs[hash].bucketIndex = stats.NewTx(txHeight, (double)feeRate.GetFeePerK());
     }
     else {
         LogPrint("estimatefee", "not adding");
@@ -436,7 +538,7 @@ void CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
     }
     // Record this as a fee estimate
     else if (isFeeDataPoint(feeRate, curPri)) {
-        feeStats.Record(blocksToConfirm, (double)feeRate.GetFeePerK());
+        feeStatsFor(entry.GetTx()).Record(blocksToConfirm, (double)feeRate.GetFeePerK());
     }
 }
 
@@ -482,29 +584,70 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     else
         feeUnlikely = CFeeRate(feeUnlikelyEst);
 
-    // Clear the current block states
+    // Decay all exponential averages for the new block
     feeStats.ClearCurrent(nBlockHeight);
     priStats.ClearCurrent(nBlockHeight);
+    scFeeStats.ClearCurrent(nBlockHeight);
+    certFeeStats.ClearCurrent(nBlockHeight);
 
-    // Repopulate the current block states
+    // Add the current block states to them
     for (unsigned int i = 0; i < entries.size(); i++)
         processBlockTx(nBlockHeight, entries[i]);
 
-    // Update all exponential averages with the current block states
-    feeStats.UpdateMovingAverages();
-    priStats.UpdateMovingAverages();
-
     LogPrint("estimatefee", "Blockpolicy after updating estimates for %u confirmed entries, new mempool map size %u\n",
              entries.size(), mapMemPoolTxs.size());
 }
 
-CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget)
+void CBlockPolicyEstimator::processCertificate(const CCertificateMemPoolEntry& entry, bool fCurrentEstimate)
+{
+    unsigned int certHeight = entry.GetHeight();
+    uint256 hash = entry.GetCertificate().GetHash();
+    if (mapMemPoolTxs[hash].stats != NULL) {
+        LogPrint("estimatefee", "Blockpolicy error mempool cert %s already being tracked\n",
+                 hash.ToString().c_str());
+        return;
+    }
+
+    if (certHeight < nBestSeenHeight || !fCurrentEstimate)
+        return;
+
+    // Certificates are mined whatever their priority, only their fee counts
+    CFeeRate feeRate(entry.GetFee(), entry.GetCertificateSize());
+    if (feeRate < minTrackedFee)
+        return;
+
+    mapMemPoolTxs[hash].blockHeight = certHeight;
+    mapMemPoolTxs[hash].stats = &certFeeStats;
+    mapMemPoolTxs[hash].bucketIndex = certFeeStats.NewTx(certHeight, (double)feeRate.GetFeePerK());
+}
+
+void CBlockPolicyEstimator::processBlockCertificates(unsigned int nBlockHeight,
+                                                     std::vector<CCertificateMemPoolEntry>& entries, bool fCurrentEstimate)
 {
+    // The block has just been processed by processBlock, which decayed the averages
+    if (nBlockHeight != nBestSeenHeight || !fCurrentEstimate)
+        return;
+
+    for (const CCertificateMemPoolEntry& entry : entries) {
+        int blocksToConfirm = nBlockHeight - entry.GetHeight();
+        if (blocksToConfirm <= 0)
+            continue;
+        CFeeRate feeRate(entry.GetFee(), entry.GetCertificateSize());
+        if (feeRate >= minTrackedFee)
+            certFeeStats.Record(blocksToConfirm, (double)feeRate.GetFeePerK());
+    }
+}
+
+CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget, FeeEstimateType type)
+{
+    TxConfirmStats& stats = type == FEE_ESTIMATE_CERTIFICATE ? certFeeStats :
+                            type == FEE_ESTIMATE_SC_TX ? scFeeStats : feeStats;
+
     // Return failure if trying to analyze a target we're not tracking
-    if (confTarget <= 0 || (unsigned int)confTarget > feeStats.GetMaxConfirms())
+    if (confTarget <= 0 || (unsigned int)confTarget > stats.GetMaxConfirms())
         return CFeeRate(0);
 
-    double median = feeStats.EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, MIN_SUCCESS_PCT, true, nBestSeenHeight);
+    double median = stats.EstimateCachedMedianVal(confTarget, SUFFICIENT_FEETXS, nBestSeenHeight);
 
     if (median < 0)
         return CFeeRate(0);
@@ -518,7 +661,7 @@ double CBlockPolicyEstimator::estimatePriority(int confTarget)
     if (confTarget <= 0 || (unsigned int)confTarget > priStats.GetMaxConfirms())
         return -1;
 
-    return priStats.EstimateMedianVal(confTarget, SUFFICIENT_PRITXS, MIN_SUCCESS_PCT, true, nBestSeenHeight);
+    return priStats.EstimateCachedMedianVal(confTarget, SUFFICIENT_PRITXS, nBestSeenHeight);
 }
 
 void CBlockPolicyEstimator::Write(CAutoFile& fileout)
@@ -526,13 +669,20 @@ void CBlockPolicyEstimator::Write(CAutoFile& fileout)
     fileout << nBestSeenHeight;
     feeStats.Write(fileout);
     priStats.Write(fileout);
+    scFeeStats.Write(fileout);
+    certFeeStats.Write(fileout);
 }
 
-void CBlockPolicyEstimator::Read(CAutoFile& filein)
+void CBlockPolicyEstimator::Read(CAutoFile& filein, int nFileVersion)
 {
     int nFileBestSeenHeight;
     filein >> nFileBestSeenHeight;
-    feeStats.Read(filein);
-    priStats.Read(filein);
+    feeStats.Read(filein, nFileVersion);
+    priStats.Read(filein, nFileVersion);
+    // Older files don't track the sidechain transactions and certificates apart
+    if (nFileVersion >= FEE_ESTIMATES_COMPACT_VERSION) {
+        scFeeStats.Read(filein, nFileVersion);
+        certFeeStats.Read(filein, nFileVersion);
+    }
     nBestSeenHeight = nFileBestSeenHeight;
 }
@@ -10,10 +10,13 @@
 
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 class CAutoFile;
+class CCertificateMemPoolEntry;
 class CFeeRate;
+class CTransaction;
 class CTxMemPoolEntry;
 
 /** \class CBlockPolicyEstimator
@@ -64,11 +67,29 @@ class CTxMemPoolEntry;
  * the number of transactions we've seen in that fee bucket when calculating
  * an estimate for any number of confirmations below the number of blocks
  * they've been outstanding.
+ *
+ * Transactions with sidechain outputs and certificates are not mined
+ * under the same conditions as plain transactions, their fees are tracked
+ * and estimated separately.
  */
 
 /** Decay of .998 is a half-life of 346 blocks or about 2.4 days */
 static const double DEFAULT_DECAY = .998;
 
+/**
+ * Version required to read the compact fee estimates file: the first client
+ * version writing it, so binaries released before refuse the file.
+ */
+static const int FEE_ESTIMATES_COMPACT_VERSION = 3020051;
+
+/** Kinds of transactions whose fees are estimated separately */
+enum FeeEstimateType
+{
+    FEE_ESTIMATE_TX,          //! Transactions without sidechain outputs
+    FEE_ESTIMATE_SC_TX,       //! Transactions creating or sending to sidechains, or requesting backward transfers
+    FEE_ESTIMATE_CERTIFICATE, //! Sidechain certificates
+};
+
 /**
  * We will instantiate two instances of this class, one to track transactions
  * that were included in a block due to fee, and one for txs included due to
@@ -79,32 +100,36 @@ static const double DEFAULT_DECAY = .998;
  *
  * The tracking of unconfirmed (mempool) transactions is completely independent of the
  * historical tracking of transactions that have been confirmed in a block.
+ *
+ * The moving averages are stored multiplied by a scale factor which grows by
+ * 1/decay every block, instead of decaying every bucket: recording a data point
+ * only touches its own bucket, and a new block only updates the scale.
  */
 class TxConfirmStats
 {
 private:
     //Define the buckets we will group transactions into (both fee buckets and priority buckets)
     std::vector<double> buckets;              // The upper-bound of the range for the bucket (inclusive)
-    std::map<double, unsigned int> bucketMap; // Map of bucket upper-bound to index into all vectors by bucket
+    // Exponentially spaced buckets are found directly from the log of the value
+    bool fRegularBuckets;
+    double logFirstBucket;
+    double invLogSpacing;
+
+    // Factor the moving averages below are stored multiplied by
+    double scale;
 
     // For each bucket X:
     // Count the total # of txs in each bucket
     // Track the historical moving average of this total over blocks
     std::vector<double> txCtAvg;
-    // and calcuate the total for the current block to update the moving average
-    std::vector<int> curBlockTxCt;
 
-    // Count the total # of txs confirmed within Y blocks in each bucket
+    // Count the total # of txs confirmed in exactly Y+1 blocks in each bucket
     // Track the historical moving average of theses totals over blocks
     std::vector<std::vector<double> > confAvg; // confAvg[Y][X]
-    // and calcuate the totals for the current block to update the moving averages
-    std::vector<std::vector<int> > curBlockConf; // curBlockConf[Y][X]
 
     // Sum the total priority/fee of all txs in each bucket
     // Track the historical moving average of this total over blocks
     std::vector<double> avg;
-    // and calculate the total for the current block to update the moving average
-    std::vector<double> curBlockVal;
 
     // Combine the conf counts with tx counts to calculate the confirmation % for each Y,X
     // Combine the total value with the tx counts to calculate the avg fee/priority per bucket
@@ -119,7 +144,16 @@ private:
     // transactions still unconfirmed after MAX_CONFIRMS for each bucket
     std::vector<int> oldUnconfTxs;
 
+    // Estimates already computed for each target, valid while nUpdates doesn't change
+    uint64_t nUpdates;
+    std::vector<std::pair<uint64_t, double> > estimateCache;
+
+    void SetupBuckets();
+    void Rescale();
+
 public:
+    TxConfirmStats();
+
     /** Find the bucket index of a given value */
     unsigned int FindBucketIndex(double val);
 
@@ -135,11 +169,11 @@ public:
      */
     void Initialize(std::vector<double>& defaultBuckets, unsigned int maxConfirms, double decay, std::string dataTypeString);
 
-    /** Clear the state of the curBlock variables to start counting for the new block */
+    /** Decay the moving averages and start counting for the new block */
     void ClearCurrent(unsigned int nBlockHeight);
 
     /**
-     * Record a new transaction data point in the current block stats
+     * Record a new transaction data point in the moving averages of the current block
      * @param blocksToConfirm the number of blocks it took this transaction to confirm
      * @param val either the fee or the priority when entered of the transaction
      * @warning blocksToConfirm is 1-based and has to be >= 1
@@ -153,10 +187,6 @@ public:
     void removeTx(unsigned int entryHeight, unsigned int nBestSeenHeight,
                   unsigned int bucketIndex);
 
-    /** Update our estimates by decaying our historical moving average and updating
-        with the data gathered from the current block */
-    void UpdateMovingAverages();
-
     /**
      * Calculate a fee or priority estimate.  Find the lowest value bucket (or range of buckets
      * to make sure we have enough data points) whose transactions still have sufficient likelihood
@@ -171,17 +201,21 @@ public:
     double EstimateMedianVal(int confTarget, double sufficientTxVal,
                              double minSuccess, bool requireGreater, unsigned int nBlockHeight);
 
+    /** Same as EstimateMedianVal with MIN_SUCCESS_PCT and requireGreater, computed once until the stats change */
+    double EstimateCachedMedianVal(int confTarget, double sufficientTxVal, unsigned int nBlockHeight);
+
     /** Return the max number of confirms we're tracking */
     unsigned int GetMaxConfirms() { return confAvg.size(); }
 
-    /** Write state of estimation data to a file*/
+    /** Write state of estimation data to a file, in the compact format */
     void Write(CAutoFile& fileout);
 
     /**
      * Read saved state of estimation data from a file and replace all internal data structures and
-     * variables with this state.
+     * variables with this state. Files older than FEE_ESTIMATES_COMPACT_VERSION hold doubles and
+     * cumulative confirmation counts.
      */
-    void Read(CAutoFile& filein);
+    void Read(CAutoFile& filein, int nFileVersion);
 };
 
 
@@ -237,6 +271,13 @@ public:
     /** Process a transaction accepted to the mempool*/
     void processTransaction(const CTxMemPoolEntry& entry, bool fCurrentEstimate);
 
+    /** Process the certificates included in the block processed last */
+    void processBlockCertificates(unsigned int nBlockHeight,
+                                  std::vector<CCertificateMemPoolEntry>& entries, bool fCurrentEstimate);
+
+    /** Process a certificate accepted to the mempool*/
+    void processCertificate(const CCertificateMemPoolEntry& entry, bool fCurrentEstimate);
+
     /** Remove a transaction from the mempool tracking stats*/
     void removeTx(uint256 hash);
 
@@ -247,7 +288,7 @@ public:
     bool isPriDataPoint(const CFeeRate &fee, double pri);
 
     /** Return a fee estimate */
-    CFeeRate estimateFee(int confTarget);
+    CFeeRate estimateFee(int confTarget, FeeEstimateType type = FEE_ESTIMATE_TX);
 
     /** Return a priority estimate */
     double estimatePriority(int confTarget);
@@ -255,8 +296,8 @@ public:
     /** Write estimation data to a file */
     void Write(CAutoFile& fileout);
 
-    /** Read estimation data from a file */
-    void Read(CAutoFile& filein);
+    /** Read estimation data from a file written by the given version */
+    void Read(CAutoFile& filein, int nFileVersion);
 
 private:
     CFeeRate minTrackedFee; //! Passed to constructor to avoid dependency on main
@@ -275,6 +316,11 @@ private:
 
     /** Classes to track historical data on transaction confirmations */
     TxConfirmStats feeStats, priStats;
+    /** and on the confirmations of transactions with sidechain outputs and of certificates */
+    TxConfirmStats scFeeStats, certFeeStats;
+
+    /** Stats tracking the fees of the transactions like tx */
+    TxConfirmStats& feeStatsFor(const CTransaction& tx);
 
     /** Breakpoints to help determine whether a transaction was confirmed by priority or Fee */
     CFeeRate feeLikely, feeUnlikely;
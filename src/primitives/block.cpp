@@ -152,19 +152,7 @@ uint256 CBlock::BuildMerkleTree(std::vector<uint256>& vMerkleTreeIn, size_t vtxS
 
 uint256 CBlock::BuildScTxsCommitment(const CCoinsViewCache& view)
 {
-    SidechainTxsCommitmentBuilder scCommitmentBuilder;
-
-    for (const auto& tx : vtx)
-    {
-        scCommitmentBuilder.add(tx);
-    }
-
-    for (const auto& cert : vcert)
-    {
-        scCommitmentBuilder.add(cert, view);
-    }
-
-    return scCommitmentBuilder.getCommitment();
+    return SidechainTxsCommitmentBuilder::getCommitment(vtx, vcert, view);
 }
 
 std::vector<uint256> CBlock::GetMerkleBranch(int nIndex) const
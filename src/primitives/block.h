@@ -120,6 +120,8 @@ public:
 
     // memory only
     mutable std::vector<uint256> vMerkleTree;
+    // memory only: set once CheckBlock passed with PoW and merkle root checks
+    mutable bool fChecked;
     
     CBlock()
     {
@@ -159,6 +161,7 @@ public:
         vtx.clear();
         vcert.clear();
         vMerkleTree.clear();
+        fChecked = false;
     }
 
     CBlockHeader GetBlockHeader() const
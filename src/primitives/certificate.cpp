@@ -45,6 +45,15 @@ CScCertificate::CScCertificate(const CScCertificate &cert): CTransactionBase(cer
     nFirstBwtPos(cert.nFirstBwtPos), forwardTransferScFee(cert.forwardTransferScFee),
     mainchainBackwardTransferRequestScFee(cert.mainchainBackwardTransferRequestScFee) {}
 
+CScCertificate::CScCertificate(CScCertificate &&cert) noexcept: CTransactionBase(std::move(cert)),
+    scId(cert.scId), epochNumber(cert.epochNumber), quality(cert.quality),
+    endEpochCumScTxCommTreeRoot(cert.endEpochCumScTxCommTreeRoot),
+    scProof(cert.scProof),
+    vFieldElementCertificateField(std::move(*const_cast<std::vector<FieldElementCertificateField>*>(&cert.vFieldElementCertificateField))),
+    vBitVectorCertificateField(std::move(*const_cast<std::vector<BitVectorCertificateField>*>(&cert.vBitVectorCertificateField))),
+    nFirstBwtPos(cert.nFirstBwtPos), forwardTransferScFee(cert.forwardTransferScFee),
+    mainchainBackwardTransferRequestScFee(cert.mainchainBackwardTransferRequestScFee) {}
+
 CScCertificate& CScCertificate::operator=(const CScCertificate &cert)
 {
     CTransactionBase::operator=(cert);
@@ -61,6 +70,24 @@ CScCertificate& CScCertificate::operator=(const CScCertificate &cert)
     return *this;
 }
 
+CScCertificate& CScCertificate::operator=(CScCertificate &&cert) noexcept
+{
+    CTransactionBase::operator=(std::move(cert));
+    *const_cast<uint256*>(&scId) = cert.scId;
+    *const_cast<int32_t*>(&epochNumber) = cert.epochNumber;
+    *const_cast<int64_t*>(&quality) = cert.quality;
+    *const_cast<CFieldElement*>(&endEpochCumScTxCommTreeRoot) = cert.endEpochCumScTxCommTreeRoot;
+    *const_cast<CScProof*>(&scProof) = cert.scProof;
+    *const_cast<std::vector<FieldElementCertificateField>*>(&vFieldElementCertificateField) =
+        std::move(*const_cast<std::vector<FieldElementCertificateField>*>(&cert.vFieldElementCertificateField));
+    *const_cast<std::vector<BitVectorCertificateField>*>(&vBitVectorCertificateField) =
+        std::move(*const_cast<std::vector<BitVectorCertificateField>*>(&cert.vBitVectorCertificateField));
+    *const_cast<int*>(&nFirstBwtPos) = cert.nFirstBwtPos;
+    *const_cast<CAmount*>(&forwardTransferScFee) = cert.forwardTransferScFee;
+    *const_cast<CAmount*>(&mainchainBackwardTransferRequestScFee) = cert.mainchainBackwardTransferRequestScFee;
+    return *this;
+}
+
 CScCertificate::CScCertificate(const CMutableScCertificate &cert): CTransactionBase(cert),
     scId(cert.scId), epochNumber(cert.epochNumber), quality(cert.quality),
     endEpochCumScTxCommTreeRoot(cert.endEpochCumScTxCommTreeRoot),
@@ -72,6 +99,17 @@ CScCertificate::CScCertificate(const CMutableScCertificate &cert): CTransactionB
     UpdateHash();
 }
 
+CScCertificate::CScCertificate(CMutableScCertificate &&cert): CTransactionBase(std::move(cert)),
+    scId(cert.scId), epochNumber(cert.epochNumber), quality(cert.quality),
+    endEpochCumScTxCommTreeRoot(cert.endEpochCumScTxCommTreeRoot),
+    scProof(cert.scProof), vFieldElementCertificateField(std::move(cert.vFieldElementCertificateField)),
+    vBitVectorCertificateField(std::move(cert.vBitVectorCertificateField)),
+    nFirstBwtPos(cert.nFirstBwtPos), forwardTransferScFee(cert.forwardTransferScFee),
+    mainchainBackwardTransferRequestScFee(cert.mainchainBackwardTransferRequestScFee)
+{
+    UpdateHash();
+}
+
 void CScCertificate::UpdateHash() const
 {
     *const_cast<uint256*>(&hash) = SerializeHash(*this);
@@ -308,10 +346,17 @@ void CScCertificate::AddJoinSplitToJSON(UniValue& entry) const
 
 void CScCertificate::Relay() const
 {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss.reserve(10000);
-    ss << *this;
-    ::Relay(*this, ss);
+    // Wallet rebroadcasts reuse the payload kept with the mempool entry
+    CRelayPayloadRef payload = mempool.GetRelayPayload(GetHash());
+    if (!payload)
+    {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss.reserve(10000);
+        ss << *this;
+        payload = std::make_shared<const CRelayPayload>(ss);
+        mempool.SetRelayPayload(GetHash(), payload);
+    }
+    ::Relay(*this, payload);
 }
 
 std::shared_ptr<const CTransactionBase>
@@ -66,11 +66,15 @@ public:
     /** Construct a CScCertificate that qualifies as IsNull() */
     CScCertificate(int versionIn = SC_CERT_VERSION);
     CScCertificate(const CScCertificate& tx);
+    CScCertificate(CScCertificate&& tx) noexcept;
     CScCertificate& operator=(const CScCertificate& tx);
+    CScCertificate& operator=(CScCertificate&& tx) noexcept;
     ~CScCertificate() = default;
 
     /** Convert a CMutableScCertificate into a CScCertificate.  */
     CScCertificate(const CMutableScCertificate &tx);
+    /** Convert a CMutableScCertificate into a CScCertificate, taking over its vectors instead of copying them. */
+    CScCertificate(CMutableScCertificate &&tx);
 
     friend bool operator==(const CScCertificate& a, const CScCertificate& b)
     {
@@ -239,7 +243,7 @@ struct CMutableScCertificate : public CMutableTransactionBase
     CMutableScCertificate();
     CMutableScCertificate(const CScCertificate& tx);
     CMutableScCertificate(const CMutableScCertificate& tx) = default;
-    operator CScCertificate() { return CScCertificate(static_cast<const CMutableScCertificate&>(*this)); }
+    operator CScCertificate() & { return CScCertificate(static_cast<const CMutableScCertificate&>(*this)); }
     CMutableScCertificate& operator=(const CMutableScCertificate& tx);
     ~CMutableScCertificate() = default;
 
@@ -289,12 +293,9 @@ struct CMutableScCertificate : public CMutableTransactionBase
     }
 
     template <typename Stream>
-    CMutableScCertificate(deserialize_type, Stream& s) :
-        scId(), epochNumber(CScCertificate::EPOCH_NULL),
-        quality(CScCertificate::QUALITY_NULL), endEpochCumScTxCommTreeRoot(), scProof(),
-        vFieldElementCertificateField(), vBitVectorCertificateField()
+    CMutableScCertificate(deserialize_type, Stream& s) : CMutableScCertificate()
     {
-        Unserialize(s);
+        Unserialize(s, s.GetType(), s.GetVersion());
     }
 
     /** Compute the hash of this CMutableScCertificate. This is computed on the
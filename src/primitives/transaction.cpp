@@ -468,6 +468,10 @@ CTransactionBase::CTransactionBase(int nVersionIn):
 CTransactionBase::CTransactionBase(const CTransactionBase &tx):
     nVersion(tx.nVersion), vin(tx.vin), vout(tx.vout), hash(tx.hash) {}
 
+CTransactionBase::CTransactionBase(CTransactionBase &&tx) noexcept:
+    nVersion(tx.nVersion), vin(std::move(*const_cast<std::vector<CTxIn>*>(&tx.vin))),
+    vout(std::move(*const_cast<std::vector<CTxOut>*>(&tx.vout))), hash(tx.hash) {}
+
 CTransactionBase& CTransactionBase::operator=(const CTransactionBase &tx) {
     *const_cast<uint256*>(&hash)             = tx.hash;
     *const_cast<int*>(&nVersion)             = tx.nVersion;
@@ -476,8 +480,19 @@ CTransactionBase& CTransactionBase::operator=(const CTransactionBase &tx) {
     return *this;
 }
 
+CTransactionBase& CTransactionBase::operator=(CTransactionBase &&tx) noexcept {
+    *const_cast<uint256*>(&hash)             = tx.hash;
+    *const_cast<int*>(&nVersion)             = tx.nVersion;
+    *const_cast<std::vector<CTxIn>*>(&vin)   = std::move(*const_cast<std::vector<CTxIn>*>(&tx.vin));
+    *const_cast<std::vector<CTxOut>*>(&vout) = std::move(*const_cast<std::vector<CTxOut>*>(&tx.vout));
+    return *this;
+}
+
 CTransactionBase::CTransactionBase(const CMutableTransactionBase& mutTxBase):
-    nVersion(mutTxBase.nVersion), vin(mutTxBase.vin), vout(mutTxBase.getVout()), hash(mutTxBase.GetHash()) {}
+    nVersion(mutTxBase.nVersion), vin(mutTxBase.vin), vout(mutTxBase.getVout()), hash() {}
+
+CTransactionBase::CTransactionBase(CMutableTransactionBase&& mutTxBase):
+    nVersion(mutTxBase.nVersion), vin(std::move(mutTxBase.vin)), vout(std::move(mutTxBase.vout)), hash() {}
 
 CAmount CTransactionBase::GetValueOut() const
 {
@@ -724,6 +739,14 @@ CTransaction::CTransaction(const CTransaction &tx) : CTransactionBase(tx),
     vcsw_ccin(tx.vcsw_ccin), vsc_ccout(tx.vsc_ccout), vft_ccout(tx.vft_ccout), vmbtr_out(tx.vmbtr_out),
     joinSplitPubKey(tx.joinSplitPubKey), joinSplitSig(tx.joinSplitSig) {}
 
+CTransaction::CTransaction(CTransaction &&tx) noexcept : CTransactionBase(std::move(tx)),
+    vjoinsplit(std::move(*const_cast<std::vector<JSDescription>*>(&tx.vjoinsplit))), nLockTime(tx.nLockTime),
+    vcsw_ccin(std::move(*const_cast<std::vector<CTxCeasedSidechainWithdrawalInput>*>(&tx.vcsw_ccin))),
+    vsc_ccout(std::move(*const_cast<std::vector<CTxScCreationOut>*>(&tx.vsc_ccout))),
+    vft_ccout(std::move(*const_cast<std::vector<CTxForwardTransferOut>*>(&tx.vft_ccout))),
+    vmbtr_out(std::move(*const_cast<std::vector<CBwtRequestOut>*>(&tx.vmbtr_out))),
+    joinSplitPubKey(tx.joinSplitPubKey), joinSplitSig(tx.joinSplitSig) {}
+
 CTransaction& CTransaction::operator=(const CTransaction &tx) {
     CTransactionBase::operator=(tx);
     *const_cast<std::vector<JSDescription>*>(&vjoinsplit)        = tx.vjoinsplit;
@@ -737,6 +760,19 @@ CTransaction& CTransaction::operator=(const CTransaction &tx) {
     return *this;
 }
 
+CTransaction& CTransaction::operator=(CTransaction &&tx) noexcept {
+    CTransactionBase::operator=(std::move(tx));
+    *const_cast<std::vector<JSDescription>*>(&vjoinsplit)        = std::move(*const_cast<std::vector<JSDescription>*>(&tx.vjoinsplit));
+    *const_cast<uint32_t*>(&nLockTime)                           = tx.nLockTime;
+    *const_cast<std::vector<CTxCeasedSidechainWithdrawalInput>*>(&vcsw_ccin) = std::move(*const_cast<std::vector<CTxCeasedSidechainWithdrawalInput>*>(&tx.vcsw_ccin));
+    *const_cast<std::vector<CTxScCreationOut>*>(&vsc_ccout)      = std::move(*const_cast<std::vector<CTxScCreationOut>*>(&tx.vsc_ccout));
+    *const_cast<std::vector<CTxForwardTransferOut>*>(&vft_ccout) = std::move(*const_cast<std::vector<CTxForwardTransferOut>*>(&tx.vft_ccout));
+    *const_cast<std::vector<CBwtRequestOut>*>(&vmbtr_out)        = std::move(*const_cast<std::vector<CBwtRequestOut>*>(&tx.vmbtr_out));
+    *const_cast<uint256*>(&joinSplitPubKey)                      = tx.joinSplitPubKey;
+    *const_cast<joinsplit_sig_t*>(&joinSplitSig)                 = tx.joinSplitSig;
+    return *this;
+}
+
 void CTransaction::UpdateHash() const
 {
     *const_cast<uint256*>(&hash) = SerializeHash(*this);
@@ -753,6 +789,15 @@ CTransaction::CTransaction(const CMutableTransaction &tx): CTransactionBase(tx),
     UpdateHash();
 }
 
+CTransaction::CTransaction(CMutableTransaction &&tx): CTransactionBase(std::move(tx)),
+    vjoinsplit(std::move(tx.vjoinsplit)), nLockTime(tx.nLockTime),
+    vcsw_ccin(std::move(tx.vcsw_ccin)), vsc_ccout(std::move(tx.vsc_ccout)),
+    vft_ccout(std::move(tx.vft_ccout)), vmbtr_out(std::move(tx.vmbtr_out)),
+    joinSplitPubKey(tx.joinSplitPubKey), joinSplitSig(tx.joinSplitSig)
+{
+    UpdateHash();
+}
+
 unsigned int CTransactionBase::CalculateModifiedSize(unsigned int nTxSize) const
 {
     // In order to avoid disincentivizing cleaning up the UTXO set we don't count
@@ -1168,10 +1213,17 @@ std::string CTransaction::EncodeHex() const
 
 void CTransaction::Relay() const
 {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss.reserve(10000);
-    ss << *this;
-    ::Relay(*this, ss);
+    // Wallet rebroadcasts reuse the payload kept with the mempool entry
+    CRelayPayloadRef payload = mempool.GetRelayPayload(GetHash());
+    if (!payload)
+    {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss.reserve(10000);
+        ss << *this;
+        payload = std::make_shared<const CRelayPayload>(ss);
+        mempool.SetRelayPayload(GetHash(), payload);
+    }
+    ::Relay(*this, payload);
 }
 
 std::shared_ptr<const CTransactionBase>
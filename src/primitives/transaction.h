@@ -753,9 +753,13 @@ public:
 
     CTransactionBase(int versionIn);
     CTransactionBase(const CTransactionBase& tx);
+    CTransactionBase(CTransactionBase&& tx) noexcept;
     CTransactionBase& operator=(const CTransactionBase& tx);
+    CTransactionBase& operator=(CTransactionBase&& tx) noexcept;
 
+    // The hash is left to the derived classes, which compute it once fully built
     explicit CTransactionBase(const CMutableTransactionBase& mutTxBase);
+    explicit CTransactionBase(CMutableTransactionBase&& mutTxBase);
     virtual ~CTransactionBase() = default;
 
     template <typename Stream>
@@ -897,11 +901,15 @@ public:
     /** Construct a CTransaction that qualifies as IsNull() */
     CTransaction(int nVersionIn = TRANSPARENT_TX_VERSION);
     CTransaction& operator=(const CTransaction& tx);
+    CTransaction& operator=(CTransaction&& tx) noexcept;
     CTransaction(const CTransaction& tx);
+    CTransaction(CTransaction&& tx) noexcept;
     ~CTransaction() = default;
 
     /** Convert a CMutableTransaction into a CTransaction. */
     CTransaction(const CMutableTransaction &tx);
+    /** Convert a CMutableTransaction into a CTransaction, taking over its vectors instead of copying them. */
+    CTransaction(CMutableTransaction &&tx);
 
     size_t GetSerializeSize(int nType, int nVersion) const override {
         CSizeComputer s(nType, nVersion);
@@ -1056,6 +1064,8 @@ struct CMutableTransactionBase
 
 protected:
     std::vector<CTxOut> vout;
+
+    friend class CTransactionBase;
 public:
     CMutableTransactionBase();
     virtual ~CMutableTransactionBase() = default;
@@ -1091,7 +1101,7 @@ struct CMutableTransaction : public CMutableTransactionBase
 
     CMutableTransaction();
     CMutableTransaction(const CTransaction& tx);
-    operator CTransaction() { return CTransaction(static_cast<const CMutableTransaction&>(*this)); }
+    operator CTransaction() & { return CTransaction(static_cast<const CMutableTransaction&>(*this)); }
 
     ADD_SERIALIZE_METHODS;
 
@@ -1121,7 +1131,7 @@ struct CMutableTransaction : public CMutableTransactionBase
 
     template <typename Stream>
     CMutableTransaction(deserialize_type, Stream& s):nLockTime(0) {
-        Unserialize(s);
+        Unserialize(s, s.GetType(), s.GetVersion());
     }
 
     /** Compute the hash of this CMutableTransaction. This is computed on the
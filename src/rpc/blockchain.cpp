@@ -5,11 +5,14 @@
 
 #include "amount.h"
 #include "base58.h"
+#include "blockfilecache.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "chainsnapshot.h"
 #include "checkpoints.h"
 #include "consensus/validation.h"
 #include "main.h"
+#include "orphanpool.h"
 #include "primitives/transaction.h"
 #include "script/script.h"
 #include "script/script_error.h"
@@ -116,12 +119,13 @@ static UniValue ValuePoolDesc(
 
 UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 {
+    std::shared_ptr<const CChainSnapshot> snapshot = GetChainSnapshot();
     UniValue result(UniValue::VOBJ);
     result.pushKV("hash", blockindex->GetBlockHash().GetHex());
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    if (snapshot->Contains(blockindex))
+        confirmations = snapshot->Height() - blockindex->nHeight + 1;
     result.pushKV("confirmations", confirmations);
     result.pushKV("height", blockindex->nHeight);
     result.pushKV("version", blockindex->nVersion);
@@ -137,7 +141,7 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 
     if (blockindex->pprev)
         result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    CBlockIndex *pnext = snapshot->Next(blockindex);
     if (pnext)
         result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
     return result;
@@ -251,14 +255,14 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
 }
 #endif // ENABLE_ADDRESS_INDEXING
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails, const CChainSnapshot& snapshot)
 {
     UniValue result(UniValue::VOBJ);
     result.pushKV("hash", block.GetHash().GetHex());
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    if (snapshot.Contains(blockindex))
+        confirmations = snapshot.Height() - blockindex->nHeight + 1;
 
     result.pushKV("confirmations", confirmations);
     result.pushKV("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
@@ -315,12 +319,17 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 
     if (blockindex->pprev)
         result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    CBlockIndex *pnext = snapshot.Next(blockindex);
     if (pnext)
         result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
     return result;
 }
 
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+{
+    return blockToJSON(block, blockindex, txDetails, *GetChainSnapshot());
+}
+
 UniValue getblockcount(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 0)
@@ -336,8 +345,7 @@ UniValue getblockcount(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockcount", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return GetChainSnapshot()->Height();
 }
 
 UniValue getbestblockhash(const UniValue& params, bool fHelp)
@@ -355,8 +363,7 @@ UniValue getbestblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getbestblockhash", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    return GetChainSnapshot()->Tip()->GetBlockHash().GetHex();
 }
 
 UniValue getdifficulty(const UniValue& params, bool fHelp)
@@ -374,8 +381,7 @@ UniValue getdifficulty(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getdifficulty", "")
         );
 
-    LOCK(cs_main);
-    return GetNetworkDifficulty();
+    return GetNetworkDifficulty(GetChainSnapshot()->Tip());
 }
 
 static void AddDependancy(const CTransactionBase& root, UniValue& info)
@@ -615,13 +621,13 @@ UniValue getblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockhash", "1000")
         );
 
-    LOCK(cs_main);
+    std::shared_ptr<const CChainSnapshot> snapshot = GetChainSnapshot();
 
     int nHeight = params[0].get_int();
-    if (nHeight < 0 || nHeight > chainActive.Height())
+    if (nHeight < 0 || nHeight > snapshot->Height())
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
 
-    CBlockIndex* pblockindex = chainActive[nHeight];
+    CBlockIndex* pblockindex = (*snapshot)[nHeight];
     return pblockindex->GetBlockHash().GetHex();
 }
 
@@ -660,8 +666,6 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockheader", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
         );
 
-    LOCK(cs_main);
-
     std::string strHash = params[0].get_str();
     uint256 hash(uint256S(strHash));
 
@@ -669,11 +673,10 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
+    CBlockIndex* pblockindex = LookupBlockIndex(hash);
+    if (pblockindex == NULL)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
     if (!fVerbose)
     {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
@@ -748,8 +751,7 @@ UniValue getblock(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblock", "height")
         );
 
-    LOCK(cs_main);
-
+    std::shared_ptr<const CChainSnapshot> snapshot = GetChainSnapshot();
     std::string strHash = params[0].get_str();
 
     // If height is supplied, find the hash
@@ -768,10 +770,10 @@ UniValue getblock(const UniValue& params, bool fHelp)
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
         }
 
-        if (nHeight < 0 || nHeight > chainActive.Height()) {
+        if (nHeight < 0 || nHeight > snapshot->Height()) {
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
         }
-        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
+        strHash = (*snapshot)[nHeight]->GetBlockHash().GetHex();
     }
 
     uint256 hash(uint256S(strHash));
@@ -789,27 +791,33 @@ UniValue getblock(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 0 to 2");
     }
 
-    if (mapBlockIndex.count(hash) == 0)
+    CBlockIndex* pblockindex = LookupBlockIndex(hash);
+    if (pblockindex == NULL)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    // Blocks of the active chain stay where they were stored unless pruning is on,
+    // any other block may still be in the middle of being written
+    bool fNeedsMainLock = fHavePruned || !snapshot->Contains(pblockindex);
+    CCriticalBlock lockMain(fNeedsMainLock ? &cs_main : NULL, "cs_main", __FILE__, __LINE__);
 
+    CBlock block;
     if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
 
-    if(!ReadBlockFromDisk(block, pblockindex))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
-
     if (verbosity == 0)
     {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        // The serialized block is sent as stored, without decoding it
+        CBlockFileBytes bytes;
+        if(!ReadRawBlockFromDisk(bytes, pblockindex))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+        return HexStr(bytes.begin(), bytes.end());
     }
 
-    return blockToJSON(block, pblockindex, verbosity >= 2);
+    if(!ReadBlockFromDisk(block, pblockindex))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+
+    // The same snapshot the block was looked up in, so that the reply can't mix two tips
+    return blockToJSON(block, pblockindex, verbosity >= 2, *snapshot);
 }
 
 UniValue getblockexpanded(const UniValue& params, bool fHelp)
@@ -1220,7 +1228,19 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
             "        },\n"
             "        \"reject\": { ... }        (object) progress toward rejecting pre-softfork blocks (same fields as \"enforce\")\n"
             "     }, ...\n"
-            "  ]\n"
+            "  ],\n"
+            "  \"blockcache\": {                (object) reads of blocks and undo data from disk since startup\n"
+            "     \"hits\": xx,                  (numeric) blocks found decoded in memory\n"
+            "     \"misses\": xx,                (numeric) blocks that had to be read from disk\n"
+            "     \"blocks\": xx,                (numeric) blocks currently kept decoded\n"
+            "     \"bytes\": xx,                 (numeric) serialized size of the blocks currently kept decoded\n"
+            "     \"mappedreads\": xx,           (numeric) blocks and undo data read from a memory-mapped file\n"
+            "     \"filereads\": xx,             (numeric) blocks and undo data read through a file stream\n"
+            "     \"bytesread\": xx,             (numeric) bytes of blocks and undo data read from disk\n"
+            "     \"maps\": xx,                  (numeric) number of times a block or undo file was mapped\n"
+            "     \"mappedfiles\": xx,           (numeric) block and undo files currently mapped\n"
+            "     \"mappedbytes\": xx            (numeric) size of the files currently mapped\n"
+            "  }\n"
             "}\n"
 
             "\nExamples:\n"
@@ -1265,6 +1285,7 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
 
         if (block) obj.pushKV("pruneheight", block->nHeight);
     }
+    obj.pushKV("blockcache", blockFileCache.GetStats().ToJSON());
     return obj;
 }
 
@@ -1393,6 +1414,12 @@ UniValue mempoolInfoToJSON()
     ret.pushKV("size", (int64_t) mempool.size());
     ret.pushKV("bytes", (int64_t) mempool.GetTotalSize());
     ret.pushKV("usage", (int64_t) mempool.DynamicMemoryUsage());
+    size_t maxmempool = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
+    ret.pushKV("maxmempool", (int64_t) maxmempool);
+    ret.pushKV("mempoolminfee", ValueFromAmount(mempool.GetMinFee(maxmempool).GetFeePerK()));
+    if (GetArg("-checkmempoolsample", 0) > 0 && !GetBoolArg("-checkmempool", Params().DefaultConsistencyChecks()))
+        ret.pushKV("consistency", mempool.GetCheckStats().ToJSON());
+    ret.pushKV("orphans", orphanPool.GetStats().ToJSON());
 
     if (Params().NetworkIDString() == "regtest") {
         ret.pushKV("fullyNotified", mempool.IsFullyNotified());
@@ -1413,6 +1440,30 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
             "  \"size\": xxxxx                (numeric) current tx count\n"
             "  \"bytes\": xxxxx               (numeric) sum of all tx sizes\n"
             "  \"usage\": xxxxx               (numeric) total memory usage for the mempool\n"
+            "  \"maxmempool\": xxxxx          (numeric) maximum memory usage for the mempool\n"
+            "  \"mempoolminfee\": xxxxx       (numeric) minimum fee for tx to be accepted\n"
+            "  \"consistency\": {             (json object, only with -checkmempoolsample) sampled consistency checks\n"
+            "    \"runs\": xxxxx               (numeric) checks run since startup\n"
+            "    \"checked\": xxxxx            (numeric) entries checked\n"
+            "    \"sweeps\": xxxxx             (numeric) complete passes over the mempool\n"
+            "    \"lastsweep\": xxxxx          (numeric) time of the last complete pass\n"
+            "    \"inconsistencies\": xxxxx    (numeric) entries found inconsistent, see the log for the details\n"
+            "    \"lastinconsistent\": \"hash\" (string, optional) the last of them\n"
+            "    \"time\": xxxxx               (numeric) microseconds spent checking\n"
+            "  }\n"
+            "  \"orphans\": {                 (json object) transactions waiting for the outputs they spend\n"
+            "    \"size\": xxxxx               (numeric) current orphan count\n"
+            "    \"bytes\": xxxxx              (numeric) sum of all orphan sizes\n"
+            "    \"peers\": xxxxx              (numeric) peers the orphans came from\n"
+            "    \"added\": xxxxx              (numeric) orphans stored since startup\n"
+            "    \"resolved\": xxxxx           (numeric) orphans accepted once their parents arrived\n"
+            "    \"hitrate\": x.xxx            (numeric) fraction of the stored orphans that were resolved\n"
+            "    \"invalid\": xxxxx            (numeric) orphans rejected once their parents arrived\n"
+            "    \"evictedpeersize\": xxxxx    (numeric) orphans evicted because their peer was over -maxorphanpeersize\n"
+            "    \"evictedcount\": xxxxx       (numeric) orphans evicted because the pool was over -maxorphantx\n"
+            "    \"erasedforpeer\": xxxxx      (numeric) orphans dropped when their peer disconnected\n"
+            "    \"ignoredlarge\": xxxxx       (numeric) orphans not stored because too large\n"
+            "  }\n"
             "}\n"
             
             "\nExamples:\n"
@@ -1423,6 +1474,73 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
     return mempoolInfoToJSON();
 }
 
+UniValue getvalidationqueueinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getvalidationqueueinfo\n"
+            "\nReturns details on the dispatch of the validation events to the notification listeners.\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"running\": true|false        (boolean) whether the listeners that are not synchronous are called from the queue\n"
+            "  \"depth\": xxxxx               (numeric) events waiting in the queue\n"
+            "  \"maxdepth\": xxxxx            (numeric) maximum number of events in the queue\n"
+            "  \"peakdepth\": xxxxx           (numeric) highest number of events seen in the queue\n"
+            "  \"queued\": xxxxx              (numeric) events queued since startup\n"
+            "  \"blocked\": xxxxx             (numeric) events whose firing thread waited for room in the queue\n"
+            "  \"avgblocked\": xxxxx          (numeric) average time in microseconds those threads waited\n"
+            "  \"maxblocked\": xxxxx          (numeric) longest time in microseconds a thread waited\n"
+            "  \"overflowed\": xxxxx          (numeric) events queued beyond maxdepth because the queue thread was stalled\n"
+            "  \"avgwait\": xxxxx             (numeric) average time in microseconds an event waited in the queue\n"
+            "  \"maxwait\": xxxxx             (numeric) longest time in microseconds an event waited in the queue\n"
+            "  \"listeners\": [\n"
+            "    {\n"
+            "      \"name\": \"name\",          (string) listener name\n"
+            "      \"synchronous\": true|false, (boolean) whether the listener is called by the thread firing the events\n"
+            "      \"events\": xxxxx,          (numeric) events delivered to the listener\n"
+            "      \"avgtime\": xxxxx,         (numeric) average time in microseconds spent in the listener per event\n"
+            "      \"maxtime\": xxxxx          (numeric) longest time in microseconds spent in the listener for an event\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getvalidationqueueinfo", "")
+            + HelpExampleRpc("getvalidationqueueinfo", "")
+        );
+
+    CValidationQueueStats stats = GetMainSignals().GetQueueStats();
+    uint64_t nDelivered = stats.nQueued - stats.nDepth;
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("running", stats.fRunning);
+    ret.pushKV("depth", (int64_t)stats.nDepth);
+    ret.pushKV("maxdepth", (int64_t)stats.nMaxDepth);
+    ret.pushKV("peakdepth", (int64_t)stats.nPeakDepth);
+    ret.pushKV("queued", (int64_t)stats.nQueued);
+    ret.pushKV("blocked", (int64_t)stats.nBlocked);
+    ret.pushKV("avgblocked", stats.nBlocked ? stats.nTotalBlockedMicros / (int64_t)stats.nBlocked : 0);
+    ret.pushKV("maxblocked", stats.nMaxBlockedMicros);
+    ret.pushKV("overflowed", (int64_t)stats.nOverflowed);
+    ret.pushKV("avgwait", nDelivered ? stats.nTotalWaitMicros / (int64_t)nDelivered : 0);
+    ret.pushKV("maxwait", stats.nMaxWaitMicros);
+
+    UniValue listeners(UniValue::VARR);
+    for (const CValidationListenerStats& listener : stats.listeners) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("name", listener.name);
+        entry.pushKV("synchronous", listener.fSynchronous);
+        entry.pushKV("events", (int64_t)listener.nEvents);
+        entry.pushKV("avgtime", listener.nEvents ? listener.nTotalMicros / (int64_t)listener.nEvents : 0);
+        entry.pushKV("maxtime", listener.nMaxMicros);
+        listeners.push_back(entry);
+    }
+    ret.pushKV("listeners", listeners);
+
+    return ret;
+}
+
 UniValue invalidateblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -1563,7 +1681,7 @@ static void addScUnconfCcData(const uint256& scId, UniValue& sc)
     // there are no info about bwt requests in sc db, therefore we do not include them neither when they are in mempool
 }
 
-bool FillScRecordFromInfo(const uint256& scId, const CSidechain& info, CSidechain::State scState, const CCoinsViewCache& scView, 
+bool FillScRecordFromInfo(const uint256& scId, const CSidechain& info, CSidechain::State scState, int nHeight,
     UniValue& sc, bool bOnlyAlive, bool bVerbose)
 {
     if (bOnlyAlive && (scState != CSidechain::State::ALIVE))
@@ -1573,7 +1691,7 @@ bool FillScRecordFromInfo(const uint256& scId, const CSidechain& info, CSidechai
     if (!info.IsNull() )
     {
         int currentEpoch = (scState == CSidechain::State::ALIVE)?
-                info.EpochFor(chainActive.Height()):
+                info.EpochFor(nHeight):
                 info.EpochFor(info.GetScheduledCeasingHeight());
  
         sc.pushKV("balance", ValueFromAmount(info.balance));
@@ -1593,7 +1711,7 @@ bool FillScRecordFromInfo(const uint256& scId, const CSidechain& info, CSidechai
         sc.pushKV("lastCertificateQuality", info.lastTopQualityCertQuality);
         sc.pushKV("lastCertificateAmount", ValueFromAmount(info.lastTopQualityCertBwtAmount));
 
-        const CScCertificateView& certView = scView.GetActiveCertView(scId);
+        const CScCertificateView& certView = info.GetActiveCertView(nHeight);
         sc.pushKV("activeFtScFee", ValueFromAmount(certView.forwardTransferScFee));
         sc.pushKV("activeMbtrScFee", ValueFromAmount(certView.mainchainBackwardTransferRequestScFee));
  
@@ -1759,26 +1877,31 @@ bool FillScRecordFromInfo(const uint256& scId, const CSidechain& info, CSidechai
     return true;
 }
 
-bool FillScRecord(const uint256& scId, UniValue& scRecord, bool bOnlyAlive, bool bVerbose)
+bool FillScRecord(const CChainSnapshot& snapshot, const uint256& scId, UniValue& scRecord, bool bOnlyAlive, bool bVerbose)
 {
     CSidechain sidechain;
-    CCoinsViewCache scView(pcoinsTip);
-    if (!scView.GetSidechain(scId, sidechain)) {
+    std::shared_ptr<const CSidechain> pSidechain = snapshot.GetSidechain(scId);
+    if (pSidechain)
+        sidechain = *pSidechain;
+    else
         LogPrint("sc", "%s():%d - scid[%s] not yet created\n", __func__, __LINE__, scId.ToString() );
-    }
-    CSidechain::State scState = scView.GetSidechainState(scId);
+    CSidechain::State scState = snapshot.GetSidechainState(scId);
 
-    return FillScRecordFromInfo(scId, sidechain, scState, scView, scRecord, bOnlyAlive, bVerbose);
+    LOCK(mempool.cs);
+    return FillScRecordFromInfo(scId, sidechain, scState, snapshot.Height(), scRecord, bOnlyAlive, bVerbose);
 }
 
-int FillScList(UniValue& scItems, bool bOnlyAlive, bool bVerbose, int from=0, int to=-1)
+int FillScList(const CChainSnapshot& snapshot, UniValue& scItems, bool bOnlyAlive, bool bVerbose, int from=0, int to=-1)
 {
     std::set<uint256> sScIds;
+    snapshot.GetScIds(sScIds);
     {
         LOCK(mempool.cs);
-        CCoinsViewMemPool scView(pcoinsTip, mempool);
-
-        scView.GetScIds(sScIds);
+        for (const auto& entry : mempool.mapSidechains)
+        {
+            if (!entry.second.scCreationTxHash.IsNull())
+                sScIds.insert(entry.first);
+        }
     }
 
     if (sScIds.size() == 0)
@@ -1803,7 +1926,7 @@ int FillScList(UniValue& scItems, bool bOnlyAlive, bool bVerbose, int from=0, in
     while (it != sScIds.end())
     {
         UniValue scRecord(UniValue::VOBJ);
-        if (FillScRecord(*it, scRecord, bOnlyAlive, bVerbose))
+        if (FillScRecord(snapshot, *it, scRecord, bOnlyAlive, bVerbose))
             totalResult.push_back(scRecord);
         ++it;
     }
@@ -1962,6 +2085,8 @@ UniValue getscinfo(const UniValue& params, bool fHelp)
     if (params.size() > 2)
         bVerbose = params[2].get_bool();
 
+    // Sidechains are read as of the latest published tip, without holding up validation
+    std::shared_ptr<const CChainSnapshot> snapshot = GetChainSnapshot();
     UniValue ret(UniValue::VOBJ);
     UniValue scItems(UniValue::VARR);
 
@@ -1973,7 +2098,7 @@ UniValue getscinfo(const UniValue& params, bool fHelp)
  
         UniValue scRecord(UniValue::VOBJ);
         // throws a json rpc exception if the scid is not found in the db
-        if (!FillScRecord(scId, scRecord, bOnlyAlive, bVerbose) )
+        if (!FillScRecord(*snapshot, scId, scRecord, bOnlyAlive, bVerbose) )
         {
             // after filtering no sc has been found, this can happen for instance when the sc is ceased
             // and bOnlyAlive is true
@@ -2001,7 +2126,7 @@ UniValue getscinfo(const UniValue& params, bool fHelp)
 
         // throws a json rpc exception if the from/to parameters are invalid or out of the range of the
         // retrieved scItems list
-        int tot = FillScList(scItems, bOnlyAlive, bVerbose, from, to);
+        int tot = FillScList(*snapshot, scItems, bOnlyAlive, bVerbose, from, to);
 
         ret.pushKV("totalItems", tot);
         ret.pushKV("from", from);
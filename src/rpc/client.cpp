@@ -143,6 +143,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "zcrawjoinsplit", 4 },
     { "zcbenchmark", 1 },
     { "zcbenchmark", 2 },
+    { "zcbenchmark", 3 },
     { "getblocksubsidy", 0 },
     { "getblockmerkleroots", 0 },
     { "getblockmerkleroots", 1 },
@@ -568,8 +568,6 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
         includeMerkleRoots = params[1].get_bool();
     }
 
-    static unsigned int nTransactionsUpdatedLast;
-
     if (!lpval.isNull())
     {
         // Wait to respond until either the best block changes, OR a minute has passed and there are more transactions
@@ -589,7 +587,7 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
         {
             // NOTE: Spec does not specify behaviour for non-string longpollid, but this makes testing easier
             hashWatchedChain = chainActive.Tip()->GetBlockHash();
-            nTransactionsUpdatedLastLP = nTransactionsUpdatedLast;
+            nTransactionsUpdatedLastLP = mempool.GetTransactionsUpdated();
         }
 
         // Release the wallet and main lock while waiting
@@ -597,16 +595,16 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
         {
             checktxtime = boost::get_system_time() + boost::posix_time::minutes(1);
 
-            boost::unique_lock<boost::mutex> lock(csBestBlock);
-            while (chainActive.Tip()->GetBlockHash() == hashWatchedChain && IsRPCRunning())
+            // Tip and mempool changes wake us up, the timeout only bounds each wait
+            while (IsRPCRunning())
             {
-                if (!cvBlockChange.timed_wait(lock, checktxtime))
-                {
-                    // Timeout: Check transactions for update
-                    if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLastLP)
-                        break;
-                    checktxtime += boost::posix_time::seconds(10);
-                }
+                uint64_t nEvents = GetBlockTemplateEvents();
+                if (chainActive.Tip()->GetBlockHash() != hashWatchedChain)
+                    break;
+                boost::system_time now = boost::get_system_time();
+                if (now >= checktxtime && mempool.GetTransactionsUpdated() != nTransactionsUpdatedLastLP)
+                    break;
+                WaitBlockTemplateEvent(nEvents, std::max(checktxtime, now + boost::posix_time::minutes(1)));
             }
         }
         ENTER_CRITICAL_SECTION(cs_main);
@@ -616,39 +614,12 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
         // TODO: Maybe recheck connections/IBD and (if something wrong) send an expires-immediately template to stop miners?
     }
 
-    // Update block
-    static CBlockIndex* pindexPrev;
-    static int64_t nStart;
-    static CBlockTemplate* pblocktemplate;
-    if (pindexPrev != chainActive.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
-    {
-        // Clear pindexPrev so future calls make a new block, despite any failures from here on
-        pindexPrev = NULL;
-
-        // Store the pindexBest used before CreateNewBlockWithKey, to avoid races
-        nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-        CBlockIndex* pindexPrevNew = chainActive.Tip();
-        nStart = GetTime();
-
-        // Create new block
-        if(pblocktemplate)
-        {
-            delete pblocktemplate;
-            pblocktemplate = NULL;
-        }
-#ifdef ENABLE_WALLET
-        CReserveKey reservekey(pwalletMain);
-        pblocktemplate = CreateNewBlockWithKey(reservekey);
-#else
-        pblocktemplate = CreateNewBlockWithKey();
-#endif
-        if (!pblocktemplate)
-            throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
-
-        // Need to update only after we know CreateNewBlockWithKey succeeded
-        pindexPrev = pindexPrevNew;
-    }
+    // Shared with the other callers, and kept up to date in the background while polled
+    CSharedBlockTemplate shared = GetSharedBlockTemplate();
+    if (!shared.pblocktemplate)
+        throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
+    CBlockTemplate* pblocktemplate = shared.pblocktemplate.get();
+    CBlockIndex* pindexPrev = shared.pindexPrev;
     CBlock* pblock = &pblocktemplate->block; // pointer for convenience
 
     // Update nTime
@@ -657,50 +628,74 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
 
     UniValue aCaps(UniValue::VARR); aCaps.push_back("proposal");
 
-    UniValue txCoinbase = NullUniValue;
-    UniValue transactions(UniValue::VARR);
-    map<uint256, int64_t> setTxIndex;
-    int i = 0;
-    BOOST_FOREACH (const CTransaction& tx, pblock->vtx) {
-        uint256 txHash = tx.GetHash();
-        setTxIndex[txHash] = i++;
+    // Encoding the transactions is the bulk of the reply, do it once per template
+    static std::shared_ptr<CBlockTemplate> pencodedTemplate;
+    static UniValue txCoinbase;
+    static UniValue transactions;
+    static UniValue certificates;
+    if (pencodedTemplate != shared.pblocktemplate)
+    {
+        pencodedTemplate.reset();
+        txCoinbase = NullUniValue;
+        transactions = UniValue(UniValue::VARR);
+        certificates = UniValue(UniValue::VARR);
 
-        if (tx.IsCoinBase() && !coinbasetxn)
-            continue;
+        map<uint256, int64_t> setTxIndex;
+        int i = 0;
+        BOOST_FOREACH (const CTransaction& tx, pblock->vtx) {
+            uint256 txHash = tx.GetHash();
+            setTxIndex[txHash] = i++;
 
-        UniValue entry(UniValue::VOBJ);
+            UniValue entry(UniValue::VOBJ);
 
-        entry.pushKV("data", EncodeHexTx(tx));
+            entry.pushKV("data", EncodeHexTx(tx));
 
-        entry.pushKV("hash", txHash.GetHex());
+            entry.pushKV("hash", txHash.GetHex());
 
-        UniValue deps(UniValue::VARR);
-        BOOST_FOREACH (const CTxIn &in, tx.GetVin())
-        {
-            if (setTxIndex.count(in.prevout.hash))
-                deps.push_back(setTxIndex[in.prevout.hash]);
-        }
-        entry.pushKV("depends", deps);
-
-        int index_in_template = i - 1;
-        entry.pushKV("fee", pblocktemplate->vTxFees[index_in_template]);
-        entry.pushKV("sigops", pblocktemplate->vTxSigOps[index_in_template]);
-
-        if (tx.IsCoinBase()) {
-            // Show community reward if it is required
-            if (pblock->vtx[0].GetVout().size() > 1) {
-                // Correct this if GetBlockTemplate changes the order
-                entry.pushKV("communityfund", (int64_t)tx.GetVout()[1].nValue);
-                if (pblock->vtx[0].GetVout().size() > 3) {
-                    entry.pushKV("securenodes", (int64_t)tx.GetVout()[2].nValue);
-                    entry.pushKV("supernodes", (int64_t)tx.GetVout()[3].nValue);
+            UniValue deps(UniValue::VARR);
+            BOOST_FOREACH (const CTxIn &in, tx.GetVin())
+            {
+                if (setTxIndex.count(in.prevout.hash))
+                    deps.push_back(setTxIndex[in.prevout.hash]);
+            }
+            entry.pushKV("depends", deps);
+
+            int index_in_template = i - 1;
+            entry.pushKV("fee", pblocktemplate->vTxFees[index_in_template]);
+            entry.pushKV("sigops", pblocktemplate->vTxSigOps[index_in_template]);
+
+            if (tx.IsCoinBase()) {
+                // Show community reward if it is required
+                if (pblock->vtx[0].GetVout().size() > 1) {
+                    // Correct this if GetBlockTemplate changes the order
+                    entry.pushKV("communityfund", (int64_t)tx.GetVout()[1].nValue);
+                    if (pblock->vtx[0].GetVout().size() > 3) {
+                        entry.pushKV("securenodes", (int64_t)tx.GetVout()[2].nValue);
+                        entry.pushKV("supernodes", (int64_t)tx.GetVout()[3].nValue);
+                    }
                 }
+                entry.pushKV("required", true);
+                txCoinbase = entry;
+            } else {
+                transactions.push_back(entry);
             }
-            entry.pushKV("required", true);
-            txCoinbase = entry;
-        } else {
-            transactions.push_back(entry);
         }
+
+        int cert_idx_in_template = 0;
+        BOOST_FOREACH (const CScCertificate& cert, pblock->vcert) {
+            uint256 certHash = cert.GetHash();
+            UniValue entry(UniValue::VOBJ);
+ 
+            entry.pushKV("data", EncodeHexCert(cert));
+            entry.pushKV("hash", certHash.GetHex());
+            // no depends for cert since there are no inputs
+            entry.pushKV("fee", pblocktemplate->vCertFees[cert_idx_in_template]);
+            entry.pushKV("sigops", pblocktemplate->vCertSigOps[cert_idx_in_template]);
+            certificates.push_back(entry);
+ 
+            cert_idx_in_template++;
+        }
+        pencodedTemplate = shared.pblocktemplate;
     }
 
     UniValue aux(UniValue::VOBJ);
@@ -742,21 +737,6 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     result.pushKV("transactions", transactions);
     if (certSupported)
     {
-        UniValue certificates(UniValue::VARR);
-        int cert_idx_in_template = 0;
-        BOOST_FOREACH (const CScCertificate& cert, pblock->vcert) {
-            uint256 certHash = cert.GetHash();
-            UniValue entry(UniValue::VOBJ);
- 
-            entry.pushKV("data", EncodeHexCert(cert));
-            entry.pushKV("hash", certHash.GetHex());
-            // no depends for cert since there are no inputs
-            entry.pushKV("fee", pblocktemplate->vCertFees[cert_idx_in_template]);
-            entry.pushKV("sigops", pblocktemplate->vCertSigOps[cert_idx_in_template]);
-            certificates.push_back(entry);
- 
-            cert_idx_in_template++;
-        }
         result.pushKV("certificates", certificates);
     }
 
@@ -772,7 +752,7 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     if (pblock->nVersion != BLOCK_VERSION_SC_SUPPORT)
         block_size_limit = MAX_BLOCK_SIZE_BEFORE_SC;
 
-    result.pushKV("longpollid", chainActive.Tip()->GetBlockHash().GetHex() + i64tostr(nTransactionsUpdatedLast));
+    result.pushKV("longpollid", chainActive.Tip()->GetBlockHash().GetHex() + i64tostr(shared.nTransactionsUpdated));
     result.pushKV("target", hashTarget.GetHex());
     result.pushKV("mintime", (int64_t)pindexPrev->GetMedianTimePast()+1);
     result.pushKV("mutable", aMutable);
@@ -876,15 +856,17 @@ UniValue submitblock(const UniValue& params, bool fHelp)
 
 UniValue estimatefee(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() != 1)
+    if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
-            "estimatefee nblocks\n"
+            "estimatefee nblocks ( \"type\" )\n"
             "\nEstimates the approximate fee per kilobyte\n"
             "needed for a transaction to begin confirmation\n"
             "within nblocks blocks.\n"
 
             "\nArguments:\n"
             "1. nblocks     (numeric) number of blocks\n"
+            "2. \"type\"      (string, optional, default=\"transaction\") the kind of transaction, whose fees are estimated apart:\n"
+            "               \"transaction\", \"sidechain\" for transactions with sidechain outputs, or \"certificate\"\n"
 
             "\nResult:\n"
             "n :            (numeric) estimated fee-per-kilobyte\n"
@@ -894,16 +876,28 @@ UniValue estimatefee(const UniValue& params, bool fHelp)
 
             "\nExample:\n"
             + HelpExampleCli("estimatefee", "6")
+            + HelpExampleCli("estimatefee", "6 \"certificate\"")
             + HelpExampleRpc("estimatefee", "6")
         );
 
-    RPCTypeCheck(params, boost::assign::list_of(UniValue::VNUM));
+    RPCTypeCheck(params, boost::assign::list_of(UniValue::VNUM)(UniValue::VSTR));
 
     int nBlocks = params[0].get_int();
     if (nBlocks < 1)
         nBlocks = 1;
 
-    CFeeRate feeRate = mempool.estimateFee(nBlocks);
+    FeeEstimateType type = FEE_ESTIMATE_TX;
+    if (params.size() > 1) {
+        const std::string& strType = params[1].get_str();
+        if (strType == "sidechain")
+            type = FEE_ESTIMATE_SC_TX;
+        else if (strType == "certificate")
+            type = FEE_ESTIMATE_CERTIFICATE;
+        else if (strType != "transaction")
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid type, must be transaction, sidechain or certificate");
+    }
+
+    CFeeRate feeRate = mempool.estimateFee(nBlocks, type);
     if (feeRate == CFeeRate(0))
         return -1.0;
 
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "base58.h"
+#include "chainsnapshot.h"
 #include "clientversion.h"
 #include "init.h"
 #include "main.h"
@@ -686,10 +687,10 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
     int currentTipHeight = -1;
     std::string bestHashStr;
     {
-        LOCK(cs_main);
+        std::shared_ptr<const CChainSnapshot> snapshot = GetChainSnapshot();
         if (includeChainInfo)
-            bestHashStr = chainActive.Tip()->GetBlockHash().GetHex();
-        currentTipHeight = (int)chainActive.Height();
+            bestHashStr = snapshot->Tip()->GetBlockHash().GetHex();
+        currentTipHeight = snapshot->Height();
     }
 
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
@@ -859,14 +860,14 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
     UniValue result(UniValue::VOBJ);
 
     if (includeChainInfo && start > 0 && end > 0) {
-        LOCK(cs_main);
+        std::shared_ptr<const CChainSnapshot> snapshot = GetChainSnapshot();
 
-        if (start > chainActive.Height() || end > chainActive.Height()) {
+        if (start > snapshot->Height() || end > snapshot->Height()) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Start or end is outside chain range");
         }
 
-        CBlockIndex* startIndex = chainActive[start];
-        CBlockIndex* endIndex = chainActive[end];
+        CBlockIndex* startIndex = (*snapshot)[start];
+        CBlockIndex* endIndex = (*snapshot)[end];
 
         UniValue startInfo(UniValue::VOBJ);
         UniValue endInfo(UniValue::VOBJ);
@@ -935,7 +936,7 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
     CAmount received = 0;
     CAmount immature = 0;
 
-    int currentTipHeight = chainActive.Tip()->nHeight;
+    int currentTipHeight = GetChainSnapshot()->Height();
 
     for (std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
         //If maturityHeight is negative it's superseded and we skip it
@@ -116,6 +116,9 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
             "       n,                                   (numeric) the heights of blocks we're currently asking from this peer\n"
             "       ...\n"
             "    ],\n"
+            "    \"blockwindow\": n,                     (numeric) how many blocks may be in flight from this peer, sized from its delivery rate\n"
+            "    \"blockdelay\": n,                      (numeric) the average time in milliseconds this peer took to deliver a requested block\n"
+            "    \"blocksreassigned\": n,                (numeric) the blocks this peer was late with and that were requested from another peer\n"
             "    \"whitelisted\": true|false             (boolean) whether the peer is whitelisted\n"
             "  }\n"
             "  ,...\n"
@@ -169,6 +172,9 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
                 heights.push_back(height);
             }
             obj.pushKV("inflight", heights);
+            obj.pushKV("blockwindow", statestats.nBlocksInFlightWindow);
+            obj.pushKV("blockdelay", statestats.nBlockDelay / 1000);
+            obj.pushKV("blocksreassigned", statestats.nBlocksReassigned);
         }
         obj.pushKV("whitelisted", stats.fWhitelisted);
 
@@ -390,7 +396,15 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
             "{\n"
             "  \"totalbytesrecv\": n,   (numeric) total bytes received\n"
             "  \"totalbytessent\": n,   (numeric) total bytes sent\n"
-            "  \"timemillis\": t        (numeric) number of milliseconds since 1 Jan 1970 GMT\n"
+            "  \"timemillis\": t,       (numeric) number of milliseconds since 1 Jan 1970 GMT\n"
+            "  \"relay\": {             (json object) transaction and certificate relay\n"
+            "    \"relayed\": n,        (numeric) transactions and certificates relayed to the peers\n"
+            "    \"relayrate\": n.n,    (numeric) relayed per second, averaged over the last minute\n"
+            "    \"announced\": n,      (numeric) inventory entries queued for the peers\n"
+            "    \"served\": n,         (numeric) transactions and certificates sent on getdata\n"
+            "    \"servedbytes\": n,    (numeric) bytes of the transactions and certificates sent on getdata\n"
+            "    \"serialized\": n      (numeric) relay payloads serialized, each shared by all the peers\n"
+            "  }\n"
             "}\n"
             
             "\nExamples:\n"
@@ -402,6 +416,16 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
     obj.pushKV("totalbytesrecv", CNode::GetTotalBytesRecv());
     obj.pushKV("totalbytessent", CNode::GetTotalBytesSent());
     obj.pushKV("timemillis", GetTimeMillis());
+
+    CRelayStats relayStats = GetRelayStats();
+    UniValue relay(UniValue::VOBJ);
+    relay.pushKV("relayed", relayStats.nRelayed);
+    relay.pushKV("relayrate", relayStats.dRelayRate);
+    relay.pushKV("announced", relayStats.nAnnounced);
+    relay.pushKV("served", relayStats.nServed);
+    relay.pushKV("servedbytes", relayStats.nServedBytes);
+    relay.pushKV("serialized", relayStats.nSerialized);
+    obj.pushKV("relay", relay);
     return obj;
 }
 
@@ -49,8 +49,18 @@ UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const Un
 
 string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id)
 {
-    UniValue reply = JSONRPCReplyObj(result, error, id);
-    return reply.write() + "\n";
+    // Written as JSONRPCReplyObj() would be, without copying the result
+    string strReply = "{\"result\":";
+    if (!error.isNull())
+        NullUniValue.write(strReply);
+    else
+        result.write(strReply);
+    strReply += ",\"error\":";
+    error.write(strReply);
+    strReply += ",\"id\":";
+    id.write(strReply);
+    strReply += "}\n";
+    return strReply;
 }
 
 UniValue JSONRPCError(int code, const string& message)
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "base58.h"
+#include "chainsnapshot.h"
 #include "consensus/validation.h"
 #include "core_io.h"
 #include "init.h"
@@ -203,12 +204,12 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
 
     if (!hashBlock.IsNull()) {
         entry.pushKV("blockhash", hashBlock.GetHex());
-        BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
-        if (mi != mapBlockIndex.end() && (*mi).second) {
-            CBlockIndex* pindex = (*mi).second;
-            if (chainActive.Contains(pindex)) {
+        CBlockIndex* pindex = LookupBlockIndex(hashBlock);
+        if (pindex) {
+            std::shared_ptr<const CChainSnapshot> snapshot = GetChainSnapshot();
+            if (snapshot->Contains(pindex)) {
                 entry.pushKV("height", pindex->nHeight);
-                entry.pushKV("confirmations", 1 + chainActive.Height() - pindex->nHeight);
+                entry.pushKV("confirmations", 1 + snapshot->Height() - pindex->nHeight);
                 entry.pushKV("time", pindex->GetBlockTime());
                 entry.pushKV("blocktime", pindex->GetBlockTime());
             } else {
@@ -317,12 +318,12 @@ void CertToJSON(const CScCertificate& cert, const uint256 hashBlock, UniValue& e
 
     if (!hashBlock.IsNull()) {
         entry.pushKV("blockhash", hashBlock.GetHex());
-        BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
-        if (mi != mapBlockIndex.end() && (*mi).second) {
-            CBlockIndex* pindex = (*mi).second;
-            if (chainActive.Contains(pindex)) {
+        CBlockIndex* pindex = LookupBlockIndex(hashBlock);
+        if (pindex) {
+            std::shared_ptr<const CChainSnapshot> snapshot = GetChainSnapshot();
+            if (snapshot->Contains(pindex)) {
                 entry.pushKV("height", pindex->nHeight);
-                entry.pushKV("confirmations", 1 + chainActive.Height() - pindex->nHeight);
+                entry.pushKV("confirmations", 1 + snapshot->Height() - pindex->nHeight);
                 entry.pushKV("time", pindex->GetBlockTime());
                 entry.pushKV("blocktime", pindex->GetBlockTime());
             }
@@ -525,11 +526,8 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
     
     uint256 hashBlock{};
 
-    {
-        LOCK(cs_main);
-        if (!GetTxBaseObj(hash, pTxBase, hashBlock, true) || !pTxBase)
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available about transaction");
-    }
+    if (!GetTxBaseObj(hash, pTxBase, hashBlock, true) || !pTxBase)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available about transaction");
 
     std::string strHex = EncodeHex(pTxBase);
 
@@ -14,6 +14,7 @@
 #include "utilstrencodings.h"
 #include "asyncrpcqueue.h"
 
+#include <atomic>
 #include <memory>
 
 #include <univalue.h>
@@ -37,6 +38,12 @@ static std::string rpcWarmupStatus("RPC server started");
 static CCriticalSection cs_rpcWarmup;
 /* Timer-creating functions */
 static std::vector<RPCTimerInterface*> timerInterfaces;
+/* Limits of JSON-RPC batches */
+static unsigned int nRPCBatchMaxSize = DEFAULT_RPC_BATCH_MAX_SIZE;
+static int64_t nRPCBatchMethodBudget = DEFAULT_RPC_BATCH_METHOD_BUDGET * 1000000;
+/* Runs the concurrent requests of batches on other threads */
+static CCriticalSection cs_rpcBatchQueue;
+static RPCTaskQueue rpcBatchQueue;
 /* Map of name to timer.
  * @note Can be changed to std::unique_ptr when C++11 */
 static std::map<std::string, boost::shared_ptr<RPCTimerBase> > deadlineTimers;
@@ -281,196 +288,197 @@ UniValue stop(const UniValue& params, bool fHelp)
  * Call Table
  */
 static const CRPCCommand vRPCCommands[] =
-{ //  category              name                      actor (function)         okSafeMode
-  //  --------------------- ------------------------  -----------------------  ----------
+{ //  category              name                      actor (function)         okSafeMode concurrent
+  //  --------------------- ------------------------  -----------------------  ---------- ----------
     /* Overall control/query calls */
-    { "control",            "getinfo",                &getinfo,                true  }, /* uses wallet if enabled */
-    { "control",            "help",                   &help,                   true  },
-    { "control",            "stop",                   &stop,                   true  },
-    { "control",            "dbg_log",                &dbg_log,                true  },
-    { "control",            "dbg_do",                 &dbg_do,                 true  },
-    { "control",            "getscinfo",              &getscinfo,              true  },
-    { "control",            "getactivecertdatahash",  &getactivecertdatahash,  true  },
-    { "control",            "getceasingcumsccommtreehash", &getceasingcumsccommtreehash, true  },
-    { "control",            "getscgenesisinfo",       &getscgenesisinfo,       true  },
-    { "control",            "getproofverifierstats",  &getproofverifierstats,  true  },
-    { "control",            "setproofverifierlowpriorityguard",  &setproofverifierlowpriorityguard,  true  },
+    { "control",            "getinfo",                &getinfo,                true,  false }, /* uses wallet if enabled */
+    { "control",            "help",                   &help,                   true,  false },
+    { "control",            "stop",                   &stop,                   true,  false },
+    { "control",            "dbg_log",                &dbg_log,                true,  false },
+    { "control",            "dbg_do",                 &dbg_do,                 true,  false },
+    { "control",            "getscinfo",              &getscinfo,              true,  false },
+    { "control",            "getactivecertdatahash",  &getactivecertdatahash,  true,  false },
+    { "control",            "getceasingcumsccommtreehash", &getceasingcumsccommtreehash, true,  false },
+    { "control",            "getscgenesisinfo",       &getscgenesisinfo,       true,  false },
+    { "control",            "getproofverifierstats",  &getproofverifierstats,  true,  false },
+    { "control",            "setproofverifierlowpriorityguard",  &setproofverifierlowpriorityguard,  true,  false },
 
     /* P2P networking */
-    { "network",            "getnetworkinfo",         &getnetworkinfo,         true  },
-    { "network",            "addnode",                &addnode,                true  },
-    { "network",            "disconnectnode",         &disconnectnode,         true  },
-    { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true  },
-    { "network",            "getconnectioncount",     &getconnectioncount,     true  },
-    { "network",            "getnettotals",           &getnettotals,           true  },
-    { "network",            "getpeerinfo",            &getpeerinfo,            true  },
-    { "network",            "ping",                   &ping,                   true  },
-    { "network",            "setban",                 &setban,                 true  },
-    { "network",            "listbanned",             &listbanned,             true  },
-    { "network",            "clearbanned",            &clearbanned,            true  },
+    { "network",            "getnetworkinfo",         &getnetworkinfo,         true,  false },
+    { "network",            "addnode",                &addnode,                true,  false },
+    { "network",            "disconnectnode",         &disconnectnode,         true,  false },
+    { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true,  false },
+    { "network",            "getconnectioncount",     &getconnectioncount,     true,  false },
+    { "network",            "getnettotals",           &getnettotals,           true,  false },
+    { "network",            "getpeerinfo",            &getpeerinfo,            true,  false },
+    { "network",            "ping",                   &ping,                   true,  false },
+    { "network",            "setban",                 &setban,                 true,  false },
+    { "network",            "listbanned",             &listbanned,             true,  false },
+    { "network",            "clearbanned",            &clearbanned,            true,  false },
 
     /* Block chain and UTXO */
-    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
-    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
-    { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
-    { "blockchain",         "getblockexpanded",       &getblockexpanded,       true  },
+    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true,  true  },
+    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  true  },
+    { "blockchain",         "getblockcount",          &getblockcount,          true,  true  },
+    { "blockchain",         "getblock",               &getblock,               true,  true  },
+    { "blockchain",         "getblockexpanded",       &getblockexpanded,       true,  true  },
 
 #ifdef ENABLE_ADDRESS_INDEXING
-    { "blockchain",         "getblockdeltas",         &getblockdeltas,         false },
-    { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
-    { "blockchain",         "getspentinfo",           &getspentinfo,           false },
+    { "blockchain",         "getblockdeltas",         &getblockdeltas,         false, true  },
+    { "blockchain",         "getblockhashes",         &getblockhashes,         true,  true  },
+    { "blockchain",         "getspentinfo",           &getspentinfo,           false, true  },
 #endif // ENABLE_ADDRESS_INDEXING
 
-    { "blockchain",         "getblockhash",           &getblockhash,           true  },
-    { "blockchain",         "getblockfinalityindex",  &getblockfinalityindex,  true  },
-    { "blockchain",         "getglobaltips",          &getglobaltips,          true  },
-    { "blockchain",         "getblockheader",         &getblockheader,         true  },
-    { "blockchain",         "getchaintips",           &getchaintips,           true  },
-    { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
-    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
-    { "blockchain",         "gettxout",               &gettxout,               true  },
-    { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
-    { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
-    { "blockchain",         "verifychain",            &verifychain,            true  },
-    { "blockchain",         "checkcswnullifier",      &checkcswnullifier,      true  },
-    { "blockchain",         "getcertmaturityinfo",    &getcertmaturityinfo,    true  },
-    { "blockchain",         "clearmempool",           &clearmempool,           true  },
+    { "blockchain",         "getblockhash",           &getblockhash,           true,  true  },
+    { "blockchain",         "getblockfinalityindex",  &getblockfinalityindex,  true,  false },
+    { "blockchain",         "getglobaltips",          &getglobaltips,          true,  false },
+    { "blockchain",         "getblockheader",         &getblockheader,         true,  true  },
+    { "blockchain",         "getchaintips",           &getchaintips,           true,  true  },
+    { "blockchain",         "getdifficulty",          &getdifficulty,          true,  true  },
+    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  true  },
+    { "blockchain",         "getvalidationqueueinfo", &getvalidationqueueinfo, true,  false },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true,  true  },
+    { "blockchain",         "gettxout",               &gettxout,               true,  true  },
+    { "blockchain",         "gettxoutproof",          &gettxoutproof,          true,  true  },
+    { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true,  true  },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  false },
+    { "blockchain",         "verifychain",            &verifychain,            true,  false },
+    { "blockchain",         "checkcswnullifier",      &checkcswnullifier,      true,  false },
+    { "blockchain",         "getcertmaturityinfo",    &getcertmaturityinfo,    true,  false },
+    { "blockchain",         "clearmempool",           &clearmempool,           true,  false },
 
     /* Mining */
-    { "mining",             "getblocktemplate",       &getblocktemplate,       true  },
-    { "mining",             "getmininginfo",          &getmininginfo,          true  },
-    { "mining",             "getlocalsolps",          &getlocalsolps,          true  },
-    { "mining",             "getnetworksolps",        &getnetworksolps,        true  },
-    { "mining",             "getnetworkhashps",       &getnetworkhashps,       true  },
-    { "mining",             "prioritisetransaction",  &prioritisetransaction,  true  },
-    { "mining",             "submitblock",            &submitblock,            true  },
-    { "mining",             "getblocksubsidy",        &getblocksubsidy,        true  },
-    { "mining",             "getblockmerkleroots",    &getblockmerkleroots,    true  },
+    { "mining",             "getblocktemplate",       &getblocktemplate,       true,  false },
+    { "mining",             "getmininginfo",          &getmininginfo,          true,  false },
+    { "mining",             "getlocalsolps",          &getlocalsolps,          true,  false },
+    { "mining",             "getnetworksolps",        &getnetworksolps,        true,  false },
+    { "mining",             "getnetworkhashps",       &getnetworkhashps,       true,  false },
+    { "mining",             "prioritisetransaction",  &prioritisetransaction,  true,  false },
+    { "mining",             "submitblock",            &submitblock,            true,  false },
+    { "mining",             "getblocksubsidy",        &getblocksubsidy,        true,  false },
+    { "mining",             "getblockmerkleroots",    &getblockmerkleroots,    true,  false },
 
 
 #ifdef ENABLE_MINING
     /* Coin generation */
-    { "generating",         "getgenerate",            &getgenerate,            true  },
-    { "generating",         "setgenerate",            &setgenerate,            true  },
-    { "generating",         "generate",               &generate,               true  },
+    { "generating",         "getgenerate",            &getgenerate,            true,  false },
+    { "generating",         "setgenerate",            &setgenerate,            true,  false },
+    { "generating",         "generate",               &generate,               true,  false },
 #endif
 
     /* Raw transactions */
-    { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true  },
-    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
-    { "rawtransactions",    "createrawcertificate",   &createrawcertificate,   true  },
-    { "rawtransactions",    "decodescript",           &decodescript,           true  },
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
-    { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false },
-    { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false }, /* uses wallet if enabled */
+    { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true,  false },
+    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true,  true  },
+    { "rawtransactions",    "createrawcertificate",   &createrawcertificate,   true,  false },
+    { "rawtransactions",    "decodescript",           &decodescript,           true,  true  },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,  true  },
+    { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false, false },
+    { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false, false }, /* uses wallet if enabled */
 #ifdef ENABLE_WALLET
-    { "rawtransactions",    "fundrawtransaction",     &fundrawtransaction,     false },
+    { "rawtransactions",    "fundrawtransaction",     &fundrawtransaction,     false, false },
 #endif
 
 #ifdef ENABLE_ADDRESS_INDEXING
     /* Address index */
-    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true  },
-    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false },
-    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false },
-    { "addressindex",       "getaddresstxids",        &getaddresstxids,        false },
-    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false },
+    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true,  true  },
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false, true  },
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false, true  },
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        false, true  },
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false, true  },
 #endif // ENABLE_ADDRESS_INDEXING
 
     /* Utility functions */
-    { "util",               "createmultisig",         &createmultisig,         true  },
-    { "util",               "validateaddress",        &validateaddress,        true  }, /* uses wallet if enabled */
-    { "util",               "verifymessage",          &verifymessage,          true  },
-    { "util",               "estimatefee",            &estimatefee,            true  },
-    { "util",               "estimatepriority",       &estimatepriority,       true  },
-    { "util",               "z_validateaddress",      &z_validateaddress,      true  }, /* uses wallet if enabled */
+    { "util",               "createmultisig",         &createmultisig,         true,  false },
+    { "util",               "validateaddress",        &validateaddress,        true,  false }, /* uses wallet if enabled */
+    { "util",               "verifymessage",          &verifymessage,          true,  false },
+    { "util",               "estimatefee",            &estimatefee,            true,  false },
+    { "util",               "estimatepriority",       &estimatepriority,       true,  false },
+    { "util",               "z_validateaddress",      &z_validateaddress,      true,  false }, /* uses wallet if enabled */
 
     /* Not shown in help */
-    { "hidden",             "invalidateblock",        &invalidateblock,        true  },
-    { "hidden",             "reconsiderblock",        &reconsiderblock,        true  },
-    { "hidden",             "setmocktime",            &setmocktime,            true  },
+    { "hidden",             "invalidateblock",        &invalidateblock,        true,  false },
+    { "hidden",             "reconsiderblock",        &reconsiderblock,        true,  false },
+    { "hidden",             "setmocktime",            &setmocktime,            true,  false },
 #ifdef ENABLE_WALLET
-    { "hidden",             "resendwallettransactions", &resendwallettransactions, true},
+    { "hidden",             "resendwallettransactions", &resendwallettransactions, true, false },
 #endif
 
 #ifdef ENABLE_WALLET
     /* Wallet */
-    { "wallet",             "addmultisigaddress",     &addmultisigaddress,     true  },
-    { "wallet",             "backupwallet",           &backupwallet,           true  },
-    { "wallet",             "dumpprivkey",            &dumpprivkey,            true  },
-    { "wallet",             "dumpwallet",             &dumpwallet,             true  },
-    { "wallet",             "encryptwallet",          &encryptwallet,          true  },
-    { "wallet",             "getaccountaddress",      &getaccountaddress,      true  },
-    { "wallet",             "getaccount",             &getaccount,             true  },
-    { "wallet",             "getaddressesbyaccount",  &getaddressesbyaccount,  true  },
-    { "wallet",             "getbalance",             &getbalance,             false },
-    { "wallet",             "getnewaddress",          &getnewaddress,          true  },
-    { "wallet",             "getrawchangeaddress",    &getrawchangeaddress,    true  },
-    { "wallet",             "getreceivedbyaccount",   &getreceivedbyaccount,   false },
-    { "wallet",             "getreceivedbyaddress",   &getreceivedbyaddress,   false },
-    { "wallet",             "gettransaction",         &gettransaction,         false },
-    { "wallet",             "getunconfirmedbalance",  &getunconfirmedbalance,  false },
-    { "wallet",             "getwalletinfo",          &getwalletinfo,          false },
-    { "wallet",             "importprivkey",          &importprivkey,          true  },
-    { "wallet",             "importwallet",           &importwallet,           true  },
-    { "wallet",             "importaddress",          &importaddress,          true  },
-    { "wallet",             "keypoolrefill",          &keypoolrefill,          true  },
-    { "wallet",             "listaccounts",           &listaccounts,           false },
-    { "wallet",             "listaddressgroupings",   &listaddressgroupings,   false },
-    { "wallet",             "listlockunspent",        &listlockunspent,        false },
-    { "wallet",             "listreceivedbyaccount",  &listreceivedbyaccount,  false },
-    { "wallet",             "listreceivedbyaddress",  &listreceivedbyaddress,  false },
-    { "wallet",             "listsinceblock",         &listsinceblock,         false },
-    { "wallet",             "listtransactions",       &listtransactions,       false },
-    { "wallet",             "listtxesbyaddress",      &listtxesbyaddress,      false },
-    { "wallet",             "getunconfirmedtxdata",   &getunconfirmedtxdata,   false },
-    { "wallet",             "listunspent",            &listunspent,            false },
-    { "wallet",             "lockunspent",            &lockunspent,            true  },
-    { "wallet",             "move",                   &movecmd,                false },
-    { "wallet",             "sendfrom",               &sendfrom,               false },
-    { "wallet",             "sendmany",               &sendmany,               false },
-    { "wallet",             "sendtoaddress",          &sendtoaddress,          false },
-    { "wallet",             "setaccount",             &setaccount,             true  },
-    { "wallet",             "settxfee",               &settxfee,               true  },
-    { "wallet",             "signmessage",            &signmessage,            true  },
-    { "wallet",             "walletlock",             &walletlock,             true  },
-    { "wallet",             "walletpassphrasechange", &walletpassphrasechange, true  },
-    { "wallet",             "walletpassphrase",       &walletpassphrase,       true  },
-    { "wallet",             "zcbenchmark",            &zc_benchmark,           true  },
-    { "wallet",             "zcrawkeygen",            &zc_raw_keygen,          true  },
-    { "wallet",             "zcrawjoinsplit",         &zc_raw_joinsplit,       true  },
-    { "wallet",             "zcrawreceive",           &zc_raw_receive,         true  },
-    { "wallet",             "zcsamplejoinsplit",      &zc_sample_joinsplit,    true  },
-    { "wallet",             "z_listreceivedbyaddress",&z_listreceivedbyaddress,false },
-    { "wallet",             "z_listunspent",          &z_listunspent,          false },
-    { "wallet",             "z_getbalance",           &z_getbalance,           false },
-    { "wallet",             "z_gettotalbalance",      &z_gettotalbalance,      false },
-    { "wallet",             "z_mergetoaddress",       &z_mergetoaddress,       false },
-    { "wallet",             "z_sendmany",             &z_sendmany,             false },
-    { "wallet",             "z_shieldcoinbase",       &z_shieldcoinbase,       false },
-    { "wallet",             "z_getoperationstatus",   &z_getoperationstatus,   true  },
-    { "wallet",             "z_getoperationresult",   &z_getoperationresult,   true  },
-    { "wallet",             "z_listoperationids",     &z_listoperationids,     true  },
-    { "wallet",             "z_getnewaddress",        &z_getnewaddress,        true  },
-    { "wallet",             "z_listaddresses",        &z_listaddresses,        true  },
-    { "wallet",             "z_exportkey",            &z_exportkey,            true  },
-    { "wallet",             "z_importkey",            &z_importkey,            true  },
-    { "wallet",             "z_exportviewingkey",     &z_exportviewingkey,     true  },
-    { "wallet",             "z_importviewingkey",     &z_importviewingkey,     true  },
-    { "wallet",             "z_exportwallet",         &z_exportwallet,         true  },
-    { "wallet",             "z_importwallet",         &z_importwallet,         true  },
-    { "wallet",             "sc_send_certificate",    &sc_send_certificate,    false },
+    { "wallet",             "addmultisigaddress",     &addmultisigaddress,     true,  false },
+    { "wallet",             "backupwallet",           &backupwallet,           true,  false },
+    { "wallet",             "dumpprivkey",            &dumpprivkey,            true,  false },
+    { "wallet",             "dumpwallet",             &dumpwallet,             true,  false },
+    { "wallet",             "encryptwallet",          &encryptwallet,          true,  false },
+    { "wallet",             "getaccountaddress",      &getaccountaddress,      true,  false },
+    { "wallet",             "getaccount",             &getaccount,             true,  false },
+    { "wallet",             "getaddressesbyaccount",  &getaddressesbyaccount,  true,  false },
+    { "wallet",             "getbalance",             &getbalance,             false, false },
+    { "wallet",             "getnewaddress",          &getnewaddress,          true,  false },
+    { "wallet",             "getrawchangeaddress",    &getrawchangeaddress,    true,  false },
+    { "wallet",             "getreceivedbyaccount",   &getreceivedbyaccount,   false, false },
+    { "wallet",             "getreceivedbyaddress",   &getreceivedbyaddress,   false, false },
+    { "wallet",             "gettransaction",         &gettransaction,         false, false },
+    { "wallet",             "getunconfirmedbalance",  &getunconfirmedbalance,  false, false },
+    { "wallet",             "getwalletinfo",          &getwalletinfo,          false, false },
+    { "wallet",             "importprivkey",          &importprivkey,          true,  false },
+    { "wallet",             "importwallet",           &importwallet,           true,  false },
+    { "wallet",             "importaddress",          &importaddress,          true,  false },
+    { "wallet",             "keypoolrefill",          &keypoolrefill,          true,  false },
+    { "wallet",             "listaccounts",           &listaccounts,           false, false },
+    { "wallet",             "listaddressgroupings",   &listaddressgroupings,   false, false },
+    { "wallet",             "listlockunspent",        &listlockunspent,        false, false },
+    { "wallet",             "listreceivedbyaccount",  &listreceivedbyaccount,  false, false },
+    { "wallet",             "listreceivedbyaddress",  &listreceivedbyaddress,  false, false },
+    { "wallet",             "listsinceblock",         &listsinceblock,         false, false },
+    { "wallet",             "listtransactions",       &listtransactions,       false, false },
+    { "wallet",             "listtxesbyaddress",      &listtxesbyaddress,      false, false },
+    { "wallet",             "getunconfirmedtxdata",   &getunconfirmedtxdata,   false, false },
+    { "wallet",             "listunspent",            &listunspent,            false, false },
+    { "wallet",             "lockunspent",            &lockunspent,            true,  false },
+    { "wallet",             "move",                   &movecmd,                false, false },
+    { "wallet",             "sendfrom",               &sendfrom,               false, false },
+    { "wallet",             "sendmany",               &sendmany,               false, false },
+    { "wallet",             "sendtoaddress",          &sendtoaddress,          false, false },
+    { "wallet",             "setaccount",             &setaccount,             true,  false },
+    { "wallet",             "settxfee",               &settxfee,               true,  false },
+    { "wallet",             "signmessage",            &signmessage,            true,  false },
+    { "wallet",             "walletlock",             &walletlock,             true,  false },
+    { "wallet",             "walletpassphrasechange", &walletpassphrasechange, true,  false },
+    { "wallet",             "walletpassphrase",       &walletpassphrase,       true,  false },
+    { "wallet",             "zcbenchmark",            &zc_benchmark,           true,  false },
+    { "wallet",             "zcrawkeygen",            &zc_raw_keygen,          true,  false },
+    { "wallet",             "zcrawjoinsplit",         &zc_raw_joinsplit,       true,  false },
+    { "wallet",             "zcrawreceive",           &zc_raw_receive,         true,  false },
+    { "wallet",             "zcsamplejoinsplit",      &zc_sample_joinsplit,    true,  false },
+    { "wallet",             "z_listreceivedbyaddress",&z_listreceivedbyaddress,false, false },
+    { "wallet",             "z_listunspent",          &z_listunspent,          false, false },
+    { "wallet",             "z_getbalance",           &z_getbalance,           false, false },
+    { "wallet",             "z_gettotalbalance",      &z_gettotalbalance,      false, false },
+    { "wallet",             "z_mergetoaddress",       &z_mergetoaddress,       false, false },
+    { "wallet",             "z_sendmany",             &z_sendmany,             false, false },
+    { "wallet",             "z_shieldcoinbase",       &z_shieldcoinbase,       false, false },
+    { "wallet",             "z_getoperationstatus",   &z_getoperationstatus,   true,  false },
+    { "wallet",             "z_getoperationresult",   &z_getoperationresult,   true,  false },
+    { "wallet",             "z_listoperationids",     &z_listoperationids,     true,  false },
+    { "wallet",             "z_getnewaddress",        &z_getnewaddress,        true,  false },
+    { "wallet",             "z_listaddresses",        &z_listaddresses,        true,  false },
+    { "wallet",             "z_exportkey",            &z_exportkey,            true,  false },
+    { "wallet",             "z_importkey",            &z_importkey,            true,  false },
+    { "wallet",             "z_exportviewingkey",     &z_exportviewingkey,     true,  false },
+    { "wallet",             "z_importviewingkey",     &z_importviewingkey,     true,  false },
+    { "wallet",             "z_exportwallet",         &z_exportwallet,         true,  false },
+    { "wallet",             "z_importwallet",         &z_importwallet,         true,  false },
+    { "wallet",             "sc_send_certificate",    &sc_send_certificate,    false, false },
     // useful for sbh wallet
-    { "wallet",             "sc_create",              &sc_create,              false },
-    { "wallet",             "sc_send",                &sc_send,                false },
-    { "wallet",             "sc_request_transfer",    &sc_request_transfer,    false },
+    { "wallet",             "sc_create",              &sc_create,              false, false },
+    { "wallet",             "sc_send",                &sc_send,                false, false },
+    { "wallet",             "sc_request_transfer",    &sc_request_transfer,    false, false },
 
     // TODO: rearrange into another category 
-    { "disclosure",         "z_getpaymentdisclosure", &z_getpaymentdisclosure, true  }, 
-    { "disclosure",         "z_validatepaymentdisclosure", &z_validatepaymentdisclosure, true },
-    { "wallet",             "listaddresses",          &listaddresses,          true  }
+    { "disclosure",         "z_getpaymentdisclosure", &z_getpaymentdisclosure, true,  false }, 
+    { "disclosure",         "z_validatepaymentdisclosure", &z_validatepaymentdisclosure, true,  false },
+    { "wallet",             "listaddresses",          &listaddresses,          true,  false }
 #endif // ENABLE_WALLET
 };
 
@@ -500,6 +508,9 @@ bool StartRPC()
     fRPCRunning = true;
     g_rpcSignals.Started();
 
+    nRPCBatchMaxSize = std::max(GetArg("-rpcbatchmaxsize", DEFAULT_RPC_BATCH_MAX_SIZE), (int64_t)0);
+    nRPCBatchMethodBudget = std::max(GetArg("-rpcbatchmethodbudget", DEFAULT_RPC_BATCH_METHOD_BUDGET), (int64_t)0) * 1000000;
+
     // Launch one async rpc worker.  The ability to launch multiple workers is not recommended at present and thus the option is disabled.
     getAsyncRPCQueue()->addWorker();
 /*
@@ -571,8 +582,14 @@ void JSONRequest::parse(const UniValue& valRequest)
     // Parse id now so errors from here on will have the id
     id = find_value(request, "id");
 
-    // Parse method
     UniValue valMethod = find_value(request, "method");
+    UniValue valParams = find_value(request, "params");
+    parseMembers(valMethod, valParams);
+}
+
+void JSONRequest::parseMembers(UniValue& valMethod, UniValue& valParams)
+{
+    // Parse method
     if (valMethod.isNull())
         throw JSONRPCError(RPC_INVALID_REQUEST, "Missing method");
     if (!valMethod.isStr())
@@ -582,24 +599,173 @@ void JSONRequest::parse(const UniValue& valRequest)
     LogPrint("rpc", "ThreadRPCServer method=%s\n", SanitizeString(strMethod));
 
     // Parse params
-    UniValue valParams = find_value(request, "params");
     if (valParams.isArray())
-        params = valParams.get_array();
+        std::swap(params, valParams);
     else if (valParams.isNull())
         params = UniValue(UniValue::VARR);
     else
         throw JSONRPCError(RPC_INVALID_REQUEST, "Params must be an array");
 }
 
-static UniValue JSONRPCExecOne(const UniValue& req)
+namespace {
+
+/**
+ * Reads the members of a single request as they are parsed: the values of
+ * "id", "method" and "params" are built on their own and the other members
+ * are dropped. Anything but an object is built whole, for a batch.
+ */
+class JSONRequestReader : public UniValueHandler
+{
+public:
+    UniValue valId;
+    UniValue valMethod;
+    UniValue valParams;
+    UniValue valOther;
+    bool fObject;
+
+    JSONRequestReader() : fObject(false), nDepth(0), fId(false), fMethod(false), fParams(false) {}
+
+    bool onNull() { return value().onNull() && done(); }
+    bool onBool(bool val) { return value().onBool(val) && done(); }
+    bool onNumber(std::string& val) { return value().onNumber(val) && done(); }
+    bool onString(std::string& val) { return value().onString(val) && done(); }
+
+    bool onKey(std::string& key)
+    {
+        if (!fObject || nDepth > 1)
+            return value().onKey(key);
+
+        // As with find_value(), only the first member of a name counts
+        UniValue* pval = &valDropped;
+        if (key == "id" && !fId) {
+            pval = &valId;
+            fId = true;
+        } else if (key == "method" && !fMethod) {
+            pval = &valMethod;
+            fMethod = true;
+        } else if (key == "params" && !fParams) {
+            pval = &valParams;
+            fParams = true;
+        }
+        member.reset(new UniValueBuilder(*pval));
+        return true;
+    }
+
+    bool onObjectStart()
+    {
+        if (nDepth++ == 0 && !member) {
+            fObject = true;
+            return true;
+        }
+        return value().onObjectStart();
+    }
+
+    bool onObjectEnd()
+    {
+        if (--nDepth == 0 && fObject)
+            return true;
+        return value().onObjectEnd() && done();
+    }
+
+    bool onArrayStart() { nDepth++; return value().onArrayStart(); }
+    bool onArrayEnd() { nDepth--; return value().onArrayEnd() && done(); }
+
+private:
+    int nDepth;
+    bool fId;
+    bool fMethod;
+    bool fParams;
+    UniValue valDropped;
+    std::unique_ptr<UniValueBuilder> member;
+    std::unique_ptr<UniValueBuilder> other;
+
+    //! Builder of the value being read
+    UniValueHandler& value()
+    {
+        if (member)
+            return *member;
+        if (!other)
+            other.reset(new UniValueBuilder(valOther));
+        return *other;
+    }
+
+    //! Close the member whose value was read completely
+    bool done()
+    {
+        if (member && member->complete())
+            member.reset();
+        return true;
+    }
+};
+
+} // anon namespace
+
+bool JSONRequest::read(const std::string& strRequest, UniValue& valBatch)
+{
+    JSONRequestReader reader;
+    if (!parseJson(strRequest.data(), strRequest.size(), reader))
+        return false;
+
+    valBatch.setNull();
+    if (!reader.fObject) {
+        if (!reader.valOther.isArray())
+            throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
+        std::swap(valBatch, reader.valOther);
+        return true;
+    }
+
+    // Parse id now so errors from here on will have the id
+    std::swap(id, reader.valId);
+    parseMembers(reader.valMethod, reader.valParams);
+    return true;
+}
+
+/**
+ * Time spent by a batch in each of its methods, so that a single batch
+ * can't hold the server with many slow calls of the same method.
+ */
+class CRPCBatchBudget
+{
+private:
+    boost::mutex mutex;
+    std::map<std::string, int64_t> mapSpent;
+
+public:
+    bool IsExhausted(const std::string& strMethod)
+    {
+        if (nRPCBatchMethodBudget <= 0)
+            return false;
+        boost::unique_lock<boost::mutex> lock(mutex);
+        std::map<std::string, int64_t>::const_iterator it = mapSpent.find(strMethod);
+        return it != mapSpent.end() && it->second >= nRPCBatchMethodBudget;
+    }
+
+    void Spend(const std::string& strMethod, int64_t nMicros)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        mapSpent[strMethod] += nMicros;
+    }
+};
+
+static UniValue JSONRPCExecOne(const UniValue& req, CRPCBatchBudget& budget)
 {
     UniValue rpc_result(UniValue::VOBJ);
 
     JSONRequest jreq;
     try {
         jreq.parse(req);
-
-        UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
+        if (budget.IsExhausted(jreq.strMethod))
+            throw JSONRPCError(RPC_MISC_ERROR, strprintf("Batch exceeded the time budget of method %s", jreq.strMethod));
+
+        UniValue result;
+        const int64_t nTimeStart = GetTimeMicros();
+        try {
+            result = tableRPC.execute(jreq.strMethod, jreq.params);
+        } catch (...) {
+            budget.Spend(jreq.strMethod, GetTimeMicros() - nTimeStart);
+            throw;
+        }
+        budget.Spend(jreq.strMethod, GetTimeMicros() - nTimeStart);
         rpc_result = JSONRPCReplyObj(result, NullUniValue, jreq.id);
     }
     catch (const UniValue& objError)
@@ -615,11 +781,100 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
+static bool IsConcurrentRequest(const UniValue& req)
+{
+    if (!req.isObject())
+        return false;
+    const UniValue& valMethod = find_value(req, "method");
+    if (!valMethod.isStr())
+        return false;
+    const CRPCCommand *pcmd = tableRPC[valMethod.get_str()];
+    return pcmd && pcmd->fConcurrent;
+}
+
+/**
+ * A run of consecutive concurrent requests of a batch. The calling thread
+ * and the helpers queued on the RPC server take requests from it until none
+ * is left, each result is stored at the position of its request.
+ * Helpers only touch the batch after taking a request, so the ones starting
+ * after the run is over return without accessing it.
+ */
+class CRPCBatchRun
+{
+private:
+    const UniValue& vReq;
+    std::vector<UniValue>& vResults;
+    CRPCBatchBudget& budget;
+    const size_t nEnd;
+    std::atomic<size_t> nNext;
+
+    boost::mutex mutex;
+    boost::condition_variable condDone;
+    size_t nTodo;
+
+public:
+    CRPCBatchRun(const UniValue& vReqIn, std::vector<UniValue>& vResultsIn, CRPCBatchBudget& budgetIn, size_t nBegin, size_t nEndIn):
+        vReq(vReqIn), vResults(vResultsIn), budget(budgetIn), nEnd(nEndIn), nNext(nBegin), nTodo(nEndIn - nBegin)
+    {
+    }
+
+    void Work()
+    {
+        for (size_t nIdx = nNext++; nIdx < nEnd; nIdx = nNext++) {
+            vResults[nIdx] = JSONRPCExecOne(vReq[nIdx], budget);
+
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (--nTodo == 0)
+                condDone.notify_all();
+        }
+    }
+
+    void Wait()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (nTodo > 0)
+            condDone.wait(lock);
+    }
+};
+
 std::string JSONRPCExecBatch(const UniValue& vReq)
 {
+    if (nRPCBatchMaxSize > 0 && vReq.size() > nRPCBatchMaxSize)
+        throw JSONRPCError(RPC_INVALID_REQUEST, strprintf("Batch of %u requests exceeds the limit of %u", vReq.size(), nRPCBatchMaxSize));
+
+    RPCTaskQueue queue;
+    {
+        LOCK(cs_rpcBatchQueue);
+        queue = rpcBatchQueue;
+    }
+
+    CRPCBatchBudget budget;
+    std::vector<UniValue> vResults(vReq.size());
+    for (size_t reqIdx = 0; reqIdx < vReq.size(); ) {
+        size_t reqEnd = reqIdx;
+        while (reqEnd < vReq.size() && IsConcurrentRequest(vReq[reqEnd]))
+            reqEnd++;
+
+        if (reqEnd - reqIdx < 2 || queue.empty()) {
+            // Other requests may change state, run them in order on this thread
+            reqEnd = std::max(reqEnd, reqIdx + 1);
+            for (; reqIdx < reqEnd; reqIdx++)
+                vResults[reqIdx] = JSONRPCExecOne(vReq[reqIdx], budget);
+            continue;
+        }
+
+        boost::shared_ptr<CRPCBatchRun> run(new CRPCBatchRun(vReq, vResults, budget, reqIdx, reqEnd));
+        for (size_t nHelpers = 1; nHelpers < reqEnd - reqIdx; nHelpers++)
+            if (!queue(boost::bind(&CRPCBatchRun::Work, run)))
+                break;
+        run->Work();
+        run->Wait();
+        reqIdx = reqEnd;
+    }
+
     UniValue ret(UniValue::VARR);
-    for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    for (size_t reqIdx = 0; reqIdx < vResults.size(); reqIdx++)
+        ret.push_back(vResults[reqIdx]);
 
     return ret.write() + "\n";
 }
@@ -676,6 +931,12 @@ void RPCUnregisterTimerInterface(RPCTimerInterface *iface)
     timerInterfaces.erase(i);
 }
 
+void RPCSetBatchQueue(const RPCTaskQueue& queue)
+{
+    LOCK(cs_rpcBatchQueue);
+    rpcBatchQueue = queue;
+}
+
 void RPCRunLater(const std::string& name, boost::function<void(void)> func, int64_t nSeconds)
 {
     if (timerInterfaces.empty())
@@ -43,6 +43,16 @@ public:
 
     JSONRequest() { id = NullUniValue; }
     void parse(const UniValue& valRequest);
+    /**
+     * Parse a request body. A single request is parsed straight into this
+     * object, without a UniValue being built for the whole of it; a batch
+     * is returned in valBatch, left null otherwise. Returns false if the
+     * body is not valid JSON.
+     */
+    bool read(const std::string& strRequest, UniValue& valBatch);
+
+private:
+    void parseMembers(UniValue& valMethod, UniValue& valParams);
 };
 
 /** Query whether RPC is running */
@@ -117,6 +127,20 @@ void RPCUnregisterTimerInterface(RPCTimerInterface *iface);
  */
 void RPCRunLater(const std::string& name, boost::function<void(void)> func, int64_t nSeconds);
 
+/** Default and maximum number of requests in a JSON-RPC batch, 0 = unlimited */
+static const unsigned int DEFAULT_RPC_BATCH_MAX_SIZE = 1000;
+/** Default time (in seconds) a batch may spend in any one method, 0 = unlimited */
+static const int64_t DEFAULT_RPC_BATCH_METHOD_BUDGET = 30;
+
+/**
+ * Queues func on a thread of the RPC server, returning false if it could not
+ * be queued. Used to run the concurrent calls of a batch in parallel.
+ */
+typedef boost::function<bool(const boost::function<void(void)>& func)> RPCTaskQueue;
+
+/** Register the queue running batch calls, an empty queue runs them on the calling thread */
+void RPCSetBatchQueue(const RPCTaskQueue& queue);
+
 typedef UniValue(*rpcfn_type)(const UniValue& params, bool fHelp);
 
 class CRPCCommand
@@ -126,6 +150,8 @@ public:
     std::string name;
     rpcfn_type actor;
     bool okSafeMode;
+    /** Read-only call that can run alongside the other calls of a batch */
+    bool fConcurrent;
 };
 
 /**
@@ -274,6 +300,7 @@ extern UniValue getbestblockhash(const UniValue& params, bool fHelp);
 extern UniValue getdifficulty(const UniValue& params, bool fHelp);
 extern UniValue settxfee(const UniValue& params, bool fHelp);
 extern UniValue getmempoolinfo(const UniValue& params, bool fHelp);
+extern UniValue getvalidationqueueinfo(const UniValue& params, bool fHelp);
 extern UniValue getrawmempool(const UniValue& params, bool fHelp);
 
 #ifdef ENABLE_ADDRESS_INDEXING
@@ -0,0 +1,135 @@
+#include "sc/cswnullifiers.h"
+
+#include "memusage.h"
+#include "random.h"
+
+#include <algorithm>
+#include <limits>
+
+//! Smallest table allocated, and the largest fraction of slots in use
+static const size_t MIN_CSW_NULLIFIER_SLOTS = 8;
+static const size_t MAX_CSW_NULLIFIER_LOAD_PERCENT = 50;
+
+size_t CCswNullifierTxMap::homeSlot(const uint256& nullifier) const
+{
+    // Nullifiers are chosen by whoever builds the CSW, so slots are salted
+    static const uint256 salt = GetRandHash();
+    return nullifier.GetHash(salt) & (slots.size() - 1);
+}
+
+size_t CCswNullifierTxMap::findSlot(const uint256& nullifier) const
+{
+    size_t slot = homeSlot(nullifier);
+    while (used[slot] && slots[slot].nullifier != nullifier)
+        slot = (slot + 1) & (slots.size() - 1);
+    return slot;
+}
+
+void CCswNullifierTxMap::resize(size_t nSlots)
+{
+    std::vector<Entry> oldSlots(nSlots);
+    std::vector<unsigned char> oldUsed(nSlots, 0);
+    oldSlots.swap(slots);
+    oldUsed.swap(used);
+
+    for (size_t i = 0; i < oldSlots.size(); i++) {
+        if (!oldUsed[i])
+            continue;
+        size_t slot = findSlot(oldSlots[i].nullifier);
+        slots[slot] = oldSlots[i];
+        used[slot] = 1;
+    }
+}
+
+void CCswNullifierTxMap::set(const uint256& nullifier, const uint256& txHash)
+{
+    if ((nEntries + 1) * 100 > slots.size() * MAX_CSW_NULLIFIER_LOAD_PERCENT)
+        resize(std::max(MIN_CSW_NULLIFIER_SLOTS, slots.size() * 2));
+
+    size_t slot = findSlot(nullifier);
+    if (!used[slot]) {
+        slots[slot].nullifier = nullifier;
+        used[slot] = 1;
+        nEntries++;
+    }
+    slots[slot].txHash = txHash;
+}
+
+bool CCswNullifierTxMap::erase(const uint256& nullifier)
+{
+    if (nEntries == 0)
+        return false;
+
+    size_t hole = findSlot(nullifier);
+    if (!used[hole])
+        return false;
+    used[hole] = 0;
+    nEntries--;
+
+    // Shift back the entries following the hole whose probe sequence crosses
+    // it, so that no lookup stops at the hole before reaching them
+    const size_t mask = slots.size() - 1;
+    for (size_t slot = (hole + 1) & mask; used[slot]; slot = (slot + 1) & mask) {
+        size_t home = homeSlot(slots[slot].nullifier);
+        bool fReachable = (hole <= slot) ? (hole < home && home <= slot) : (hole < home || home <= slot);
+        if (fReachable)
+            continue;
+        slots[hole] = slots[slot];
+        used[hole] = 1;
+        used[slot] = 0;
+        hole = slot;
+    }
+
+    if (nEntries == 0) {
+        slots.clear();
+        used.clear();
+    }
+    return true;
+}
+
+const uint256* CCswNullifierTxMap::find(const uint256& nullifier) const
+{
+    if (nEntries == 0)
+        return nullptr;
+    size_t slot = findSlot(nullifier);
+    return used[slot] ? &slots[slot].txHash : nullptr;
+}
+
+size_t CCswNullifierTxMap::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(slots) + memusage::DynamicUsage(used);
+}
+
+//! False positive rate of the db nullifiers filter, and the least it is sized for
+static const double CSW_NULLIFIER_FILTER_FP_RATE = 0.001;
+static const size_t MIN_CSW_NULLIFIER_FILTER_ELEMENTS = 1024;
+
+static std::vector<unsigned char> CswNullifierFilterKey(const uint256& scId, const uint256& nullifier)
+{
+    std::vector<unsigned char> key(scId.begin(), scId.end());
+    key.insert(key.end(), nullifier.begin(), nullifier.end());
+    return key;
+}
+
+CCswNullifierFilter::CCswNullifierFilter() : fReset(false), nCapacity(0), nInserted(0) {}
+
+void CCswNullifierFilter::Reset(size_t nExpected)
+{
+    nCapacity = std::max(MIN_CSW_NULLIFIER_FILTER_ELEMENTS, nExpected * 2);
+    nCapacity = std::min<size_t>(nCapacity, std::numeric_limits<unsigned int>::max());
+    filter = CBloomFilter(nCapacity, CSW_NULLIFIER_FILTER_FP_RATE,
+                          GetRand(std::numeric_limits<unsigned int>::max()), BLOOM_UPDATE_NONE);
+    nInserted = 0;
+    fReset = true;
+}
+
+void CCswNullifierFilter::Insert(const uint256& scId, const uint256& nullifier)
+{
+    filter.insert(CswNullifierFilterKey(scId, nullifier));
+    nInserted++;
+}
+
+bool CCswNullifierFilter::MayContain(const uint256& scId, const uint256& nullifier) const
+{
+    return filter.contains(CswNullifierFilterKey(scId, nullifier));
+}
@@ -0,0 +1,113 @@
+#ifndef _SC_CSW_NULLIFIERS_H
+#define _SC_CSW_NULLIFIERS_H
+
+#include "bloom.h"
+#include "sc/sidechaintypes.h"
+#include "uint256.h"
+
+#include <assert.h>
+#include <string.h>
+#include <vector>
+
+/** Raw encoding of a CSW nullifier, which is what nullifiers are indexed by */
+inline uint256 CswNullifierKey(const CFieldElement& nullifier)
+{
+    // nullifiers are already checked by the caller, but let's assert it too
+    assert(nullifier.GetByteArray().size() == CFieldElement::ByteSize());
+    static_assert(CFieldElement::ByteSize() == sizeof(uint256), "CSW nullifier key must hold a whole field element");
+
+    uint256 key;
+    memcpy(key.begin(), &nullifier.GetByteArray()[0], CFieldElement::ByteSize());
+    return key;
+}
+
+/**
+ * CSW nullifiers used by the mempool txes of one sidechain, mapped to the tx
+ * using each of them.
+ *
+ * The entries live in a flat open-addressing table keyed by the raw nullifier
+ * encoding, so that a lookup hashes 32 bytes and scans a few adjacent slots,
+ * without allocating, chasing tree nodes or locking field elements.
+ */
+class CCswNullifierTxMap
+{
+public:
+    struct Entry
+    {
+        uint256 nullifier;
+        uint256 txHash;
+    };
+
+    class const_iterator
+    {
+    public:
+        const_iterator(const CCswNullifierTxMap* mapIn, size_t slotIn) : map(mapIn), slot(slotIn) { skipEmpty(); }
+
+        const Entry& operator*() const { return map->slots[slot]; }
+        const Entry* operator->() const { return &map->slots[slot]; }
+        const_iterator& operator++() { ++slot; skipEmpty(); return *this; }
+        bool operator==(const const_iterator& rhs) const { return slot == rhs.slot; }
+        bool operator!=(const const_iterator& rhs) const { return slot != rhs.slot; }
+
+    private:
+        const CCswNullifierTxMap* map;
+        size_t slot;
+
+        void skipEmpty() { while (slot < map->used.size() && !map->used[slot]) ++slot; }
+    };
+
+    //! Map nullifier to txHash, replacing the tx it was mapped to if any
+    void set(const uint256& nullifier, const uint256& txHash);
+    //! Returns false if nullifier was not mapped
+    bool erase(const uint256& nullifier);
+    //! Tx using nullifier, NULL if none
+    const uint256* find(const uint256& nullifier) const;
+    bool count(const uint256& nullifier) const { return find(nullifier) != nullptr; }
+
+    size_t size() const { return nEntries; }
+    bool empty() const { return nEntries == 0; }
+    size_t DynamicMemoryUsage() const;
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, used.size()); }
+
+private:
+    std::vector<Entry> slots;
+    std::vector<unsigned char> used;
+    size_t nEntries = 0;
+
+    size_t homeSlot(const uint256& nullifier) const;
+    //! Slot holding nullifier, or the empty slot ending its probe sequence
+    size_t findSlot(const uint256& nullifier) const;
+    void resize(size_t nSlots);
+};
+
+/**
+ * Probabilistic set of the CSW nullifiers stored in the chainstate db.
+ *
+ * Nullifiers looked up while validating CSW inputs are almost always new, so
+ * the db is only asked about the ones the filter may contain. Nullifiers
+ * erased from the db stay in the filter until it is rebuilt, which only costs
+ * a db lookup when they are asked about again.
+ */
+class CCswNullifierFilter
+{
+public:
+    CCswNullifierFilter();
+
+    //! Start over, empty, with room for at least nExpected nullifiers
+    void Reset(size_t nExpected);
+    //! False until Reset, and once more nullifiers were inserted than the filter was sized for
+    bool IsUsable() const { return fReset && nInserted <= nCapacity; }
+
+    void Insert(const uint256& scId, const uint256& nullifier);
+    bool MayContain(const uint256& scId, const uint256& nullifier) const;
+
+private:
+    CBloomFilter filter;
+    bool fReset;
+    size_t nCapacity;
+    size_t nInserted;
+};
+
+#endif // _SC_CSW_NULLIFIERS_H
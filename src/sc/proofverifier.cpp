@@ -1,11 +1,40 @@
 #include "sc/proofverifier.h"
 
+#include "checkqueue.h"
 #include "coins.h"
 #include "main.h"
 #include "primitives/certificate.h"
+#include "util.h"
 
 std::atomic<uint32_t> CScProofVerifier::proofIdCounter(0);
 
+/**
+ * Each check verifies the proof(s) of a whole certificate or transaction,
+ * which takes long enough for a batch to be a single check.
+ */
+static CCheckQueue<CScProofCheck> proofcheckqueue(1, MAX_SCRIPTCHECK_THREADS);
+
+/** Held by the thread running checks on the queue, its only master */
+static CCriticalSection cs_proofCheckQueue;
+
+bool CScProofCheck::operator()()
+{
+    verifier->NormalVerifyItem(*item);
+    return true;
+}
+
+void CScProofCheck::swap(CScProofCheck& check)
+{
+    std::swap(verifier, check.verifier);
+    std::swap(item, check.item);
+}
+
+void ThreadScProofCheck()
+{
+    RenameThread("horizen-proofch");
+    proofcheckqueue.Thread();
+}
+
 /**
  * @brief Converts a ProofVerificationResult enum to string.
  *
@@ -421,23 +450,49 @@ bool CScProofVerifier::BatchVerifyInternal(std::map</* Cert or Tx hash */ uint25
  */
 void CScProofVerifier::NormalVerify(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs)
 {
-    for (auto& proof : proofs)
+    if (nScriptCheckThreads == 0 || proofs.size() < 2)
     {
-        CProofVerifierItem& item = proof.second;
-
-        if (item.proofInput.type() == typeid(std::vector<CCswProofVerifierInput>))
-        {
-            item.result = NormalVerifyCsw(boost::get<std::vector<CCswProofVerifierInput>>(item.proofInput));
-        }
-        else if (item.proofInput.type() == typeid(CCertProofVerifierInput))
-        {
-            item.result = NormalVerifyCertificate(boost::get<CCertProofVerifierInput>(item.proofInput));
-        }
-        else
+        for (auto& proof : proofs)
         {
-            // It should never happen that the proof entry is neither a certificate nor a CSW input.
-            assert(false);
+            NormalVerifyItem(proof.second);
         }
+        return;
+    }
+
+    // The items are independent, spread them over the proof check threads.
+    std::vector<CScProofCheck> vChecks;
+    vChecks.reserve(proofs.size());
+    for (auto& proof : proofs)
+    {
+        vChecks.emplace_back(*this, proof.second);
+    }
+
+    LOCK(cs_proofCheckQueue);
+    CCheckQueueControl<CScProofCheck> control(&proofcheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
+/**
+ * @brief Runs the normal verification for the proof(s) of a single item,
+ * storing the result in the item.
+ * 
+ * @param item The item to be verified.
+ */
+void CScProofVerifier::NormalVerifyItem(CProofVerifierItem& item) const
+{
+    if (item.proofInput.type() == typeid(std::vector<CCswProofVerifierInput>))
+    {
+        item.result = NormalVerifyCsw(boost::get<std::vector<CCswProofVerifierInput>>(item.proofInput));
+    }
+    else if (item.proofInput.type() == typeid(CCertProofVerifierInput))
+    {
+        item.result = NormalVerifyCertificate(boost::get<CCertProofVerifierInput>(item.proofInput));
+    }
+    else
+    {
+        // It should never happen that the proof entry is neither a certificate nor a CSW input.
+        assert(false);
     }
 }
 
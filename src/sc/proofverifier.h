@@ -14,6 +14,7 @@ class CSidechain;
 class CScCertificate;
 class uint256;
 class CCoinsViewCache;
+class CScProofVerifier;
 
 /**
  * The enumeration of possible results of the proof verifier for any proof processed.
@@ -78,6 +79,29 @@ struct CProofVerifierItem
     boost::variant<CCertProofVerifierInput, std::vector<CCswProofVerifierInput>> proofInput;        /**< The proof input data, it can be a (single) certificate input or a list of CSW inputs. */
 };
 
+/**
+ * @brief A check, run by a CCheckQueue, verifying the proof(s) of a single item of the proof verifier.
+ * The result is stored in the item itself, a failing proof does not stop the verification of the other items.
+ */
+class CScProofCheck
+{
+private:
+    const CScProofVerifier* verifier;
+    CProofVerifierItem* item;
+
+public:
+    CScProofCheck() : verifier(nullptr), item(nullptr) {}
+    CScProofCheck(const CScProofVerifier& verifierIn, CProofVerifierItem& itemIn) : verifier(&verifierIn), item(&itemIn) {}
+
+    bool operator()();
+    void swap(CScProofCheck& check);
+};
+
+/**
+ * @brief The body of the threads running the proof checks of the normal (not batched) verification.
+ */
+void ThreadScProofCheck();
+
 /* A verifier that is able to verify different kind of ScProof(s) */
 class CScProofVerifier
 {
@@ -125,11 +149,14 @@ protected:
     void NormalVerify(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs);
     ProofVerificationResult NormalVerifyCertificate(CCertProofVerifierInput input) const;
     ProofVerificationResult NormalVerifyCsw(std::vector<CCswProofVerifierInput> cswInputs) const;
+    void NormalVerifyItem(CProofVerifierItem& item) const;
 
     std::map</* Cert or Tx hash */ uint256, CProofVerifierItem> proofQueue;   /**< The queue of proofs to be verified. */
 
 private:
 
+    friend class CScProofCheck;
+
     static std::atomic<uint32_t> proofIdCounter;   /**< The counter used to get a unique ID for proofs. */
 
     const Verification verificationMode;    /**< The type of verification to be performed by this instance of proof verifier. */
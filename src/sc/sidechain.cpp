@@ -115,6 +115,37 @@ int CSidechain::GetScheduledCeasingHeight() const
     return GetCertSubmissionWindowEnd(lastTopQualityCertReferencedEpoch+1);
 }
 
+CSidechain::State CSidechain::GetState(int nHeight) const
+{
+    if (!isCreationConfirmed())
+        return State::UNCONFIRMED;
+
+    if (nHeight >= GetScheduledCeasingHeight())
+        return State::CEASED;
+    else
+        return State::ALIVE;
+}
+
+const CScCertificateView& CSidechain::GetActiveCertView(int nHeight) const
+{
+    State state = GetState(nHeight);
+    if (state == State::CEASED)
+        return pastEpochTopQualityCertView;
+
+    if (state == State::UNCONFIRMED)
+        return lastTopQualityCertView;
+
+    int certReferencedEpoch = EpochFor(nHeight + 1 - GetCertSubmissionWindowLength()) - 1;
+
+    if (lastTopQualityCertReferencedEpoch == certReferencedEpoch)
+        return lastTopQualityCertView;
+    else if (lastTopQualityCertReferencedEpoch - 1 == certReferencedEpoch)
+        return pastEpochTopQualityCertView;
+
+    assert(false);
+    return lastTopQualityCertView;
+}
+
 std::string CSidechain::stateToString(State s)
 {
     switch(s)
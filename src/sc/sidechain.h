@@ -193,6 +193,10 @@ public:
         return this->creationBlockHeight != -1;
     }
 
+    // state and active certificate view once the chain is nHeight blocks long
+    State GetState(int nHeight) const;
+    const CScCertificateView& GetActiveCertView(int nHeight) const;
+
     void InitScFees();
     void UpdateScFees(const CScCertificateView& certView);
     void DumpScFees() const;
@@ -2,8 +2,11 @@
 #include <primitives/transaction.h>
 #include <primitives/certificate.h>
 #include <uint256.h>
+#include <crypto/sha256.h>
+#include <sync.h>
 #include <algorithm>
 #include <iostream>
+#include <list>
 #include <zendoo/zendoo_mc.h>
 
 // TODO remove when not needed anymore
@@ -13,6 +16,8 @@
 bool SidechainTxsCommitmentBuilder::add(const CTransaction& tx) { return true; }
 bool SidechainTxsCommitmentBuilder::add(const CScCertificate& cert, const CCoinsViewCache& view) { return true; }
 uint256 SidechainTxsCommitmentBuilder::getCommitment() { return uint256(); }
+uint256 SidechainTxsCommitmentBuilder::getCommitment(const std::vector<CTransaction>& vtx,
+    const std::vector<CScCertificate>& vcert, const CCoinsViewCache& view) { return uint256(); }
 SidechainTxsCommitmentBuilder::SidechainTxsCommitmentBuilder(): _cmt(nullptr) {}
 SidechainTxsCommitmentBuilder::~SidechainTxsCommitmentBuilder(){}
 #else
@@ -397,12 +402,70 @@ uint256 SidechainTxsCommitmentBuilder::getCommitment()
 
 const uint256& SidechainTxsCommitmentBuilder::getEmptyCommitment()
 {
-    static uint256 value;
-    if (value.IsNull())
+    static const uint256 value = SidechainTxsCommitmentBuilder().getCommitment();
+    return value;
+}
+
+namespace {
+/** Number of commitments kept by the cache of getCommitment */
+const size_t SC_TXS_COMMITMENT_CACHE_SIZE = 8;
+
+CCriticalSection cs_scTxsCommitmentCache;
+/** Key of the sidechain content of txs and certs and its commitment, most recent first */
+std::list<std::pair<uint256, uint256> > scTxsCommitmentCache;
+}
+
+uint256 SidechainTxsCommitmentBuilder::getCommitment(const std::vector<CTransaction>& vtx,
+    const std::vector<CScCertificate>& vcert, const CCoinsViewCache& view)
+{
+    // Only sidechain outputs, csw inputs and certificates are added to the tree, and
+    // their hashes commit to them: the ordered hashes identify the commitment
+    CSHA256 hasher;
+    bool fEmpty = vcert.empty();
+    for (const CTransaction& tx : vtx)
     {
-        SidechainTxsCommitmentBuilder nullBuilder;
-        value = nullBuilder.getCommitment();
+        if (!tx.IsScVersion() || tx.ccIsNull())
+            continue;
+        hasher.Write(tx.GetHash().begin(), CSHA256::OUTPUT_SIZE);
+        fEmpty = false;
     }
-    return value;
+    for (const CScCertificate& cert : vcert)
+        hasher.Write(cert.GetHash().begin(), CSHA256::OUTPUT_SIZE);
+
+    if (fEmpty)
+        return getEmptyCommitment();
+
+    uint256 key;
+    hasher.Finalize(key.begin());
+    {
+        LOCK(cs_scTxsCommitmentCache);
+        for (auto it = scTxsCommitmentCache.begin(); it != scTxsCommitmentCache.end(); ++it)
+        {
+            if (it->first == key)
+            {
+                scTxsCommitmentCache.splice(scTxsCommitmentCache.begin(), scTxsCommitmentCache, it);
+                return it->second;
+            }
+        }
+    }
+
+    SidechainTxsCommitmentBuilder builder;
+    bool fAdded = true;
+    for (const CTransaction& tx : vtx)
+        fAdded = builder.add(tx) && fAdded;
+    for (const CScCertificate& cert : vcert)
+        fAdded = builder.add(cert, view) && fAdded;
+
+    const uint256 commitment = builder.getCommitment();
+
+    // A failed add must not hide the failure behind a cached value
+    if (fAdded)
+    {
+        LOCK(cs_scTxsCommitmentCache);
+        scTxsCommitmentCache.push_front(std::make_pair(key, commitment));
+        if (scTxsCommitmentCache.size() > SC_TXS_COMMITMENT_CACHE_SIZE)
+            scTxsCommitmentCache.pop_back();
+    }
+    return commitment;
 }
 #endif
@@ -29,6 +29,15 @@ public:
 
     static const uint256& getEmptyCommitment();
 
+    /**
+     * Commitment of the given txs and certs, as a builder they are added to
+     * would compute. The commitments of the latest sets of sidechain txs and
+     * certs are cached, so that block templates refreshed with the same ones
+     * and the blocks mined from them don't rebuild the tree.
+     */
+    static uint256 getCommitment(const std::vector<CTransaction>& vtx,
+                                 const std::vector<CScCertificate>& vcert, const CCoinsViewCache& view);
+
 private:
     const commitment_tree_t* const _cmt;
 
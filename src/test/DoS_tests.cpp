@@ -11,6 +11,7 @@
 #include "keystore.h"
 #include "main.h"
 #include "net.h"
+#include "orphanpool.h"
 #include "pow.h"
 #include "script/sign.h"
 #include "serialize.h"
@@ -25,14 +26,6 @@
 #include <boost/foreach.hpp>
 #include <boost/test/unit_test.hpp>
 
-// Tests this internal-to-main.cpp method:
-extern bool AddOrphanTx(const CTransactionBase& tx, NodeId peer);
-extern void EraseOrphansFor(NodeId peer);
-extern unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans);
-
-extern std::map<uint256, COrphanTx> mapOrphanTransactions;
-extern std::map<uint256, std::set<uint256> > mapOrphanTransactionsByPrev;
-
 CService ip(uint32_t i)
 {
     struct in_addr s;
@@ -104,13 +97,23 @@ BOOST_AUTO_TEST_CASE(DoS_bantime)
     SetMockTime(0);
 }
 
-const CTransactionBase* RandomOrphan()
+const CTransactionBase* RandomOrphan(const std::vector<CTransaction>& vOrphans)
 {
-    std::map<uint256, COrphanTx>::iterator it;
-    it = mapOrphanTransactions.lower_bound(GetRandHash());
-    if (it == mapOrphanTransactions.end())
-        it = mapOrphanTransactions.begin();
-    return (it->second.tx).get();
+    return &vOrphans[insecure_rand() % vOrphans.size()];
+}
+
+CMutableTransaction OrphanSpending(const uint256& parent, unsigned int nOutputs)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(nOutputs);
+    for (unsigned int j = 0; j < nOutputs; j++)
+    {
+        tx.vin[j].prevout.hash = parent;
+        tx.vin[j].prevout.n = j;
+    }
+    tx.resizeOut(1);
+    tx.getOut(0).nValue = 1*CENT;
+    return tx;
 }
 
 BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
@@ -119,6 +122,9 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     key.MakeNewKey(true);
     CBasicKeyStore keystore;
     keystore.AddKey(key);
+    orphanPool.Clear();
+    COrphanPoolStats statsBefore = orphanPool.GetStats();
+    std::vector<CTransaction> vOrphans;
 
     // 50 orphan transactions:
     for (int i = 0; i < 50; i++)
@@ -132,13 +138,14 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
         tx.getOut(0).nValue = 1*CENT;
         tx.getOut(0).scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
 
-        AddOrphanTx(tx, i);
+        if (orphanPool.Add(tx, i))
+            vOrphans.push_back(tx);
     }
 
     // ... and 50 that depend on other orphans:
     for (int i = 0; i < 50; i++)
     {
-        const CTransactionBase* txPrev = RandomOrphan();
+        const CTransactionBase* txPrev = RandomOrphan(vOrphans);
 
         CMutableTransaction tx;
         tx.vin.resize(1);
@@ -157,14 +164,15 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
             SignSignature(keystore, *dynamic_cast<const CScCertificate*>(txPrev), tx, 0);
         }
 
-        AddOrphanTx(tx, i);
+        if (orphanPool.Add(tx, i))
+            vOrphans.push_back(tx);
     }
 
 
     // This really-big orphan should be ignored:
     for (int i = 0; i < 10; i++)
     {
-        const CTransactionBase* txPrev = RandomOrphan();
+        const CTransactionBase* txPrev = RandomOrphan(vOrphans);
 
         CMutableTransaction tx;
         tx.resizeOut(1);
@@ -190,25 +198,82 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
         for (unsigned int j = 1; j < tx.vin.size(); j++)
             tx.vin[j].scriptSig = tx.vin[0].scriptSig;
 
-        BOOST_CHECK(!AddOrphanTx(tx, i));
+        BOOST_CHECK(!orphanPool.Add(tx, i));
     }
 
-    // Test EraseOrphansFor:
+    // Test EraseForPeer:
     for (NodeId i = 0; i < 3; i++)
     {
-        size_t sizeBefore = mapOrphanTransactions.size();
-        EraseOrphansFor(i);
-        BOOST_CHECK(mapOrphanTransactions.size() < sizeBefore);
+        size_t sizeBefore = orphanPool.size();
+        orphanPool.EraseForPeer(i);
+        BOOST_CHECK(orphanPool.size() < sizeBefore);
     }
 
-    // Test LimitOrphanTxSize() function:
-    LimitOrphanTxSize(40);
-    BOOST_CHECK(mapOrphanTransactions.size() <= 40);
-    LimitOrphanTxSize(10);
-    BOOST_CHECK(mapOrphanTransactions.size() <= 10);
-    LimitOrphanTxSize(0);
-    BOOST_CHECK(mapOrphanTransactions.empty());
-    BOOST_CHECK(mapOrphanTransactionsByPrev.empty());
+    // Test LimitSize() function:
+    orphanPool.LimitSize(40);
+    BOOST_CHECK(orphanPool.size() <= 40);
+    orphanPool.LimitSize(10);
+    BOOST_CHECK(orphanPool.size() <= 10);
+    orphanPool.LimitSize(0);
+    BOOST_CHECK(orphanPool.size() == 0);
+    BOOST_CHECK(orphanPool.GetSpendersOf(std::vector<uint256>{vOrphans[0].GetHash()}).empty());
+
+    COrphanPoolStats stats = orphanPool.GetStats();
+    BOOST_CHECK_EQUAL(stats.nAdded - statsBefore.nAdded, vOrphans.size());
+    BOOST_CHECK_EQUAL(stats.nIgnoredLarge - statsBefore.nIgnoredLarge, 10u);
+    BOOST_CHECK_EQUAL(stats.nErasedForPeer - statsBefore.nErasedForPeer + stats.nEvictedCount - statsBefore.nEvictedCount,
+                      vOrphans.size());
+    BOOST_CHECK_EQUAL(stats.nBytes, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(DoS_orphanPoolBounds)
+{
+    orphanPool.Clear();
+    COrphanPoolStats statsBefore = orphanPool.GetStats();
+    uint256 parent = GetRandHash();
+    uint256 otherParent = GetRandHash();
+    CTransaction first = OrphanSpending(parent, 1);
+    CTransaction second = OrphanSpending(otherParent, 2);
+    CTransaction child = OrphanSpending(first.GetHash(), 1);
+    unsigned int nSize = first.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+
+    // All the spenders of the parents, each once and in arrival order
+    BOOST_CHECK(orphanPool.Add(second, 1));
+    BOOST_CHECK(orphanPool.Add(first, 1));
+    BOOST_CHECK(!orphanPool.Add(first, 2));
+    BOOST_CHECK(orphanPool.Add(child, 2));
+    std::vector<COrphanTx> vSpenders = orphanPool.GetSpendersOf(std::vector<uint256>{parent, otherParent, parent});
+    BOOST_CHECK_EQUAL(vSpenders.size(), 2u);
+    BOOST_CHECK(vSpenders[0].tx->GetHash() == second.GetHash());
+    BOOST_CHECK(vSpenders[1].tx->GetHash() == first.GetHash());
+    BOOST_CHECK_EQUAL(vSpenders[1].fromPeer, 1);
+
+    orphanPool.EraseResolved(first.GetHash());
+    BOOST_CHECK(orphanPool.GetSpendersOf(std::vector<uint256>{parent}).empty());
+    BOOST_CHECK_EQUAL(orphanPool.GetSpendersOf(std::vector<uint256>{first.GetHash()}).size(), 1u);
+
+    // A peer over its size limit evicts its own oldest orphans only
+    orphanPool.SetMaxPeerBytes(3 * nSize);
+    for (int i = 0; i < 4; i++)
+        BOOST_CHECK(orphanPool.Add(OrphanSpending(GetRandHash(), 1), 3));
+    BOOST_CHECK(orphanPool.Exists(second.GetHash()));
+    BOOST_CHECK(orphanPool.Exists(child.GetHash()));
+    BOOST_CHECK_EQUAL(orphanPool.size(), 5u);
+
+    // Too many orphans, the peer holding most of the pool makes room
+    orphanPool.LimitSize(4);
+    BOOST_CHECK(orphanPool.Exists(second.GetHash()));
+    BOOST_CHECK(orphanPool.Exists(child.GetHash()));
+
+    COrphanPoolStats stats = orphanPool.GetStats();
+    BOOST_CHECK_EQUAL(stats.nResolved - statsBefore.nResolved, 1u);
+    BOOST_CHECK_EQUAL(stats.nEvictedPeerSize - statsBefore.nEvictedPeerSize, 1u);
+    BOOST_CHECK_EQUAL(stats.nEvictedCount - statsBefore.nEvictedCount, 1u);
+    BOOST_CHECK_EQUAL(stats.nOrphans, 4u);
+    BOOST_CHECK_EQUAL(stats.nPeers, 3u);
+
+    orphanPool.SetMaxPeerBytes(DEFAULT_MAX_ORPHAN_PEER_SIZE * 1000);
+    orphanPool.Clear();
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -109,7 +109,7 @@ public:
                 std::map<uint256, ZCIncrementalMerkleTree>::iterator ret =
                     mapAnchors_.insert(std::make_pair(it->first, ZCIncrementalMerkleTree())).first;
 
-                ret->second = it->second.tree;
+                ret->second = *it->second.tree;
             } else {
                 mapAnchors_.erase(it->first);
             }
@@ -131,6 +131,22 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+BOOST_AUTO_TEST_CASE(sha256_compress64) {
+    // Compressing several blocks at once must match compressing them one by
+    // one, including the ones left over after the full groups.
+    for (size_t blocks = 0; blocks <= 9; blocks++) {
+        std::vector<unsigned char> in(64 * blocks);
+        for (size_t i = 0; i < in.size(); i++)
+            in[i] = (unsigned char)(i * 7 + blocks);
+
+        std::vector<unsigned char> out(32 * blocks), expected(32 * blocks);
+        SHA256Compress64(out.data(), in.data(), blocks);
+        for (size_t b = 0; b < blocks; b++)
+            CSHA256().Write(&in[64 * b], 64).FinalizeNoPadding(&expected[32 * b]);
+        BOOST_CHECK(out == expected);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
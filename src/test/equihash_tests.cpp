@@ -82,6 +82,21 @@ void TestEquihashSolvers(unsigned int n, unsigned int k, const std::string &I, c
     BOOST_TEST_MESSAGE(strm.str());
     BOOST_CHECK(retOpt == solns);
     BOOST_CHECK(retOpt == ret);
+
+    // And so should the arena solver
+    std::set<std::vector<uint32_t>> retArena;
+    std::function<bool(std::vector<unsigned char>)> validBlockArena =
+            [&retArena, cBitLen](std::vector<unsigned char> soln) {
+        retArena.insert(GetIndicesFromMinimal(soln, cBitLen));
+        return false;
+    };
+    EhArenaSolver arenaSolver;
+    arenaSolver.SolveUncancellable(n, k, state, validBlockArena);
+    BOOST_TEST_MESSAGE("[Arena] Number of solutions: " << retArena.size());
+    strm.str("");
+    PrintSolutions(strm, retArena);
+    BOOST_TEST_MESSAGE(strm.str());
+    BOOST_CHECK(retArena == solns);
 }
 #endif
 
@@ -2,7 +2,9 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "clientversion.h"
 #include "policy/fees.h"
+#include "streams.h"
 #include "txmempool.h"
 #include "uint256.h"
 #include "util.h"
@@ -205,4 +207,47 @@ BOOST_AUTO_TEST_CASE(TxConfirmStats_FindBucketIndex)
     BOOST_CHECK_EQUAL(txcs.FindBucketIndex(nan("")), 0);
 }
 
+BOOST_AUTO_TEST_CASE(TxConfirmStats_RegularBuckets)
+{
+    std::vector<double> buckets;
+    for (double bucketBoundary = MIN_FEERATE; bucketBoundary <= MAX_FEERATE; bucketBoundary *= FEE_SPACING)
+        buckets.push_back(bucketBoundary);
+    TxConfirmStats txcs;
+    txcs.Initialize(buckets, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY, "Test");
+
+    // The direct lookup agrees with a search on and around each boundary
+    for (unsigned int i = 0; i < buckets.size(); i++) {
+        BOOST_CHECK_EQUAL(txcs.FindBucketIndex(buckets[i]), i);
+        BOOST_CHECK_EQUAL(txcs.FindBucketIndex(buckets[i] * 0.999), i);
+        BOOST_CHECK_EQUAL(txcs.FindBucketIndex(buckets[i] * 1.001), i + 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TxConfirmStats_CompactReadWrite)
+{
+    std::vector<double> buckets {1000.0, 2000.0, 4000.0, 8000.0};
+    TxConfirmStats txcs;
+    txcs.Initialize(buckets, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY, "Test");
+    for (unsigned int nHeight = 1; nHeight <= 1000; nHeight++) {
+        txcs.ClearCurrent(nHeight);
+        for (int i = 0; i < 5; i++) {
+            txcs.Record(1, 7000.0);
+            txcs.Record(3, 3000.0);
+        }
+    }
+
+    CAutoFile file(tmpfile(), SER_DISK, CLIENT_VERSION);
+    txcs.Write(file);
+    rewind(file.Get());
+    TxConfirmStats readTxcs;
+    readTxcs.Initialize(buckets, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY, "Test");
+    readTxcs.Read(file, FEE_ESTIMATES_COMPACT_VERSION);
+
+    for (int i = 1; i <= 4; i++) {
+        double estimate = txcs.EstimateMedianVal(i, 1, MIN_SUCCESS_PCT, true, 1000);
+        BOOST_CHECK(estimate > 0);
+        BOOST_CHECK_CLOSE(readTxcs.EstimateMedianVal(i, 1, MIN_SUCCESS_PCT, true, 1000), estimate, 0.01);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
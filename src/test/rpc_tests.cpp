@@ -11,6 +11,8 @@
 #include "test/test_bitcoin.h"
 
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
 #include <boost/test/unit_test.hpp>
 
 #include <univalue.h>
@@ -304,4 +306,91 @@ BOOST_AUTO_TEST_CASE(rpc_ban)
     BOOST_CHECK_EQUAL(adr.get_str(), "2001:4d48:ac57:400:cacf:e9ff:fe1d:9c63/ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff");
 }
 
+BOOST_AUTO_TEST_CASE(rpc_readrequest)
+{
+    UniValue valBatch;
+    {
+        // Only the first member of a name counts, nested ones are ignored
+        JSONRequest jreq;
+        BOOST_CHECK(jreq.read("{\"id\":7,\"x\":{\"method\":\"no\"},\"method\":\"getinfo\","
+                              "\"params\":[\"abc\",{\"id\":1}],\"method\":\"stop\"}", valBatch));
+        BOOST_CHECK(valBatch.isNull());
+        BOOST_CHECK_EQUAL(jreq.id.write(), "7");
+        BOOST_CHECK_EQUAL(jreq.strMethod, "getinfo");
+        BOOST_CHECK_EQUAL(jreq.params.write(), "[\"abc\",{\"id\":1}]");
+    }
+    {
+        JSONRequest jreq;
+        BOOST_CHECK(jreq.read("{\"method\":\"getinfo\"}", valBatch));
+        BOOST_CHECK(jreq.id.isNull());
+        BOOST_CHECK(jreq.params.isArray() && jreq.params.empty());
+    }
+    {
+        JSONRequest jreq;
+        BOOST_CHECK(jreq.read("[{\"method\":\"a\"},{\"method\":\"b\"}]", valBatch));
+        BOOST_CHECK(valBatch.isArray());
+        BOOST_CHECK_EQUAL(valBatch.size(), 2);
+        BOOST_CHECK(jreq.strMethod.empty());
+    }
+    {
+        JSONRequest jreq;
+        BOOST_CHECK(!jreq.read("{\"method\":\"getinfo\",}", valBatch));
+        BOOST_CHECK_THROW(jreq.read("\"getinfo\"", valBatch), UniValue);
+        BOOST_CHECK_THROW(jreq.read("{\"id\":3}", valBatch), UniValue);
+        BOOST_CHECK_EQUAL(jreq.id.write(), "3");
+        BOOST_CHECK_THROW(jreq.read("{\"method\":\"getinfo\",\"params\":{}}", valBatch), UniValue);
+    }
+
+    // The reply is written as the reply object would be
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("hex", std::string(100000, 'a'));
+    UniValue id(3);
+    BOOST_CHECK_EQUAL(JSONRPCReply(result, NullUniValue, id), JSONRPCReplyObj(result, NullUniValue, id).write() + "\n");
+    UniValue error = JSONRPCError(RPC_INVALID_REQUEST, "error");
+    BOOST_CHECK_EQUAL(JSONRPCReply(result, error, id), JSONRPCReplyObj(result, error, id).write() + "\n");
+}
+
+static bool RunOnThread(boost::thread_group& threads, const boost::function<void(void)>& func)
+{
+    threads.create_thread(func);
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(rpc_execbatch)
+{
+    boost::thread_group threads;
+    RPCSetBatchQueue(boost::bind(&RunOnThread, boost::ref(threads), _1));
+
+    // Runs of decodescript calls are split by a call that is not concurrent
+    UniValue vReq(UniValue::VARR);
+    for (int i = 0; i < 40; i++) {
+        UniValue req(UniValue::VOBJ);
+        req.pushKV("id", i);
+        req.pushKV("method", i % 15 == 7 ? "help" : "decodescript");
+        UniValue params(UniValue::VARR);
+        params.push_back(i % 15 == 7 ? "getblockcount" : "51");
+        req.pushKV("params", params);
+        vReq.push_back(req);
+    }
+    vReq.push_back(UniValue(UniValue::VOBJ));
+
+    UniValue ret;
+    BOOST_CHECK(ret.read(JSONRPCExecBatch(vReq)));
+    RPCSetBatchQueue(RPCTaskQueue());
+    threads.join_all();
+
+    // Replies are in the order of the requests
+    BOOST_CHECK_EQUAL(ret.size(), vReq.size());
+    for (int i = 0; i < 40; i++) {
+        BOOST_CHECK_EQUAL(find_value(ret[i], "id").get_int(), i);
+        BOOST_CHECK(find_value(ret[i], "error").isNull());
+    }
+    BOOST_CHECK_EQUAL(find_value(find_value(ret[40], "error"), "code").get_int(), RPC_INVALID_REQUEST);
+
+    UniValue vTooLarge(UniValue::VARR);
+    for (unsigned int i = 0; i <= DEFAULT_RPC_BATCH_MAX_SIZE; i++)
+        vTooLarge.push_back(UniValue(UniValue::VOBJ));
+    BOOST_CHECK_THROW(JSONRPCExecBatch(vTooLarge), UniValue);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -217,7 +217,39 @@ uint256 CCoinsViewDB::GetBestAnchor() const {
     return hashBestAnchor;
 }
 
+void CCoinsViewDB::LoadCswNullifierFilter() const {
+    AssertLockHeld(cs_cswNullifierFilter);
+
+    std::vector<std::pair<uint256, uint256> > nullifiers;
+    std::unique_ptr<leveldb::Iterator> it(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+    static const std::string cswNullifiersPrefix = std::string(1, DB_CSW_NULLIFIER);
+
+    for (it->Seek(cswNullifiersPrefix); it->Valid() && it->key().starts_with(cswNullifiersPrefix); it->Next())
+    {
+        leveldb::Slice slKey = it->key();
+        // serialize key, skipping prefix
+        CDataStream ssKey(slKey.data() + sizeof(char), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+        uint256 keyScId;
+        CFieldElement keyNullifier;
+        ssKey >> keyScId >> keyNullifier;
+        nullifiers.push_back(std::make_pair(keyScId, CswNullifierKey(keyNullifier)));
+    }
+
+    cswNullifierFilter.Reset(nullifiers.size());
+    for (const auto& nullifier : nullifiers)
+        cswNullifierFilter.Insert(nullifier.first, nullifier.second);
+    LogPrint("sc", "%s():%d - %d csw nullifiers loaded\n", __func__, __LINE__, nullifiers.size());
+}
+
 bool CCoinsViewDB::HaveCswNullifier(const uint256& scId, const CFieldElement &nullifier) const {
+    {
+        LOCK(cs_cswNullifierFilter);
+        if (!cswNullifierFilter.IsUsable())
+            LoadCswNullifierFilter();
+        if (!cswNullifierFilter.MayContain(scId, CswNullifierKey(nullifier)))
+            return false;
+    }
+
     std::pair<uint256, CFieldElement> position = std::make_pair(scId, nullifier);
     return db.Exists(make_pair(DB_CSW_NULLIFIER, position));
 }
@@ -245,7 +277,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
 
     for (CAnchorsMap::iterator it = mapAnchors.begin(); it != mapAnchors.end();) {
         if (it->second.flags & CAnchorsCacheEntry::DIRTY) {
-            BatchWriteAnchor(batch, it->first, it->second.tree, it->second.entered);
+            BatchWriteAnchor(batch, it->first, *it->second.tree, it->second.entered);
             // TODO: changed++?
         }
         CAnchorsMap::iterator itOld = it++;
@@ -273,11 +305,17 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
         mapSidechainEvents.erase(itOld);
     }
     
-    for (CCswNullifiersMap::iterator it = cswNullifies.begin(); it != cswNullifies.end();) {
-        const std::pair<uint256, CFieldElement>& position = it->first;
-        BatchWriteCswNullifier(batch, position.first, position.second, it->second);
-        CCswNullifiersMap::iterator itOld = it++;
-        cswNullifies.erase(itOld);
+    {
+        LOCK(cs_cswNullifierFilter);
+        for (CCswNullifiersMap::iterator it = cswNullifies.begin(); it != cswNullifies.end();) {
+            const std::pair<uint256, uint256>& position = it->first;
+            BatchWriteCswNullifier(batch, position.first, CFieldElement(position.second), it->second);
+            // An unusable filter is loaded from the db later on, new nullifiers included
+            if (it->second.flag == CCswNullifiersCacheEntry::Flags::FRESH && cswNullifierFilter.IsUsable())
+                cswNullifierFilter.Insert(position.first, position.second);
+            CCswNullifiersMap::iterator itOld = it++;
+            cswNullifies.erase(itOld);
+        }
     }
 
     if (!hashBlock.IsNull())
@@ -9,6 +9,7 @@
 #include "chain.h"
 #include "coins.h"
 #include "leveldbwrapper.h"
+#include "sc/cswnullifiers.h"
 
 #include <map>
 #include <string>
@@ -126,6 +127,11 @@ class CCoinsViewDB : public CCoinsView
 protected:
     CLevelDBWrapper db;
     CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    //! Filter of the csw nullifiers in the db, loaded on first use
+    mutable CCriticalSection cs_cswNullifierFilter;
+    mutable CCswNullifierFilter cswNullifierFilter;
+    void LoadCswNullifierFilter() const;
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
@@ -17,14 +17,19 @@
 #include "validationinterface.h"
 #include <undo.h>
 
+#include <cmath>
+
+#include <univalue.h>
+
 CMemPoolEntry::CMemPoolEntry():
-    nFee(0), nModSize(0), nUsageSize(0), nTime(0), dPriority(0.0)
+    nFee(0), nModSize(0), nUsageSize(0), nTime(0), dPriority(0.0), nRelayPayloadUsage(0)
 {
     nHeight = MEMPOOL_HEIGHT;
 }
 
 CMemPoolEntry::CMemPoolEntry(const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight) :
-    nFee(_nFee), nModSize(0), nUsageSize(0), nTime(_nTime), dPriority(_dPriority), nHeight(_nHeight)
+    nFee(_nFee), nModSize(0), nUsageSize(0), nTime(_nTime), dPriority(_dPriority), nHeight(_nHeight),
+    nRelayPayloadUsage(0)
 {
 }
 
@@ -111,12 +116,16 @@ bool CSidechainMemPoolEntry::HasCert(const uint256& hash) const
 }
 
 CTxMemPool::CTxMemPool(const CFeeRate& _minRelayFee) :
-    nTransactionsUpdated(0), nCertificatesUpdated(0), cachedInnerUsage(0)
+    nTransactionsUpdated(0), nCertificatesUpdated(0), cachedInnerUsage(0), minReasonableRelayFee(_minRelayFee),
+    lastRollingFeeUpdate(GetTime()), blockSinceLastRollingFeeBump(false), rollingMinimumFeeRate(0)
 {
     // Sanity checks off by default for performance, because otherwise
     // accepting transactions becomes O(N^2) where N is the number
     // of transactions in the pool
     fSanityCheck = false;
+    nCheckSampleSize = 0;
+    nCheckBudgetMicros = 0;
+    fCheckingCerts = false;
 
     minerPolicyEstimator = new CBlockPolicyEstimator(_minRelayFee);
 }
@@ -149,6 +158,7 @@ void CTxMemPool::AddTransactionsUpdated(unsigned int n)
 {
     LOCK(cs);
     nTransactionsUpdated += n;
+    NotifyTransactionsUpdated();
 }
 
 
@@ -177,7 +187,7 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
         if (mapSidechains.count(csw.scId) == 0)
             LogPrint("mempool", "%s():%d - adding tx [%s] in mapSidechain [%s], cswNullifiers\n",
                      __func__, __LINE__, hash.ToString(), csw.scId.ToString());
-        mapSidechains[csw.scId].cswNullifiers[csw.nullifier] = tx.GetHash();
+        mapSidechains[csw.scId].cswNullifiers.set(CswNullifierKey(csw.nullifier), tx.GetHash());
         mapSidechains[csw.scId].cswTotalAmount += csw.nValue;
     }
 
@@ -198,7 +208,11 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
         mapSidechains[btr.scId].mcBtrsTxHashes.insert(hash);
     }
 
+    setByFeeRate.insert(GetEvictionKey(hash, entry.GetFee(), entry.GetTxSize()));
+    setByTime.insert(std::make_pair(entry.GetTime(), hash));
+
     nTransactionsUpdated++;
+    NotifyTransactionsUpdated();
     totalTxSize += entry.GetTxSize();
     cachedInnerUsage += entry.DynamicMemoryUsage();
     minerPolicyEstimator->processTransaction(entry, fCurrentEstimate);
@@ -224,12 +238,15 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CCertificateMemPoolEntr
     if (mapSidechains.count(cert.GetScId())!= 0)
         assert(mapSidechains.at(cert.GetScId()).mBackwardCertificates.count(cert.quality) == 0);
     mapSidechains[cert.GetScId()].mBackwardCertificates[cert.quality] = hash;
-           
+
+    setByFeeRate.insert(GetEvictionKey(hash, entry.GetFee(), entry.GetCertificateSize()));
+    setByTime.insert(std::make_pair(entry.GetTime(), hash));
+
     nCertificatesUpdated++;
+    NotifyTransactionsUpdated();
     totalCertificateSize += entry.GetCertificateSize();
     cachedInnerUsage += entry.DynamicMemoryUsage();
-    // TODO cert: for the time being skip the part on policy estimator, certificates currently have maximum priority
-    // minerPolicyEstimator->processTransaction(entry, fCurrentEstimate);
+    minerPolicyEstimator->processCertificate(entry, fCurrentEstimate);
     LogPrint("mempool", "%s():%d - cert [%s] added in mempool\n", __func__, __LINE__, hash.ToString() );
     return true;
 }
@@ -239,7 +256,7 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CCertificateMemPoolEntr
 void CTxMemPool::addAddressIndex(const CTransactionBase &txBase, int64_t nTime, const CCoinsViewCache &view)
 {
     LOCK(cs);
-    std::vector<CMempoolAddressDeltaKey> inserted;
+    CMempoolAddressIndex::DeltaList inserted;
 
     const uint256& txBaseHash = txBase.GetHash();
     for (unsigned int j = 0; j < txBase.GetVin().size(); j++) {
@@ -252,8 +269,7 @@ void CTxMemPool::addAddressIndex(const CTransactionBase &txBase, int64_t nTime,
 
         CMempoolAddressDeltaKey key(type, prevout.scriptPubKey.AddressHash(), txBaseHash, j, 1);
         CMempoolAddressDelta delta(nTime, prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-        mapAddress.insert(std::make_pair(key, delta));
-        inserted.push_back(key);
+        inserted.push_back(std::make_pair(key, delta));
     }
 
     // default values for cert handling, not used for ordinary txes
@@ -302,7 +318,7 @@ void CTxMemPool::addAddressIndex(const CTransactionBase &txBase, int64_t nTime,
                     continue;
 
                 CMempoolAddressDeltaKey key(type, out.scriptPubKey.AddressHash(), certSuperseededHash, m, 0);
-                mapAddress[key].outStatus = CMempoolAddressDelta::OutputStatus::LOW_QUALITY_CERT_BACKWARD_TRANSFER;
+                addressIndex.setOutputStatus(key, CMempoolAddressDelta::OutputStatus::LOW_QUALITY_CERT_BACKWARD_TRANSFER);
 
             }
         }
@@ -325,11 +341,10 @@ void CTxMemPool::addAddressIndex(const CTransactionBase &txBase, int64_t nTime,
             continue;
 
         CMempoolAddressDeltaKey key(type, out.scriptPubKey.AddressHash(), txBaseHash, k, 0);
-        mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(nTime, out.nValue, outStatus)));
-        inserted.push_back(key);
+        inserted.push_back(std::make_pair(key, CMempoolAddressDelta(nTime, out.nValue, outStatus)));
     }
 
-    mapAddressInserted.insert(std::make_pair(txBaseHash, inserted));
+    addressIndex.add(txBaseHash, inserted);
 }
 
 void CTxMemPool::updateTopQualCertAddressIndex(const uint256& scid)
@@ -351,7 +366,7 @@ void CTxMemPool::updateTopQualCertAddressIndex(const uint256& scid)
                 continue;
  
             CMempoolAddressDeltaKey key(type, out.scriptPubKey.AddressHash(), topQualHash, m, 0);
-            mapAddress[key].outStatus = CMempoolAddressDelta::OutputStatus::TOP_QUALITY_CERT_BACKWARD_TRANSFER;
+            addressIndex.setOutputStatus(key, CMempoolAddressDelta::OutputStatus::TOP_QUALITY_CERT_BACKWARD_TRANSFER);
         }
     }
 }
@@ -361,11 +376,7 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
 {
     LOCK(cs);
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
-        }
+        addressIndex.get((*it).second, (*it).first, results);
     }
     return true;
 }
@@ -373,16 +384,7 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
 bool CTxMemPool::removeAddressIndex(const uint256& txBaseHash)
 {
     LOCK(cs);
-    addressDeltaMapInserted::iterator it = mapAddressInserted.find(txBaseHash);
-
-    if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
-        }
-        mapAddressInserted.erase(it);
-    }
-
+    addressIndex.remove(txBaseHash);
     return true;
 }
 
@@ -390,7 +392,7 @@ void CTxMemPool::addSpentIndex(const CTransactionBase &txBase, const CCoinsViewC
 {
     LOCK(cs);
 
-    std::vector<CSpentIndexKey> inserted;
+    CMempoolSpentIndex::SpentList inserted;
 
     const uint256& txBaseHash = txBase.GetHash();
     for (unsigned int j = 0; j < txBase.GetVin().size(); j++) {
@@ -402,40 +404,22 @@ void CTxMemPool::addSpentIndex(const CTransactionBase &txBase, const CCoinsViewC
             prevout.scriptPubKey.GetType(),
             prevout.scriptPubKey.AddressHash());
 
-        mapSpent.insert(std::make_pair(key, value));
-        inserted.push_back(key);
-
+        inserted.push_back(std::make_pair(key, value));
     }
 
-    mapSpentInserted.insert(std::make_pair(txBaseHash, inserted));
+    spentIndex.add(txBaseHash, inserted);
 }
 
 bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 {
     LOCK(cs);
-    mapSpentIndex::iterator it;
-
-    it = mapSpent.find(key);
-    if (it != mapSpent.end()) {
-        value = it->second;
-        return true;
-    }
-    return false;
+    return spentIndex.get(key, value);
 }
 
 bool CTxMemPool::removeSpentIndex(const uint256& txBaseHash)
 {
     LOCK(cs);
-    mapSpentIndexInserted::iterator it = mapSpentInserted.find(txBaseHash);
-
-    if (it != mapSpentInserted.end()) {
-        std::vector<CSpentIndexKey> keys = (*it).second;
-        for (std::vector<CSpentIndexKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapSpent.erase(*mit);
-        }
-        mapSpentInserted.erase(it);
-    }
-
+    spentIndex.remove(txBaseHash);
     return true;
 }
 #endif // ENABLE_ADDRESS_INDEXING
@@ -609,7 +593,7 @@ void CTxMemPool::remove(const CTransactionBase& origTx, std::list<CTransaction>&
             }
 
             for(const CTxCeasedSidechainWithdrawalInput& csw: tx.GetVcswCcIn()) {
-                mapSidechains.at(csw.scId).cswNullifiers.erase(csw.nullifier);
+                mapSidechains.at(csw.scId).cswNullifiers.erase(CswNullifierKey(csw.nullifier));
                 mapSidechains.at(csw.scId).cswTotalAmount -= csw.nValue;
 
                 if (mapSidechains.at(csw.scId).IsNull())
@@ -655,6 +639,8 @@ void CTxMemPool::remove(const CTransactionBase& origTx, std::list<CTransaction>&
             }
 
             removedTxs.push_back(tx);
+            setByFeeRate.erase(GetEvictionKey(hash, mapTx[hash].GetFee(), mapTx[hash].GetTxSize()));
+            setByTime.erase(std::make_pair(mapTx[hash].GetTime(), hash));
             totalTxSize -= mapTx[hash].GetTxSize();
             cachedInnerUsage -= mapTx[hash].DynamicMemoryUsage();
 
@@ -662,7 +648,9 @@ void CTxMemPool::remove(const CTransactionBase& origTx, std::list<CTransaction>&
             mapTx.erase(hash);
 
             nTransactionsUpdated++;
+            NotifyTransactionsUpdated();
             minerPolicyEstimator->removeTx(hash);
+            NotifyEntryRemoved(hash, false);
 
 #ifdef ENABLE_ADDRESS_INDEXING
             if (fAddressIndex)
@@ -699,11 +687,16 @@ void CTxMemPool::remove(const CTransactionBase& origTx, std::list<CTransaction>&
             }
 
             removedCerts.push_back(cert);
+            setByFeeRate.erase(GetEvictionKey(hash, mapCertificate[hash].GetFee(), mapCertificate[hash].GetCertificateSize()));
+            setByTime.erase(std::make_pair(mapCertificate[hash].GetTime(), hash));
             totalCertificateSize -= mapCertificate[hash].GetCertificateSize();
             cachedInnerUsage -= mapCertificate[hash].DynamicMemoryUsage();
             LogPrint("mempool", "%s():%d - removing cert [%s] from mempool\n", __func__, __LINE__, hash.ToString() );
             mapCertificate.erase(hash);
             nCertificatesUpdated++;
+            NotifyTransactionsUpdated();
+            minerPolicyEstimator->removeTx(hash);
+            NotifyEntryRemoved(hash, true);
 
 #ifdef ENABLE_ADDRESS_INDEXING
             if (fAddressIndex)
@@ -828,6 +821,38 @@ inline bool CTxMemPool::checkCertImmatureExpenditures(const CScCertificate& cert
     return true;
 }
 
+bool CTxMemPool::checkTxSidechainDependencies(const CTransaction& tx, const CCoinsViewCache * const pcoins)
+{
+    for(const CTxForwardTransferOut& ft: tx.GetVftCcOut())
+    {
+        // pcoins does not encompass mempool.
+        // Hence we need to checks explicitly for unconfirmed scCreations
+        if (hasSidechainCreationTx(ft.scId))
+            continue;
+
+        if (!pcoins->CheckScTxTiming(ft.scId) || !pcoins->CheckMinimumFtScFee(ft))
+            return false;
+    }
+
+    for(const CBwtRequestOut& mbtr: tx.GetVBwtRequestOut())
+    {
+        // pcoins does not encompass mempool.
+        // Hence we need to checks explicitly for unconfirmed scCreations
+        if (hasSidechainCreationTx(mbtr.scId))
+            continue;
+
+        if (!pcoins->CheckScTxTiming(mbtr.scId) || !pcoins->CheckMinimumMbtrScFee(mbtr))
+            return false;
+    }
+
+    for(const CTxCeasedSidechainWithdrawalInput& csw: tx.GetVcswCcIn())
+    {
+        if(pcoins->GetSidechainState(csw.scId) != CSidechain::State::CEASED)
+            return false;
+    }
+    return true;
+}
+
 void CTxMemPool::removeStaleCertificates(const CCoinsViewCache * const pCoinsView,
                                          std::list<CScCertificate>& outdatedCerts)
 {
@@ -893,12 +918,25 @@ void CTxMemPool::removeWithAnchor(const uint256 &invalidRoot)
 }
 
 void CTxMemPool::removeOutOfScBalanceCsw(const CCoinsViewCache * const pCoinsView, std::list<CTransaction> &removedTxs, std::list<CScCertificate> &removedCerts)
+{
+    std::set<uint256> scIds;
+    for (const auto& entry : mapSidechains)
+        scIds.insert(entry.first);
+    removeOutOfScBalanceCsw(pCoinsView, scIds, removedTxs, removedCerts);
+}
+
+void CTxMemPool::removeOutOfScBalanceCsw(const CCoinsViewCache * const pCoinsView, const std::set<uint256>& scIds,
+                                        std::list<CTransaction> &removedTxs, std::list<CScCertificate> &removedCerts)
 {
     // Remove CSWs that try to withdraw more coins than belongs to the sidechain.
     // Note: if there is a CSW values conflict (may occur only if CSW circuit is broken or malicious) -> remove all CSWs for given sidechain.
     std::set<uint256> txesToRemove;
-    for (std::map<uint256, CSidechainMemPoolEntry>::const_iterator sIt = mapSidechains.begin(); sIt != mapSidechains.end(); sIt++)
+    for (const uint256& scId : scIds)
     {
+        std::map<uint256, CSidechainMemPoolEntry>::const_iterator sIt = mapSidechains.find(scId);
+        if (sIt == mapSidechains.end())
+            continue;
+
         const CSidechainMemPoolEntry &sidechainEntry = sIt->second;
         if (sidechainEntry.cswTotalAmount == 0) //how about < 0?
             continue;//no csw that could reduce sc balance
@@ -908,12 +946,8 @@ void CTxMemPool::removeOutOfScBalanceCsw(const CCoinsViewCache * const pCoinsVie
         if (sidechainEntry.cswTotalAmount <= sidechain.balance)
             continue; //enough Sc balance to accomodate for all unconfirmed csw
 
-        for (auto nIt = sidechainEntry.cswNullifiers.begin(); nIt != sidechainEntry.cswNullifiers.end(); nIt++)
-        {
-            const uint256 &txHash = nIt->second;
-            const CTransaction &tx = mapTx[txHash].GetTx();
-            txesToRemove.insert(tx.GetHash());
-        }
+        for (auto nIt = sidechainEntry.cswNullifiers.begin(); nIt != sidechainEntry.cswNullifiers.end(); ++nIt)
+            txesToRemove.insert(nIt->txHash);
     }
 
     for(const auto& hash: txesToRemove)
@@ -962,11 +996,11 @@ void CTxMemPool::removeConflicts(const CTransaction &tx, std::list<CTransaction>
         if (mapSidechains.count(csw.scId) == 0)
             continue;
 
-        const auto& cswNullifierTx = mapSidechains.at(csw.scId).cswNullifiers.find(csw.nullifier);
-        if(cswNullifierTx == mapSidechains.at(csw.scId).cswNullifiers.end())
+        const uint256* cswNullifierTx = mapSidechains.at(csw.scId).cswNullifiers.find(CswNullifierKey(csw.nullifier));
+        if(cswNullifierTx == nullptr)
             continue;
 
-        const uint256& txHash = cswNullifierTx->second;
+        const uint256& txHash = *cswNullifierTx;
         const auto& it = mapTx.find(txHash);
         // If CSW nullifier was present in cswNullifers, the containing tx must be present in the mempool.
         assert(it != mapTx.end());
@@ -976,7 +1010,12 @@ void CTxMemPool::removeConflicts(const CTransaction &tx, std::list<CTransaction>
             remove(txConflict, removedTxs, removedCerts, true);
     }
 
-    removeOutOfScBalanceCsw(pcoinsTip, removedTxs, removedCerts);
+    // Only the balances of the sidechains tx withdraws from can have decreased
+    std::set<uint256> cswScIds;
+    for(const CTxCeasedSidechainWithdrawalInput& csw: tx.GetVcswCcIn())
+        cswScIds.insert(csw.scId);
+    if (!cswScIds.empty())
+        removeOutOfScBalanceCsw(pcoinsTip, cswScIds, removedTxs, removedCerts);
 }
 
 void CTxMemPool::removeStaleTransactions(const CCoinsViewCache * const pCoinsView,
@@ -989,47 +1028,49 @@ void CTxMemPool::removeStaleTransactions(const CCoinsViewCache * const pCoinsVie
     {
         const CTransaction& tx = it->second.GetTx();
 
-        if (!checkTxImmatureExpenditures(tx, pCoinsView))
-        {
+        if (!checkTxImmatureExpenditures(tx, pCoinsView) || !checkTxSidechainDependencies(tx, pCoinsView))
             txesToRemove.insert(tx.GetHash());
-            continue;
-        }
+    }
 
-        for(const CTxForwardTransferOut& ft: tx.GetVftCcOut())
+    for(const auto& hash: txesToRemove)
+    {
+        // there can be dependancy also between txes, so check that a tx is still in map during the loop
+        if (mapTx.count(hash))
         {
-            // pCoinsView does not encompass mempool.
-            // Hence we need to checks explicitly for unconfirmed scCreations
-            if (hasSidechainCreationTx(ft.scId))
-                continue;
-
-            if (!pCoinsView->CheckScTxTiming(ft.scId) || !pCoinsView->CheckMinimumFtScFee(ft))
-            {
-                txesToRemove.insert(tx.GetHash());
-                break;
-            }
+            const CTransaction& tx = mapTx.at(hash).GetTx();
+            remove(tx, outdatedTxs, outdatedCerts, true);
         }
+    }
+    
+    LogPrint("mempool", "%s():%d - removed %d certs and %d txes\n", __func__, __LINE__, outdatedCerts.size(), outdatedTxs.size());
+}
 
-        for(const CBwtRequestOut& mbtr: tx.GetVBwtRequestOut())
-        {
-            // pCoinsView does not encompass mempool.
-            // Hence we need to checks explicitly for unconfirmed scCreations
-            if (hasSidechainCreationTx(mbtr.scId))
-                continue;
+void CTxMemPool::removeStaleTransactions(const CCoinsViewCache * const pCoinsView, const std::set<uint256>& scIds,
+                                         std::list<CTransaction>& outdatedTxs, std::list<CScCertificate>& outdatedCerts)
+{
+    LOCK(cs);
+    std::set<uint256> txesChecked;
+    std::set<uint256> txesToRemove;
 
-            if (!pCoinsView->CheckScTxTiming(mbtr.scId) || !pCoinsView->CheckMinimumMbtrScFee(mbtr))
-            {
-                txesToRemove.insert(tx.GetHash());
-                break;
-            }
-        }
+    for(const uint256& scId: scIds)
+    {
+        std::map<uint256, CSidechainMemPoolEntry>::const_iterator scIt = mapSidechains.find(scId);
+        if (scIt == mapSidechains.end())
+            continue;
+
+        std::vector<uint256> dependingTxes(scIt->second.fwdTxHashes.begin(), scIt->second.fwdTxHashes.end());
+        dependingTxes.insert(dependingTxes.end(), scIt->second.mcBtrsTxHashes.begin(), scIt->second.mcBtrsTxHashes.end());
+        for(const auto& entry: scIt->second.cswNullifiers)
+            dependingTxes.push_back(entry.txHash);
 
-        for(const CTxCeasedSidechainWithdrawalInput& csw: tx.GetVcswCcIn())
+        for(const uint256& hash: dependingTxes)
         {
-            if(pCoinsView->GetSidechainState(csw.scId) != CSidechain::State::CEASED)
-            {
-                txesToRemove.insert(tx.GetHash());
+            // a tx can depend on several sidechains, it is checked against all of them at once
+            if (!txesChecked.insert(hash).second)
                 continue;
-            }
+
+            if (!checkTxSidechainDependencies(mapTx.at(hash).GetTx(), pCoinsView))
+                txesToRemove.insert(hash);
         }
     }
 
@@ -1042,8 +1083,42 @@ void CTxMemPool::removeStaleTransactions(const CCoinsViewCache * const pCoinsVie
             remove(tx, outdatedTxs, outdatedCerts, true);
         }
     }
-    
-    LogPrint("mempool", "%s():%d - removed %d certs and %d txes\n", __func__, __LINE__, outdatedCerts.size(), outdatedTxs.size());
+
+    LogPrint("mempool", "%s():%d - checked %d txes of %d sidechains, removed %d certs and %d txes\n", __func__, __LINE__,
+        txesChecked.size(), scIds.size(), outdatedCerts.size(), outdatedTxs.size());
+}
+
+void CTxMemPool::removeSpendersOfVoidedCerts(const CCoinsViewCache * const pCoinsView, const std::set<uint256>& certHashes,
+                                             std::list<CTransaction>& outdatedTxs, std::list<CScCertificate>& outdatedCerts)
+{
+    LOCK(cs);
+    std::set<uint256> spendersToRemove;
+
+    for(const uint256& certHash: certHashes)
+    {
+        const CCoins* coins = pCoinsView->AccessCoins(certHash);
+        for(auto it = mapNextTx.lower_bound(COutPoint(certHash, 0)); it != mapNextTx.end() && it->first.hash == certHash; ++it)
+        {
+            if (coins != nullptr && coins->IsAvailable(it->first.n))
+                continue;
+
+            LogPrint("mempool", "%s():%d - adding [%s] to list for removing since it spends voided output %d of cert[%s]\n",
+                __func__, __LINE__, it->second.ptx->GetHash().ToString(), it->first.n, certHash.ToString());
+            spendersToRemove.insert(it->second.ptx->GetHash());
+        }
+    }
+
+    for(const auto& hash: spendersToRemove)
+    {
+        // there can be dependancy also between txes, so check that a spender is still in map during the loop
+        if (mapTx.count(hash))
+            remove(mapTx.at(hash).GetTx(), outdatedTxs, outdatedCerts, true);
+        else if (mapCertificate.count(hash))
+            remove(mapCertificate.at(hash).GetCertificate(), outdatedTxs, outdatedCerts, true);
+    }
+
+    LogPrint("mempool", "%s():%d - checked %d certs, removed %d certs and %d txes\n", __func__, __LINE__,
+        certHashes.size(), outdatedCerts.size(), outdatedTxs.size());
 }
 
 /**
@@ -1073,6 +1148,8 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, unsigned i
     }
     // After the txs in the new block have been removed from the mempool, update policy estimates
     minerPolicyEstimator->processBlock(nBlockHeight, entries, fCurrentEstimate);
+    lastRollingFeeUpdate = GetTime();
+    blockSinceLastRollingFeeBump = true;
 }
 
 void CTxMemPool::removeConflicts(const CScCertificate &cert, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts) {
@@ -1122,9 +1199,16 @@ void CTxMemPool::removeConflicts(const CScCertificate &cert, std::list<CTransact
 }
 
 void CTxMemPool::removeForBlock(const std::vector<CScCertificate>& vcert, unsigned int nBlockHeight,
-                                std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts)
+                                std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts, bool fCurrentEstimate)
 {
     LOCK(cs);
+    std::vector<CCertificateMemPoolEntry> entries;
+    for (const auto& cert : vcert)
+    {
+        std::map<uint256, CCertificateMemPoolEntry>::const_iterator it = mapCertificate.find(cert.GetHash());
+        if (it != mapCertificate.end())
+            entries.push_back(it->second);
+    }
 
     // dummy lists: dummyTxs must be empty, dummyCerts contains exactly the certs that were in the mempool
     // and now are in the block. The caller is not interested in them because they will be synced with the block
@@ -1136,6 +1220,156 @@ void CTxMemPool::removeForBlock(const std::vector<CScCertificate>& vcert, unsign
         removeConflicts(cert, removedTxs, removedCerts);
         ClearPrioritisation(cert.GetHash());
     }
+    minerPolicyEstimator->processBlockCertificates(nBlockHeight, entries, fCurrentEstimate);
+}
+
+std::pair<CFeeRate, uint256> CTxMemPool::GetEvictionKey(const uint256& hash, const CAmount& nFee, size_t nSize) const
+{
+    double dPriorityDelta = 0;
+    CAmount nFeeDelta = 0;
+    ApplyDeltas(hash, dPriorityDelta, nFeeDelta);
+    return std::make_pair(CFeeRate(nFee + nFeeDelta, nSize), hash);
+}
+
+void CTxMemPool::trackPackageRemoved(const CFeeRate& rate)
+{
+    AssertLockHeld(cs);
+    if (rate.GetFeePerK() > rollingMinimumFeeRate) {
+        rollingMinimumFeeRate = rate.GetFeePerK();
+        blockSinceLastRollingFeeBump = false;
+    }
+}
+
+bool CTxMemPool::IsTopQualityCert(const uint256& hash) const
+{
+    AssertLockHeld(cs);
+    std::map<uint256, CCertificateMemPoolEntry>::const_iterator it = mapCertificate.find(hash);
+    if (it == mapCertificate.end())
+        return false;
+    const CSidechainMemPoolEntry& sidechain = mapSidechains.at(it->second.GetCertificate().GetScId());
+    return sidechain.GetTopQualityCert()->second == hash;
+}
+
+bool CTxMemPool::GetEvictablePackage(const uint256& hash, std::vector<uint256>& package) const
+{
+    AssertLockHeld(cs);
+    const CTransactionBase* pRoot = mapTx.count(hash) ?
+        static_cast<const CTransactionBase*>(&mapTx.at(hash).GetTx()) :
+        static_cast<const CTransactionBase*>(&mapCertificate.at(hash).GetCertificate());
+
+    // Whatever depends on the entry goes with it, which is not allowed to take a top quality certificate along
+    package = mempoolDependenciesOf(*pRoot);
+    package.insert(package.begin(), hash);
+    for (const uint256& dep : package) {
+        if (IsTopQualityCert(dep))
+            return false;
+    }
+    return true;
+}
+
+void CTxMemPool::RemovePackage(const uint256& hash, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts)
+{
+    AssertLockHeld(cs);
+    // The entry itself is erased while being removed
+    if (mapTx.count(hash)) {
+        CTransaction tx = mapTx.at(hash).GetTx();
+        remove(tx, removedTxs, removedCerts, true);
+    } else {
+        CScCertificate cert = mapCertificate.at(hash).GetCertificate();
+        remove(cert, removedTxs, removedCerts, true);
+    }
+}
+
+int CTxMemPool::Expire(int64_t time, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts)
+{
+    LOCK(cs);
+    int nRemoved = 0;
+    std::set<std::pair<int64_t, uint256> >::const_iterator it = setByTime.begin();
+    while (it != setByTime.end() && it->first < time) {
+        // Superseded certificates expire as transactions do, the top quality ones only leave with their epoch
+        std::vector<uint256> package;
+        if (!GetEvictablePackage(it->second, package)) {
+            ++it;
+            continue;
+        }
+
+        const std::pair<int64_t, uint256> key = *it;
+        RemovePackage(key.second, removedTxs, removedCerts);
+        nRemoved += package.size();
+
+        // Dependencies went along, whatever came before was kept on purpose and still is
+        it = setByTime.upper_bound(key);
+    }
+    return nRemoved;
+}
+
+void CTxMemPool::TrimToSize(size_t sizelimit, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts)
+{
+    LOCK(cs);
+    unsigned int nEvicted = 0;
+    CFeeRate maxFeeRateRemoved(0);
+    std::set<std::pair<CFeeRate, uint256> >::const_iterator it = setByFeeRate.begin();
+    while (it != setByFeeRate.end() && DynamicMemoryUsage() > sizelimit) {
+        std::vector<uint256> package;
+        if (!GetEvictablePackage(it->second, package)) {
+            ++it;
+            continue;
+        }
+
+        CAmount nPackageFees = 0;
+        size_t nPackageSize = 0;
+        for (const uint256& hash : package) {
+            double dPriorityDelta = 0;
+            ApplyDeltas(hash, dPriorityDelta, nPackageFees);
+            if (mapTx.count(hash)) {
+                nPackageFees += mapTx.at(hash).GetFee();
+                nPackageSize += mapTx.at(hash).GetTxSize();
+            } else {
+                nPackageFees += mapCertificate.at(hash).GetFee();
+                nPackageSize += mapCertificate.at(hash).GetCertificateSize();
+            }
+        }
+
+        // New entries must pay more than what was evicted to make room for them
+        CFeeRate removed(nPackageFees, nPackageSize);
+        removed = CFeeRate(removed.GetFeePerK() + minReasonableRelayFee.GetFeePerK());
+        trackPackageRemoved(removed);
+        maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
+
+        const std::pair<CFeeRate, uint256> key = *it;
+        RemovePackage(key.second, removedTxs, removedCerts);
+        nEvicted += package.size();
+
+        it = setByFeeRate.upper_bound(key);
+    }
+
+    if (maxFeeRateRemoved > CFeeRate(0))
+        LogPrint("mempool", "Removed %u txn, rolling minimum fee bumped to %s\n", nEvicted, maxFeeRateRemoved.ToString());
+}
+
+CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const
+{
+    LOCK(cs);
+    if (!blockSinceLastRollingFeeBump || rollingMinimumFeeRate == 0)
+        return CFeeRate(rollingMinimumFeeRate);
+
+    int64_t time = GetTime();
+    if (time > lastRollingFeeUpdate + 10) {
+        double halflife = ROLLING_FEE_HALFLIFE;
+        if (DynamicMemoryUsage() < sizelimit / 4)
+            halflife /= 4;
+        else if (DynamicMemoryUsage() < sizelimit / 2)
+            halflife /= 2;
+
+        rollingMinimumFeeRate = rollingMinimumFeeRate / pow(2.0, (time - lastRollingFeeUpdate) / halflife);
+        lastRollingFeeUpdate = time;
+
+        if (rollingMinimumFeeRate < minReasonableRelayFee.GetFeePerK() / 2) {
+            rollingMinimumFeeRate = 0;
+            return CFeeRate(0);
+        }
+    }
+    return std::max(CFeeRate(rollingMinimumFeeRate), minReasonableRelayFee);
 }
 
 void CTxMemPool::clear()
@@ -1149,25 +1383,240 @@ void CTxMemPool::clear()
     mapSidechains.clear();
     mapNullifiers.clear();
     mapRecentlyAddedTxBase.clear();
+    setByFeeRate.clear();
+    setByTime.clear();
 
 #ifdef ENABLE_ADDRESS_INDEXING
-    mapAddress.clear();
-    mapAddressInserted.clear();
-    mapSpent.clear();
-    mapSpentInserted.clear();
+    addressIndex.clear();
+    spentIndex.clear();
 #endif // ENABLE_ADDRESS_INDEXING
 
     totalTxSize = 0;
     totalCertificateSize = 0;
     cachedInnerUsage = 0;
+    lastRollingFeeUpdate = GetTime();
+    blockSinceLastRollingFeeBump = false;
+    rollingMinimumFeeRate = 0;
     ++nTransactionsUpdated;
     ++nCertificatesUpdated;
+    NotifyTransactionsUpdated();
+}
+
+UniValue CMempoolCheckStats::ToJSON() const
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("runs", nRuns);
+    obj.pushKV("checked", nEntriesChecked);
+    obj.pushKV("sweeps", nSweeps);
+    obj.pushKV("lastsweep", nLastSweepTime);
+    obj.pushKV("inconsistencies", nInconsistencies);
+    if (nInconsistencies > 0)
+        obj.pushKV("lastinconsistent", lastInconsistentHash.GetHex());
+    obj.pushKV("time", nTimeMicros);
+    return obj;
+}
+
+void CTxMemPool::setSampledCheck(unsigned int nSampleSize, int64_t nBudgetMicros)
+{
+    LOCK(cs);
+    nCheckSampleSize = nSampleSize;
+    nCheckBudgetMicros = nBudgetMicros;
+}
+
+CMempoolCheckStats CTxMemPool::GetCheckStats() const
+{
+    LOCK(cs);
+    return checkStats;
+}
+
+static bool InconsistentEntry(std::string& strReason, const std::string& reason)
+{
+    strReason = reason;
+    return false;
+}
+
+bool CTxMemPool::checkTxEntry(const CTxMemPoolEntry& entry, const CCoinsViewCache *pcoins, std::string& strReason) const
+{
+    AssertLockHeld(cs);
+    const CTransaction& tx = entry.GetTx();
+    const uint256& hash = tx.GetHash();
+
+    bool fDependsOnMempool = false;
+    for(unsigned int i = 0; i < tx.GetVin().size(); i++) {
+        const COutPoint& prevout = tx.GetVin()[i].prevout;
+        std::map<uint256, CTxMemPoolEntry>::const_iterator it = mapTx.find(prevout.hash);
+        if (it != mapTx.end()) {
+            const CTransaction& txPrev = it->second.GetTx();
+            if (txPrev.GetVout().size() <= prevout.n || txPrev.GetVout()[prevout.n].IsNull())
+                return InconsistentEntry(strReason, "spends a missing output of a mempool tx");
+            fDependsOnMempool = true;
+        } else if (mapCertificate.count(prevout.hash)) {
+            return InconsistentEntry(strReason, "spends the output of a mempool certificate");
+        } else {
+            const CCoins* coins = pcoins->AccessCoins(prevout.hash);
+            if (!coins || !coins->IsAvailable(prevout.n))
+                return InconsistentEntry(strReason, "spends an unavailable coin");
+        }
+
+        std::map<COutPoint, CInPoint>::const_iterator itNext = mapNextTx.find(prevout);
+        if (itNext == mapNextTx.end() || itNext->second.ptx != &tx || itNext->second.n != i)
+            return InconsistentEntry(strReason, "input not recorded in mapNextTx");
+    }
+
+    for(const auto& scCreation : tx.GetVscCcOut()) {
+        if (mapSidechains.count(scCreation.GetScId()) == 0 || mapSidechains.at(scCreation.GetScId()).scCreationTxHash != hash)
+            return InconsistentEntry(strReason, "sidechain creation not recorded");
+        if (pcoins->HaveSidechain(scCreation.GetScId()))
+            return InconsistentEntry(strReason, "creates a confirmed sidechain");
+    }
+
+    for(const auto& fwd: tx.GetVftCcOut()) {
+        if (mapSidechains.count(fwd.scId) == 0 || mapSidechains.at(fwd.scId).fwdTxHashes.count(hash) == 0)
+            return InconsistentEntry(strReason, "forward transfer not recorded");
+        if (mapSidechains.at(fwd.scId).scCreationTxHash.IsNull() && pcoins->GetSidechainState(fwd.scId) != CSidechain::State::ALIVE)
+            return InconsistentEntry(strReason, "forward transfer to a sidechain not alive");
+    }
+
+    for(const auto& btr: tx.GetVBwtRequestOut()) {
+        if (mapSidechains.count(btr.scId) == 0 || mapSidechains.at(btr.scId).mcBtrsTxHashes.count(hash) == 0)
+            return InconsistentEntry(strReason, "backward transfer request not recorded");
+        if (mapSidechains.at(btr.scId).scCreationTxHash.IsNull() && !pcoins->HaveSidechain(btr.scId))
+            return InconsistentEntry(strReason, "backward transfer request to an unknown sidechain");
+    }
+
+    for(const CTxCeasedSidechainWithdrawalInput& csw: tx.GetVcswCcIn()) {
+        if (mapSidechains.count(csw.scId) == 0)
+            return InconsistentEntry(strReason, "ceased sidechain withdrawal not recorded");
+        const uint256* nullifierTx = mapSidechains.at(csw.scId).cswNullifiers.find(CswNullifierKey(csw.nullifier));
+        if (nullifierTx == nullptr || *nullifierTx != hash)
+            return InconsistentEntry(strReason, "ceased sidechain withdrawal not recorded");
+        if (pcoins->GetSidechainState(csw.scId) != CSidechain::State::CEASED)
+            return InconsistentEntry(strReason, "ceased sidechain withdrawal from a sidechain not ceased");
+    }
+
+    for(const JSDescription& joinsplit: tx.GetVjoinsplit()) {
+        for(const uint256& nf: joinsplit.nullifiers) {
+            if (pcoins->GetNullifier(nf))
+                return InconsistentEntry(strReason, "spends a confirmed nullifier");
+            std::map<uint256, const CTransaction*>::const_iterator itNullifier = mapNullifiers.find(nf);
+            if (itNullifier == mapNullifiers.end() || itNullifier->second != &tx)
+                return InconsistentEntry(strReason, "nullifier not recorded");
+        }
+    }
+
+    if (setByFeeRate.count(GetEvictionKey(hash, entry.GetFee(), entry.GetTxSize())) == 0 ||
+        setByTime.count(std::make_pair(entry.GetTime(), hash)) == 0)
+        return InconsistentEntry(strReason, "not indexed for eviction");
+
+    // The inputs of the txes depending on the mempool are only available in a view applying the whole pool
+    CValidationState state;
+    if (!fDependsOnMempool &&
+        !::ContextualCheckTxInputs(tx, state, *pcoins, false, chainActive, 0, false, Params().GetConsensus(), NULL))
+        return InconsistentEntry(strReason, "invalid inputs: " + state.GetRejectReason());
+
+    return true;
+}
+
+bool CTxMemPool::checkCertEntry(const CCertificateMemPoolEntry& entry, const CCoinsViewCache *pcoins, std::string& strReason) const
+{
+    AssertLockHeld(cs);
+    const CScCertificate& cert = entry.GetCertificate();
+    const uint256& hash = cert.GetHash();
+
+    if (mapSidechains.count(cert.GetScId()) == 0 || !mapSidechains.at(cert.GetScId()).HasCert(hash))
+        return InconsistentEntry(strReason, "certificate not recorded");
+
+    bool fDependsOnMempool = false;
+    for(unsigned int i = 0; i < cert.GetVin().size(); i++) {
+        const COutPoint& prevout = cert.GetVin()[i].prevout;
+        std::map<uint256, CCertificateMemPoolEntry>::const_iterator itCert = mapCertificate.find(prevout.hash);
+        if (itCert != mapCertificate.end()) {
+            // certificates can only spend change outputs of another certificate in mempool
+            const CScCertificate& certPrev = itCert->second.GetCertificate();
+            if (certPrev.IsBackwardTransfer(prevout.n) ||
+                certPrev.GetVout().size() <= prevout.n || certPrev.GetVout()[prevout.n].IsNull())
+                return InconsistentEntry(strReason, "spends a backward transfer or a missing output of a mempool certificate");
+            fDependsOnMempool = true;
+        } else if (mapTx.count(prevout.hash)) {
+            fDependsOnMempool = true;
+        } else {
+            const CCoins* coins = pcoins->AccessCoins(prevout.hash);
+            if (!coins || !coins->IsAvailable(prevout.n))
+                return InconsistentEntry(strReason, "spends an unavailable coin");
+        }
+
+        std::map<COutPoint, CInPoint>::const_iterator itNext = mapNextTx.find(prevout);
+        if (itNext == mapNextTx.end() || itNext->second.ptx != &cert || itNext->second.n != i)
+            return InconsistentEntry(strReason, "input not recorded in mapNextTx");
+    }
+
+    if (setByFeeRate.count(GetEvictionKey(hash, entry.GetFee(), entry.GetCertificateSize())) == 0 ||
+        setByTime.count(std::make_pair(entry.GetTime(), hash)) == 0)
+        return InconsistentEntry(strReason, "not indexed for eviction");
+
+    CValidationState state;
+    if (!fDependsOnMempool &&
+        !::ContextualCheckCertInputs(cert, state, *pcoins, false, chainActive, 0, false, Params().GetConsensus(), NULL))
+        return InconsistentEntry(strReason, "invalid inputs: " + state.GetRejectReason());
+
+    return true;
+}
+
+void CTxMemPool::checkSample(const CCoinsViewCache *pcoins) const
+{
+    int64_t nStart = GetTimeMicros();
+    LOCK(cs);
+
+    // A rolling window over the txes then the certificates, by hash: every entry
+    // staying in the pool long enough is checked once per sweep, however small the sample
+    unsigned int nChecked = 0;
+    while (nChecked < nCheckSampleSize && GetTimeMicros() - nStart < nCheckBudgetMicros)
+    {
+        bool fConsistent = true;
+        std::string strReason;
+        if (!fCheckingCerts) {
+            std::map<uint256, CTxMemPoolEntry>::const_iterator it = mapTx.upper_bound(checkCursor);
+            if (it == mapTx.end()) {
+                fCheckingCerts = true;
+                checkCursor.SetNull();
+                continue;
+            }
+            checkCursor = it->first;
+            fConsistent = checkTxEntry(it->second, pcoins, strReason);
+        } else {
+            std::map<uint256, CCertificateMemPoolEntry>::const_iterator it = mapCertificate.upper_bound(checkCursor);
+            if (it == mapCertificate.end()) {
+                fCheckingCerts = false;
+                checkCursor.SetNull();
+                checkStats.nSweeps++;
+                checkStats.nLastSweepTime = GetTime();
+                // at most one sweep per call, the pool may be empty
+                break;
+            }
+            checkCursor = it->first;
+            fConsistent = checkCertEntry(it->second, pcoins, strReason);
+        }
+
+        if (!fConsistent) {
+            LogPrintf("%s(): mempool entry %s is inconsistent: %s\n", __func__, checkCursor.ToString(), strReason);
+            checkStats.nInconsistencies++;
+            checkStats.lastInconsistentHash = checkCursor;
+        }
+        ++nChecked;
+    }
+
+    checkStats.nRuns++;
+    checkStats.nEntriesChecked += nChecked;
+    checkStats.nTimeMicros += GetTimeMicros() - nStart;
 }
 
 void CTxMemPool::check(const CCoinsViewCache *pcoins) const
 {
-    if (!fSanityCheck)
+    if (!fSanityCheck) {
+        if (nCheckSampleSize > 0)
+            checkSample(pcoins);
         return;
+    }
 
     LogPrint("mempool", "Checking mempool with %u transactions, %u certificates, %u sidechains, and %u inputs\n",
         (unsigned int)mapTx.size(), (unsigned int)mapCertificate.size(), (unsigned int)mapSidechains.size(), (unsigned int)mapNextTx.size());
@@ -1252,9 +1701,9 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
         for(const CTxCeasedSidechainWithdrawalInput& csw: tx.GetVcswCcIn()) {
             //CSW must be duly recorded in mapSidechain
             assert(mapSidechains.count(csw.scId) != 0);
-            const auto& cswNullifierPos = mapSidechains.at(csw.scId).cswNullifiers.find(csw.nullifier);
-            assert(cswNullifierPos != mapSidechains.at(csw.scId).cswNullifiers.end());
-            assert(cswNullifierPos->second == tx.GetHash());
+            const uint256* cswNullifierTx = mapSidechains.at(csw.scId).cswNullifiers.find(CswNullifierKey(csw.nullifier));
+            assert(cswNullifierTx != nullptr);
+            assert(*cswNullifierTx == tx.GetHash());
 
             //there must be no dangling CSWs, i.e. sidechain is ceased
             assert(pcoins->GetSidechainState(csw.scId) == CSidechain::State::CEASED);
@@ -1618,6 +2067,49 @@ void CTxMemPool::queryHashes(std::vector<uint256>& vtxid) const
         vtxid.push_back(mapCertEntry.first);
 }
 
+void CTxMemPool::queryHashesByDependencies(std::vector<uint256>& vHashes) const
+{
+    LOCK(cs);
+    std::vector<uint256> vRoots;
+    queryHashes(vRoots);
+    vHashes.clear();
+    vHashes.reserve(vRoots.size());
+
+    // Depth-first on the dependencies, an entry is listed once all of those it depends on are.
+    // The second member tells whether the dependencies of the entry were already pushed.
+    std::set<uint256> setVisited;
+    std::vector<std::pair<uint256, bool> > stack;
+    for(const uint256& root : vRoots)
+    {
+        stack.push_back(std::make_pair(root, false));
+        while(!stack.empty())
+        {
+            if (stack.back().second)
+            {
+                vHashes.push_back(stack.back().first);
+                stack.pop_back();
+                continue;
+            }
+            const uint256 hash = stack.back().first;
+            if (!setVisited.insert(hash).second)
+            {
+                stack.pop_back();
+                continue;
+            }
+            stack.back().second = true;
+
+            const CTransactionBase& txBase = mapTx.count(hash) ?
+                static_cast<const CTransactionBase&>(mapTx.at(hash).GetTx()) :
+                static_cast<const CTransactionBase&>(mapCertificate.at(hash).GetCertificate());
+            for(const uint256& dep : mempoolDirectDependenciesFrom(txBase))
+            {
+                if (setVisited.count(dep) == 0)
+                    stack.push_back(std::make_pair(dep, false));
+            }
+        }
+    }
+}
+
 int CTxMemPool::getNumOfCswInputs(const uint256& scId) const
 {
     LOCK(cs);
@@ -1645,6 +2137,38 @@ bool CTxMemPool::lookup(const uint256& hash, CScCertificate& result) const
     return true;
 }
 
+void CTxMemPool::SetRelayPayload(const uint256& hash, const std::shared_ptr<const CRelayPayload>& payload)
+{
+    LOCK(cs);
+    CMemPoolEntry* entry = NULL;
+    std::map<uint256, CTxMemPoolEntry>::iterator itTx = mapTx.find(hash);
+    if (itTx != mapTx.end())
+        entry = &itTx->second;
+    else
+    {
+        std::map<uint256, CCertificateMemPoolEntry>::iterator itCert = mapCertificate.find(hash);
+        if (itCert == mapCertificate.end())
+            return;
+        entry = &itCert->second;
+    }
+
+    cachedInnerUsage -= entry->DynamicMemoryUsage();
+    entry->SetRelayPayload(payload, payload ? payload->DynamicMemoryUsage() : 0);
+    cachedInnerUsage += entry->DynamicMemoryUsage();
+}
+
+std::shared_ptr<const CRelayPayload> CTxMemPool::GetRelayPayload(const uint256& hash) const
+{
+    LOCK(cs);
+    std::map<uint256, CTxMemPoolEntry>::const_iterator itTx = mapTx.find(hash);
+    if (itTx != mapTx.end())
+        return itTx->second.GetRelayPayload();
+    std::map<uint256, CCertificateMemPoolEntry>::const_iterator itCert = mapCertificate.find(hash);
+    if (itCert != mapCertificate.end())
+        return itCert->second.GetRelayPayload();
+    return std::shared_ptr<const CRelayPayload>();
+}
+
 void CTxMemPool::CertQualityStatusString(const CScCertificate& cert, std::string& statusString) const
 {
     const uint256& scid = cert.GetScId();
@@ -1665,10 +2189,10 @@ void CTxMemPool::CertQualityStatusString(const CScCertificate& cert, std::string
     }
 }
 
-CFeeRate CTxMemPool::estimateFee(int nBlocks) const
+CFeeRate CTxMemPool::estimateFee(int nBlocks, FeeEstimateType type) const
 {
     LOCK(cs);
-    return minerPolicyEstimator->estimateFee(nBlocks);
+    return minerPolicyEstimator->estimateFee(nBlocks, type);
 }
 double CTxMemPool::estimatePriority(int nBlocks) const
 {
@@ -1676,12 +2200,15 @@ double CTxMemPool::estimatePriority(int nBlocks) const
     return minerPolicyEstimator->estimatePriority(nBlocks);
 }
 
+static_assert(FEE_ESTIMATES_COMPACT_VERSION <= CLIENT_VERSION,
+              "the compact fee estimates file must be readable by the client writing it");
+
 bool
 CTxMemPool::WriteFeeEstimates(CAutoFile& fileout) const
 {
     try {
         LOCK(cs);
-        fileout << 109900; // version required to read: 0.10.99 or later
+        fileout << FEE_ESTIMATES_COMPACT_VERSION; // version required to read
         fileout << CLIENT_VERSION; // version that wrote the file
         minerPolicyEstimator->Write(fileout);
     }
@@ -1702,7 +2229,7 @@ CTxMemPool::ReadFeeEstimates(CAutoFile& filein)
             return error("CTxMemPool::ReadFeeEstimates(): up-version (%d) fee estimate file", nVersionRequired);
 
         LOCK(cs);
-        minerPolicyEstimator->Read(filein);
+        minerPolicyEstimator->Read(filein, nVersionRequired);
     }
     catch (const std::exception&) {
         LogPrintf("CTxMemPool::ReadFeeEstimates(): unable to read policy estimator data (non-fatal)\n");
@@ -1715,17 +2242,31 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const std::string& s
 {
     {
         LOCK(cs);
+        // Move the entry, if any, to its new place in the eviction order
+        std::pair<CFeeRate, uint256> oldKey;
+        if (mapTx.count(hash))
+            oldKey = GetEvictionKey(hash, mapTx.at(hash).GetFee(), mapTx.at(hash).GetTxSize());
+        else if (mapCertificate.count(hash))
+            oldKey = GetEvictionKey(hash, mapCertificate.at(hash).GetFee(), mapCertificate.at(hash).GetCertificateSize());
+
         std::pair<double, CAmount> &deltas = mapDeltas[hash];
         deltas.first += dPriorityDelta;
         deltas.second += nFeeDelta;
+
+        if (setByFeeRate.erase(oldKey)) {
+            if (mapTx.count(hash))
+                setByFeeRate.insert(GetEvictionKey(hash, mapTx.at(hash).GetFee(), mapTx.at(hash).GetTxSize()));
+            else
+                setByFeeRate.insert(GetEvictionKey(hash, mapCertificate.at(hash).GetFee(), mapCertificate.at(hash).GetCertificateSize()));
+        }
     }
     LogPrintf("PrioritiseTransaction: %s priority += %f, fee += %d\n", strHash, dPriorityDelta, FormatMoney(nFeeDelta));
 }
 
-void CTxMemPool::ApplyDeltas(const uint256& hash, double &dPriorityDelta, CAmount &nFeeDelta)
+void CTxMemPool::ApplyDeltas(const uint256& hash, double &dPriorityDelta, CAmount &nFeeDelta) const
 {
     LOCK(cs);
-    std::map<uint256, std::pair<double, CAmount> >::iterator pos = mapDeltas.find(hash);
+    std::map<uint256, std::pair<double, CAmount> >::const_iterator pos = mapDeltas.find(hash);
     if (pos == mapDeltas.end())
         return;
     const std::pair<double, CAmount> &deltas = pos->second;
@@ -1898,6 +2439,12 @@ size_t CTxMemPool::DynamicMemoryUsage() const {
           memusage::DynamicUsage(mapDeltas) +
           memusage::DynamicUsage(mapCertificate) +
           memusage::DynamicUsage(mapSidechains) +
+          memusage::DynamicUsage(setByFeeRate) +
+          memusage::DynamicUsage(setByTime) +
+#ifdef ENABLE_ADDRESS_INDEXING
+          addressIndex.DynamicMemoryUsage() +
+          spentIndex.DynamicMemoryUsage() +
+#endif // ENABLE_ADDRESS_INDEXING
           cachedInnerUsage);
 }
 
@@ -15,15 +15,22 @@
 #ifdef ENABLE_ADDRESS_INDEXING
 #include "addressindex.h"
 #include "spentindex.h"
+#include "mempoolindex.h"
 #endif // ENABLE_ADDRESS_INDEXING
 
 #include "amount.h"
 #include "coins.h"
+#include "sc/cswnullifiers.h"
+#include "policy/fees.h"
 #include "primitives/transaction.h"
 #include "primitives/certificate.h"
 #include "sync.h"
 
+#include <boost/signals2/signal.hpp>
+
 class CAutoFile;
+class CRelayPayload;
+class UniValue;
 
 inline double AllowFreeThreshold()
 {
@@ -52,6 +59,8 @@ protected:
     int64_t nTime; //! Local time when entering the mempool
     double dPriority; //! Priority when entering the mempool
     unsigned int nHeight; //! Chain height when entering the mempool
+    std::shared_ptr<const CRelayPayload> relayPayload; //! Serialized once for relay, shared with the relay memory
+    size_t nRelayPayloadUsage;
 public:
     CMemPoolEntry();
     CMemPoolEntry(const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight);
@@ -60,7 +69,13 @@ public:
     CAmount GetFee() const { return nFee; }
     int64_t GetTime() const { return nTime; }
     unsigned int GetHeight() const { return nHeight; }
-    size_t DynamicMemoryUsage() const { return nUsageSize; }
+    size_t DynamicMemoryUsage() const { return nUsageSize + nRelayPayloadUsage; }
+    const std::shared_ptr<const CRelayPayload>& GetRelayPayload() const { return relayPayload; }
+    void SetRelayPayload(const std::shared_ptr<const CRelayPayload>& payload, size_t nUsage)
+    {
+        relayPayload = payload;
+        nRelayPayloadUsage = nUsage;
+    }
 };
 
 /**
@@ -121,7 +136,7 @@ struct CSidechainMemPoolEntry
     std::set<uint256> fwdTxHashes; 
     std::map<int64_t, uint256> mBackwardCertificates; //quality -> certHash
     std::set<uint256> mcBtrsTxHashes;
-    std::map<CFieldElement, uint256> cswNullifiers; // csw nullifier -> containing Tx hash
+    CCswNullifierTxMap cswNullifiers; // csw nullifier -> containing Tx hash
     CAmount cswTotalAmount;
 
     // Note: in fwdTxHashes and mcBtrsTxHashes, a tx is registered only once,
@@ -143,6 +158,26 @@ struct CSidechainMemPoolEntry
     bool HasCert(const uint256& hash) const;
 };
 
+/** Outcome of the sampled consistency checks of the pool */
+struct CMempoolCheckStats
+{
+    //! Calls of check, entries checked and complete passes over the pool since startup
+    uint64_t nRuns;
+    uint64_t nEntriesChecked;
+    uint64_t nSweeps;
+    //! Entries found inconsistent, and the last of them
+    uint64_t nInconsistencies;
+    uint256 lastInconsistentHash;
+    //! Time spent checking, and when the last complete pass ended
+    int64_t nTimeMicros;
+    int64_t nLastSweepTime;
+
+    CMempoolCheckStats() : nRuns(0), nEntriesChecked(0), nSweeps(0), nInconsistencies(0),
+                           nTimeMicros(0), nLastSweepTime(0) {}
+
+    UniValue ToJSON() const;
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain
  * transactions that may be included in the next block.
@@ -167,26 +202,47 @@ private:
 
     bool checkTxImmatureExpenditures(const CTransaction& tx, const CCoinsViewCache * const pcoins);
     bool checkCertImmatureExpenditures(const CScCertificate& cert, const CCoinsViewCache * const pcoins);
+    bool checkTxSidechainDependencies(const CTransaction& tx, const CCoinsViewCache * const pcoins);
+
+    unsigned int nCheckSampleSize; //! entries checked per call when sampling, 0 if not sampling
+    int64_t nCheckBudgetMicros;    //! time a sampled check may take
+    mutable bool fCheckingCerts;   //! the sample continues over certificates, once past the last tx
+    mutable uint256 checkCursor;   //! hash of the last entry checked
+    mutable CMempoolCheckStats checkStats;
+
+    void checkSample(const CCoinsViewCache *pcoins) const;
+    bool checkTxEntry(const CTxMemPoolEntry& entry, const CCoinsViewCache *pcoins, std::string& strReason) const;
+    bool checkCertEntry(const CCertificateMemPoolEntry& entry, const CCoinsViewCache *pcoins, std::string& strReason) const;
+
+    CFeeRate minReasonableRelayFee;
+
+    mutable int64_t lastRollingFeeUpdate;
+    mutable bool blockSinceLastRollingFeeBump;
+    mutable double rollingMinimumFeeRate; //! minimum fee to get into the pool, decreases exponentially
+
+    //! Entries by fee rate, including their prioritisation, the lowest are evicted first when the pool is full
+    std::set<std::pair<CFeeRate, uint256> > setByFeeRate;
+    //! Entries by the time they entered the pool, the oldest expire first
+    std::set<std::pair<int64_t, uint256> > setByTime;
+
+    std::pair<CFeeRate, uint256> GetEvictionKey(const uint256& hash, const CAmount& nFee, size_t nSize) const;
+    void trackPackageRemoved(const CFeeRate& rate);
+    bool IsTopQualityCert(const uint256& hash) const;
+    bool GetEvictablePackage(const uint256& hash, std::vector<uint256>& package) const;
+    void RemovePackage(const uint256& hash, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts);
 
     std::map<uint256, std::shared_ptr<CTransactionBase> > mapRecentlyAddedTxBase;
     uint64_t nRecentlyAddedSequence = 0;
     uint64_t nNotifiedSequence = 0;
 
 #ifdef ENABLE_ADDRESS_INDEXING
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
-    addressDeltaMap mapAddress;
-
-    typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
-    addressDeltaMapInserted mapAddressInserted;
-
-    typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
-    mapSpentIndex mapSpent;
-
-    typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
-    mapSpentIndexInserted mapSpentInserted;
+    CMempoolAddressIndex addressIndex;
+    CMempoolSpentIndex spentIndex;
 #endif // ENABLE_ADDRESS_INDEXING
 
 public:
+    static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12; // public only for testing
+
     mutable CCriticalSection cs;
     std::map<uint256, CTxMemPoolEntry> mapTx;
     std::map<uint256, CCertificateMemPoolEntry> mapCertificate;
@@ -195,6 +251,11 @@ public:
     std::map<uint256, const CTransaction*> mapNullifiers;
     std::map<uint256, std::pair<double, CAmount> > mapDeltas;
 
+    /** Fired under cs for every transaction (false) or certificate (true) leaving the pool */
+    boost::signals2::signal<void (const uint256&, bool)> NotifyEntryRemoved;
+    /** Signaled, with the pool locked, when the counter of GetTransactionsUpdated changes */
+    boost::signals2::signal<void ()> NotifyTransactionsUpdated;
+
     CTxMemPool(const CFeeRate& _minRelayFee);
     ~CTxMemPool();
 
@@ -206,7 +267,9 @@ public:
      * If sanity-checking is turned on, check makes sure the pool is
      * consistent (does not contain two transactions that spend the same inputs,
      * all inputs are in the mapNextTx array). If sanity-checking is turned off,
-     * check does nothing.
+     * check does nothing, unless sampling is enabled: then each call checks
+     * the next entries of the pool, as many as the sample size and the time
+     * budget allow, without asserting.
      */
     void check(const CCoinsViewCache *pcoins) const;
 
@@ -215,6 +278,8 @@ public:
     bool checkIncomingCertConflicts(const CScCertificate& incomingCert) const;
 
     void setSanityCheck(bool _fSanityCheck) { fSanityCheck = _fSanityCheck; }
+    void setSampledCheck(unsigned int nSampleSize, int64_t nBudgetMicros);
+    CMempoolCheckStats GetCheckStats() const;
 
     std::pair<uint256, CAmount> FindCertWithQuality(const uint256& scId, int64_t certQuality);
     bool RemoveCertAndSync(const uint256& certToRmHash);
@@ -251,21 +316,57 @@ public:
                          std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts);
     void removeOutOfScBalanceCsw(const CCoinsViewCache * const pCoinsView,
                                  std::list<CTransaction> &removedTxs, std::list<CScCertificate> &removedCerts);
+    void removeOutOfScBalanceCsw(const CCoinsViewCache * const pCoinsView, const std::set<uint256>& scIds,
+                                 std::list<CTransaction> &removedTxs, std::list<CScCertificate> &removedCerts);
     void removeStaleTransactions(const CCoinsViewCache * const pCoinsView,
                                  std::list<CTransaction>& outdatedTxs, std::list<CScCertificate>& outdatedCerts);
+    /**
+     * Cleanup after a block is connected: only the txes depending on the sidechains in scIds are checked again.
+     * Connecting a block only moves maturity forward, and the sidechain checks can only change for the sidechains
+     * the block refers to or that cease at its height. The one way a block can make an input unspendable is voiding
+     * backward transfers, whose spenders are handled by removeSpendersOfVoidedCerts.
+     */
+    void removeStaleTransactions(const CCoinsViewCache * const pCoinsView, const std::set<uint256>& scIds,
+                                 std::list<CTransaction>& outdatedTxs, std::list<CScCertificate>& outdatedCerts);
+    /**
+     * Cleanup after a block is connected: removes the txes and certs spending outputs of the certificates in certHashes
+     * which are no longer available, i.e. backward transfers voided by a superseding cert or by the sidechain ceasing.
+     */
+    void removeSpendersOfVoidedCerts(const CCoinsViewCache * const pCoinsView, const std::set<uint256>& certHashes,
+                                     std::list<CTransaction>& outdatedTxs, std::list<CScCertificate>& outdatedCerts);
     // END OF UNCONFIRMED TRANSACTIONS CLEANUP METHODS
 
     // UNCONFIRMED CERTIFICATES CLEANUP METHODS
     void removeForBlock(const std::vector<CScCertificate>& vcert, unsigned int nBlockHeight,
-                        std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts);
+                        std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts, bool fCurrentEstimate = true);
     void removeConflicts(const CScCertificate &cert,
                          std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts);
     void removeStaleCertificates(const CCoinsViewCache * const pCoinsView,
                                  std::list<CScCertificate>& outdatedCerts);
     // END OF UNCONFIRMED CERTIFICATES CLEANUP METHODS
 
+    // MEMORY LIMIT METHODS
+    /**
+     * Remove the transactions and certificates which entered the pool before time, with their dependencies.
+     * Returns the number of entries removed.
+     */
+    int Expire(int64_t time, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts);
+    /**
+     * Evict the lowest fee rate entries, with their dependencies, until the pool uses at most sizelimit bytes.
+     * The top quality certificate of each sidechain, and whatever it depends on, is never evicted.
+     */
+    void TrimToSize(size_t sizelimit, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts);
+    /**
+     * The minimum fee rate to get into a pool limited to sizelimit bytes. It rises when entries are
+     * evicted and decays back to zero, faster as the pool gets emptier, once blocks are found.
+     */
+    CFeeRate GetMinFee(size_t sizelimit) const;
+    // END OF MEMORY LIMIT METHODS
+
     void clear();
     void queryHashes(std::vector<uint256>& vtxid) const;
+    /** All the hashes in the pool, each listed after the transactions and certificates it depends on */
+    void queryHashesByDependencies(std::vector<uint256>& vHashes) const;
     void pruneSpent(const uint256& hash, CCoins &coins);
     unsigned int GetTransactionsUpdated() const;
     void AddTransactionsUpdated(unsigned int n);
@@ -277,7 +378,7 @@ public:
 
     /** Affect CreateNewBlock prioritisation of transactions */
     void PrioritiseTransaction(const uint256& hash, const std::string& strHash, double dPriorityDelta, const CAmount& nFeeDelta);
-    void ApplyDeltas(const uint256& hash, double &dPriorityDelta, CAmount &nFeeDelta);
+    void ApplyDeltas(const uint256& hash, double &dPriorityDelta, CAmount &nFeeDelta) const;
     void ClearPrioritisation(const uint256& hash);
 
     void NotifyRecentlyAdded();
@@ -351,7 +452,7 @@ public:
     bool HaveCswNullifier(const uint256& scId, const CFieldElement &nullifier) const
     {
         LOCK(cs);
-        return mapSidechains.count(scId) != 0 && mapSidechains.at(scId).cswNullifiers.count(nullifier) != 0;
+        return mapSidechains.count(scId) != 0 && mapSidechains.at(scId).cswNullifiers.count(CswNullifierKey(nullifier));
     }
 
     bool hasSidechainBwtRequest(const uint256& scId) const
@@ -371,10 +472,14 @@ public:
     bool lookup(const uint256& hash, CTransaction& result) const;
     bool lookup(const uint256& hash, CScCertificate& result) const;
 
+    /** Keep the relay payload of a transaction or certificate with its entry, so it is serialized only once */
+    void SetRelayPayload(const uint256& hash, const std::shared_ptr<const CRelayPayload>& payload);
+    std::shared_ptr<const CRelayPayload> GetRelayPayload(const uint256& hash) const;
+
     void CertQualityStatusString(const CScCertificate& cert, std::string& statusString) const;
 
-    /** Estimate fee rate needed to get into the next nBlocks */
-    CFeeRate estimateFee(int nBlocks) const;
+    /** Estimate fee rate needed to get into the next nBlocks, for the given kind of transaction */
+    CFeeRate estimateFee(int nBlocks, FeeEstimateType type = FEE_ESTIMATE_TX) const;
 
     /** Estimate priority needed to get into the next nBlocks */
     double estimatePriority(int nBlocks) const;
@@ -106,6 +106,9 @@ public:
 
     std::string write(unsigned int prettyIndent = 0,
                       unsigned int indentLevel = 0) const;
+    // Append the JSON text to s, without building intermediate strings
+    void write(std::string& s, unsigned int prettyIndent = 0,
+               unsigned int indentLevel = 0) const;
 
     bool read(const char *raw, size_t len);
     bool read(const char *raw) { return read(raw, strlen(raw)); }
@@ -123,6 +126,8 @@ private:
     void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
 
+    friend class UniValueBuilder;
+
 public:
     // Strict type-specific getters, these throw std::runtime_error if the
     // value is of unexpected type
@@ -236,6 +241,64 @@ extern enum jtokentype getJsonToken(std::string& tokenVal,
                                     unsigned int& consumed, const char *raw, const char *end);
 extern const char *uvTypeName(UniValue::VType t);
 
+/**
+ * Receives the contents of a JSON text from parseJson() as they are read,
+ * without a UniValue being built for them. The strings passed to the
+ * handler may be moved from. Returning false stops the parse, which then
+ * fails.
+ */
+class UniValueHandler {
+public:
+    virtual ~UniValueHandler() {}
+
+    virtual bool onNull() = 0;
+    virtual bool onBool(bool val) = 0;
+    virtual bool onNumber(std::string& val) = 0;
+    virtual bool onString(std::string& val) = 0;
+    // Name of the next member of the current object
+    virtual bool onKey(std::string& key) = 0;
+    virtual bool onObjectStart() = 0;
+    virtual bool onObjectEnd() = 0;
+    virtual bool onArrayStart() = 0;
+    virtual bool onArrayEnd() = 0;
+};
+
+/**
+ * Handler building a UniValue, as UniValue::read does. It can be handed
+ * the events of a single value taken out of a larger text, complete()
+ * tells when that value ended.
+ */
+class UniValueBuilder : public UniValueHandler {
+public:
+    explicit UniValueBuilder(UniValue& rootIn) : root(rootIn), started(false) { root.clear(); }
+
+    bool complete() const { return started && stack.empty(); }
+
+    bool onNull();
+    bool onBool(bool val);
+    bool onNumber(std::string& val);
+    bool onString(std::string& val);
+    bool onKey(std::string& key);
+    bool onObjectStart();
+    bool onObjectEnd();
+    bool onArrayStart();
+    bool onArrayEnd();
+
+private:
+    UniValue& root;
+    std::vector<UniValue*> stack;
+    bool started;
+
+    UniValue *add(UniValue::VType typ);
+    bool close(UniValue::VType typ);
+};
+
+/**
+ * Parse the JSON text raw[0..size), passing its contents to handler.
+ * Returns false if the text is not valid JSON or the handler stopped.
+ */
+extern bool parseJson(const char *raw, size_t size, UniValueHandler& handler);
+
 static inline bool jsonTokenIsValue(enum jtokentype jtt)
 {
     switch (jtt) {
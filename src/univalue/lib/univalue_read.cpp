@@ -21,6 +21,13 @@ static bool json_isdigit(int ch)
     return ((ch >= '0') && (ch <= '9'));
 }
 
+// 7-bit ASCII char standing for itself inside a string
+static inline bool json_isplain(char ch)
+{
+    unsigned char uch = (unsigned char)ch;
+    return uch >= 0x20 && uch < 0x80 && ch != '"' && ch != '\\';
+}
+
 // convert hexadecimal string to unsigned integer
 static const char *hatoui(const char *first, const char *last,
                           unsigned int& out)
@@ -120,8 +127,6 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
     case '8':
     case '9': {
         // part 1: int
-        std::string numStr;
-
         const char *first = raw;
 
         const char *firstDigit = first;
@@ -130,49 +135,38 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
         if ((*firstDigit == '0') && json_isdigit(firstDigit[1]))
             return JTOK_ERR;
 
-        numStr += *raw;                       // copy first char
-        raw++;
+        raw++;                                // skip first char
 
         if ((*first == '-') && (raw < end) && (!json_isdigit(*raw)))
             return JTOK_ERR;
 
-        while (raw < end && json_isdigit(*raw)) {  // copy digits
-            numStr += *raw;
+        while (raw < end && json_isdigit(*raw))  // skip digits
             raw++;
-        }
 
         // part 2: frac
         if (raw < end && *raw == '.') {
-            numStr += *raw;                   // copy .
-            raw++;
+            raw++;                            // skip .
 
             if (raw >= end || !json_isdigit(*raw))
                 return JTOK_ERR;
-            while (raw < end && json_isdigit(*raw)) { // copy digits
-                numStr += *raw;
+            while (raw < end && json_isdigit(*raw)) // skip digits
                 raw++;
-            }
         }
 
         // part 3: exp
         if (raw < end && (*raw == 'e' || *raw == 'E')) {
-            numStr += *raw;                   // copy E
-            raw++;
+            raw++;                            // skip E
 
-            if (raw < end && (*raw == '-' || *raw == '+')) { // copy +/-
-                numStr += *raw;
+            if (raw < end && (*raw == '-' || *raw == '+')) // skip +/-
                 raw++;
-            }
 
             if (raw >= end || !json_isdigit(*raw))
                 return JTOK_ERR;
-            while (raw < end && json_isdigit(*raw)) { // copy digits
-                numStr += *raw;
+            while (raw < end && json_isdigit(*raw)) // skip digits
                 raw++;
-            }
         }
 
-        tokenVal = numStr;
+        tokenVal.assign(first, raw);          // copy the number at once
         consumed = (raw - rawStart);
         return JTOK_NUMBER;
         }
@@ -227,14 +221,23 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
             }
 
             else {
-                writer.push_back(*raw);
-                raw++;
+                // Plain ASCII runs, such as hex strings, are copied at once
+                const char *run = raw;
+                while (run < end && json_isplain(*run))
+                    run++;
+                if (run != raw) {
+                    writer.append_ascii(raw, run);
+                    raw = run;
+                } else {
+                    writer.push_back(*raw);
+                    raw++;
+                }
             }
         }
 
         if (!writer.finalize())
             return JTOK_ERR;
-        tokenVal = valStr;
+        tokenVal.swap(valStr);
         consumed = (raw - rawStart);
         return JTOK_STRING;
         }
@@ -256,12 +259,11 @@ enum expect_bits {
 #define setExpect(bit) (expectMask |= EXP_##bit)
 #define clearExpect(bit) (expectMask &= ~EXP_##bit)
 
-bool UniValue::read(const char *raw, size_t size)
+bool parseJson(const char *raw, size_t size, UniValueHandler& handler)
 {
-    clear();
-
     uint32_t expectMask = 0;
-    std::vector<UniValue*> stack;
+    // Types of the objects and arrays open
+    std::vector<UniValue::VType> stack;
 
     std::string tokenVal;
     unsigned int consumed;
@@ -273,7 +275,7 @@ bool UniValue::read(const char *raw, size_t size)
 
         tok = getJsonToken(tokenVal, consumed, raw, end);
         if (tok == JTOK_NONE || tok == JTOK_ERR)
-            goto return_fail;
+            return false;
         raw += consumed;
 
         bool isValueOpen = jsonTokenIsValue(tok) ||
@@ -281,33 +283,33 @@ bool UniValue::read(const char *raw, size_t size)
 
         if (expect(VALUE)) {
             if (!isValueOpen)
-                goto return_fail;
+                return false;
             clearExpect(VALUE);
 
         } else if (expect(ARR_VALUE)) {
             bool isArrValue = isValueOpen || (tok == JTOK_ARR_CLOSE);
             if (!isArrValue)
-                goto return_fail;
+                return false;
 
             clearExpect(ARR_VALUE);
 
         } else if (expect(OBJ_NAME)) {
             bool isObjName = (tok == JTOK_OBJ_CLOSE || tok == JTOK_STRING);
             if (!isObjName)
-                goto return_fail;
+                return false;
 
         } else if (expect(COLON)) {
             if (tok != JTOK_COLON)
-                goto return_fail;
+                return false;
             clearExpect(COLON);
 
         } else if (!expect(COLON) && (tok == JTOK_COLON)) {
-            goto return_fail;
+            return false;
         }
 
         if (expect(NOT_VALUE)) {
             if (isValueOpen)
-                goto return_fail;
+                return false;
             clearExpect(NOT_VALUE);
         }
 
@@ -315,55 +317,43 @@ bool UniValue::read(const char *raw, size_t size)
 
         case JTOK_OBJ_OPEN:
         case JTOK_ARR_OPEN: {
-            VType utyp = (tok == JTOK_OBJ_OPEN ? VOBJ : VARR);
-            if (!stack.size()) {
-                if (utyp == VOBJ)
-                    setObject();
-                else
-                    setArray();
-                stack.push_back(this);
-            } else {
-                UniValue tmpVal(utyp);
-                UniValue *top = stack.back();
-                top->values.push_back(tmpVal);
-
-                UniValue *newTop = &(top->values.back());
-                stack.push_back(newTop);
-            }
-
+            UniValue::VType utyp = (tok == JTOK_OBJ_OPEN ? UniValue::VOBJ : UniValue::VARR);
+            stack.push_back(utyp);
             if (stack.size() > MAX_JSON_DEPTH)
-                goto return_fail;
+                return false;
 
-            if (utyp == VOBJ)
+            if (utyp == UniValue::VOBJ) {
+                if (!handler.onObjectStart())
+                    return false;
                 setExpect(OBJ_NAME);
-            else
+            } else {
+                if (!handler.onArrayStart())
+                    return false;
                 setExpect(ARR_VALUE);
+            }
             break;
             }
 
         case JTOK_OBJ_CLOSE:
         case JTOK_ARR_CLOSE: {
             if (!stack.size() || (last_tok == JTOK_COMMA))
-                goto return_fail;
+                return false;
 
-            VType utyp = (tok == JTOK_OBJ_CLOSE ? VOBJ : VARR);
-            UniValue *top = stack.back();
-            if (utyp != top->getType())
-                goto return_fail;
+            UniValue::VType utyp = (tok == JTOK_OBJ_CLOSE ? UniValue::VOBJ : UniValue::VARR);
+            if (utyp != stack.back())
+                return false;
 
             stack.pop_back();
+            if (!(utyp == UniValue::VOBJ ? handler.onObjectEnd() : handler.onArrayEnd()))
+                return false;
             clearExpect(OBJ_NAME);
             setExpect(NOT_VALUE);
             break;
             }
 
         case JTOK_COLON: {
-            if (!stack.size())
-                goto return_fail;
-
-            UniValue *top = stack.back();
-            if (top->getType() != VOBJ)
-                goto return_fail;
+            if (!stack.size() || stack.back() != UniValue::VOBJ)
+                return false;
 
             setExpect(VALUE);
             break;
@@ -372,10 +362,9 @@ bool UniValue::read(const char *raw, size_t size)
         case JTOK_COMMA: {
             if (!stack.size() ||
                 (last_tok == JTOK_COMMA) || (last_tok == JTOK_ARR_OPEN))
-                goto return_fail;
+                return false;
 
-            UniValue *top = stack.back();
-            if (top->getType() == VOBJ)
+            if (stack.back() == UniValue::VOBJ)
                 setExpect(OBJ_NAME);
             else
                 setExpect(ARR_VALUE);
@@ -385,41 +374,17 @@ bool UniValue::read(const char *raw, size_t size)
         case JTOK_KW_NULL:
         case JTOK_KW_TRUE:
         case JTOK_KW_FALSE: {
-            UniValue tmpVal;
-            switch (tok) {
-            case JTOK_KW_NULL:
-                // do nothing more
-                break;
-            case JTOK_KW_TRUE:
-                tmpVal.setBool(true);
-                break;
-            case JTOK_KW_FALSE:
-                tmpVal.setBool(false);
-                break;
-            default: /* impossible */ break;
-            }
-
-            if (!stack.size()) {
-                *this = tmpVal;
-                break;
-            }
-
-            UniValue *top = stack.back();
-            top->values.push_back(tmpVal);
+            bool ok = (tok == JTOK_KW_NULL ? handler.onNull() : handler.onBool(tok == JTOK_KW_TRUE));
+            if (!ok)
+                return false;
 
             setExpect(NOT_VALUE);
             break;
             }
 
         case JTOK_NUMBER: {
-            UniValue tmpVal(VNUM, tokenVal);
-            if (!stack.size()) {
-                *this = tmpVal;
-                break;
-            }
-
-            UniValue *top = stack.back();
-            top->values.push_back(tmpVal);
+            if (!handler.onNumber(tokenVal))
+                return false;
 
             setExpect(NOT_VALUE);
             break;
@@ -427,18 +392,13 @@ bool UniValue::read(const char *raw, size_t size)
 
         case JTOK_STRING: {
             if (expect(OBJ_NAME)) {
-                UniValue *top = stack.back();
-                top->keys.push_back(tokenVal);
+                if (!handler.onKey(tokenVal))
+                    return false;
                 clearExpect(OBJ_NAME);
                 setExpect(COLON);
             } else {
-                UniValue tmpVal(VSTR, tokenVal);
-                if (!stack.size()) {
-                    *this = tmpVal;
-                    break;
-                }
-                UniValue *top = stack.back();
-                top->values.push_back(tmpVal);
+                if (!handler.onString(tokenVal))
+                    return false;
             }
 
             setExpect(NOT_VALUE);
@@ -446,19 +406,111 @@ bool UniValue::read(const char *raw, size_t size)
             }
 
         default:
-            goto return_fail;
+            return false;
         }
     } while (!stack.empty ());
 
     /* Check that nothing follows the initial construct (parsed above).  */
     tok = getJsonToken(tokenVal, consumed, raw, end);
     if (tok != JTOK_NONE)
-        goto return_fail;
+        return false;
+
+    return true;
+}
+
+UniValue *UniValueBuilder::add(UniValue::VType typ)
+{
+    if (!started) {
+        started = true;
+        root.typ = typ;
+        return &root;
+    }
+    if (stack.empty())
+        return NULL;
+
+    UniValue *top = stack.back();
+    top->values.push_back(UniValue(typ));
+    return &top->values.back();
+}
+
+bool UniValueBuilder::close(UniValue::VType typ)
+{
+    if (stack.empty() || stack.back()->typ != typ)
+        return false;
+    stack.pop_back();
+    return true;
+}
+
+bool UniValueBuilder::onNull()
+{
+    return add(UniValue::VNULL) != NULL;
+}
+
+bool UniValueBuilder::onBool(bool val)
+{
+    UniValue *v = add(UniValue::VBOOL);
+    if (v && val)
+        v->val = "1";
+    return v != NULL;
+}
+
+bool UniValueBuilder::onNumber(std::string& val)
+{
+    UniValue *v = add(UniValue::VNUM);
+    if (v)
+        v->val.swap(val);
+    return v != NULL;
+}
+
+bool UniValueBuilder::onString(std::string& val)
+{
+    UniValue *v = add(UniValue::VSTR);
+    if (v)
+        v->val.swap(val);
+    return v != NULL;
+}
 
+bool UniValueBuilder::onKey(std::string& key)
+{
+    if (stack.empty() || stack.back()->typ != UniValue::VOBJ)
+        return false;
+    stack.back()->keys.push_back(std::string());
+    stack.back()->keys.back().swap(key);
     return true;
+}
+
+bool UniValueBuilder::onObjectStart()
+{
+    UniValue *v = add(UniValue::VOBJ);
+    if (v)
+        stack.push_back(v);
+    return v != NULL;
+}
+
+bool UniValueBuilder::onObjectEnd()
+{
+    return close(UniValue::VOBJ);
+}
 
-return_fail:
-    clear();
-    return false;
+bool UniValueBuilder::onArrayStart()
+{
+    UniValue *v = add(UniValue::VARR);
+    if (v)
+        stack.push_back(v);
+    return v != NULL;
 }
 
+bool UniValueBuilder::onArrayEnd()
+{
+    return close(UniValue::VARR);
+}
+
+bool UniValue::read(const char *raw, size_t size)
+{
+    UniValueBuilder builder(*this);
+    if (!parseJson(raw, size, builder)) {
+        clear();
+        return false;
+    }
+    return true;
+}
@@ -398,6 +398,92 @@ BOOST_AUTO_TEST_CASE(univalue_readwrite)
     BOOST_CHECK(!v.read("{} 42"));
 }
 
+// Records the events of a parse as a string
+class TraceHandler : public UniValueHandler {
+public:
+    std::string trace;
+    std::string stopAt;
+
+    bool onNull() { return add("null"); }
+    bool onBool(bool val) { return add(val ? "true" : "false"); }
+    bool onNumber(std::string& val) { return add("n:" + val); }
+    bool onString(std::string& val) { return add("s:" + val); }
+    bool onKey(std::string& key) { return add("k:" + key); }
+    bool onObjectStart() { return add("{"); }
+    bool onObjectEnd() { return add("}"); }
+    bool onArrayStart() { return add("["); }
+    bool onArrayEnd() { return add("]"); }
+
+private:
+    bool add(const std::string& event)
+    {
+        trace += event + " ";
+        return event != stopAt;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(univalue_parsehandler)
+{
+    TraceHandler handler;
+    BOOST_CHECK(parseJson(json1, strlen(json1), handler));
+    std::string expected = "[ n:1.10000000 { k:key1 s:str";
+    expected.push_back('\0');
+    expected += " k:key2 n:800 k:key3 { k:name s:martian http://test.com } } ] ";
+    BOOST_CHECK_EQUAL(handler.trace, expected);
+
+    // The handler can stop the parse
+    TraceHandler stopping;
+    stopping.stopAt = "k:key2";
+    BOOST_CHECK(!parseJson(json1, strlen(json1), stopping));
+    BOOST_CHECK_EQUAL(stopping.trace.find("n:800"), std::string::npos);
+
+    TraceHandler invalid;
+    const char *text = "[1,2,}";
+    BOOST_CHECK(!parseJson(text, strlen(text), invalid));
+
+    // A builder handed the events of a single value
+    UniValue v;
+    UniValueBuilder builder(v);
+    BOOST_CHECK(!builder.complete());
+    std::string key("key");
+    std::string str("str");
+    BOOST_CHECK(builder.onObjectStart());
+    BOOST_CHECK(builder.onKey(key));
+    BOOST_CHECK(builder.onString(str));
+    BOOST_CHECK(!builder.complete());
+    BOOST_CHECK(builder.onObjectEnd());
+    BOOST_CHECK(builder.complete());
+    BOOST_CHECK(!builder.onNull());
+    BOOST_CHECK_EQUAL(v.write(), "{\"key\":\"str\"}");
+}
+
+BOOST_AUTO_TEST_CASE(univalue_largestrings)
+{
+    // Long runs of plain chars, as hex strings, mixed with escapes
+    std::string hex;
+    for (int i = 0; i < 100000; i++)
+        hex += "0123456789abcdef";
+    std::string mixed = hex + "\"\n\\" + hex + "\xc3\xa9" + hex;
+
+    UniValue arr(UniValue::VARR);
+    arr.push_back(hex);
+    arr.push_back(mixed);
+
+    std::string out = "prefix";
+    arr.write(out);
+    BOOST_CHECK_EQUAL(out, "prefix" + arr.write());
+
+    UniValue v;
+    BOOST_CHECK(v.read(out.substr(6)));
+    BOOST_CHECK(v.isArray());
+    BOOST_CHECK_EQUAL(v.size(), 2);
+    BOOST_CHECK_EQUAL(v[0].get_str(), hex);
+    BOOST_CHECK_EQUAL(v[1].get_str(), mixed);
+
+    // A UTF-8 sequence cut by an ASCII run is still rejected
+    BOOST_CHECK(!v.read("[\"\xc3" + hex + "\"]"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 int main (int argc, char *argv[])
@@ -408,6 +494,8 @@ int main (int argc, char *argv[])
     univalue_array();
     univalue_object();
     univalue_readwrite();
+    univalue_parsehandler();
+    univalue_largestrings();
     return 0;
 }
 
@@ -4,9 +4,16 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "validationinterface.h"
+#include <primitives/block.h>
 #include <primitives/certificate.h>
+#include "util.h"
+#include "utiltime.h"
 
-using namespace boost::placeholders;
+#include <algorithm>
+#include <limits>
+
+// How long the queue thread may deliver nothing before it is deemed stalled
+static const int64_t VALIDATION_QUEUE_STALL_MILLIS = 100;
 
 static CMainSignals g_signals;
 
@@ -15,46 +22,362 @@ CMainSignals& GetMainSignals()
     return g_signals;
 }
 
+CMainSignals::CMainSignals() :
+    nQueuedListeners(0), fRunning(false), fStopRequested(false), fDispatching(false),
+    nMaxDepth(0), nPeakDepth(0), nQueued(0), nDispatched(0), nStalledAt(std::numeric_limits<uint64_t>::max()),
+    nBlocked(0), nTotalBlockedMicros(0), nMaxBlockedMicros(0), nOverflowed(0), nTotalWaitMicros(0), nMaxWaitMicros(0),
+    pLastBlock(NULL)
+{
+}
+
+CMainSignals::~CMainSignals()
+{
+    StopQueue();
+}
+
+void CMainSignals::Register(CValidationInterface* listener)
+{
+    std::shared_ptr<Listener> entry = std::make_shared<Listener>();
+    entry->listener = listener;
+    entry->stats.name = listener->ValidationInterfaceName();
+    entry->stats.fSynchronous = listener->IsSynchronous();
+
+    boost::lock_guard<boost::mutex> lock(cs_listeners);
+    listeners.push_back(entry);
+    if (!entry->stats.fSynchronous)
+        nQueuedListeners++;
+}
+
+void CMainSignals::Unregister(CValidationInterface* listener)
+{
+    {
+        boost::lock_guard<boost::mutex> lock(cs_listeners);
+        for (auto it = listeners.begin(); it != listeners.end(); ++it) {
+            if ((*it)->listener == listener) {
+                if (!(*it)->stats.fSynchronous)
+                    nQueuedListeners--;
+                listeners.erase(it);
+                break;
+            }
+        }
+    }
+
+    WaitForDispatch();
+}
+
+void CMainSignals::UnregisterAll()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(cs_listeners);
+        listeners.clear();
+        nQueuedListeners = 0;
+    }
+
+    WaitForDispatch();
+}
+
+// Wait for the queue thread to be done with the event it may be delivering
+// to a listener just unregistered, unless it is the caller.
+void CMainSignals::WaitForDispatch()
+{
+    if (thread.get_id() == boost::this_thread::get_id())
+        return;
+
+    boost::lock_guard<boost::mutex> lock(cs_dispatch);
+}
+
+void CMainSignals::StartQueue(size_t nMaxDepthIn)
+{
+    boost::lock_guard<boost::mutex> lock(cs_queue);
+    if (fRunning)
+        return;
+
+    nMaxDepth = std::max<size_t>(nMaxDepthIn, 1);
+    fStopRequested = false;
+    fRunning = true;
+    thread = boost::thread(&CMainSignals::ThreadQueue, this);
+}
+
+void CMainSignals::StopQueue()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(cs_queue);
+        if (!fRunning)
+            return;
+        fStopRequested = true;
+    }
+    condQueue.notify_all();
+    thread.join();
+
+    boost::lock_guard<boost::mutex> lock(cs_queue);
+    fRunning = false;
+    pLastBlock = NULL;
+    lastBlock.reset();
+}
+
+void CMainSignals::FlushQueue()
+{
+    boost::unique_lock<boost::mutex> lock(cs_queue);
+    while (fRunning && (!queue.empty() || fDispatching))
+        condQueue.wait(lock);
+}
+
+CValidationQueueStats CMainSignals::GetQueueStats() const
+{
+    CValidationQueueStats stats;
+    {
+        boost::lock_guard<boost::mutex> lock(cs_queue);
+        stats.fRunning = fRunning;
+        stats.nDepth = queue.size();
+        stats.nMaxDepth = nMaxDepth;
+        stats.nPeakDepth = nPeakDepth;
+        stats.nQueued = nQueued;
+        stats.nBlocked = nBlocked;
+        stats.nTotalBlockedMicros = nTotalBlockedMicros;
+        stats.nMaxBlockedMicros = nMaxBlockedMicros;
+        stats.nOverflowed = nOverflowed;
+        stats.nTotalWaitMicros = nTotalWaitMicros;
+        stats.nMaxWaitMicros = nMaxWaitMicros;
+    }
+
+    boost::lock_guard<boost::mutex> lock(cs_listeners);
+    for (const auto& entry : listeners)
+        stats.listeners.push_back(entry->stats);
+    return stats;
+}
+
+void CMainSignals::Dispatch(const Callback& call, DispatchTarget target)
+{
+    std::vector<std::shared_ptr<Listener> > targets;
+    {
+        boost::lock_guard<boost::mutex> lock(cs_listeners);
+        for (const auto& entry : listeners) {
+            if (target == DISPATCH_ALL || entry->stats.fSynchronous == (target == DISPATCH_SYNCHRONOUS))
+                targets.push_back(entry);
+        }
+    }
+
+    // Listeners are called without holding cs_listeners, they may fire
+    // events themselves.
+    for (const auto& entry : targets) {
+        int64_t nStart = GetTimeMicros();
+        call(entry->listener);
+        int64_t nElapsed = GetTimeMicros() - nStart;
+
+        boost::lock_guard<boost::mutex> lock(cs_listeners);
+        entry->stats.nEvents++;
+        entry->stats.nTotalMicros += nElapsed;
+        entry->stats.nMaxMicros = std::max(entry->stats.nMaxMicros, nElapsed);
+    }
+}
+
+// The synchronous listeners get the event right away. The others get it
+// through the queue, with the copy of the event data made by makeQueued, or
+// right away as well when the queue is not running.
+void CMainSignals::Fire(const Callback& call, const std::function<Callback ()>& makeQueued)
+{
+    Dispatch(call, DISPATCH_SYNCHRONOUS);
+
+    {
+        boost::lock_guard<boost::mutex> lock(cs_listeners);
+        if (nQueuedListeners == 0)
+            return;
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(cs_queue);
+        if (fRunning && !fStopRequested && queue.size() >= nMaxDepth)
+            WaitForRoom(lock);
+        if (fRunning && !fStopRequested) {
+            if (queue.size() >= nMaxDepth)
+                nOverflowed++;
+
+            QueuedEvent event;
+            event.call = makeQueued();
+            event.nTimeQueued = GetTimeMicros();
+            queue.push_back(std::move(event));
+            nQueued++;
+            nPeakDepth = std::max(nPeakDepth, queue.size());
+            condQueue.notify_all();
+            return;
+        }
+    }
+
+    Dispatch(call, DISPATCH_QUEUED);
+}
+
+// Called with cs_queue held, through lock. The queue thread itself never waits,
+// it is the one making room. The thread firing the event may hold a lock a
+// queued listener is waiting for, so the wait is given up once the queue thread
+// delivers nothing for VALIDATION_QUEUE_STALL_MILLIS, and not tried again until
+// it delivers an event.
+void CMainSignals::WaitForRoom(boost::unique_lock<boost::mutex>& lock)
+{
+    if (thread.get_id() == boost::this_thread::get_id() || nDispatched == nStalledAt)
+        return;
+
+    int64_t nStart = GetTimeMicros();
+    while (queue.size() >= nMaxDepth && !fStopRequested && nDispatched != nStalledAt) {
+        uint64_t nDispatchedBefore = nDispatched;
+        boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(VALIDATION_QUEUE_STALL_MILLIS);
+        while (nDispatched == nDispatchedBefore && !fStopRequested) {
+            if (!condQueue.timed_wait(lock, deadline)) {
+                if (nDispatched == nDispatchedBefore)
+                    nStalledAt = nDispatchedBefore;
+                break;
+            }
+        }
+    }
+
+    int64_t nWait = GetTimeMicros() - nStart;
+    nBlocked++;
+    nTotalBlockedMicros += nWait;
+    nMaxBlockedMicros = std::max(nMaxBlockedMicros, nWait);
+}
+
+// Called with cs_queue held
+std::shared_ptr<const CBlock> CMainSignals::ShareBlock(const CBlock* pblock)
+{
+    if (pblock == NULL)
+        return std::shared_ptr<const CBlock>();
+
+    // The transactions of a block are synced one by one with the same block
+    if (pblock != pLastBlock || lastBlock->hashMerkleRoot != pblock->hashMerkleRoot ||
+        lastBlock->vtx.size() != pblock->vtx.size() || lastBlock->vcert.size() != pblock->vcert.size()) {
+        lastBlock = std::make_shared<const CBlock>(*pblock);
+        pLastBlock = pblock;
+    }
+    return lastBlock;
+}
+
+void CMainSignals::ThreadQueue()
+{
+    RenameThread("horizen-validation");
+
+    while (true) {
+        QueuedEvent event;
+        {
+            boost::unique_lock<boost::mutex> lock(cs_queue);
+            while (queue.empty() && !fStopRequested)
+                condQueue.wait(lock);
+            if (queue.empty())
+                break;
+
+            event = std::move(queue.front());
+            queue.pop_front();
+            fDispatching = true;
+
+            int64_t nWait = GetTimeMicros() - event.nTimeQueued;
+            nTotalWaitMicros += nWait;
+            nMaxWaitMicros = std::max(nMaxWaitMicros, nWait);
+        }
+
+        {
+            boost::lock_guard<boost::mutex> lock(cs_dispatch);
+            try {
+                Dispatch(event.call, DISPATCH_QUEUED);
+            } catch (const std::exception& e) {
+                PrintExceptionContinue(&e, "CMainSignals::ThreadQueue()");
+            } catch (...) {
+                PrintExceptionContinue(NULL, "CMainSignals::ThreadQueue()");
+            }
+        }
+
+        {
+            boost::lock_guard<boost::mutex> lock(cs_queue);
+            fDispatching = false;
+            nDispatched++;
+        }
+        condQueue.notify_all();
+    }
+}
+
+void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindex)
+{
+    Fire([&](CValidationInterface* l) { l->UpdatedBlockTip(pindex); },
+         [&]() { return Callback([=](CValidationInterface* l) { l->UpdatedBlockTip(pindex); }); });
+}
+
+void CMainSignals::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+{
+    Fire([&](CValidationInterface* l) { l->SyncTransaction(tx, pblock); },
+         [&]() {
+             std::shared_ptr<const CTransaction> ptx = std::make_shared<const CTransaction>(tx);
+             std::shared_ptr<const CBlock> block = ShareBlock(pblock);
+             return Callback([=](CValidationInterface* l) { l->SyncTransaction(*ptx, block.get()); });
+         });
+}
+
+void CMainSignals::EraseTransaction(const uint256 &hash)
+{
+    Fire([&](CValidationInterface* l) { l->EraseFromWallet(hash); },
+         [&]() { return Callback([=](CValidationInterface* l) { l->EraseFromWallet(hash); }); });
+}
+
+void CMainSignals::UpdatedTransaction(const uint256 &hash)
+{
+    Fire([&](CValidationInterface* l) { l->UpdatedTransaction(hash); },
+         [&]() { return Callback([=](CValidationInterface* l) { l->UpdatedTransaction(hash); }); });
+}
+
+void CMainSignals::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added)
+{
+    Fire([&](CValidationInterface* l) { l->ChainTip(pindex, pblock, tree, added); },
+         [&]() {
+             std::shared_ptr<const CBlock> block = ShareBlock(pblock);
+             return Callback([=](CValidationInterface* l) { l->ChainTip(pindex, block.get(), tree, added); });
+         });
+}
+
+void CMainSignals::SetBestChain(const CBlockLocator &locator)
+{
+    Fire([&](CValidationInterface* l) { l->SetBestChain(locator); },
+         [&]() { return Callback([=](CValidationInterface* l) { l->SetBestChain(locator); }); });
+}
+
+void CMainSignals::Inventory(const uint256 &hash)
+{
+    Fire([&](CValidationInterface* l) { l->Inventory(hash); },
+         [&]() { return Callback([=](CValidationInterface* l) { l->Inventory(hash); }); });
+}
+
+void CMainSignals::Broadcast(int64_t nBestBlockTime)
+{
+    Fire([&](CValidationInterface* l) { l->ResendWalletTransactions(nBestBlockTime); },
+         [&]() { return Callback([=](CValidationInterface* l) { l->ResendWalletTransactions(nBestBlockTime); }); });
+}
+
+void CMainSignals::BlockChecked(const CBlock &block, const CValidationState &state)
+{
+    Dispatch([&](CValidationInterface* l) { l->BlockChecked(block, state); }, DISPATCH_ALL);
+}
+
+void CMainSignals::SyncCertificate(const CScCertificate &cert, const CBlock *pblock, int bwtMaturityDepth)
+{
+    Fire([&](CValidationInterface* l) { l->SyncCertificate(cert, pblock, bwtMaturityDepth); },
+         [&]() {
+             std::shared_ptr<const CScCertificate> pcert = std::make_shared<const CScCertificate>(cert);
+             std::shared_ptr<const CBlock> block = ShareBlock(pblock);
+             return Callback([=](CValidationInterface* l) { l->SyncCertificate(*pcert, block.get(), bwtMaturityDepth); });
+         });
+}
+
+void CMainSignals::SyncCertStatus(const CScCertificateStatusUpdateInfo& certStatusInfo)
+{
+    Fire([&](CValidationInterface* l) { l->SyncCertStatusInfo(certStatusInfo); },
+         [&]() { return Callback([=](CValidationInterface* l) { l->SyncCertStatusInfo(certStatusInfo); }); });
+}
+
 void RegisterValidationInterface(CValidationInterface* pwalletIn) {
-    g_signals.UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
-    g_signals.SyncTransaction.connect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2));
-    g_signals.EraseTransaction.connect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
-    g_signals.UpdatedTransaction.connect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
-    g_signals.ChainTip.connect(boost::bind(&CValidationInterface::ChainTip, pwalletIn, _1, _2, _3, _4));
-    g_signals.SetBestChain.connect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
-    g_signals.Inventory.connect(boost::bind(&CValidationInterface::Inventory, pwalletIn, _1));
-    g_signals.Broadcast.connect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
-    g_signals.BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
-    g_signals.SyncCertificate.connect(boost::bind(&CValidationInterface::SyncCertificate, pwalletIn, _1, _2, _3));
-    g_signals.SyncCertStatus.connect(boost::bind(&CValidationInterface::SyncCertStatusInfo, pwalletIn, _1));
+    g_signals.Register(pwalletIn);
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
-    g_signals.SyncCertStatus.disconnect(boost::bind(&CValidationInterface::SyncCertStatusInfo, pwalletIn, _1));
-    g_signals.SyncCertificate.disconnect(boost::bind(&CValidationInterface::SyncCertificate, pwalletIn, _1, _2, _3));
-    g_signals.BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
-    g_signals.Broadcast.disconnect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
-    g_signals.Inventory.disconnect(boost::bind(&CValidationInterface::Inventory, pwalletIn, _1));
-    g_signals.ChainTip.disconnect(boost::bind(&CValidationInterface::ChainTip, pwalletIn, _1, _2, _3, _4));
-    g_signals.SetBestChain.disconnect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
-    g_signals.UpdatedTransaction.disconnect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
-    g_signals.EraseTransaction.disconnect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
-    g_signals.SyncTransaction.disconnect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2));
-    g_signals.UpdatedBlockTip.disconnect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
+    g_signals.Unregister(pwalletIn);
 }
 
 void UnregisterAllValidationInterfaces() {
-    g_signals.SyncCertificate.disconnect_all_slots();
-    g_signals.SyncCertStatus.disconnect_all_slots();
-    g_signals.BlockChecked.disconnect_all_slots();
-    g_signals.Broadcast.disconnect_all_slots();
-    g_signals.Inventory.disconnect_all_slots();
-    g_signals.ChainTip.disconnect_all_slots();
-    g_signals.SetBestChain.disconnect_all_slots();
-    g_signals.UpdatedTransaction.disconnect_all_slots();
-    g_signals.EraseTransaction.disconnect_all_slots();
-    g_signals.SyncTransaction.disconnect_all_slots();
-    g_signals.UpdatedBlockTip.disconnect_all_slots();
+    g_signals.UnregisterAll();
 }
 
 void SyncWithWallets(const CTransaction &tx, const CBlock *pblock) {
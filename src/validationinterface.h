@@ -6,7 +6,13 @@
 #ifndef BITCOIN_VALIDATIONINTERFACE_H
 #define BITCOIN_VALIDATIONINTERFACE_H
 
-#include <boost/signals2/signal.hpp>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
 
 #include "zcash/IncrementalMerkleTree.hpp"
 
@@ -36,7 +42,20 @@ void SyncWithWallets(const CScCertificate& cert, const CBlock* pblock = NULL, in
 /** Push to wallets updates about bwt state and related sidechain information */
 void SyncCertStatusUpdate(const CScCertificateStatusUpdateInfo& certStatusInfo);
 
+/** Default for -validationqueuedepth */
+static const unsigned int DEFAULT_VALIDATION_QUEUE_DEPTH = 1000;
+
 class CValidationInterface {
+public:
+    /**
+     * Listeners whose state must be updated before the validation code goes
+     * on, like the wallet, are called synchronously. The others are called
+     * from the validation queue thread.
+     */
+    virtual bool IsSynchronous() const { return false; }
+    /** Name of the listener in the dispatch statistics */
+    virtual std::string ValidationInterfaceName() const { return "unnamed"; }
+
 protected:
     virtual ~CValidationInterface() {}
     virtual void UpdatedBlockTip(const CBlockIndex *pindex) {}
@@ -50,34 +69,154 @@ protected:
     virtual void Inventory(const uint256 &hash) {}
     virtual void ResendWalletTransactions(int64_t nBestBlockTime) {}
     virtual void BlockChecked(const CBlock&, const CValidationState&) {}
-    friend void ::RegisterValidationInterface(CValidationInterface*);
-    friend void ::UnregisterValidationInterface(CValidationInterface*);
-    friend void ::UnregisterAllValidationInterfaces();
+    friend class CMainSignals;
+};
+
+/** Dispatch statistics of a listener */
+struct CValidationListenerStats
+{
+    std::string name;
+    bool fSynchronous;
+    uint64_t nEvents;
+    int64_t nTotalMicros;
+    int64_t nMaxMicros;
+
+    CValidationListenerStats() : fSynchronous(false), nEvents(0), nTotalMicros(0), nMaxMicros(0) {}
 };
 
-struct CMainSignals {
+/** Statistics of the validation queue */
+struct CValidationQueueStats
+{
+    bool fRunning;
+    size_t nDepth;
+    size_t nMaxDepth;
+    size_t nPeakDepth;
+    uint64_t nQueued;
+    uint64_t nBlocked;            //! events whose firing thread waited for room in the queue
+    int64_t nTotalBlockedMicros;
+    int64_t nMaxBlockedMicros;
+    uint64_t nOverflowed;         //! events queued beyond the depth, the queue thread being stalled
+    int64_t nTotalWaitMicros;
+    int64_t nMaxWaitMicros;
+    std::vector<CValidationListenerStats> listeners;
+
+    CValidationQueueStats() : fRunning(false), nDepth(0), nMaxDepth(0), nPeakDepth(0), nQueued(0), nBlocked(0),
+                              nTotalBlockedMicros(0), nMaxBlockedMicros(0), nOverflowed(0),
+                              nTotalWaitMicros(0), nMaxWaitMicros(0) {}
+};
+
+/**
+ * Dispatches the validation events to the registered listeners.
+ *
+ * Synchronous listeners are called by the thread firing the event. Once the
+ * queue is started, the other listeners get the events in order from a
+ * background thread, with copies of the event data, so that a slow listener
+ * does not hold back block connection and mempool acceptance, which fire
+ * most of the events while holding cs_main. The queue is bounded: a thread
+ * firing an event while it is full waits for the queue thread to make room.
+ * As the queued listeners may need cs_main too, once the queue thread delivers
+ * nothing for a while the event is queued beyond the depth instead, so no event
+ * is ever lost. BlockChecked is always dispatched synchronously, as the
+ * validation state it reports only lives during the call.
+ */
+class CMainSignals {
+public:
+    CMainSignals();
+    ~CMainSignals();
+
     /** Notifies listeners of updated block chain tip */
-    boost::signals2::signal<void (const CBlockIndex *)> UpdatedBlockTip;
+    void UpdatedBlockTip(const CBlockIndex *pindex);
     /** Notifies listeners of updated transaction data (transaction, and optionally the block it is found in. */
-    boost::signals2::signal<void (const CTransaction &, const CBlock *)> SyncTransaction;
+    void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
     /** Notifies listeners of an erased transaction (currently disabled, requires transaction replacement). */
-    boost::signals2::signal<void (const uint256 &)> EraseTransaction;
+    void EraseTransaction(const uint256 &hash);
     /** Notifies listeners of an updated transaction without new data (for now: a coinbase potentially becoming visible). */
-    boost::signals2::signal<void (const uint256 &)> UpdatedTransaction;
+    void UpdatedTransaction(const uint256 &hash);
     /** Notifies listeners of a change to the tip of the active block chain. */
-    boost::signals2::signal<void (const CBlockIndex *, const CBlock *, ZCIncrementalMerkleTree, bool)> ChainTip;
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added);
     /** Notifies listeners of a new active block chain. */
-    boost::signals2::signal<void (const CBlockLocator &)> SetBestChain;
+    void SetBestChain(const CBlockLocator &locator);
     /** Notifies listeners about an inventory item being seen on the network. */
-    boost::signals2::signal<void (const uint256 &)> Inventory;
+    void Inventory(const uint256 &hash);
     /** Tells listeners to broadcast their data. */
-    boost::signals2::signal<void (int64_t nBestBlockTime)> Broadcast;
+    void Broadcast(int64_t nBestBlockTime);
     /** Notifies listeners of a block validation result */
-    boost::signals2::signal<void (const CBlock&, const CValidationState&)> BlockChecked;
+    void BlockChecked(const CBlock &block, const CValidationState &state);
     /** Notifies listeners of updated certificate data (certificate, and optionally the block it is found in. */
-    boost::signals2::signal<void (const CScCertificate &, const CBlock *, int bwtMaturityDepth)> SyncCertificate;
+    void SyncCertificate(const CScCertificate &cert, const CBlock *pblock, int bwtMaturityDepth);
     /** Notifies listeners of updated bwts for given certificate.*/
-    boost::signals2::signal<void (const CScCertificateStatusUpdateInfo& certStatusInfo)> SyncCertStatus;
+    void SyncCertStatus(const CScCertificateStatusUpdateInfo& certStatusInfo);
+
+    void Register(CValidationInterface* listener);
+    /** Once this returns, the listener is not called anymore */
+    void Unregister(CValidationInterface* listener);
+    void UnregisterAll();
+
+    /** Start the thread dispatching the events to the listeners that are not synchronous */
+    void StartQueue(size_t nMaxDepth);
+    /** Deliver the queued events and stop the queue thread, later events are dispatched synchronously */
+    void StopQueue();
+    /** Wait until the events fired so far have been delivered */
+    void FlushQueue();
+
+    CValidationQueueStats GetQueueStats() const;
+
+private:
+    typedef std::function<void (CValidationInterface*)> Callback;
+
+    struct Listener
+    {
+        CValidationInterface* listener;
+        CValidationListenerStats stats;
+    };
+
+    struct QueuedEvent
+    {
+        Callback call;
+        int64_t nTimeQueued;
+    };
+
+    //! guards the listeners and their statistics
+    mutable boost::mutex cs_listeners;
+    std::vector<std::shared_ptr<Listener> > listeners;
+    size_t nQueuedListeners;
+
+    //! guards the queue
+    mutable boost::mutex cs_queue;
+    boost::condition_variable condQueue;
+    std::deque<QueuedEvent> queue;
+    bool fRunning;
+    bool fStopRequested;
+    bool fDispatching;
+    size_t nMaxDepth;
+    size_t nPeakDepth;
+    uint64_t nQueued;
+    uint64_t nDispatched;
+    //! nDispatched when the queue thread was last seen stalled, the firing threads don't wait on it until it moves
+    uint64_t nStalledAt;
+    uint64_t nBlocked;
+    int64_t nTotalBlockedMicros;
+    int64_t nMaxBlockedMicros;
+    uint64_t nOverflowed;
+    int64_t nTotalWaitMicros;
+    int64_t nMaxWaitMicros;
+    boost::thread thread;
+
+    //! held by the queue thread while delivering an event
+    boost::mutex cs_dispatch;
+
+    //! last block shared by the queued events, most events refer to the same one
+    const CBlock* pLastBlock;
+    std::shared_ptr<const CBlock> lastBlock;
+
+    enum DispatchTarget { DISPATCH_ALL, DISPATCH_SYNCHRONOUS, DISPATCH_QUEUED };
+
+    void Dispatch(const Callback& call, DispatchTarget target);
+    void Fire(const Callback& call, const std::function<Callback ()>& makeQueued);
+    void WaitForRoom(boost::unique_lock<boost::mutex>& lock);
+    std::shared_ptr<const CBlock> ShareBlock(const CBlock* pblock);
+    void WaitForDispatch();
+    void ThreadQueue();
 };
 
 CMainSignals& GetMainSignals();
@@ -236,6 +236,35 @@ TEST_F(SidechainsCertInWalletTestSuite, LoadWalletCertFromDb) {
     EXPECT_TRUE(retrievedWalletCert == walletCert);
 }
 
+TEST_F(SidechainsCertInWalletTestSuite, LoadWalletTxsFromDbOnSeveralThreads) {
+    unsigned int nPrevThreads = nWalletLoadThreads;
+    nWalletLoadThreads = 4;
+
+    std::vector<CWalletTx> walletTxs;
+    for (size_t i = 0; i < 4 * MIN_RECORDS_PER_WALLET_LOAD_THREAD; i++) {
+        CMutableTransaction mutTx;
+        mutTx.nVersion = TRANSPARENT_TX_VERSION;
+        mutTx.vin.push_back(CTxIn(COutPoint(GetRandHash(), 0), CScript(), 1));
+        mutTx.addOut(CTxOut(CAmount(10), CScript()));
+        walletTxs.push_back(CWalletTx(pWallet, CTransaction(mutTx)));
+        walletTxs.back().nOrderPos = i;
+        ASSERT_TRUE(pWalletDb->WriteWalletTxBase(walletTxs.back().getWrappedTx().GetHash(), walletTxs.back()));
+    }
+
+    // Test
+    DBErrors ret = pWalletDb->LoadWallet(pWallet);
+    nWalletLoadThreads = nPrevThreads;
+
+    // Checks
+    ASSERT_TRUE(DB_LOAD_OK == ret) << "Error: "<<ret;
+    for (const CWalletTx& walletTx : walletTxs) {
+        const uint256& hash = walletTx.getWrappedTx().GetHash();
+        ASSERT_TRUE(pWallet->getMapWallet().count(hash));
+        CWalletTx retrievedWalletTx = *dynamic_cast<const CWalletTx*>(pWallet->getMapWallet().at(hash).get());
+        EXPECT_TRUE(retrievedWalletTx == walletTx);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //////////////////////////////// IsOutputMature ///////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -6,6 +6,7 @@
 #include "amount.h"
 #include "base58.h"
 #include "core_io.h"
+#include "crypto/equihash.h"
 #include "init.h"
 #include "main.h"
 #include "net.h"
@@ -4269,6 +4270,7 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             "parameterloading\n"
             "createjoinsplit\n"
             "solveequihash\n"
+            "solveequihasharena\n"
             "verifyequihash\n"
             "validatelargetx\n"
             "trydecryptnotes\n"
@@ -4277,6 +4279,17 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             "sendtoaddress\n"
             "loadwallet\n"
             "listunspent\n"
+            "mempooladdressindex\n"
+            "relaytransactions\n"
+            "mempoolspam\n"
+            "mempoolrevalidation\n"
+            "scriptcheckqueue\n"
+            "getblockjson\n"
+            "parsehexrequest\n"
+            "sctxscommitment\n"
+            "deserializeblock\n"
+            "rpcreadsunderload\n"
+            "blockdownload\n"
             
             "\nResult:\n"
             "[\n"
@@ -4319,6 +4332,11 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
         os >> samplejoinsplit;
     }
 
+#ifdef ENABLE_MINING
+    // Reused by the samples, as a mining thread does for each nonce
+    EhArenaSolver arenaSolver;
+#endif
+
     for (int i = 0; i < samplecount; i++) {
         if (benchmarktype == "sleep") {
             sample_times.push_back(benchmark_sleep());
@@ -4345,6 +4363,14 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
                 std::vector<double> vals = benchmark_solve_equihash_threaded(nThreads);
                 sample_times.insert(sample_times.end(), vals.begin(), vals.end());
             }
+        } else if (benchmarktype == "solveequihasharena") {
+            if (params.size() < 3) {
+                sample_times.push_back(benchmark_solve_equihash(&arenaSolver));
+            } else {
+                int nThreads = params[2].get_int();
+                std::vector<double> vals = benchmark_solve_equihash_threaded(nThreads, true);
+                sample_times.insert(sample_times.end(), vals.begin(), vals.end());
+            }
 #endif
         } else if (benchmarktype == "verifyequihash") {
             sample_times.push_back(benchmark_verify_equihash());
@@ -4355,7 +4381,11 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             sample_times.push_back(benchmark_try_decrypt_notes(nAddrs));
         } else if (benchmarktype == "incnotewitnesses") {
             int nTxs = params[2].get_int();
-            sample_times.push_back(benchmark_increment_note_witnesses(nTxs));
+            int nThreads = params.size() > 3 ? params[3].get_int() : 1;
+            if (nThreads < 1 || nThreads > MAX_WITNESS_UPDATE_THREADS) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of threads");
+            }
+            sample_times.push_back(benchmark_increment_note_witnesses(nTxs, nThreads));
         } else if (benchmarktype == "connectblockslow") {
             if (Params().NetworkIDString() != "regtest") {
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
@@ -4371,9 +4401,96 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             if (Params().NetworkIDString() != "regtest") {
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
             }
-            sample_times.push_back(benchmark_loadwallet());
+            // With a number of transactions, a synthetic wallet holding them is loaded instead of the node's one
+            int nTxs = params.size() > 2 ? params[2].get_int() : 0;
+            if (nTxs < 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of transactions");
+            }
+            sample_times.push_back(benchmark_loadwallet(nTxs));
         } else if (benchmarktype == "listunspent") {
             sample_times.push_back(benchmark_listunspent());
+#ifdef ENABLE_ADDRESS_INDEXING
+        } else if (benchmarktype == "mempooladdressindex") {
+            int nEntries = params.size() > 2 ? params[2].get_int() : 100000;
+            sample_times.push_back(benchmark_mempool_address_index(nEntries));
+#endif // ENABLE_ADDRESS_INDEXING
+        } else if (benchmarktype == "relaytransactions") {
+            if (Params().NetworkIDString() != "regtest") {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
+            }
+            int nTxs = params.size() > 2 ? params[2].get_int() : 10000;
+            int nPeers = params.size() > 3 ? params[3].get_int() : 8;
+            if (nTxs < 1 || nPeers < 1 || nPeers > 65536) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of transactions or peers");
+            }
+            sample_times.push_back(benchmark_relay_transactions(nTxs, nPeers));
+        } else if (benchmarktype == "mempoolspam") {
+            int nTxs = params.size() > 2 ? params[2].get_int() : 100000;
+            int nMaxMempoolKB = params.size() > 3 ? params[3].get_int() : 5000;
+            if (nTxs < 1 || nMaxMempoolKB < 1) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of transactions or mempool size");
+            }
+            sample_times.push_back(benchmark_mempool_spam(nTxs, (size_t)nMaxMempoolKB * 1000));
+        } else if (benchmarktype == "mempoolrevalidation") {
+            int nTxs = params.size() > 2 ? params[2].get_int() : 100000;
+            if (nTxs < 1) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of transactions");
+            }
+            std::vector<double> vals = benchmark_mempool_revalidation(nTxs);
+            sample_times.insert(sample_times.end(), vals.begin(), vals.end());
+        } else if (benchmarktype == "scriptcheckqueue") {
+            int nMaxThreads = params.size() > 2 ? params[2].get_int() : 32;
+            int nChecks = params.size() > 3 ? params[3].get_int() : 20000;
+            if (nMaxThreads < 1 || nMaxThreads > 64 || nChecks < 1) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of threads or checks");
+            }
+            std::vector<double> vals = benchmark_script_check_queue(nMaxThreads, nChecks);
+            sample_times.insert(sample_times.end(), vals.begin(), vals.end());
+        } else if (benchmarktype == "getblockjson") {
+            int nHeight = params.size() > 2 ? params[2].get_int() : chainActive.Height();
+            if (nHeight < 0 || nHeight > chainActive.Height()) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+            }
+            sample_times.push_back(benchmark_getblock_json(nHeight));
+        } else if (benchmarktype == "parsehexrequest") {
+            int nBytes = params.size() > 2 ? params[2].get_int() : 1000000;
+            if (nBytes < 2) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of bytes");
+            }
+            sample_times.push_back(benchmark_parse_hex_request(nBytes));
+        } else if (benchmarktype == "sctxscommitment") {
+            int nTxs = params.size() > 2 ? params[2].get_int() : 1000;
+            if (nTxs < 1) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of transactions");
+            }
+            std::vector<double> vals = benchmark_sc_txs_commitment(nTxs);
+            sample_times.insert(sample_times.end(), vals.begin(), vals.end());
+        } else if (benchmarktype == "deserializeblock") {
+            int nHeight = params.size() > 2 ? params[2].get_int() : chainActive.Height();
+            if (nHeight < 0 || nHeight > chainActive.Height()) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+            }
+            std::vector<double> vals = benchmark_deserialize_block(nHeight);
+            sample_times.insert(sample_times.end(), vals.begin(), vals.end());
+        } else if (benchmarktype == "rpcreadsunderload") {
+            if (Params().NetworkIDString() != "regtest") {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
+            }
+            int nReaders = params.size() > 2 ? params[2].get_int() : 8;
+            int nBlocks = params.size() > 3 ? params[3].get_int() : 100;
+            if (nReaders < 1 || nReaders > 256 || nBlocks < 1) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of readers or blocks");
+            }
+            std::vector<double> vals = benchmark_rpc_reads_under_load(nReaders, nBlocks);
+            sample_times.insert(sample_times.end(), vals.begin(), vals.end());
+        } else if (benchmarktype == "blockdownload") {
+            int nPeers = params.size() > 2 ? params[2].get_int() : 8;
+            int nBlocks = params.size() > 3 ? params[3].get_int() : 20000;
+            if (nPeers < 1 || nPeers > 256 || nBlocks < 1) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of peers or blocks");
+            }
+            std::vector<double> vals = benchmark_block_download(nPeers, nBlocks);
+            sample_times.insert(sample_times.end(), vals.begin(), vals.end());
         } else {
             throw JSONRPCError(RPC_TYPE_ERROR, "Invalid benchmarktype");
         }
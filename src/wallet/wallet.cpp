@@ -47,6 +47,8 @@ unsigned int nTxConfirmTarget = DEFAULT_TX_CONFIRM_TARGET;
 bool bSpendZeroConfChange = true;
 bool fSendFreeTransactions = false;
 bool fPayAtLeastCustomFee = true;
+unsigned int nWitnessUpdateThreads = 1;
+unsigned int nWalletLoadThreads = 1;
 
 /**
  * Fees smaller than this (in satoshi) are considered zero fee (for transaction creation)
@@ -694,6 +696,9 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
 {
     {
         LOCK(cs_wallet);
+        // Notes whose witnesses are behind the current height. Collecting
+        // them once avoids rescanning mapWallet for every commitment.
+        std::vector<CNoteData*> vBehind;
         for (auto& wtxItem : mapWallet)
         {
             for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
@@ -717,6 +722,7 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                     if (nd->witnesses.size() > WITNESS_CACHE_SIZE) {
                         nd->witnesses.pop_back();
                     }
+                    vBehind.push_back(nd);
                 }
             }
         }
@@ -731,6 +737,14 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
             pblock = &block;
         }
 
+        // Append the commitments of the block to the tree, witnessing our
+        // own notes on the way. The witnesses themselves are brought up to
+        // date afterwards, all at once.
+        const uint64_t firstPosition = tree.size();
+        std::vector<libzcash::SHA256Compress> vCommitments;
+        // Our notes first witnessed in this block, along with the index of
+        // their commitment in vCommitments
+        std::map<CNoteData*, size_t> mapNewNotes;
         for (const CTransaction& tx : pblock->vtx) {
             auto hash = tx.GetHash();
             bool txIsOurs = mapWallet.count(hash);
@@ -739,21 +753,7 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                 for (uint8_t j = 0; j < jsdesc.commitments.size(); j++) {
                     const uint256& note_commitment = jsdesc.commitments[j];
                     tree.append(note_commitment);
-
-                    // Increment existing witnesses
-                    for (auto& wtxItem : mapWallet)
-                    {
-                        for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
-                            CNoteData* nd = &(item.second);
-                            if (nd->witnessHeight < pindex->nHeight &&
-                                    nd->witnesses.size() > 0) {
-                                // Check the validity of the cache
-                                // See earlier comment about validity.
-                                assert(nWitnessCacheSize >= nd->witnesses.size());
-                                nd->witnesses.front().append(note_commitment);
-                            }
-                        }
-                    }
+                    vCommitments.push_back(note_commitment);
 
                     // If this is our note, witness it
                     if (txIsOurs) {
@@ -779,6 +779,7 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                                 nd->witnesses.clear();
                             }
                             nd->witnesses.push_front(tree.witness());
+                            mapNewNotes[nd] = vCommitments.size() - 1;
                             // Set height to one less than pindex so it gets incremented
                             nd->witnessHeight = pindex->nHeight - 1;
                             // Check the validity of the cache
@@ -789,17 +790,57 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
             }
         }
 
-        // Update witness heights
-        for (auto& wtxItem : mapWallet)
-        {
-            for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
-                CNoteData* nd = &(item.second);
-                if (nd->witnessHeight < pindex->nHeight) {
-                    nd->witnessHeight = pindex->nHeight;
+        // Increment existing witnesses, and the ones created above with the
+        // commitments following their own, sharing the subtrees of the block
+        // between all of them.
+        if (!vCommitments.empty()) {
+            ZCMerkleSubtreeCache subtrees(firstPosition, vCommitments);
+
+            std::vector<std::pair<CNoteData*, size_t>> vToIncrement;
+            for (CNoteData* nd : vBehind) {
+                if (nd->witnesses.size() > 0 && !mapNewNotes.count(nd)) {
                     // Check the validity of the cache
                     // See earlier comment about validity.
                     assert(nWitnessCacheSize >= nd->witnesses.size());
+                    vToIncrement.push_back(std::make_pair(nd, 0));
+                }
+            }
+            for (const auto& newNote : mapNewNotes) {
+                vToIncrement.push_back(std::make_pair(newNote.first, newNote.second + 1));
+            }
+
+            // Each note only touches its own witness, so the work can be
+            // split across threads without further locking.
+            auto incrementRange = [&vToIncrement, &subtrees](size_t begin, size_t end) {
+                for (size_t n = begin; n < end; n++) {
+                    vToIncrement[n].first->witnesses.front().append(subtrees, vToIncrement[n].second);
+                }
+            };
+
+            size_t nThreads = std::min<size_t>(nWitnessUpdateThreads,
+                                               vToIncrement.size() / MIN_NOTES_PER_WITNESS_THREAD);
+            if (nThreads <= 1) {
+                incrementRange(0, vToIncrement.size());
+            } else {
+                boost::thread_group workers;
+                size_t chunk = (vToIncrement.size() + nThreads - 1) / nThreads;
+                for (size_t begin = chunk; begin < vToIncrement.size(); begin += chunk) {
+                    size_t end = std::min(begin + chunk, vToIncrement.size());
+                    workers.create_thread([&incrementRange, begin, end] { incrementRange(begin, end); });
                 }
+                incrementRange(0, chunk);
+                workers.join_all();
+            }
+        }
+
+        // Update witness heights
+        for (CNoteData* nd : vBehind)
+        {
+            if (nd->witnessHeight < pindex->nHeight) {
+                nd->witnessHeight = pindex->nHeight;
+                // Check the validity of the cache
+                // See earlier comment about validity.
+                assert(nWitnessCacheSize >= nd->witnesses.size());
             }
         }
 
@@ -813,6 +854,7 @@ void CWallet::DecrementNoteWitnesses(const CBlockIndex* pindex)
 {
     {
         LOCK(cs_wallet);
+        nWitnessCacheSize -= 1;
         for (auto& wtxItem : mapWallet)
         {
             for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
@@ -822,7 +864,7 @@ void CWallet::DecrementNoteWitnesses(const CBlockIndex* pindex)
                     // Check the validity of the cache
                     // See comment below (this would be invalid if there was a
                     // prior decrement).
-                    assert(nWitnessCacheSize >= nd->witnesses.size());
+                    assert(nWitnessCacheSize + 1 >= nd->witnesses.size());
                     // Witnesses being decremented should always be either -1
                     // (never incremented or decremented) or equal to pindex
                     assert((nd->witnessHeight == -1) ||
@@ -834,13 +876,6 @@ void CWallet::DecrementNoteWitnesses(const CBlockIndex* pindex)
                     // height is one below it.
                     nd->witnessHeight = pindex->nHeight - 1;
                 }
-            }
-        }
-        nWitnessCacheSize -= 1;
-        for (auto& wtxItem : mapWallet)
-        {
-            for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
-                CNoteData* nd = &(item.second);
                 // Check the validity of the cache
                 // Technically if there are notes witnessed above the current
                 // height, their cache will now be invalid (relative to the new
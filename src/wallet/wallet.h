@@ -45,6 +45,8 @@ extern unsigned int nTxConfirmTarget;
 extern bool bSpendZeroConfChange;
 extern bool fSendFreeTransactions;
 extern bool fPayAtLeastCustomFee;
+extern unsigned int nWitnessUpdateThreads;
+extern unsigned int nWalletLoadThreads;
 
 //! -paytxfee default
 static const CAmount DEFAULT_TRANSACTION_FEE = 0;
@@ -62,6 +64,18 @@ static const unsigned int MAX_FREE_TRANSACTION_CREATE_SIZE = 1000;
 //  Should be large enough that we can expect not to reorg beyond our cache
 //  unless there is some exceptional network disruption.
 static const unsigned int WITNESS_CACHE_SIZE = COINBASE_MATURITY;
+//! -witnessupdatethreads default (0 = autodetect)
+static const int DEFAULT_WITNESS_UPDATE_THREADS = 0;
+//! Maximum number of threads updating note witnesses
+static const int MAX_WITNESS_UPDATE_THREADS = 16;
+//! Minimum number of witnesses worth handing to a separate thread
+static const size_t MIN_NOTES_PER_WITNESS_THREAD = 64;
+//! -walletloadthreads default (0 = autodetect)
+static const int DEFAULT_WALLET_LOAD_THREADS = 0;
+//! Maximum number of threads decoding wallet transactions on load
+static const int MAX_WALLET_LOAD_THREADS = 16;
+//! Minimum number of wallet transactions worth handing to a separate thread
+static const size_t MIN_RECORDS_PER_WALLET_LOAD_THREAD = 256;
 
 class CBlockIndex;
 class CCoinControl;
@@ -1076,6 +1090,9 @@ public:
     bool UpdateNullifierNoteMap();
     void UpdateNullifierNoteMapWithTx(const CWalletTransactionBase& wtx);
     bool AddToWallet(const CWalletTransactionBase& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb);
+    // The wallet state must follow the chain and the mempool immediately
+    bool IsSynchronous() const override { return true; }
+    std::string ValidationInterfaceName() const override { return "wallet"; }
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock) override;
     void SyncCertificate(const CScCertificate& cert, const CBlock* pblock, int bwtMaturityDepth = -1) override;
     void SyncCertStatusInfo(const CScCertificateStatusUpdateInfo& certStatusInfo) override;
@@ -459,6 +459,143 @@ public:
     }
 };
 
+/**
+ * Decode and check a "tx" record, the key stream being past its type.
+ * It touches no wallet, so that the records can be decoded on several threads.
+ */
+static bool ReadWalletTx(CDataStream& ssKey, CDataStream& ssValue, uint256& hash, CWalletTx& wtx, bool& fUpgraded, string& strErr)
+{
+    ssKey >> hash;
+    ssValue >> wtx;
+    CValidationState state;
+    auto verifier = libzcash::ProofVerifier::Strict();
+    if (!(CheckTransaction(wtx.getWrappedTx(), state, verifier) && (wtx.getWrappedTx().GetHash() == hash) && state.IsValid()))
+    {
+        LogPrintf("%s():%d - failure: tx id = %s, reject code = %d\n",
+            __func__, __LINE__, wtx.getWrappedTx().GetHash().ToString(), CValidationState::CodeToChar(state.GetRejectCode()));
+        // Don't consider CValidationState::Code::REJECT_CHECKBLOCKATHEIGHT_NOT_FOUND error code as a failure. It can appear because a tx
+        // is a pre-chainsplit tx, so it is perfectly fine in this case.
+        if (state.GetRejectCode() != CValidationState::Code::CHECKBLOCKATHEIGHT_NOT_FOUND)
+            return false;
+    }
+
+    // Undo serialize changes in 31600
+    if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
+    {
+        if (!ssValue.empty())
+        {
+            char fTmp;
+            char fUnused;
+            ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
+            strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
+                               wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = fTmp;
+        }
+        else
+        {
+            strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = 0;
+        }
+        fUpgraded = true;
+    }
+    return true;
+}
+
+/** Decode and check a "cert" record, the key stream being past its type */
+static bool ReadWalletCert(CDataStream& ssKey, CDataStream& ssValue, uint256& hash, CWalletCert& wcert)
+{
+    ssKey >> hash;
+    ssValue >> wcert;
+    CValidationState state;
+    if (!(CheckCertificate(wcert.getWrappedCert(), state) && (wcert.getWrappedCert().GetHash() == hash) && state.IsValid()))
+    {
+        LogPrint("cert", "%s():%d - cert[%s] is invalid\n", __func__, __LINE__, wcert.getWrappedCert().GetHash().ToString());
+        return false;
+    }
+    return true;
+}
+
+static void AddWalletTxBase(CWallet* pwallet, CWalletScanState& wss, const uint256& hash,
+                            const CWalletTransactionBase& wtx, bool fUpgraded)
+{
+    if (fUpgraded)
+        wss.vWalletUpgrade.push_back(hash);
+
+    if (wtx.nOrderPos == -1)
+        wss.fAnyUnordered = true;
+
+    pwallet->AddToWallet(wtx, true, NULL);
+}
+
+/** A tx or cert record read from the database, decoded later along with the others */
+struct CWalletTxRecord
+{
+    CDataStream ssKey;
+    CDataStream ssValue;
+    string strType;
+    uint256 hash;
+    std::unique_ptr<CWalletTransactionBase> pwtx;
+    bool fUpgraded;
+    bool fOk;
+    string strErr;
+
+    CWalletTxRecord(CDataStream&& ssKeyIn, CDataStream&& ssValueIn):
+        ssKey(std::move(ssKeyIn)), ssValue(std::move(ssValueIn)), fUpgraded(false), fOk(false) {}
+};
+
+static void DecodeWalletTxRecord(CWalletTxRecord& record)
+{
+    try {
+        record.ssKey >> record.strType;
+        if (record.strType == "tx")
+        {
+            CWalletTx* pwtx = new CWalletTx();
+            record.pwtx.reset(pwtx);
+            record.fOk = ReadWalletTx(record.ssKey, record.ssValue, record.hash, *pwtx, record.fUpgraded, record.strErr);
+        }
+        else
+        {
+            CWalletCert* pwcert = new CWalletCert();
+            record.pwtx.reset(pwcert);
+            record.fOk = ReadWalletCert(record.ssKey, record.ssValue, record.hash, *pwcert);
+        }
+    } catch (...) {
+        LogPrintf("%s():%d - Error decoding record of type[%s] (hash[%s])\n",
+            __func__, __LINE__, record.strType, record.hash.ToString());
+        record.fOk = false;
+    }
+    // The streams are not needed anymore, release them before the wallet maps grow
+    record.ssKey = CDataStream(SER_DISK, CLIENT_VERSION);
+    record.ssValue = CDataStream(SER_DISK, CLIENT_VERSION);
+}
+
+/**
+ * Decoding the transactions and checking them, joinsplit proofs included, is
+ * most of the load time of a large wallet, and each record is decoded on its
+ * own: the records are split across threads.
+ */
+static void DecodeWalletTxRecords(std::vector<CWalletTxRecord>& vRecords)
+{
+    auto decodeRange = [&vRecords](size_t begin, size_t end) {
+        for (size_t n = begin; n < end; n++)
+            DecodeWalletTxRecord(vRecords[n]);
+    };
+
+    size_t nThreads = std::min<size_t>(nWalletLoadThreads, vRecords.size() / MIN_RECORDS_PER_WALLET_LOAD_THREAD);
+    if (nThreads <= 1) {
+        decodeRange(0, vRecords.size());
+    } else {
+        boost::thread_group workers;
+        size_t chunk = (vRecords.size() + nThreads - 1) / nThreads;
+        for (size_t begin = chunk; begin < vRecords.size(); begin += chunk) {
+            size_t end = std::min(begin + chunk, vRecords.size());
+            workers.create_thread([&decodeRange, begin, end] { decodeRange(begin, end); });
+        }
+        decodeRange(0, chunk);
+        workers.join_all();
+    }
+}
+
 bool
 ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
              CWalletScanState &wss, string& strType, string& strErr)
@@ -485,66 +622,18 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
         }
         else if (strType == "tx")
         {
-            ssKey >> hash;
             CWalletTx wtx;
-            ssValue >> wtx;
-            CValidationState state;
-            auto verifier = libzcash::ProofVerifier::Strict();
-            if (!(CheckTransaction(wtx.getWrappedTx(), state, verifier) && (wtx.getWrappedTx().GetHash() == hash) && state.IsValid()))
-            {
-                LogPrintf("%s():%d - failure: tx id = %s, reject code = %d\n",
-                    __func__, __LINE__, wtx.getWrappedTx().GetHash().ToString(), CValidationState::CodeToChar(state.GetRejectCode()));
-                // Don't consider CValidationState::Code::REJECT_CHECKBLOCKATHEIGHT_NOT_FOUND error code as a failure. It can appear because a tx
-                // is a pre-chainsplit tx, so it is perfectly fine in this case.
-                if (state.GetRejectCode() != CValidationState::Code::CHECKBLOCKATHEIGHT_NOT_FOUND)
-                    return false;
-            }
-
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
-            {
-                if (!ssValue.empty())
-                {
-                    char fTmp;
-                    char fUnused;
-                    ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
-                                       wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                }
-                else
-                {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
-                wss.vWalletUpgrade.push_back(hash);
-            }
-
-            if (wtx.nOrderPos == -1)
-                wss.fAnyUnordered = true;
-
-            pwallet->AddToWallet(wtx, true, NULL);
+            bool fUpgraded = false;
+            if (!ReadWalletTx(ssKey, ssValue, hash, wtx, fUpgraded, strErr))
+                return false;
+            AddWalletTxBase(pwallet, wss, hash, wtx, fUpgraded);
         }
         else if (strType == "cert")
         {
-            ssKey >> hash;
             CWalletCert wcert;
-            ssValue >> wcert;
-            CValidationState state;
-            if (!(CheckCertificate(wcert.getWrappedCert(), state) && (wcert.getWrappedCert().GetHash() == hash) && state.IsValid()))
-            {
-                LogPrint("cert", "%s():%d - cert[%s] is invalid\n", __func__, __LINE__, wcert.getWrappedCert().GetHash().ToString());
+            if (!ReadWalletCert(ssKey, ssValue, hash, wcert))
                 return false;
-            }
-
-            if (wcert.nOrderPos == -1)
-            {
-                LogPrint("cert", "%s():%d - cert[%s] is unordered\n", __func__, __LINE__, wcert.getWrappedCert().GetHash().ToString());
-                wss.fAnyUnordered = true;
-            }
-
-            LogPrint("cert", "%s():%d - adding cert[%s] to wallet\n", __func__, __LINE__, wcert.getWrappedCert().GetHash().ToString());
-            pwallet->AddToWallet(wcert, true, NULL);
+            AddWalletTxBase(pwallet, wss, hash, wcert, false);
         }
         else if (strType == "acentry")
         {
@@ -843,6 +932,28 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
             return DB_CORRUPT;
         }
 
+        const size_t nTxRecordsBatch = 16 * MIN_RECORDS_PER_WALLET_LOAD_THREAD * nWalletLoadThreads;
+        std::vector<CWalletTxRecord> vTxRecords;
+        auto addTxRecords = [&]() {
+            DecodeWalletTxRecords(vTxRecords);
+            for (CWalletTxRecord& record : vTxRecords)
+            {
+                if (record.fOk)
+                    AddWalletTxBase(pwallet, wss, record.hash, *record.pwtx, record.fUpgraded);
+                else
+                {
+                    // Leave the bad record alone, but warn the user and rescan
+                    fNoncriticalErrors = true;
+                    if (record.strType == "cert")
+                        LogPrint("cert", "%s():%d - cert error: rescan set to true\n", __func__, __LINE__);
+                    SoftSetBoolArg("-rescan", true);
+                }
+                if (!record.strErr.empty())
+                    LogPrintf("%s\n", record.strErr);
+            }
+            vTxRecords.clear();
+        };
+
         while (true)
         {
             // Read next record
@@ -857,8 +968,21 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
                 return DB_CORRUPT;
             }
 
-            // Try to be tolerant of single corrupt records:
+            // Txes and certs are decoded by batches on several threads, then added in the order they were read
             string strType, strErr;
+            {
+                CDataStream ssType(ssKey);
+                ssType >> strType;
+            }
+            if (strType == "tx" || strType == "cert")
+            {
+                vTxRecords.emplace_back(std::move(ssKey), std::move(ssValue));
+                if (vTxRecords.size() >= nTxRecordsBatch)
+                    addTxRecords();
+                continue;
+            }
+
+            // Try to be tolerant of single corrupt records:
             if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr))
             {
                 // losing keys is considered a catastrophic error, anything else
@@ -884,6 +1008,7 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
                 LogPrintf("%s\n", strErr);
         }
         pcursor->close();
+        addTxRecords();
     }
     catch (const boost::thread_interrupted&) {
         throw;
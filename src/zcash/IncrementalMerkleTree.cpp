@@ -27,6 +27,18 @@ PedersenHash PedersenHash::combine(
     return res;
 }
 
+void PedersenHash::combine_pairs(
+    const PedersenHash* nodes,
+    size_t count,
+    PedersenHash* out,
+    size_t depth
+)
+{
+    for (size_t i = 0; i < count; i++) {
+        out[i] = combine(nodes[2*i], nodes[2*i+1], depth);
+    }
+}
+
 PedersenHash PedersenHash::uncommitted() {
     PedersenHash res = PedersenHash();
 
@@ -51,6 +63,21 @@ SHA256Compress SHA256Compress::combine(
     return res;
 }
 
+void SHA256Compress::combine_pairs(
+    const SHA256Compress* nodes,
+    size_t count,
+    SHA256Compress* out,
+    size_t depth
+)
+{
+    // Each pair is exactly one 64-byte block, already contiguous in memory
+    static_assert(sizeof(SHA256Compress) == 32, "SHA256Compress must be a bare 256-bit value");
+
+    if (count > 0) {
+        SHA256Compress64(out[0].begin(), nodes[0].begin(), count);
+    }
+}
+
 template <size_t Depth, typename Hash>
 class PathFiller {
 private:
@@ -165,6 +192,61 @@ void IncrementalMerkleTree<Depth, Hash>::append(Hash obj) {
     }
 }
 
+template<size_t Depth, typename Hash>
+void IncrementalMerkleTree<Depth, Hash>::append(const std::vector<Hash>& objs) {
+    if (objs.empty()) {
+        return;
+    }
+
+    if (objs.size() > (uint64_t(1) << Depth) - size()) {
+        throw std::runtime_error("tree is full");
+    }
+
+    // Leaves of the level being combined, starting from the pending pair
+    // (if any) so that the first one sits at an even position.
+    std::vector<Hash> nodes;
+    nodes.reserve(objs.size() + 2);
+    if (left) {
+        nodes.push_back(*left);
+    }
+    if (right) {
+        nodes.push_back(*right);
+    }
+    nodes.insert(nodes.end(), objs.begin(), objs.end());
+
+    // The pair holding the last leaf stays uncombined, as after append(Hash)
+    size_t lastPair = (nodes.size() - 1) & ~size_t(1);
+    left = nodes[lastPair];
+    right = (lastPair + 1 < nodes.size()) ? boost::optional<Hash>(nodes[lastPair + 1]) : boost::none;
+    nodes.resize(lastPair);
+
+    // Combine the complete pairs level by level. Above the leaves, the
+    // waiting parent of a level completes its first pair, and a left-over
+    // node becomes the new waiting parent.
+    parents.resize(Depth - 1);
+    std::vector<Hash> combined;
+    for (size_t d = 0; d < Depth && !nodes.empty(); d++) {
+        if (d > 0) {
+            if (parents[d-1]) {
+                nodes.insert(nodes.begin(), *parents[d-1]);
+                parents[d-1] = boost::none;
+            }
+            if (nodes.size() % 2) {
+                parents[d-1] = nodes.back();
+                nodes.pop_back();
+            }
+        }
+
+        combined.resize(nodes.size() / 2);
+        Hash::combine_pairs(nodes.data(), combined.size(), combined.data(), d);
+        nodes.swap(combined);
+    }
+
+    while (!parents.empty() && !parents.back()) {
+        parents.pop_back();
+    }
+}
+
 // This is for allowing the witness to determine if a subtree has filled
 // to a particular depth, or for append() to ensure we're not appending
 // to a full tree.
@@ -333,7 +415,7 @@ void IncrementalWitness<Depth, Hash>::append(Hash obj) {
             cursor = boost::none;
         }
     } else {
-        cursor_depth = tree.next_depth(filled.size());
+        cursor_depth = tree->next_depth(filled.size());
 
         if (cursor_depth >= Depth) {
             throw std::runtime_error("tree is full");
@@ -348,10 +430,83 @@ void IncrementalWitness<Depth, Hash>::append(Hash obj) {
     }
 }
 
+template<size_t Depth, typename Hash>
+void IncrementalWitness<Depth, Hash>::append(const MerkleSubtreeCache<Depth, Hash>& cache, size_t from) {
+    size_t i = from;
+    while (i < cache.size()) {
+        if (!cursor) {
+            // The next uncle starts exactly at the next leaf; if the cache
+            // already holds its root there is no need to rebuild it here.
+            size_t depth = tree->next_depth(filled.size());
+            if (depth < Depth) {
+                boost::optional<Hash> subtree = cache.subtree_root(cache.first() + i, depth);
+                if (subtree) {
+                    cursor_depth = depth;
+                    filled.push_back(*subtree);
+                    i += (size_t(1) << depth);
+                    continue;
+                }
+            }
+        }
+
+        append(cache.leaf(i));
+        i++;
+    }
+}
+
+template<size_t Depth, typename Hash>
+MerkleSubtreeCache<Depth, Hash>::MerkleSubtreeCache(uint64_t firstPosition,
+                                                    const std::vector<Hash>& leaves) :
+    firstPosition(firstPosition), levels(1, leaves), levelStart(1, firstPosition)
+{
+    const uint64_t end = firstPosition + leaves.size();
+
+    for (size_t d = 1; d < Depth; d++) {
+        const uint64_t span = uint64_t(1) << d;
+        const uint64_t start = (firstPosition + span - 1) & ~(span - 1);
+        if (start + span > end) {
+            break;
+        }
+
+        const std::vector<Hash>& children = levels[d-1];
+        const uint64_t childStart = levelStart[d-1];
+
+        // The children of consecutive roots are consecutive too
+        std::vector<Hash> roots((end - start) >> d);
+        size_t left = (start - childStart) >> (d-1);
+        Hash::combine_pairs(&children[left], roots.size(), roots.data(), d-1);
+
+        levels.push_back(std::move(roots));
+        levelStart.push_back(start);
+    }
+}
+
+template<size_t Depth, typename Hash>
+boost::optional<Hash> MerkleSubtreeCache<Depth, Hash>::subtree_root(uint64_t start, size_t depth) const {
+    if (depth >= levels.size()) {
+        return boost::none;
+    }
+
+    const uint64_t span = uint64_t(1) << depth;
+    if ((start & (span - 1)) != 0 || start < levelStart[depth]) {
+        return boost::none;
+    }
+
+    uint64_t idx = (start - levelStart[depth]) >> depth;
+    if (idx >= levels[depth].size()) {
+        return boost::none;
+    }
+
+    return levels[depth][idx];
+}
+
 template class IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH, SHA256Compress>;
 template class IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, SHA256Compress>;
 
 template class IncrementalWitness<INCREMENTAL_MERKLE_TREE_DEPTH, SHA256Compress>;
 template class IncrementalWitness<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, SHA256Compress>;
 
+template class MerkleSubtreeCache<INCREMENTAL_MERKLE_TREE_DEPTH, SHA256Compress>;
+template class MerkleSubtreeCache<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, SHA256Compress>;
+
 } // end namespace `libzcash`
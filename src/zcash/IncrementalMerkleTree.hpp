@@ -3,6 +3,7 @@
 
 #include <array>
 #include <deque>
+#include <memory>
 #include <boost/optional.hpp>
 #include <boost/static_assert.hpp>
 
@@ -82,6 +83,35 @@ bool operator==(const EmptyMerkleRoots<Depth, Hash>& a,
 template<size_t Depth, typename Hash>
 class IncrementalWitness;
 
+/**
+ * Roots of every aligned, complete subtree spanned by a contiguous run of
+ * leaves appended to a tree (e.g. the note commitments of one block).
+ * Witnesses following the same tree can consume it through
+ * IncrementalWitness::append(const MerkleSubtreeCache&, size_t), so that
+ * subtrees shared between them are hashed once instead of once per witness.
+ */
+template<size_t Depth, typename Hash>
+class MerkleSubtreeCache {
+public:
+    MerkleSubtreeCache(uint64_t firstPosition, const std::vector<Hash>& leaves);
+
+    // Tree position of the first leaf
+    uint64_t first() const { return firstPosition; }
+    size_t size() const { return levels[0].size(); }
+    const Hash& leaf(size_t i) const { return levels[0][i]; }
+
+    // Root of the subtree of the given depth starting at tree position
+    // `start`, if it is aligned and entirely made of cached leaves.
+    boost::optional<Hash> subtree_root(uint64_t start, size_t depth) const;
+
+private:
+    uint64_t firstPosition;
+    // levels[d][i] is the root of the subtree of depth d starting at tree
+    // position levelStart[d] + (i << d)
+    std::vector<std::vector<Hash>> levels;
+    std::vector<uint64_t> levelStart;
+};
+
 template<size_t Depth, typename Hash>
 class IncrementalMerkleTree {
 
@@ -101,6 +131,9 @@ public:
     size_t size() const;
 
     void append(Hash obj);
+    // Append all of `objs`, hashing the complete sibling pairs of each level
+    // together instead of one append at a time.
+    void append(const std::vector<Hash>& objs);
     Hash root() const {
         return root(Depth, std::deque<Hash>());
     }
@@ -158,37 +191,47 @@ friend class IncrementalMerkleTree<Depth, Hash>;
 
 public:
     // Required for Unserialize()
-    IncrementalWitness() {}
+    IncrementalWitness() : tree(std::make_shared<const IncrementalMerkleTree<Depth, Hash>>()) {}
 
     MerklePath path() const {
-        return tree.path(partial_path());
+        return tree->path(partial_path());
     }
 
     // Return the element being witnessed (should be a note
     // commitment!)
     Hash element() const {
-        return tree.last();
+        return tree->last();
     }
 
     uint64_t position() const {
-        return tree.size() - 1;
+        return tree->size() - 1;
     }
 
     Hash root() const {
-        return tree.root(Depth, partial_path());
+        return tree->root(Depth, partial_path());
     }
 
     void append(Hash obj);
 
+    // Append the leaves of `cache` starting at index `from`. The next leaf
+    // this witness expects must be at tree position cache.first() + from.
+    void append(const MerkleSubtreeCache<Depth, Hash>& cache, size_t from = 0);
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
-        READWRITE(tree);
+        if (ser_action.ForRead()) {
+            IncrementalMerkleTree<Depth, Hash> witnessedTree;
+            READWRITE(witnessedTree);
+            tree = std::make_shared<const IncrementalMerkleTree<Depth, Hash>>(witnessedTree);
+        } else {
+            READWRITE(REF(*tree));
+        }
         READWRITE(filled);
         READWRITE(cursor);
 
-        cursor_depth = tree.next_depth(filled.size());
+        cursor_depth = tree->next_depth(filled.size());
     }
 
     template <size_t D, typename H>
@@ -196,18 +239,22 @@ public:
                            const IncrementalWitness<D, H>& b);
 
 private:
-    IncrementalMerkleTree<Depth, Hash> tree;
+    // The tree as of the witnessed element never changes once the witness
+    // is created, so copies of a witness (e.g. the per-block witness cache
+    // of the wallet) share it instead of duplicating it.
+    std::shared_ptr<const IncrementalMerkleTree<Depth, Hash>> tree;
     std::vector<Hash> filled;
     boost::optional<IncrementalMerkleTree<Depth, Hash>> cursor;
     size_t cursor_depth = 0;
     std::deque<Hash> partial_path() const;
-    IncrementalWitness(IncrementalMerkleTree<Depth, Hash> tree) : tree(tree) {}
+    IncrementalWitness(IncrementalMerkleTree<Depth, Hash> tree) :
+        tree(std::make_shared<const IncrementalMerkleTree<Depth, Hash>>(tree)) {}
 };
 
 template<size_t Depth, typename Hash>
 bool operator==(const IncrementalWitness<Depth, Hash>& a,
                 const IncrementalWitness<Depth, Hash>& b) {
-    return (a.tree == b.tree &&
+    return (*a.tree == *b.tree &&
             a.filled == b.filled &&
             a.cursor == b.cursor &&
             a.cursor_depth == b.cursor_depth);
@@ -224,6 +271,15 @@ public:
         size_t depth
     );
 
+    // Combine the sibling pairs (nodes[2*i], nodes[2*i+1]) into out[i], for
+    // i below `count`.
+    static void combine_pairs(
+        const SHA256Compress* nodes,
+        size_t count,
+        SHA256Compress* out,
+        size_t depth
+    );
+
     static SHA256Compress uncommitted() {
         return SHA256Compress();
     }
@@ -240,6 +296,13 @@ public:
         size_t depth
     );
 
+    static void combine_pairs(
+        const PedersenHash* nodes,
+        size_t count,
+        PedersenHash* out,
+        size_t depth
+    );
+
     static PedersenHash uncommitted();
 };
 
@@ -253,4 +316,7 @@ typedef libzcash::IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, l
 
 typedef libzcash::IncrementalWitness<INCREMENTAL_MERKLE_TREE_DEPTH, libzcash::SHA256Compress> ZCIncrementalWitness;
 typedef libzcash::IncrementalWitness<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, libzcash::SHA256Compress> ZCTestingIncrementalWitness;
+
+typedef libzcash::MerkleSubtreeCache<INCREMENTAL_MERKLE_TREE_DEPTH, libzcash::SHA256Compress> ZCMerkleSubtreeCache;
+typedef libzcash::MerkleSubtreeCache<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, libzcash::SHA256Compress> ZCTestingMerkleSubtreeCache;
 #endif /* ZC_INCREMENTALMERKLETREE_H_ */
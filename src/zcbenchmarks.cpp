@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
 #include <future>
 #include <map>
+#include <new>
 #include <thread>
 #include <unistd.h>
 #include <boost/filesystem.hpp>
@@ -10,19 +15,25 @@
 #include "init.h"
 #include "primitives/transaction.h"
 #include "base58.h"
+#include "blockdownload.h"
 #include "crypto/equihash.h"
+#include "crypto/sha256.h"
 #include "chain.h"
+#include "checkqueue.h"
 #include "chainparams.h"
 #include "consensus/validation.h"
 #include "main.h"
 #include "miner.h"
 #include "pow.h"
+#include "random.h"
 #include "rpc/server.h"
 #include "script/sign.h"
+#include "sc/sidechainTxsCommitmentBuilder.h"
 #include "sodium.h"
 #include "streams.h"
 #include "txdb.h"
 #include "utiltest.h"
+#include "utilstrencodings.h"
 #include "wallet/wallet.h"
 
 #include "zcbenchmarks.h"
@@ -162,7 +173,7 @@ double benchmark_verify_joinsplit(const JSDescription &joinsplit)
 }
 
 #ifdef ENABLE_MINING
-double benchmark_solve_equihash()
+double benchmark_solve_equihash(EhArenaSolver* pArenaSolver)
 {
     CBlock pblock;
     CEquihashInput I{pblock};
@@ -184,18 +195,27 @@ double benchmark_solve_equihash()
     struct timeval tv_start;
     timer_start(tv_start);
     std::set<std::vector<unsigned int>> solns;
-    EhOptimisedSolveUncancellable(n, k, eh_state,
-                                  [](std::vector<unsigned char> soln) { return false; });
+    if (pArenaSolver) {
+        pArenaSolver->SolveUncancellable(n, k, eh_state,
+                                         [](std::vector<unsigned char> soln) { return false; });
+    } else {
+        EhOptimisedSolveUncancellable(n, k, eh_state,
+                                      [](std::vector<unsigned char> soln) { return false; });
+    }
     return timer_stop(tv_start);
 }
 
-std::vector<double> benchmark_solve_equihash_threaded(int nThreads)
+std::vector<double> benchmark_solve_equihash_threaded(int nThreads, bool fArena)
 {
     std::vector<double> ret;
     std::vector<std::future<double>> tasks;
     std::vector<std::thread> threads;
     for (int i = 0; i < nThreads; i++) {
-        std::packaged_task<double(void)> task(&benchmark_solve_equihash);
+        // Each thread owns its arena, as the mining threads do
+        std::packaged_task<double(void)> task([fArena]() {
+            EhArenaSolver arenaSolver;
+            return benchmark_solve_equihash(fArena ? &arenaSolver : nullptr);
+        });
         tasks.emplace_back(task.get_future());
         threads.emplace_back(std::move(task));
     }
@@ -282,6 +302,71 @@ double benchmark_large_tx()
     return timer_stop(tv_start);
 }
 
+std::vector<double> benchmark_script_check_queue(int nMaxThreads, size_t nChecks)
+{
+    // Signature checks of distinct inputs, to be added to the queue two at a
+    // time as ConnectBlock does for a typical transaction
+    const size_t NUM_INPUTS = 500;
+    const size_t CHECKS_PER_ADD = 2;
+
+    CKey priv;
+    priv.MakeNewKey(false);
+    CBasicKeyStore tempKeystore;
+    tempKeystore.AddKey(priv);
+
+    CMutableTransaction m_orig_tx;
+    CScript prevPubKey = GetScriptForDestination(priv.GetPubKey().GetID());
+    m_orig_tx.addOut(CTxOut(1000000, prevPubKey));
+    CTransaction orig_tx(m_orig_tx);
+
+    CMutableTransaction spending_tx;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        spending_tx.vin.emplace_back(orig_tx.GetHash(), 0);
+    }
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        SignSignature(tempKeystore, prevPubKey, spending_tx, i, SIGHASH_ALL);
+    }
+    CTransaction final_spending_tx(spending_tx);
+
+    // From 1 thread (the master alone) up to nMaxThreads, doubling each time
+    std::vector<double> times;
+    for (int nThreads = 1; ; nThreads = std::min(2 * nThreads, nMaxThreads)) {
+        CCheckQueue<CScriptCheck> queue(128, nThreads);
+        boost::thread_group workers;
+        for (int i = 0; i < nThreads - 1; i++) {
+            workers.create_thread(boost::bind(&CCheckQueue<CScriptCheck>::Thread, &queue));
+        }
+
+        struct timeval tv_start;
+        timer_start(tv_start);
+        {
+            CCheckQueueControl<CScriptCheck> control(&queue);
+            std::vector<CScriptCheck> vChecks;
+            for (size_t i = 0; i < nChecks; i++) {
+                // not cached, so that every check verifies its signature
+                vChecks.emplace_back(prevPubKey, final_spending_tx, i % NUM_INPUTS, &chainActive,
+                                     STANDARD_NONCONTEXTUAL_SCRIPT_VERIFY_FLAGS, false);
+                if (vChecks.size() == CHECKS_PER_ADD) {
+                    control.Add(vChecks);
+                    vChecks.clear();
+                }
+            }
+            control.Add(vChecks);
+            assert(control.Wait());
+        }
+        double time = timer_stop(tv_start);
+        times.push_back(time);
+        LogPrintf("%s: %d threads, %.0f script checks/s\n", __func__, nThreads, nChecks / time);
+
+        queue.Quit();
+        workers.join_all();
+
+        if (nThreads == nMaxThreads)
+            break;
+    }
+    return times;
+}
+
 double benchmark_try_decrypt_notes(size_t nAddrs)
 {
     CWallet wallet;
@@ -299,7 +384,7 @@ double benchmark_try_decrypt_notes(size_t nAddrs)
     return timer_stop(tv_start);
 }
 
-double benchmark_increment_note_witnesses(size_t nTxs)
+double benchmark_increment_note_witnesses(size_t nTxs, int nThreads)
 {
     CWallet wallet;
     ZCIncrementalMerkleTree tree;
@@ -349,10 +434,16 @@ double benchmark_increment_note_witnesses(size_t nTxs)
     CBlockIndex index2(block2);
     index2.nHeight = 2;
 
+    unsigned int nPrevThreads = nWitnessUpdateThreads;
+    nWitnessUpdateThreads = nThreads;
+
     struct timeval tv_start;
     timer_start(tv_start);
     wallet.ChainTip(&index2, &block2, tree, true);
-    return timer_stop(tv_start);
+    double ret = timer_stop(tv_start);
+
+    nWitnessUpdateThreads = nPrevThreads;
+    return ret;
 }
 
 // Fake the input of a given block
@@ -457,19 +548,241 @@ double benchmark_sendtoaddress(CAmount amount)
     return timer_stop(tv_start);
 }
 
-double benchmark_loadwallet()
+double benchmark_loadwallet(size_t nSyntheticTxs)
 {
-    pre_wallet_load();
+    if (nSyntheticTxs == 0) {
+        pre_wallet_load();
+        struct timeval tv_start;
+        bool fFirstRunRet=true;
+        timer_start(tv_start);
+        pwalletMain = new CWallet("wallet.dat");
+        DBErrors nLoadWalletRet = pwalletMain->LoadWallet(fFirstRunRet);
+        auto res = timer_stop(tv_start);
+        post_wallet_load();
+        return res;
+    }
+
+    // A wallet of its own, the wallet of the node is left alone
+    const std::string strFile = "benchwallet.dat";
+    bitdb.RemoveDb(strFile);
+    {
+        CWallet wallet(strFile);
+        CWalletDB walletdb(strFile, "cr+");
+        walletdb.TxnBegin();
+        for (size_t i = 0; i < nSyntheticTxs; i++) {
+            CMutableTransaction mtx;
+            mtx.vin.resize(1);
+            mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+            mtx.addOut(CTxOut(1000, CScript() << OP_TRUE));
+            CWalletTx wtx(&wallet, CTransaction(mtx));
+            wtx.nOrderPos = i;
+            walletdb.WriteWalletTxBase(wtx.getWrappedTx().GetHash(), wtx);
+            if (i % 10000 == 9999) {
+                walletdb.TxnCommit();
+                walletdb.TxnBegin();
+            }
+        }
+        walletdb.TxnCommit();
+    }
+    bitdb.CloseDb(strFile);
+
     struct timeval tv_start;
-    bool fFirstRunRet=true;
     timer_start(tv_start);
-    pwalletMain = new CWallet("wallet.dat");
-    DBErrors nLoadWalletRet = pwalletMain->LoadWallet(fFirstRunRet);
+    CWallet* pwallet = new CWallet(strFile);
+    bool fFirstRunRet = true;
+    DBErrors nLoadWalletRet = pwallet->LoadWallet(fFirstRunRet);
     auto res = timer_stop(tv_start);
-    post_wallet_load();
+    assert(nLoadWalletRet == DB_LOAD_OK && pwallet->getMapWallet().size() == nSyntheticTxs);
+    delete pwallet;
+    bitdb.RemoveDb(strFile);
     return res;
 }
 
+#ifdef ENABLE_ADDRESS_INDEXING
+double benchmark_mempool_address_index(size_t nEntries)
+{
+    CCoinsView coinsDummy;
+    CCoinsViewCache view(&coinsDummy);
+    CTxMemPool pool(CFeeRate(0));
+
+    // A few hundred addresses, so that some of them collect many deltas as
+    // busy addresses do on explorer nodes
+    std::vector<CScript> scripts;
+    for (int i = 0; i < 256; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        scripts.push_back(GetScriptForDestination(key.GetPubKey().GetID()));
+    }
+
+    std::vector<CTransaction> txs;
+    txs.reserve(nEntries);
+    for (size_t i = 0; i < nEntries; i++) {
+        uint256 prevHash = GetRandHash();
+        {
+            CCoinsModifier coins = view.ModifyCoins(prevHash);
+            coins->nHeight = 1;
+            coins->vout.resize(1);
+            coins->vout[0] = CTxOut(1000, scripts[i % scripts.size()]);
+        }
+
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout = COutPoint(prevHash, 0);
+        mtx.addOut(CTxOut(600, scripts[(i * 7 + 1) % scripts.size()]));
+        mtx.addOut(CTxOut(300, scripts[(i * 13 + 2) % scripts.size()]));
+        txs.push_back(CTransaction(mtx));
+    }
+
+    int64_t nTime = GetTime();
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (const CTransaction& tx : txs) {
+        pool.addAddressIndex(tx, nTime, view);
+    }
+    for (const CTransaction& tx : txs) {
+        pool.removeAddressIndex(tx.GetHash());
+    }
+    return timer_stop(tv_start);
+}
+#endif // ENABLE_ADDRESS_INDEXING
+
+double benchmark_relay_transactions(size_t nTxs, int nPeers)
+{
+    std::vector<CTransaction> txs;
+    txs.reserve(nTxs);
+    for (size_t i = 0; i < nTxs; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(2);
+        mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+        mtx.vin[1] = mtx.vin[0];
+        mtx.vin[1].prevout = COutPoint(GetRandHash(), 1);
+        mtx.addOut(CTxOut(600, CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 3) << OP_EQUALVERIFY << OP_CHECKSIG));
+        mtx.addOut(CTxOut(300, CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 4) << OP_EQUALVERIFY << OP_CHECKSIG));
+        txs.push_back(CTransaction(mtx));
+    }
+
+    // Peers without a socket, whose send queue just collects the messages.
+    // They are kept out of vNodes, so nothing reaches the node's real peers.
+    std::vector<CNode*> peers;
+    for (int i = 0; i < nPeers; i++) {
+        CAddress addr(CService(CNetAddr(strprintf("10.0.%d.%d", i / 256, i % 256)), Params().GetDefaultPort()));
+        CNode* pnode = new CNode(INVALID_SOCKET, addr, "", true);
+        pnode->fRelayTxes = true;
+        peers.push_back(pnode);
+    }
+
+    // Relay memory of the benchmark, in place of mapRelay which real peers can query
+    std::map<CInv, CRelayPayloadRef> mapBenchRelay;
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (const CTransaction& tx : txs) {
+        // Serialized once and announced to every peer as Relay does, then
+        // requested by each of them and served from relay memory as ProcessGetData does
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss.reserve(10000);
+        ss << tx;
+        CInv inv(MSG_TX, tx.GetHash());
+        mapBenchRelay.insert(std::make_pair(inv, std::make_shared<const CRelayPayload>(ss)));
+        AnnounceTransaction(tx, peers);
+        for (CNode* pnode : peers) {
+            std::map<CInv, CRelayPayloadRef>::iterator mi = mapBenchRelay.find(inv);
+            if (mi != mapBenchRelay.end())
+                pnode->PushRelayPayload(inv.GetCommand(), *mi->second);
+        }
+    }
+    double duration = timer_stop(tv_start);
+
+    for (CNode* pnode : peers)
+        delete pnode;
+    return duration;
+}
+
+double benchmark_mempool_spam(size_t nTxs, size_t nMaxMempoolBytes)
+{
+    // Spam with random fees, a third of it in chains of unconfirmed txs,
+    // several times what the pool can hold
+    std::vector<CTxMemPoolEntry> entries;
+    entries.reserve(nTxs);
+    int64_t nTime = GetTime();
+    for (size_t i = 0; i < nTxs; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        if (i % 3 == 2)
+            mtx.vin[0].prevout = COutPoint(entries.back().GetTx().GetHash(), 0);
+        else
+            mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+        mtx.addOut(CTxOut(600, CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 3) << OP_EQUALVERIFY << OP_CHECKSIG));
+        CTransaction tx(mtx);
+        entries.push_back(CTxMemPoolEntry(tx, 1000 + GetRand(100000), nTime + i, 0, 1));
+    }
+
+    CTxMemPool pool(CFeeRate(1000));
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (const CTxMemPoolEntry& entry : entries) {
+        // As AcceptTxToMemoryPool does, rejecting what doesn't pay the rolling minimum fee
+        if (entry.GetFee() < pool.GetMinFee(nMaxMempoolBytes).GetFee(entry.GetTxSize()))
+            continue;
+        pool.addUnchecked(entry.GetTx().GetHash(), entry, false);
+        pool.Expire(nTime - DEFAULT_MEMPOOL_EXPIRY * 60 * 60, removedTxs, removedCerts);
+        pool.TrimToSize(nMaxMempoolBytes, removedTxs, removedCerts);
+        removedTxs.clear();
+    }
+    return timer_stop(tv_start);
+}
+
+std::vector<double> benchmark_mempool_revalidation(size_t nTxs)
+{
+    CCoinsView coinsDummy;
+    CCoinsViewCache view(&coinsDummy);
+    {
+        LOCK(cs_main);
+        view.SetBestBlock(chainActive.Tip()->GetBlockHash());
+    }
+
+    CTxMemPool pool(CFeeRate(0));
+    int64_t nTime = GetTime();
+    for (size_t i = 0; i < nTxs; i++) {
+        uint256 prevHash = GetRandHash();
+        {
+            CCoinsModifier coins = view.ModifyCoins(prevHash);
+            coins->nHeight = 1;
+            coins->vout.resize(1);
+            coins->vout[0] = CTxOut(1000, CScript() << OP_TRUE);
+        }
+
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout = COutPoint(prevHash, 0);
+        mtx.addOut(CTxOut(600, CScript() << OP_TRUE));
+        CTransaction tx(mtx);
+        pool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, 1000, nTime, 0, 1), false);
+    }
+
+    // The cleanup after a block without sidechain events, checking every entry as it used to...
+    std::vector<double> times;
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    pool.removeStaleTransactions(&view, removedTxs, removedCerts);
+    pool.removeStaleCertificates(&view, removedCerts);
+    times.push_back(timer_stop(tv_start));
+
+    // ...and only those depending on the sidechains the block touched
+    timer_start(tv_start);
+    pool.removeStaleTransactions(&view, GetSidechainsTouchedByBlock(CBlock(), CSidechainEvents()), removedTxs, removedCerts);
+    pool.removeStaleCertificates(&view, removedCerts);
+    times.push_back(timer_stop(tv_start));
+    assert(removedTxs.empty() && pool.sizeTx() == nTxs);
+    return times;
+}
+
 double benchmark_listunspent()
 {
     UniValue params(UniValue::VARR);
@@ -478,3 +791,398 @@ double benchmark_listunspent()
     auto unspent = listunspent(params, false);
     return timer_stop(tv_start);
 }
+
+double benchmark_getblock_json(int nHeight)
+{
+    // The verbose getblock output, written as the reply sent to the client
+    UniValue params(UniValue::VARR);
+    params.push_back(std::to_string(nHeight));
+    params.push_back(2);
+    UniValue result = getblock(params, false);
+    UniValue id(1);
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    std::string strReply = JSONRPCReply(result, NullUniValue, id);
+    return timer_stop(tv_start);
+}
+
+double benchmark_parse_hex_request(size_t nBytes)
+{
+    // A sendrawtransaction request carrying nBytes of hex
+    std::string strRequest = "{\"jsonrpc\":\"1.0\",\"id\":\"bench\",\"method\":\"sendrawtransaction\",\"params\":[\"";
+    std::vector<unsigned char> vch(nBytes / 2);
+    GetRandBytes(vch.data(), vch.size());
+    strRequest += HexStr(vch);
+    strRequest += "\"]}";
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    JSONRequest jreq;
+    UniValue valBatch;
+    bool fRead = jreq.read(strRequest, valBatch);
+    double duration = timer_stop(tv_start);
+
+    assert(fRead && jreq.params[0].get_str().size() == vch.size() * 2);
+    return duration;
+}
+
+std::vector<double> benchmark_sc_txs_commitment(size_t nTxs)
+{
+    // Forward transfers to a few sidechains, as a template refreshed with the
+    // same sidechain txs would carry
+    CBlock block;
+    for (size_t i = 0; i < nTxs; i++) {
+        CMutableTransaction mtx;
+        mtx.nVersion = SC_TX_VERSION;
+        uint256 scId;
+        *scId.begin() = i % 16 + 1;
+        mtx.vft_ccout.push_back(CTxForwardTransferOut(scId, CAmount(i + 1), GetRandHash(), uint160()));
+        block.vtx.push_back(CTransaction(mtx));
+    }
+    LOCK(cs_main);
+    CCoinsViewCache view(pcoinsTip);
+
+    // Building the tree from scratch as each template used to do
+    struct timeval tv_start;
+    timer_start(tv_start);
+    SidechainTxsCommitmentBuilder builder;
+    for (const CTransaction& tx : block.vtx)
+        builder.add(tx);
+    uint256 commitment = builder.getCommitment();
+    std::vector<double> times;
+    times.push_back(timer_stop(tv_start));
+
+    // First template with these txs fills the cache, the next ones hit it
+    for (int i = 0; i < 2; i++) {
+        timer_start(tv_start);
+        uint256 cached = block.BuildScTxsCommitment(view);
+        times.push_back(timer_stop(tv_start));
+        assert(cached == commitment);
+    }
+    return times;
+}
+
+// Heap allocations made by the current thread while fCountAllocations is set,
+// so the deserialization benches can tell the paths apart by more than time
+static thread_local bool fCountAllocations = false;
+static thread_local uint64_t nAllocations = 0;
+
+void* operator new(size_t nSize)
+{
+    if (fCountAllocations)
+        ++nAllocations;
+    if (void* p = std::malloc(nSize ? nSize : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+static void StartCountingAllocations()
+{
+    nAllocations = 0;
+    fCountAllocations = true;
+}
+
+static uint64_t StopCountingAllocations()
+{
+    fCountAllocations = false;
+    return nAllocations;
+}
+
+std::vector<double> benchmark_deserialize_block(int nHeight)
+{
+    CBlock block;
+    {
+        LOCK(cs_main);
+        assert(ReadBlockFromDisk(block, chainActive[nHeight]));
+    }
+    CDataStream ssTxs(SER_NETWORK, PROTOCOL_VERSION);
+    ssTxs << block.vtx;
+    LogPrint("bench", "%s: %u txs, %u bytes\n", __func__, block.vtx.size(), ssTxs.size());
+
+    std::vector<double> times;
+    struct timeval tv_start;
+
+    // Default constructing the txs and deserializing into them, as CBlock does
+    {
+        CDataStream ss(ssTxs);
+        std::vector<CTransaction> vtx;
+        StartCountingAllocations();
+        timer_start(tv_start);
+        ::Unserialize(ss, vtx, SER_NETWORK, PROTOCOL_VERSION);
+        times.push_back(timer_stop(tv_start));
+        LogPrint("bench", "%s: in place: %u allocations\n", __func__, StopCountingAllocations());
+        assert(vtx.size() == block.vtx.size() && vtx.back().GetHash() == block.vtx.back().GetHash());
+    }
+
+    // Building a CMutableTransaction from the stream and copying it in, as the
+    // deserializing constructor used to
+    {
+        CDataStream ss(ssTxs);
+        std::vector<CTransaction> vtx;
+        StartCountingAllocations();
+        timer_start(tv_start);
+        uint64_t nSize = ReadCompactSize(ss);
+        vtx.reserve(nSize);
+        while (vtx.size() < nSize) {
+            CMutableTransaction mtx(deserialize, ss);
+            vtx.emplace_back(static_cast<const CMutableTransaction&>(mtx));
+        }
+        times.push_back(timer_stop(tv_start));
+        LogPrint("bench", "%s: copied: %u allocations\n", __func__, StopCountingAllocations());
+        assert(vtx.size() == block.vtx.size() && vtx.back().GetHash() == block.vtx.back().GetHash());
+    }
+
+    // Building it and moving it in, as the deserializing constructor does now
+    {
+        CDataStream ss(ssTxs);
+        std::vector<CTransaction> vtx;
+        StartCountingAllocations();
+        timer_start(tv_start);
+        uint64_t nSize = ReadCompactSize(ss);
+        vtx.reserve(nSize);
+        while (vtx.size() < nSize)
+            vtx.emplace_back(deserialize, ss);
+        times.push_back(timer_stop(tv_start));
+        LogPrint("bench", "%s: moved: %u allocations\n", __func__, StopCountingAllocations());
+        assert(vtx.size() == block.vtx.size() && vtx.back().GetHash() == block.vtx.back().GetHash());
+    }
+    return times;
+}
+
+std::vector<double> benchmark_rpc_reads_under_load(int nReaders, int nBlocks)
+{
+    // Mines nBlocks on the regtest chain with no readers, then nBlocks more while
+    // nReaders threads call getblockcount, getblockhash and getblockheader through
+    // the RPC table, then keeps the readers running while cs_main is held nBlocks
+    // times for as long as connecting a block took alone
+    CReserveKey reservekey(pwalletMain);
+    unsigned int nExtraNonce = 0;
+    auto connectBlock = [&]() {
+        std::unique_ptr<CBlockTemplate> pblocktemplate(CreateNewBlockWithKey(reservekey));
+        if (!pblocktemplate.get())
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Wallet keypool empty");
+        CBlock *pblock = &pblocktemplate->block;
+        {
+            LOCK(cs_main);
+            IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
+        }
+        generateEquihash(*pblock);
+
+        int64_t nStart = GetTimeMicros();
+        CValidationState state;
+        if (!ProcessNewBlock(state, NULL, pblock, true, NULL))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "ProcessNewBlock, block not accepted");
+        return GetTimeMicros() - nStart;
+    };
+
+    std::vector<double> times;
+    int64_t nConnectAloneMicros = 0;
+    for (int nPhase = 0; nPhase < 3; nPhase++) {
+        std::atomic<bool> fDone(false);
+        std::atomic<uint64_t> nRequests(0);
+        std::vector<std::thread> readers;
+        for (int i = 0; nPhase > 0 && i < nReaders; i++) {
+            readers.emplace_back([&, i]() {
+                // Heights picked with a per-thread xorshift, insecure_rand is not thread-safe
+                uint32_t nRand = 2463534242u + i;
+                uint64_t nServed = 0;
+                while (!fDone) {
+                    nRand ^= nRand << 13;
+                    nRand ^= nRand >> 17;
+                    nRand ^= nRand << 5;
+                    UniValue params(UniValue::VARR);
+                    int nHeight = tableRPC.execute("getblockcount", params).get_int();
+                    params.push_back((int)(nRand % (nHeight + 1)));
+                    UniValue hash = tableRPC.execute("getblockhash", params);
+                    params.setArray();
+                    params.push_back(hash);
+                    tableRPC.execute("getblockheader", params);
+                    nServed += 3;
+                }
+                nRequests += nServed;
+            });
+        }
+
+        int64_t nConnectMicros = 0;
+        struct timeval tv_start;
+        timer_start(tv_start);
+        try {
+            for (int h = 0; h < nBlocks; h++) {
+                if (nPhase < 2) {
+                    nConnectMicros += connectBlock();
+                } else {
+                    LOCK(cs_main);
+                    std::this_thread::sleep_for(std::chrono::microseconds(nConnectAloneMicros / nBlocks));
+                }
+            }
+        } catch (...) {
+            fDone = true;
+            for (std::thread& reader : readers)
+                reader.join();
+            throw;
+        }
+        fDone = true;
+        for (std::thread& reader : readers)
+            reader.join();
+        double duration = timer_stop(tv_start);
+
+        if (nPhase == 0) {
+            nConnectAloneMicros = nConnectMicros;
+            times.push_back(nConnectMicros / 1000000.0 / nBlocks);
+            LogPrintf("%s: no readers, %.3f ms per block connected\n", __func__, nConnectMicros / 1000.0 / nBlocks);
+        } else if (nPhase == 1) {
+            // Average block connect latency and time per request of a reader, in seconds
+            times.push_back(nConnectMicros / 1000000.0 / nBlocks);
+            times.push_back(nRequests > 0 ? duration * nReaders / nRequests : duration);
+            LogPrintf("%s: connecting blocks, %d readers, %.0f requests/s, %.3f ms per block connected\n", __func__,
+                      nReaders, nRequests / duration, nConnectMicros / 1000.0 / nBlocks);
+        } else {
+            times.push_back(nRequests > 0 ? duration * nReaders / nRequests : duration);
+            LogPrintf("%s: cs_main held, %d readers, %.0f requests/s\n", __func__, nReaders, nRequests / duration);
+        }
+    }
+    return times;
+}
+
+std::vector<double> benchmark_block_download(int nPeers, int nBlocks)
+{
+    // Simulated initial block download of nBlocks from nPeers peers, first with the fixed number
+    // of blocks in flight per peer, then with windows sized from each peer's delivery rate and
+    // overdue blocks asked to faster peers. Peer 0 is a slow link; the others are fast but far
+    // away, so keeping them busy takes more blocks in flight than the fixed window allows.
+    // Returns the simulated seconds to download and connect all the blocks with each scheduler.
+    const int64_t nTick = 10000;
+    const int64_t nLatency = 300000;
+    const int nConnectPerTick = 5;
+
+    struct SimPeer {
+        int64_t nServiceTime;
+        int64_t nBusyUntil;
+        int64_t nStallingSince;
+        int nInFlight;
+        bool fConnected;
+        CBlockDownloadRate rate;
+    };
+
+    std::vector<double> times;
+    for (bool fAdaptive : {false, true}) {
+        std::vector<SimPeer> peers(nPeers);
+        for (int i = 0; i < nPeers; i++) {
+            peers[i].nServiceTime = i == 0 ? 3000000 : 4000 + 1000 * i;
+            peers[i].nBusyUntil = peers[i].nStallingSince = 0;
+            peers[i].nInFlight = 0;
+            peers[i].fConnected = true;
+        }
+
+        // Requested blocks arrive in the order each peer serves them
+        std::multimap<int64_t, std::pair<int, int> > deliveries;
+        std::vector<int> vOwner(nBlocks + 1, -1);
+        std::vector<int64_t> vRequestTime(nBlocks + 1, 0);
+        std::vector<bool> vHave(nBlocks + 1, false);
+        vHave[0] = true;
+        int nValidated = 0;
+        uint64_t nReassigned = 0;
+        int64_t nNow = 0;
+
+        auto request = [&](int p, int b) {
+            int64_t nStart = std::max(nNow + nLatency / 2, peers[p].nBusyUntil);
+            peers[p].nBusyUntil = nStart + peers[p].nServiceTime;
+            deliveries.insert(std::make_pair(peers[p].nBusyUntil + nLatency / 2, std::make_pair(p, b)));
+            vOwner[b] = p;
+            vRequestTime[b] = nNow;
+            peers[p].nInFlight++;
+        };
+
+        while (nValidated < nBlocks) {
+            while (!deliveries.empty() && deliveries.begin()->first <= nNow) {
+                int64_t nTime = deliveries.begin()->first;
+                int p = deliveries.begin()->second.first;
+                int b = deliveries.begin()->second.second;
+                deliveries.erase(deliveries.begin());
+                if (vOwner[b] != p)
+                    continue;  // asked to another peer meanwhile
+                vOwner[b] = -1;
+                vHave[b] = true;
+                peers[p].nInFlight--;
+                peers[p].nStallingSince = 0;
+                peers[p].rate.Delivered(vRequestTime[b], nTime);
+            }
+
+            for (int i = 0; i < nConnectPerTick && nValidated < nBlocks && vHave[nValidated + 1]; i++)
+                nValidated++;
+
+            int nCommon = nValidated;
+            while (nCommon < nBlocks && vHave[nCommon + 1])
+                nCommon++;
+            int nWindowEnd = nCommon + BLOCK_DOWNLOAD_WINDOW;
+            bool fValidationBound = false;
+            if (fAdaptive && nValidated + (int)MAX_BLOCKS_AHEAD_OF_VALIDATION < nWindowEnd) {
+                nWindowEnd = nValidated + MAX_BLOCKS_AHEAD_OF_VALIDATION;
+                fValidationBound = true;
+            }
+
+            bool fAnyConnected = false;
+            for (int p = 0; p < nPeers; p++) {
+                if (!peers[p].fConnected)
+                    continue;
+                fAnyConnected = true;
+                int nWindow = fAdaptive ? peers[p].rate.GetWindow() : DEFAULT_BLOCKS_IN_TRANSIT_PER_PEER;
+                if (peers[p].nInFlight >= nWindow)
+                    continue;
+                int nRequested = 0;
+                int nWaitingFor = -1;
+                for (int b = nCommon + 1; b <= std::min(nWindowEnd, nBlocks) && peers[p].nInFlight < nWindow; b++) {
+                    int nOwner = vOwner[b];
+                    if (vHave[b] || nOwner == p)
+                        continue;
+                    if (nOwner != -1 && fAdaptive && peers[nOwner].rate.IsOverdue(vRequestTime[b], nNow) &&
+                            peers[p].rate.IsExpectedWithin(nNow - vRequestTime[b])) {
+                        peers[nOwner].rate.Reassigned(vRequestTime[b], nNow);
+                        peers[nOwner].nInFlight--;
+                        nReassigned++;
+                        nOwner = -1;
+                    }
+                    if (nOwner == -1) {
+                        request(p, b);
+                        nRequested++;
+                    } else if (nWaitingFor == -1) {
+                        nWaitingFor = nOwner;
+                    }
+                }
+                // Nothing left to fetch within the window, held by the first block in flight
+                if (nRequested == 0 && peers[p].nInFlight == 0 && nWaitingFor != -1 && nWindowEnd < nBlocks &&
+                        !fValidationBound && peers[nWaitingFor].nStallingSince == 0)
+                    peers[nWaitingFor].nStallingSince = nNow;
+            }
+            if (!fAnyConnected)
+                break;
+
+            for (int p = 0; p < nPeers; p++) {
+                if (peers[p].fConnected && peers[p].nStallingSince &&
+                        peers[p].nStallingSince < nNow - 1000000 * (int64_t)BLOCK_STALLING_TIMEOUT) {
+                    peers[p].fConnected = false;
+                    peers[p].nInFlight = 0;
+                    for (int b = 1; b <= nBlocks; b++) {
+                        if (vOwner[b] == p)
+                            vOwner[b] = -1;
+                    }
+                }
+            }
+            nNow += nTick;
+        }
+
+        times.push_back(nNow / 1000000.0);
+        int nDisconnected = 0;
+        for (const SimPeer& peer : peers)
+            nDisconnected += !peer.fConnected;
+        LogPrintf("%s: %s windows, %d blocks from %d peers in %.1fs simulated, %u reassigned, %d peers disconnected\n",
+                  __func__, fAdaptive ? "adaptive" : "fixed", nValidated, nPeers, nNow / 1000000.0, nReassigned, nDisconnected);
+    }
+    return times;
+}
@@ -4,20 +4,33 @@
 #include <sys/time.h>
 #include <stdlib.h>
 
+class EhArenaSolver;
+
 extern double benchmark_sleep();
 extern double benchmark_parameter_loading();
 extern double benchmark_create_joinsplit();
 extern std::vector<double> benchmark_create_joinsplit_threaded(int nThreads);
-extern double benchmark_solve_equihash();
-extern std::vector<double> benchmark_solve_equihash_threaded(int nThreads);
+extern double benchmark_solve_equihash(EhArenaSolver* pArenaSolver = nullptr);
+extern std::vector<double> benchmark_solve_equihash_threaded(int nThreads, bool fArena = false);
 extern double benchmark_verify_joinsplit(const JSDescription &joinsplit);
 extern double benchmark_verify_equihash();
 extern double benchmark_large_tx();
+extern std::vector<double> benchmark_script_check_queue(int nMaxThreads, size_t nChecks);
 extern double benchmark_try_decrypt_notes(size_t nAddrs);
-extern double benchmark_increment_note_witnesses(size_t nTxs);
+extern double benchmark_increment_note_witnesses(size_t nTxs, int nThreads = 1);
 extern double benchmark_connectblock_slow();
 extern double benchmark_sendtoaddress(CAmount amount);
-extern double benchmark_loadwallet();
+extern double benchmark_loadwallet(size_t nSyntheticTxs = 0);
 extern double benchmark_listunspent();
+extern double benchmark_mempool_address_index(size_t nEntries);
+extern double benchmark_relay_transactions(size_t nTxs, int nPeers);
+extern double benchmark_mempool_spam(size_t nTxs, size_t nMaxMempoolBytes);
+extern std::vector<double> benchmark_mempool_revalidation(size_t nTxs);
+extern double benchmark_getblock_json(int nHeight);
+extern double benchmark_parse_hex_request(size_t nBytes);
+extern std::vector<double> benchmark_sc_txs_commitment(size_t nTxs);
+extern std::vector<double> benchmark_deserialize_block(int nHeight);
+extern std::vector<double> benchmark_rpc_reads_under_load(int nReaders, int nBlocks);
+extern std::vector<double> benchmark_block_download(int nPeers, int nBlocks);
 
 #endif
@@ -17,6 +17,7 @@
 #include <queue>
 #include "validationinterface.h"
 #include "main.h"
+#include "blockfilecache.h"
 #include "consensus/validation.h"
 #include <univalue.h>
 #include "uint256.h"
@@ -80,10 +81,12 @@ static std::string findFieldValue(const std::string& field, const UniValue& requ
 class WsNotificationInterface: public CValidationInterface
 {
 protected:
-    virtual void UpdatedBlockTip(const CBlockIndex *pindex) {
+    void UpdatedBlockTip(const CBlockIndex *pindex) override {
         ws_updatetip(pindex);
     };
 public:
+    std::string ValidationInterfaceName() const override { return "websocket"; }
+
     ~WsNotificationInterface() 
     {
         LogPrint("ws", "%s():%d - called this=%p\n", __func__, __LINE__, this);
@@ -1279,17 +1282,15 @@ public:
 
 static int getblock(const CBlockIndex *pindex, std::string& strHex)
 {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    CBlockFileBytes bytes;
     {
         LOCK(cs_main);
-        CBlock block;
-        if (!ReadBlockFromDisk(block, pindex)) {
+        if (!ReadRawBlockFromDisk(bytes, pindex)) {
             LogPrint("ws", "%s():%d - error: could not read block from disk\n", __func__, __LINE__);
             return WsHandler::READ_ERROR;
         }
-        ss << block;
-        strHex = HexStr(ss.begin(), ss.end());
     }
+    strHex = HexStr(bytes.begin(), bytes.end());
     return WsHandler::OK;
 }
 
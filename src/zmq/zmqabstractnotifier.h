@@ -6,6 +6,7 @@
 #define BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
 
 #include "zmqconfig.h"
+#include "notificationstream.h"
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
@@ -34,6 +35,7 @@ public:
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyEvent(const CNotificationEventRef &event);
 
 protected:
     void *psocket;
@@ -10,6 +10,10 @@
 #include "streams.h"
 #include "util.h"
 
+#include <boost/bind/bind.hpp>
+
+using namespace boost::placeholders;
+
 void zmqError(const char *str)
 {
     LogPrint("zmq", "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
@@ -39,6 +43,8 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubevents"] = CZMQAbstractNotifier::Create<CZMQPublishEventNotifier>;
+    factories["replayevents"] = CZMQAbstractNotifier::Create<CZMQReplayEventNotifier>;
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
     {
@@ -103,6 +109,11 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    if (pnotificationStream)
+    {
+        pnotificationStream->EventPublished.connect(boost::bind(&CZMQNotificationInterface::NotifyEvent, this, _1));
+    }
+
     return true;
 }
 
@@ -112,6 +123,10 @@ void CZMQNotificationInterface::Shutdown()
     LogPrint("zmq", "zmq: Shutdown notification interface\n");
     if (pcontext)
     {
+        if (pnotificationStream)
+        {
+            pnotificationStream->EventPublished.disconnect(boost::bind(&CZMQNotificationInterface::NotifyEvent, this, _1));
+        }
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
         {
             CZMQAbstractNotifier *notifier = *i;
@@ -157,3 +172,18 @@ void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CB
         }
     }
 }
+
+// Called by the notification stream, in sequence order. A notifier failing to
+// send an event is kept: its subscribers see the gap in the sequence numbers
+// and can fetch the missing events from the replay notifier.
+void CZMQNotificationInterface::NotifyEvent(const CNotificationEventRef &event)
+{
+    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); ++i)
+    {
+        CZMQAbstractNotifier *notifier = *i;
+        if (!notifier->NotifyEvent(event))
+        {
+            LogPrint("zmq", "zmq: Notifier %s failed to send event %d\n", notifier->GetType(), event->nSequence);
+        }
+    }
+}
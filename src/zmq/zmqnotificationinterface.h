@@ -6,6 +6,7 @@
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
 #include "validationinterface.h"
+#include "notificationstream.h"
 #include <string>
 #include <map>
 
@@ -19,13 +20,18 @@ public:
 
     static CZMQNotificationInterface* CreateWithArguments(const std::map<std::string, std::string> &args);
 
+    std::string ValidationInterfaceName() const override { return "zmq"; }
+
 protected:
     bool Initialize();
     void Shutdown();
 
     // CValidationInterface
-    void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
-    void UpdatedBlockTip(const CBlockIndex *pindex);
+    void SyncTransaction(const CTransaction &tx, const CBlock *pblock) override;
+    void UpdatedBlockTip(const CBlockIndex *pindex) override;
+
+    // CNotificationStream
+    void NotifyEvent(const CNotificationEventRef &event);
 
 private:
     CZMQNotificationInterface();
@@ -13,6 +13,9 @@ static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
 
+//! Time the replay thread waits for a request before checking for shutdown
+static const long REPLAY_POLL_TIMEOUT_MS = 100;
+
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
 {
@@ -53,6 +56,69 @@ static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
     return 0;
 }
 
+// Internal function to send a single message part
+static int zmq_send_part(void *sock, const void* data, size_t size, int flags)
+{
+    zmq_msg_t msg;
+
+    int rc = zmq_msg_init_size(&msg, size);
+    if (rc != 0)
+    {
+        zmqError("Unable to initialize ZMQ msg");
+        return -1;
+    }
+
+    memcpy(zmq_msg_data(&msg), data, size);
+
+    rc = zmq_msg_send(&msg, sock, flags);
+    if (rc == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        zmq_msg_close(&msg);
+        return -1;
+    }
+
+    zmq_msg_close(&msg);
+    return 0;
+}
+
+static void zmq_release_event(void * /*data*/, void *hint)
+{
+    delete static_cast<CNotificationEventRef*>(hint);
+}
+
+// Internal function to send the parts of an event. The payload is not copied,
+// the message keeps a reference to the event until ZMQ is done with it.
+static int zmq_send_event(void *sock, const CNotificationEventRef &event, int flags)
+{
+    if (zmq_send_part(sock, event->topic.data(), event->topic.size(), ZMQ_SNDMORE) == -1)
+        return -1;
+
+    zmq_msg_t msg;
+    CNotificationEventRef *hint = new CNotificationEventRef(event);
+    int rc = zmq_msg_init_data(&msg, (void*)event->payload.data(), event->payload.size(), zmq_release_event, hint);
+    if (rc != 0)
+    {
+        zmqError("Unable to initialize ZMQ msg");
+        delete hint;
+        return -1;
+    }
+
+    rc = zmq_msg_send(&msg, sock, ZMQ_SNDMORE);
+    if (rc == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        zmq_msg_close(&msg);
+        return -1;
+    }
+
+    zmq_msg_close(&msg);
+
+    unsigned char msgseq[sizeof(uint64_t)];
+    WriteLE64(&msgseq[0], event->nSequence);
+    return zmq_send_part(sock, msgseq, sizeof(msgseq), flags);
+}
+
 bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
 {
     assert(!psocket);
@@ -139,6 +205,15 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
     return true;
 }
 
+bool CZMQAbstractPublishNotifier::SendEvent(const CNotificationEventRef &event)
+{
+    assert(psocket);
+
+    /* the sequence number is the one of the stream, not of this notifier,
+       so that the subscribers can tell which events they missed */
+    return zmq_send_event(psocket, event, 0) != -1;
+}
+
 bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     uint256 hash = pindex->GetBlockHash();
@@ -187,3 +262,137 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishEventNotifier::NotifyEvent(const CNotificationEventRef &event)
+{
+    LogPrint("zmq", "zmq: Publish event %s %d\n", event->topic, event->nSequence);
+    return SendEvent(event);
+}
+
+bool CZMQReplayEventNotifier::Initialize(void *pcontext)
+{
+    assert(!psocket);
+
+    if (!pnotificationStream)
+    {
+        LogPrint("zmq", "zmq: Notification stream not enabled\n");
+        return false;
+    }
+
+    psocket = zmq_socket(pcontext, ZMQ_REP);
+    if (!psocket)
+    {
+        zmqError("Failed to create socket");
+        return false;
+    }
+
+    int rc = zmq_bind(psocket, address.c_str());
+    if (rc!=0)
+    {
+        zmqError("Failed to bind address");
+        zmq_close(psocket);
+        psocket = 0;
+        return false;
+    }
+
+    thread = std::thread(&CZMQReplayEventNotifier::ThreadReplay, this);
+    return true;
+}
+
+void CZMQReplayEventNotifier::Shutdown()
+{
+    assert(psocket);
+
+    fStop = true;
+    if (thread.joinable())
+        thread.join();
+
+    LogPrint("zmq", "Close socket at address %s\n", address);
+    int linger = 0;
+    zmq_setsockopt(psocket, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_close(psocket);
+
+    psocket = 0;
+}
+
+// The REP socket is only used by this thread once it is started. Failures are
+// logged and the thread keeps serving until Shutdown sets fStop.
+void CZMQReplayEventNotifier::ThreadReplay()
+{
+    RenameThread("zen-zmqreplay");
+
+    while (!fStop)
+    {
+        zmq_pollitem_t item = { psocket, 0, ZMQ_POLLIN, 0 };
+        int rc = zmq_poll(&item, 1, REPLAY_POLL_TIMEOUT_MS);
+        if (rc == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            zmqError("Unable to poll ZMQ socket");
+            MilliSleep(REPLAY_POLL_TIMEOUT_MS);
+            continue;
+        }
+        if (rc == 0)
+            continue;
+
+        zmq_msg_t request;
+        zmq_msg_init(&request);
+        if (zmq_msg_recv(&request, psocket, 0) == -1)
+        {
+            int nErr = errno;
+            zmq_msg_close(&request);
+            if (nErr == EINTR || nErr == EAGAIN)
+                continue;
+            zmqError("Unable to receive ZMQ msg");
+            // the socket still waits for the end of a reply
+            if (nErr == EFSM)
+                zmq_send_part(psocket, "", 0, 0);
+            continue;
+        }
+
+        // only the first part of the request is meaningful
+        int more = zmq_msg_more(&request);
+        while (more)
+        {
+            zmq_msg_t part;
+            zmq_msg_init(&part);
+            more = zmq_msg_recv(&part, psocket, 0) != -1 && zmq_msg_more(&part);
+            zmq_msg_close(&part);
+        }
+
+        bool fSent = SendReply(zmq_msg_data(&request), zmq_msg_size(&request));
+        zmq_msg_close(&request);
+        if (!fSent)
+        {
+            zmqError("Unable to send ZMQ replay");
+            // end the reply, possibly half sent, so the socket takes the next request
+            zmq_send_part(psocket, "", 0, 0);
+        }
+    }
+}
+
+bool CZMQReplayEventNotifier::SendReply(const void *request, size_t size)
+{
+    // a malformed request gets an empty reply
+    if (size != sizeof(uint64_t))
+        return zmq_send_part(psocket, "", 0, 0) != -1;
+
+    uint64_t nSequence = ReadLE64((const unsigned char*)request);
+    std::vector<CNotificationEventRef> events;
+    uint64_t nFirst = pnotificationStream->GetEventsSince(nSequence, MAX_NOTIFICATION_REPLAY_EVENTS, events);
+    LogPrint("zmq", "zmq: Replay %d events from %d (oldest available %d)\n", events.size(), nSequence, nFirst);
+
+    unsigned char first[sizeof(uint64_t)];
+    WriteLE64(&first[0], nFirst);
+    if (zmq_send_part(psocket, first, sizeof(first), events.empty() ? 0 : ZMQ_SNDMORE) == -1)
+        return false;
+
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        if (zmq_send_event(psocket, events[i], i + 1 < events.size() ? ZMQ_SNDMORE : 0) == -1)
+            return false;
+    }
+
+    return true;
+}
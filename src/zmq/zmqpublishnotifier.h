@@ -7,6 +7,9 @@
 
 #include "zmqabstractnotifier.h"
 
+#include <atomic>
+#include <thread>
+
 class CBlockIndex;
 
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
@@ -24,6 +27,14 @@ public:
     */
     bool SendMessage(const char *command, const void* data, size_t size);
 
+    /* send zmq multipart message
+       parts:
+          * event topic
+          * event payload, shared with the notification stream
+          * LE 8byte stream sequence number
+    */
+    bool SendEvent(const CNotificationEventRef &event);
+
     bool Initialize(void *pcontext);
     void Shutdown();
 };
@@ -52,4 +63,33 @@ public:
     bool NotifyTransaction(const CTransaction &transaction);
 };
 
+class CZMQPublishEventNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyEvent(const CNotificationEventRef &event);
+};
+
+/**
+ * Answers the requests of the subscribers of the event stream that missed
+ * some events. A request is the LE 8byte sequence number of the first event
+ * wanted, the reply starts with the LE 8byte sequence number of the oldest
+ * event still available, followed by the parts of up to
+ * MAX_NOTIFICATION_REPLAY_EVENTS events as sent by CZMQPublishEventNotifier.
+ */
+class CZMQReplayEventNotifier : public CZMQAbstractNotifier
+{
+private:
+    std::thread thread;
+    std::atomic<bool> fStop;
+
+    void ThreadReplay();
+    bool SendReply(const void *request, size_t size);
+
+public:
+    CZMQReplayEventNotifier() : fStop(false) { }
+
+    bool Initialize(void *pcontext);
+    void Shutdown();
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H